@@ -30,7 +30,7 @@
 #ifndef _GZIP_ENCODING_H_
 #define _GZIP_ENCODING_H_
 #include "net/http_client_base.h"
-#include "zlib/zlib.h"
+#include <zlib.h>
 //#include "http.h"
 
 
@@ -56,15 +56,14 @@ namespace net_utils
 		{
 			memset(&m_zstream_in, 0, sizeof(m_zstream_in));
 			memset(&m_zstream_out, 0, sizeof(m_zstream_out));
-			int ret = 0;
 			if(is_deflate_mode)
 			{
-				ret = inflateInit(&m_zstream_in);	
-				ret = deflateInit(&m_zstream_out, Z_DEFAULT_COMPRESSION);
+				inflateInit(&m_zstream_in);	
+				deflateInit(&m_zstream_out, Z_DEFAULT_COMPRESSION);
 			}else
 			{
-				ret = inflateInit2(&m_zstream_in, 0x1F);
-				ret = deflateInit2(&m_zstream_out, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 0x1F, 8, Z_DEFAULT_STRATEGY);
+				inflateInit2(&m_zstream_in, 0x1F);
+				deflateInit2(&m_zstream_out, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 0x1F, 8, Z_DEFAULT_STRATEGY);
 			}	
 		}
 		/*! \brief
@@ -103,7 +102,9 @@ namespace net_utils
 			//because of the case where if after unpacking the data will exceed the awaited size, we will not halt with error
 			bool continue_unpacking = true;
 			bool first_step = true;
-			while(m_pre_decode.size() && continue_unpacking)
+			bool out_full = false;
+			//a full output buffer may leave unpacked data inside zlib even when all input is consumed
+			while((m_pre_decode.size() || out_full) && continue_unpacking)
 			{
 
 				//fill buffers
@@ -114,6 +115,7 @@ namespace net_utils
 
 				int flag = Z_SYNC_FLUSH;
 				int ret = inflate(&m_zstream_in, flag);
+				out_full = !m_zstream_in.avail_out;
 				CHECK_AND_ASSERT_MES(ret>=0 || m_zstream_in.avail_out ||m_is_deflate_mode, false, "content_encoding_gzip::update_in() Failed to inflate. err = " << ret);
 
 				if(Z_STREAM_END == ret)
@@ -169,9 +171,7 @@ namespace net_utils
 			}
 
 			//Process these data if required
-			bool res = true;
-
-			res = m_powner_filter->handle_target_data(decode_summary_buff);
+			m_powner_filter->handle_target_data(decode_summary_buff);
 
 			return true;
 
@@ -219,6 +219,31 @@ namespace net_utils
 		*/
 		bool		m_is_first_update_in;
 	};
+
+	/*! \brief
+	*  Function gzip_compress : Packs the whole buffer into a gzip stream, level is zlib compression level
+	*
+	*/
+	inline
+	bool gzip_compress(const std::string& source, std::string& target, int level)
+	{
+		z_stream zstream;
+		memset(&zstream, 0, sizeof(zstream));
+		int ret = deflateInit2(&zstream, level, Z_DEFLATED, 0x1F, 8, Z_DEFAULT_STRATEGY);
+		CHECK_AND_ASSERT_MES(Z_OK == ret, false, "gzip_compress() Failed to init deflate. err = " << ret);
+
+		//one pass, the output buffer is big enough for incompressible data too
+		target.resize(deflateBound(&zstream, (uLong)source.size()));
+		zstream.next_in = (Bytef*)source.data();
+		zstream.avail_in = (uInt)source.size();
+		zstream.next_out = (Bytef*)&target[0];
+		zstream.avail_out = (uInt)target.size();
+		ret = deflate(&zstream, Z_FINISH);
+		target.resize(target.size() - zstream.avail_out);
+		deflateEnd(&zstream);
+		CHECK_AND_ASSERT_MES(Z_STREAM_END == ret, false, "gzip_compress() Failed to deflate. err = " << ret);
+		return true;
+	}
 }
 }
 
@@ -0,0 +1,139 @@
+// Copyright (c) 2006-2013, Andrey N. Sabelnikov, www.sabelnikov.net
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+// * Neither the name of the Andrey N. Sabelnikov nor the
+// names of its contributors may be used to endorse or promote products
+// derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER  BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace epee
+{
+  /************************************************************************/
+  /* Bounded queue for any number of producers and consumers, no locks.  */
+  /* Every cell keeps a sequence number telling whether it waits for a   */
+  /* producer or a consumer of the current lap (D. Vyukov's algorithm). */
+  /************************************************************************/
+  template<class t_value>
+  class lockfree_ring_buffer
+  {
+  public:
+    //capacity is rounded up to a power of two
+    explicit lockfree_ring_buffer(size_t capacity): m_enqueue_pos(0), m_dequeue_pos(0)
+    {
+      size_t size = 2;
+      while(size < capacity)
+        size <<= 1;
+      m_mask = size - 1;
+      m_cells.reset(new cell[size]);
+      for(size_t i = 0; i != size; i++)
+        m_cells[i].m_sequence.store(i, std::memory_order_relaxed);
+    }
+
+    //on failure (queue is full) the value is left untouched
+    template<class t_arg>
+    bool try_push(t_arg&& v)
+    {
+      cell* pcell;
+      size_t pos = m_enqueue_pos.load(std::memory_order_relaxed);
+      for(;;)
+      {
+        pcell = &m_cells[pos & m_mask];
+        size_t seq = pcell->m_sequence.load(std::memory_order_acquire);
+        intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+        if(dif == 0)
+        {
+          if(m_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            break;
+        }
+        else if(dif < 0)
+          return false;
+        else
+          pos = m_enqueue_pos.load(std::memory_order_relaxed);
+      }
+      pcell->m_value = std::forward<t_arg>(v);
+      pcell->m_sequence.store(pos + 1, std::memory_order_release);
+      return true;
+    }
+
+    bool try_pop(t_value& v)
+    {
+      cell* pcell;
+      size_t pos = m_dequeue_pos.load(std::memory_order_relaxed);
+      for(;;)
+      {
+        pcell = &m_cells[pos & m_mask];
+        size_t seq = pcell->m_sequence.load(std::memory_order_acquire);
+        intptr_t dif = (intptr_t)seq - (intptr_t)(pos + 1);
+        if(dif == 0)
+        {
+          if(m_dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            break;
+        }
+        else if(dif < 0)
+          return false;
+        else
+          pos = m_dequeue_pos.load(std::memory_order_relaxed);
+      }
+      v = std::move(pcell->m_value);
+      pcell->m_sequence.store(pos + m_mask + 1, std::memory_order_release);
+      return true;
+    }
+
+    size_t capacity() const { return m_mask + 1; }
+
+    //exact only while nobody pushes or pops
+    size_t size_approx() const
+    {
+      size_t dequeue_pos = m_dequeue_pos.load(std::memory_order_relaxed);
+      size_t enqueue_pos = m_enqueue_pos.load(std::memory_order_relaxed);
+      return enqueue_pos > dequeue_pos ? enqueue_pos - dequeue_pos : 0;
+    }
+
+    bool empty_approx() const { return !size_approx(); }
+
+  private:
+    lockfree_ring_buffer(const lockfree_ring_buffer&);
+    lockfree_ring_buffer& operator=(const lockfree_ring_buffer&);
+
+    struct cell
+    {
+      std::atomic<size_t> m_sequence;
+      t_value m_value;
+    };
+
+    //producers and consumers hammer different counters, keep them on different cache lines
+    std::unique_ptr<cell[]> m_cells;
+    size_t m_mask;
+    char m_pad1[64];
+    std::atomic<size_t> m_enqueue_pos;
+    char m_pad2[64];
+    std::atomic<size_t> m_dequeue_pos;
+    char m_pad3[64];
+  };
+}
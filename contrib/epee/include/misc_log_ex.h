@@ -38,7 +38,10 @@
 #include <algorithm>
 #include <list>
 #include <map>
+#include <memory>
 #include <time.h>
+#include <stdio.h>
+#include <string.h>
 #include <boost/cstdint.hpp>
 #include <boost/thread.hpp>
 #include <boost/filesystem.hpp>
@@ -56,6 +59,7 @@
 #include "misc_os_dependent.h"
 
 #include "syncobj.h"
+#include "lockfree_ring_buffer.h"
 
 
 #define LOG_LEVEL_SILENT     -1
@@ -622,9 +626,8 @@ namespace log_space
 
     bool do_log_message(const std::string& rlog_mes, int log_level, int color, const char* plog_name = NULL)
     {
-      std::string str_mess = rlog_mes;
-      size_t str_len = str_mess.size();
-      const char* pstr = str_mess.c_str();
+      size_t str_len = rlog_mes.size();
+      const char* pstr = rlog_mes.c_str();
       for(streams_container::iterator it = m_log_streams.begin(); it!=m_log_streams.end();it++)
         if(it->second >= log_level)
           it->first->out_buffer(pstr, (int)str_len, log_level, color, plog_name);
@@ -737,12 +740,98 @@ namespace log_space
 
 
 
+  /************************************************************************/
+  /* Message waiting in the queue of the asynchronous writer             */
+  /************************************************************************/
+  struct log_record
+  {
+    std::string m_message;
+    int m_log_level;
+    int m_color;
+    const char* m_plog_name;
+
+    log_record(): m_log_level(LOG_LEVEL_0), m_color(console_color_default), m_plog_name(NULL)
+    {}
+    log_record(std::string&& message, int log_level, int color, const char* plog_name):
+      m_message(std::move(message)), m_log_level(log_level), m_color(color), m_plog_name(plog_name)
+    {}
+  };
+
+  /************************************************************************/
+  /* Formatting buffer reused by the thread. A message formatted while   */
+  /* another one is (a logging call in a logged expression) takes its own */
+  /************************************************************************/
+  class log_message_stream
+  {
+  public:
+    log_message_stream(): m_pool(get_pool())
+    {
+      if(m_pool.m_count)
+        m_pstream = m_pool.m_streams[--m_pool.m_count];
+      else
+        m_pstream = new std::ostringstream();
+    }
+    ~log_message_stream()
+    {
+      if(m_pool.m_count == max_pooled_streams || m_pool.m_destroyed)
+      {
+        delete m_pstream;
+        return;
+      }
+      //keep the buffer, forget what the message did to the formatting
+      m_pstream->str(std::string());
+      m_pstream->clear();
+      m_pstream->flags(std::ios_base::skipws | std::ios_base::dec);
+      m_pstream->precision(6);
+      m_pstream->width(0);
+      m_pstream->fill(' ');
+      m_pool.m_streams[m_pool.m_count++] = m_pstream;
+    }
+
+    std::ostream& stream(){return *m_pstream;}
+    std::string str() const {return m_pstream->str();}
+
+  private:
+    log_message_stream(const log_message_stream&);
+    log_message_stream& operator=(const log_message_stream&);
+
+    static const size_t max_pooled_streams = 4;
+
+    //plain fields only: logging from destructors running after the pool's one still works, unpooled
+    struct stream_pool
+    {
+      std::ostringstream* m_streams[max_pooled_streams];
+      size_t m_count;
+      bool m_destroyed;
+
+      stream_pool(): m_count(0), m_destroyed(false)
+      {}
+      ~stream_pool()
+      {
+        while(m_count)
+          delete m_streams[--m_count];
+        m_destroyed = true;
+      }
+    };
+
+    static stream_pool& get_pool()
+    {
+      static thread_local stream_pool pool;
+      return pool;
+    }
+
+    stream_pool& m_pool;
+    std::ostringstream* m_pstream;
+  };
+
+
     class logger
   {
   public:
     friend class log_singletone;
 
-    logger()
+    logger(): m_async(false), m_async_producers(0), m_async_stop(false), m_async_writer_idle(false),
+      m_async_dropped(0), m_async_dropped_reported(0)
     {
       CRITICAL_REGION_BEGIN(m_critical_sec);
       init();
@@ -750,6 +839,7 @@ namespace log_space
     }
     ~logger()
     {
+      stop_async();
     }
 
     bool set_max_logfile_size(uint64_t max_size)
@@ -770,23 +860,90 @@ namespace log_space
 
     bool take_away_journal(std::list<std::string>& journal)
     {
-      CRITICAL_REGION_BEGIN(m_critical_sec);
+      CRITICAL_REGION_BEGIN(m_journal_critical_sec);
       m_journal.swap(journal);
       CRITICAL_REGION_END();
       return true;
     }
 
-    bool do_log_message(const std::string& rlog_mes, int log_level, int color, bool add_to_journal = false, const char* plog_name = NULL)
+    bool do_log_message(std::string rlog_mes, int log_level, int color, bool add_to_journal = false, const char* plog_name = NULL)
     {
-      CRITICAL_REGION_BEGIN(m_critical_sec);
-      m_log_target.do_log_message(rlog_mes, log_level, color, plog_name);
       if(add_to_journal)
+      {
+        CRITICAL_REGION_LOCAL(m_journal_critical_sec);
         m_journal.push_back(rlog_mes);
+      }
 
+      m_async_producers.fetch_add(1);
+      if(m_async.load())
+      {
+        log_record rec(std::move(rlog_mes), log_level, color, plog_name);
+        bool pushed = m_async_queue->try_push(std::move(rec));
+        //queue is full: chatter is dropped, errors and level 0 messages wait for room
+        while(!pushed && log_level <= LOG_LEVEL_0)
+        {
+          wake_async_writer();
+          boost::this_thread::yield();
+          pushed = m_async_queue->try_push(std::move(rec));
+        }
+        m_async_producers.fetch_sub(1);
+        if(!pushed)
+        {
+          m_async_dropped.fetch_add(1, std::memory_order_relaxed);
+          return false;
+        }
+        wake_async_writer();
+        return true;
+      }
+      m_async_producers.fetch_sub(1);
+
+      CRITICAL_REGION_BEGIN(m_critical_sec);
+      m_log_target.do_log_message(rlog_mes, log_level, color, plog_name);
       return true;
       CRITICAL_REGION_END();
     }
 
+    //hands the writing to streams over to a background thread, up to max_queued messages wait for it
+    bool start_async(size_t max_queued)
+    {
+      CRITICAL_REGION_LOCAL(m_async_critical_sec);
+      if(m_async.load())
+        return true;
+      m_async_queue.reset(new lockfree_ring_buffer<log_record>(max_queued));
+      m_async_stop = false;
+      m_async_writer = boost::thread([this](){ async_writer_loop(); });
+      m_async.store(true);
+      return true;
+    }
+
+    //writes out everything queued so far and goes back to writing from the calling thread
+    bool stop_async()
+    {
+      CRITICAL_REGION_LOCAL(m_async_critical_sec);
+      if(!m_async.load())
+        return true;
+      m_async.store(false);
+      while(m_async_producers.load())
+        boost::this_thread::yield();
+      {
+        boost::lock_guard<boost::mutex> lock(m_async_lock);
+        m_async_stop = true;
+        m_async_cv.notify_one();
+      }
+      m_async_writer.join();
+      return true;
+    }
+
+    bool is_async()
+    {
+      return m_async.load(std::memory_order_relaxed);
+    }
+
+    uint64_t get_dropped_count()
+    {
+      return m_async_dropped.load(std::memory_order_relaxed);
+    }
+
     bool add_logger( int type, const char* pdefault_file_name, const char* pdefault_log_folder , int log_level_limit = LOG_LEVEL_4)
     {
       CRITICAL_REGION_BEGIN(m_critical_sec);
@@ -808,15 +965,6 @@ namespace log_space
     }
 
 
-    bool set_thread_prefix(const std::string& prefix)
-    {
-      CRITICAL_REGION_BEGIN(m_critical_sec);
-      m_thr_prefix_strings[misc_utils::get_thread_string_id()] = prefix;
-      CRITICAL_REGION_END();
-      return true;
-    }
-
-
     std::string get_default_log_file()
     {
       return m_default_log_file;
@@ -866,14 +1014,91 @@ namespace log_space
       return true;
     }
 
+    void wake_async_writer()
+    {
+      //pairs with the fence in async_writer_loop(): either the writer sees the message or we see it idle
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if(!m_async_writer_idle.load(std::memory_order_relaxed))
+        return;
+      boost::lock_guard<boost::mutex> lock(m_async_lock);
+      m_async_cv.notify_one();
+    }
+
+    void async_writer_loop()
+    {
+      for(;;)
+      {
+        if(write_async_batch())
+          continue;
+        boost::unique_lock<boost::mutex> lock(m_async_lock);
+        if(m_async_stop)
+          break;
+        m_async_writer_idle.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if(m_async_queue->empty_approx())
+          m_async_cv.wait_for(lock, boost::chrono::milliseconds(200));
+        m_async_writer_idle.store(false, std::memory_order_relaxed);
+      }
+      while(write_async_batch());
+    }
+
+    //writes out what is queued, neighbour messages of the same kind go to the streams as one buffer
+    size_t write_async_batch()
+    {
+      const size_t max_batch = 256;
+      CRITICAL_REGION_LOCAL(m_critical_sec);
+
+      uint64_t dropped = m_async_dropped.load(std::memory_order_relaxed);
+      if(dropped != m_async_dropped_reported)
+      {
+        std::stringstream ss;
+        ss << get_time_string() << " " << dropped - m_async_dropped_reported << " log messages dropped, log queue is full" << std::endl;
+        m_log_target.do_log_message(ss.str(), LOG_LEVEL_0, console_color_yellow);
+        m_async_dropped_reported = dropped;
+      }
+
+      size_t count = 0;
+      log_record rec;
+      log_record batch;
+      while(count < max_batch && m_async_queue->try_pop(rec))
+      {
+        if(!batch.m_message.empty() &&
+          (rec.m_log_level != batch.m_log_level || rec.m_color != batch.m_color || rec.m_plog_name != batch.m_plog_name))
+        {
+          m_log_target.do_log_message(batch.m_message, batch.m_log_level, batch.m_color, batch.m_plog_name);
+          batch.m_message.clear();
+        }
+        batch.m_message += rec.m_message;
+        batch.m_log_level = rec.m_log_level;
+        batch.m_color = rec.m_color;
+        batch.m_plog_name = rec.m_plog_name;
+        ++count;
+      }
+      if(!batch.m_message.empty())
+        m_log_target.do_log_message(batch.m_message, batch.m_log_level, batch.m_color, batch.m_plog_name);
+      return count;
+    }
+
     log_stream_splitter m_log_target;
 
     std::string m_default_log_folder;
     std::string m_default_log_file;
     std::string m_process_name;
-    std::map<std::string, std::string> m_thr_prefix_strings;
     std::list<std::string> m_journal;
     critical_section m_critical_sec;
+    critical_section m_journal_critical_sec;
+
+    critical_section m_async_critical_sec;
+    std::unique_ptr<lockfree_ring_buffer<log_record> > m_async_queue;
+    std::atomic<bool> m_async;
+    std::atomic<uint64_t> m_async_producers;
+    boost::thread m_async_writer;
+    boost::mutex m_async_lock;
+    boost::condition_variable m_async_cv;
+    bool m_async_stop;
+    std::atomic<bool> m_async_writer_idle;
+    std::atomic<uint64_t> m_async_dropped;
+    uint64_t m_async_dropped_reported;
   };
   /************************************************************************/
   /*                                                                      */
@@ -895,12 +1120,12 @@ namespace log_space
     }
 
 
-    static bool do_log_message(const std::string& rlog_mes, int log_level, int color, bool keep_in_journal, const char* plog_name = NULL)
+    static bool do_log_message(std::string rlog_mes, int log_level, int color, bool keep_in_journal, const char* plog_name = NULL)
     {
       logger* plogger = get_or_create_instance();
       bool res = false;
       if(plogger)
-        res = plogger->do_log_message(rlog_mes, log_level, color, keep_in_journal, plog_name);
+        res = plogger->do_log_message(std::move(rlog_mes), log_level, color, keep_in_journal, plog_name);
       else
       { //globally uninitialized, create new logger for each call of do_log_message() and then delete it
         plogger = new logger();
@@ -922,6 +1147,22 @@ namespace log_space
       return res;
     }
 
+    //enable: messages are queued and written by a background thread, when more than max_queued
+    //are waiting the ones above LOG_LEVEL_0 are dropped; disable: writes out the queue first
+    static bool set_async_mode(bool enable, size_t max_queued = 16384)
+    {
+      logger* plogger = get_or_create_instance();
+      if(!plogger) return false;
+      return enable ? plogger->start_async(max_queued) : plogger->stop_async();
+    }
+
+    static uint64_t get_dropped_messages_count()
+    {
+      logger* plogger = get_or_create_instance();
+      if(!plogger) return 0;
+      return plogger->get_dropped_count();
+    }
+
     static bool set_max_logfile_size(uint64_t file_size)
     {
       logger* plogger = get_or_create_instance();
@@ -1084,26 +1325,19 @@ POP_WARNINGS
 #endif
 
 
-      logger* plogger = get_or_create_instance();
-      if(!plogger) return false;
-      return plogger->set_thread_prefix(prefix);
+      char* pthread_prefix = get_thread_log_prefix();
+      size_t len = (std::min)(prefix.size(), (size_t)max_thread_prefix_size - 1);
+      memcpy(pthread_prefix, prefix.data(), len);
+      pthread_prefix[len] = 0;
+      return true;
     }
 
 
-    static std::string get_prefix_entry()
+    static void put_prefix_entry(std::ostream& str_prefix)
     {
-      std::stringstream str_prefix;
       //write time entry
       if ( get_set_time_level() <= get_set_log_detalisation_level() )
-        str_prefix << get_day_time_string() << " ";
-
-      //write process info
-      logger* plogger = get_or_create_instance();
-      //bool res = false;
-      if(!plogger)
-      { //globally uninitialized, create new logger for each call of get_prefix_entry() and then delete it
-        plogger = new logger();
-      }
+        put_day_time(str_prefix);
 
       //if ( get_set_need_proc_name() && get_set_process_level() <= get_set_log_detalisation_level()  )
       //    str_prefix << "[" << plogger->m_process_name << " (id=" << GetCurrentProcessId() << ")] ";
@@ -1112,26 +1346,58 @@ POP_WARNINGS
         str_prefix << "tid:" << misc_utils::get_thread_string_id() << " ";
 //#endif
 
-      if(plogger->m_thr_prefix_strings.size())
-      {
-        CRITICAL_REGION_LOCAL(plogger->m_critical_sec);
-        std::string thr_str = misc_utils::get_thread_string_id();
-        std::map<std::string, std::string>::iterator it = plogger->m_thr_prefix_strings.find(thr_str);
-        if(it!=plogger->m_thr_prefix_strings.end())
-        {
-          str_prefix << it->second;
-        }
-      }
-
-
-      if(get_set_is_uninitialized())
-        delete plogger;
+      const char* pthread_prefix = get_thread_log_prefix();
+      if(*pthread_prefix)
+        str_prefix << pthread_prefix;
+    }
 
+    static std::string get_prefix_entry()
+    {
+      std::stringstream str_prefix;
+      put_prefix_entry(str_prefix);
       return str_prefix.str();
     }
 
   private:
     log_singletone(){}//restric to create an instance
+
+    //thread locals below are plain buffers, so logging from thread exit and static destructors is safe
+    static const size_t max_thread_prefix_size = 64;
+
+    //prefixes are only ever set by the thread they belong to
+    static char* get_thread_log_prefix()
+    {
+      static thread_local char prefix[max_thread_prefix_size];
+      return prefix;
+    }
+
+    //same text as get_day_time_string(), the part up to seconds is formatted once a second per thread
+    static void put_day_time(std::ostream& s)
+    {
+      static thread_local int64_t last_second = -1;
+      static thread_local char last_second_str[64];
+
+      boost::posix_time::ptime now = boost::posix_time::microsec_clock::local_time();
+      boost::posix_time::time_duration::fractional_seconds_type frac = now.time_of_day().fractional_seconds();
+      boost::posix_time::ptime second = now - boost::posix_time::time_duration(0, 0, 0, frac);
+      int64_t second_key = (second - boost::posix_time::ptime(boost::gregorian::date(1970, 1, 1))).total_seconds();
+      if(second_key != last_second)
+      {
+        std::string str = misc_utils::get_time_str_v3(second);
+        size_t len = (std::min)(str.size(), sizeof(last_second_str) - 1);
+        memcpy(last_second_str, str.data(), len);
+        last_second_str[len] = 0;
+        last_second = second_key;
+      }
+      s << last_second_str;
+      if(frac)
+      {
+        char buff[32] = {0};
+        snprintf(buff, sizeof(buff), ".%0*lld", (int)boost::posix_time::time_duration::num_fractional_digits(), (long long)frac);
+        s << buff;
+      }
+      s << " ";
+    }
     //static initializer<log_singletone> m_log_initializer;//must be in one .cpp file (for example main.cpp) via DEFINE_LOGGING macro
 
     static bool init()
@@ -1316,29 +1582,29 @@ POP_WARNINGS
 #if defined(ENABLE_LOGGING_INTERNAL)
 
 #define LOG_PRINT_NO_PREFIX2(log_name, x, y) {if ( y <= epee::log_space::log_singletone::get_log_detalisation_level() )\
-  {std::stringstream ss________; ss________ << x << std::endl; epee::log_space::log_singletone::do_log_message(ss________.str() , y, epee::log_space::console_color_default, false, log_name);}}
+  {epee::log_space::log_message_stream ss________; ss________.stream() << x << std::endl; epee::log_space::log_singletone::do_log_message(ss________.str() , y, epee::log_space::console_color_default, false, log_name);}}
 
 #define LOG_PRINT_NO_PREFIX_NO_POSTFIX2(log_name, x, y) {if ( y <= epee::log_space::log_singletone::get_log_detalisation_level() )\
-  {std::stringstream ss________; ss________ << x; epee::log_space::log_singletone::do_log_message(ss________.str(), y, epee::log_space::console_color_default, false, log_name);}}
+  {epee::log_space::log_message_stream ss________; ss________.stream() << x; epee::log_space::log_singletone::do_log_message(ss________.str(), y, epee::log_space::console_color_default, false, log_name);}}
 
 
 #define LOG_PRINT_NO_POSTFIX2(log_name, x, y) {if ( y <= epee::log_space::log_singletone::get_log_detalisation_level() )\
-  {std::stringstream ss________; ss________ << epee::log_space::log_singletone::get_prefix_entry() << x; epee::log_space::log_singletone::do_log_message(ss________.str(), y, epee::log_space::console_color_default, false, log_name);}}
+  {epee::log_space::log_message_stream ss________; epee::log_space::log_singletone::put_prefix_entry(ss________.stream()); ss________.stream() << x; epee::log_space::log_singletone::do_log_message(ss________.str(), y, epee::log_space::console_color_default, false, log_name);}}
 
 
 #define LOG_PRINT2(log_name, x, y) {if ( y <= epee::log_space::log_singletone::get_log_detalisation_level() )\
-  {std::stringstream ss________; ss________ << epee::log_space::log_singletone::get_prefix_entry() << x << std::endl;epee::log_space::log_singletone::do_log_message(ss________.str(), y, epee::log_space::console_color_default, false, log_name);}}
+  {epee::log_space::log_message_stream ss________; epee::log_space::log_singletone::put_prefix_entry(ss________.stream()); ss________.stream() << x << std::endl;epee::log_space::log_singletone::do_log_message(ss________.str(), y, epee::log_space::console_color_default, false, log_name);}}
 
 #define LOG_PRINT_COLOR2(log_name, x, y, color) {if ( y <= epee::log_space::log_singletone::get_log_detalisation_level() )\
-  {std::stringstream ss________; ss________ << epee::log_space::log_singletone::get_prefix_entry() << x << std::endl;epee::log_space::log_singletone::do_log_message(ss________.str(), y, color, false, log_name);}}
+  {epee::log_space::log_message_stream ss________; epee::log_space::log_singletone::put_prefix_entry(ss________.stream()); ss________.stream() << x << std::endl;epee::log_space::log_singletone::do_log_message(ss________.str(), y, color, false, log_name);}}
 
 
 #define LOG_PRINT2_JORNAL(log_name, x, y) {if ( y <= epee::log_space::log_singletone::get_log_detalisation_level() )\
-  {std::stringstream ss________; ss________ << epee::log_space::log_singletone::get_prefix_entry() << x << std::endl;epee::log_space::log_singletone::do_log_message(ss________.str(), y, epee::log_space::console_color_default, true, log_name);}}
+  {epee::log_space::log_message_stream ss________; epee::log_space::log_singletone::put_prefix_entry(ss________.stream()); ss________.stream() << x << std::endl;epee::log_space::log_singletone::do_log_message(ss________.str(), y, epee::log_space::console_color_default, true, log_name);}}
 
 
 #define LOG_ERROR2(log_name, x) { \
-  std::stringstream ss________; ss________ << epee::log_space::log_singletone::get_prefix_entry() << "ERROR " << __FILE__ << ":" << __LINE__ << " " << x << std::endl; epee::log_space::log_singletone::do_log_message(ss________.str(), LOG_LEVEL_0, epee::log_space::console_color_red, true, log_name);LOCAL_ASSERT(0); epee::log_space::log_singletone::get_set_err_count(true, epee::log_space::log_singletone::get_set_err_count()+1);}
+  epee::log_space::log_message_stream ss________; epee::log_space::log_singletone::put_prefix_entry(ss________.stream()); ss________.stream() << "ERROR " << __FILE__ << ":" << __LINE__ << " " << x << std::endl; epee::log_space::log_singletone::do_log_message(ss________.str(), LOG_LEVEL_0, epee::log_space::console_color_red, true, log_name);LOCAL_ASSERT(0); epee::log_space::log_singletone::get_set_err_count(true, epee::log_space::log_singletone::get_set_err_count()+1);}
 
 #define LOG_FRAME2(log_name, x, y) epee::log_space::log_frame frame(x, y, log_name)
 
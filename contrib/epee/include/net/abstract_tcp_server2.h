@@ -45,10 +45,14 @@
 #include <boost/interprocess/detail/atomic.hpp>
 #include <boost/thread/thread.hpp>
 #include "net_utils_base.h"
+#include "rate_limiter.h"
 #include "syncobj.h"
 
 
 #define ABSTRACT_SERVER_SEND_QUE_MAX_COUNT 100
+#define ABSTRACT_SERVER_RECV_BUFFER_SIZE 8192             //receive buffer size when no big frame is in progress
+#define ABSTRACT_SERVER_RECV_BUFFER_MAX_SIZE (1024*1024)  //receive buffer grows up to this size for big frames
+#define ABSTRACT_SERVER_THROTTLE_MAX_WAIT_MS 1000          //throttled connections check their limits at least this often
 
 namespace epee
 {
@@ -76,7 +80,7 @@ namespace net_utils
     typedef typename t_protocol_handler::connection_context t_connection_context;
     /// Construct a connection with the given io_service.
     explicit connection(boost::asio::io_service& io_service,
-      typename t_protocol_handler::config_type& config, volatile uint32_t& sock_count, i_connection_filter * &pfilter);
+      typename t_protocol_handler::config_type& config, volatile uint32_t& sock_count, i_connection_filter * &pfilter, bandwidth_limits& limits);
 
     virtual ~connection() noexcept(false);
     /// Get the socket associated with the connection.
@@ -91,6 +95,8 @@ namespace net_utils
   private:
     //----------------- i_service_endpoint ---------------------
     virtual bool do_send(const void* ptr, size_t cb);
+    virtual bool do_send_shared(const std::string& head, const shared_buffer& body, bool urgent);
+    virtual void set_recv_hint(size_t cb);
     virtual bool close();
     virtual bool call_run_once_service_io();
     virtual bool request_callback();
@@ -103,6 +109,17 @@ namespace net_utils
     /// Handle completion of a read operation.
     void handle_read(const boost::system::error_code& e,
       std::size_t bytes_transferred);
+    /// Grow buffer_ to the rest of the frame being received, shrink it back when the connection goes idle.
+    void adjust_recv_buffer(std::size_t bytes_transferred);
+    /// Start the next read, or wait for it if the download limits are exceeded.
+    void start_read();
+    void handle_recv_timer(const boost::system::error_code& e);
+
+    /// Queue head and body for sending (urgent entries go ahead of the others), start writing if no write is in progress.
+    bool queue_send(std::string& head, const shared_buffer& body, bool urgent);
+    /// Start writing m_send_que.front(), or wait for it if the upload limits are exceeded. m_send_que_lock must be held.
+    void start_write();
+    void handle_send_timer(const boost::system::error_code& e);
 
     /// Handle completion of a write operation.
     void handle_write(const boost::system::error_code& e, size_t cb);
@@ -114,15 +131,32 @@ namespace net_utils
     boost::asio::ip::tcp::socket socket_;
 
     /// Buffer for incoming data.
-    boost::array<char, 8192> buffer_;
+    std::vector<char> buffer_;
+    /// Bytes the protocol handler still waits for, only accessed from handle_read.
+    size_t m_recv_hint;
 
     t_connection_context context;
     volatile uint32_t m_want_close_connection;
     std::atomic<bool> m_was_shutdown;
+    /// Own copy of small data followed by a body that can be shared with other connections.
+    struct send_que_entry
+    {
+      std::string m_head;
+      shared_buffer m_body;
+      bool m_urgent; //not held back by the upload limits
+    };
     critical_section m_send_que_lock;
-    std::list<std::string> m_send_que;
+    std::list<send_que_entry> m_send_que;
+    size_t m_send_que_bytes;
+    bool m_send_in_progress; //async_write issued for m_send_que.front()
+    bool m_send_throttled;   //m_send_timer armed
+    boost::asio::deadline_timer m_send_timer;
+    boost::asio::deadline_timer m_recv_timer;
     volatile uint32_t& m_ref_sockets_count;
     i_connection_filter* &m_pfilter;
+    bandwidth_limits& m_limits;
+    rate_limiter m_peer_upload;
+    rate_limiter m_peer_download;
     volatile bool m_is_multithreaded;
 
     //this should be the last one, because it could be wait on destructor, while other activities possible on other threads
@@ -171,6 +205,9 @@ namespace net_utils
 
     void set_connection_filter(i_connection_filter* pfilter);
 
+    /// Upload/download limits of the whole server and of each connection.
+    bandwidth_limits& get_bandwidth_limits(){return m_bandwidth_limits;}
+
     bool connect(const std::string& adr, const std::string& port, uint32_t conn_timeot, t_connection_context& cn, const std::string& bind_ip = "0.0.0.0");
     template<class t_callback>
     bool connect_async(const std::string& adr, const std::string& port, uint32_t conn_timeot, t_callback cb, const std::string& bind_ip = "0.0.0.0");
@@ -263,6 +300,7 @@ namespace net_utils
     std::string m_thread_name_prefix;
     size_t m_threads_count;
     i_connection_filter* m_pfilter;
+    bandwidth_limits m_bandwidth_limits;
     std::vector<boost::shared_ptr<boost::thread> > m_threads;
     boost::thread::id m_main_thread_id;
     critical_section m_threads_lock;
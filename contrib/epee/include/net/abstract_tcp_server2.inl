@@ -49,13 +49,21 @@ PRAGMA_WARNING_DISABLE_VS(4355)
 
   template<class t_protocol_handler>
   connection<t_protocol_handler>::connection(boost::asio::io_service& io_service,
-    typename t_protocol_handler::config_type& config, volatile uint32_t& sock_count, i_connection_filter* &pfilter)
+    typename t_protocol_handler::config_type& config, volatile uint32_t& sock_count, i_connection_filter* &pfilter, bandwidth_limits& limits)
                           : strand_(io_service),
                             socket_(io_service),
+                            buffer_(ABSTRACT_SERVER_RECV_BUFFER_SIZE),
+                            m_recv_hint(0),
                             m_want_close_connection(0), 
                             m_was_shutdown(0), 
+                            m_send_que_bytes(0),
+                            m_send_in_progress(false),
+                            m_send_throttled(false),
+                            m_send_timer(io_service),
+                            m_recv_timer(io_service),
                             m_ref_sockets_count(sock_count), 
                             m_pfilter(pfilter),
+                            m_limits(limits),
                             m_protocol_handler(this, config, context)
   {
     boost::interprocess::ipcdetail::atomic_inc32(&m_ref_sockets_count);
@@ -160,7 +168,7 @@ PRAGMA_WARNING_DISABLE_VS(4355)
   template<class t_protocol_handler>
   boost::asio::io_service& connection<t_protocol_handler>::get_io_service()
   {
-    return socket_.get_io_service();
+    return static_cast<boost::asio::io_service&>(socket_.get_executor().context());
   }
   //---------------------------------------------------------------------------------
   template<class t_protocol_handler>
@@ -218,6 +226,9 @@ PRAGMA_WARNING_DISABLE_VS(4355)
       LOG_PRINT("[sock " << socket_.native_handle() << "] RECV " << bytes_transferred, LOG_LEVEL_4);
       context.m_last_recv = time(NULL);
       context.m_recv_cnt += bytes_transferred;
+      m_limits.m_download.take(bytes_transferred);
+      m_peer_download.take(bytes_transferred);
+      context.m_recv_speed = m_peer_download.get_average();
       bool recv_res = m_protocol_handler.handle_recv(buffer_.data(), bytes_transferred);
       if(!recv_res)
       {  
@@ -234,12 +245,8 @@ PRAGMA_WARNING_DISABLE_VS(4355)
           shutdown();
       }else
       {
-        socket_.async_read_some(boost::asio::buffer(buffer_),
-          strand_.wrap(
-            boost::bind(&connection<t_protocol_handler>::handle_read, connection<t_protocol_handler>::shared_from_this(),
-              boost::asio::placeholders::error,
-              boost::asio::placeholders::bytes_transferred)));
-        LOG_PRINT_L4("[sock " << socket_.native_handle() << "]Async read requested.");
+        adjust_recv_buffer(bytes_transferred);
+        start_read();
       }
     }else
     {
@@ -258,13 +265,71 @@ PRAGMA_WARNING_DISABLE_VS(4355)
   }
   //---------------------------------------------------------------------------------
   template<class t_protocol_handler>
+  void connection<t_protocol_handler>::start_read()
+  {
+    // Throttled reads just wait: the peer is held back by TCP flow control meanwhile
+    m_peer_download.set_rate(m_limits.m_peer_download_rate);
+    uint64_t wait_ms = (std::max)(m_limits.m_download.get_wait_ms(), m_peer_download.get_wait_ms());
+    if(wait_ms)
+    {
+      LOG_PRINT_L4("[sock " << socket_.native_handle() << "] Read throttled for " << wait_ms << " ms");
+      m_recv_timer.expires_from_now(boost::posix_time::milliseconds((std::min)(wait_ms, (uint64_t)ABSTRACT_SERVER_THROTTLE_MAX_WAIT_MS)));
+      m_recv_timer.async_wait(strand_.wrap(
+        boost::bind(&connection<t_protocol_handler>::handle_recv_timer, connection<t_protocol_handler>::shared_from_this(),
+          boost::asio::placeholders::error)));
+      return;
+    }
+
+    socket_.async_read_some(boost::asio::buffer(buffer_),
+      strand_.wrap(
+        boost::bind(&connection<t_protocol_handler>::handle_read, connection<t_protocol_handler>::shared_from_this(),
+          boost::asio::placeholders::error,
+          boost::asio::placeholders::bytes_transferred)));
+    LOG_PRINT_L4("[sock " << socket_.native_handle() << "]Async read requested.");
+  }
+  //---------------------------------------------------------------------------------
+  template<class t_protocol_handler>
+  void connection<t_protocol_handler>::handle_recv_timer(const boost::system::error_code& e)
+  {
+    TRY_ENTRY();
+    if(e || m_was_shutdown)
+      return;
+    start_read();
+    CATCH_ENTRY_L0("connection<t_protocol_handler>::handle_recv_timer", void());
+  }
+  //---------------------------------------------------------------------------------
+  template<class t_protocol_handler>
+  void connection<t_protocol_handler>::adjust_recv_buffer(std::size_t bytes_transferred)
+  {
+    // A big frame is read in as few completions as possible; the buffer is released
+    // once the frame is done and the peer has no more than a small read pending.
+    size_t wanted = (std::min)(m_recv_hint, (size_t)ABSTRACT_SERVER_RECV_BUFFER_MAX_SIZE);
+    if(wanted > buffer_.size())
+    {
+      LOG_PRINT_L4("[sock " << socket_.native_handle() << "] Receive buffer grows to " << wanted);
+      std::vector<char>(wanted).swap(buffer_);
+    }
+    else if(!m_recv_hint && bytes_transferred < ABSTRACT_SERVER_RECV_BUFFER_SIZE && buffer_.size() > ABSTRACT_SERVER_RECV_BUFFER_SIZE)
+    {
+      LOG_PRINT_L4("[sock " << socket_.native_handle() << "] Receive buffer shrinks to " << ABSTRACT_SERVER_RECV_BUFFER_SIZE);
+      std::vector<char>(ABSTRACT_SERVER_RECV_BUFFER_SIZE).swap(buffer_);
+    }
+  }
+  //---------------------------------------------------------------------------------
+  template<class t_protocol_handler>
+  void connection<t_protocol_handler>::set_recv_hint(size_t cb)
+  {
+    m_recv_hint = cb;
+  }
+  //---------------------------------------------------------------------------------
+  template<class t_protocol_handler>
   bool connection<t_protocol_handler>::call_run_once_service_io()
   {
     TRY_ENTRY();
     if(!m_is_multithreaded)
     {
       //single thread model, we can wait in blocked call
-      size_t cnt = socket_.get_io_service().run_one();
+      size_t cnt = static_cast<boost::asio::io_service&>(socket_.get_executor().context()).run_one();
       if(!cnt)//service is going to quit
         return false;
     }else
@@ -274,7 +339,7 @@ PRAGMA_WARNING_DISABLE_VS(4355)
       //if no handlers were called
       //TODO: Maybe we need to have have critical section + event + callback to upper protocol to
       //ask it inside(!) critical region if we still able to go in event wait...
-      size_t cnt = socket_.get_io_service().poll_one();     
+      size_t cnt = static_cast<boost::asio::io_service&>(socket_.get_executor().context()).poll_one();     
       if(!cnt)
         misc_utils::sleep_no_w(0);
     }
@@ -285,6 +350,20 @@ PRAGMA_WARNING_DISABLE_VS(4355)
   //---------------------------------------------------------------------------------
   template<class t_protocol_handler>
   bool connection<t_protocol_handler>::do_send(const void* ptr, size_t cb)
+  {
+    std::string head((const char*)ptr, cb);
+    return queue_send(head, shared_buffer(), false);
+  }
+  //---------------------------------------------------------------------------------
+  template<class t_protocol_handler>
+  bool connection<t_protocol_handler>::do_send_shared(const std::string& head, const shared_buffer& body, bool urgent)
+  {
+    std::string head_copy(head);
+    return queue_send(head_copy, body, urgent);
+  }
+  //---------------------------------------------------------------------------------
+  template<class t_protocol_handler>
+  bool connection<t_protocol_handler>::queue_send(std::string& head, const shared_buffer& body, bool urgent)
   {
     TRY_ENTRY();
     // Use safe_shared_from_this, because of this is public method and it can be called on the object being deleted
@@ -294,6 +373,7 @@ PRAGMA_WARNING_DISABLE_VS(4355)
     if(m_was_shutdown)
       return false;
 
+    size_t cb = head.size() + (body ? body->size() : 0);
     LOG_PRINT("[sock " << socket_.native_handle() << "] SEND " << cb, LOG_LEVEL_4);
     context.m_last_send = time(NULL);
     context.m_send_cnt += cb;
@@ -309,28 +389,30 @@ PRAGMA_WARNING_DISABLE_VS(4355)
       return false;
     }
 
-    m_send_que.resize(m_send_que.size()+1);
-    m_send_que.back().assign((const char*)ptr, cb);
-    
-    if(m_send_que.size() > 1)
+    // urgent entries overtake the not urgent ones, but not the entry being written
+    auto it = m_send_que.begin();
+    if(m_send_in_progress)
+      ++it;
+    if(urgent)
     {
-      //active operation should be in progress, nothing to do, just wait last operation callback
-    }else
-    {
-      //no active operation
-      if(m_send_que.size()!=1)
-      {
-        LOG_ERROR("Looks like no active operations, but send que size != 1!!");
-        return false;
-      }
+      while(it != m_send_que.end() && it->m_urgent)
+        ++it;
+    }
+    else
+      it = m_send_que.end();
+    it = m_send_que.insert(it, send_que_entry());
+    it->m_head.swap(head);
+    it->m_body = body;
+    it->m_urgent = urgent;
+    m_send_que_bytes += cb;
+    context.m_send_que_bytes = m_send_que_bytes;
 
-      boost::asio::async_write(socket_, boost::asio::buffer(m_send_que.front().data(), m_send_que.front().size()),
-        //strand_.wrap(
-        boost::bind(&connection<t_protocol_handler>::handle_write, self, _1, _2)
-        //)
-        );
-      
-      LOG_PRINT_L4("[sock " << socket_.native_handle() << "] Async send requested " << m_send_que.front().size());
+    if(m_send_in_progress)
+    {
+      //active operation is in progress, nothing to do, just wait last operation callback
+    }else if(!m_send_throttled || urgent)
+    {
+      start_write();
     }
 
     return true;
@@ -339,12 +421,64 @@ PRAGMA_WARNING_DISABLE_VS(4355)
   }
   //---------------------------------------------------------------------------------
   template<class t_protocol_handler>
+  void connection<t_protocol_handler>::start_write()
+  {
+    const send_que_entry& entry = m_send_que.front();
+    m_peer_upload.set_rate(m_limits.m_peer_upload_rate);
+    if(!entry.m_urgent)
+    {
+      uint64_t wait_ms = (std::max)(m_limits.m_upload.get_wait_ms(), m_peer_upload.get_wait_ms());
+      if(wait_ms)
+      {
+        if(!m_send_throttled)
+        {
+          LOG_PRINT_L4("[sock " << socket_.native_handle() << "] Send throttled for " << wait_ms << " ms");
+          m_send_throttled = true;
+          m_send_timer.expires_from_now(boost::posix_time::milliseconds((std::min)(wait_ms, (uint64_t)ABSTRACT_SERVER_THROTTLE_MAX_WAIT_MS)));
+          m_send_timer.async_wait(boost::bind(&connection<t_protocol_handler>::handle_send_timer, connection<t_protocol_handler>::shared_from_this(), _1));
+        }
+        return;
+      }
+    }
+
+    // urgent data is counted too, so it delays the data behind it instead of being delayed
+    size_t cb = entry.m_head.size() + (entry.m_body ? entry.m_body->size() : 0);
+    m_limits.m_upload.take(cb);
+    m_peer_upload.take(cb);
+    context.m_send_speed = m_peer_upload.get_average();
+    m_send_in_progress = true;
+
+    // gather write: head and body are sent from where they are, without being joined
+    boost::array<boost::asio::const_buffer, 2> buffers = {{
+      boost::asio::buffer(entry.m_head.data(), entry.m_head.size()),
+      entry.m_body ? boost::asio::buffer(entry.m_body->data(), entry.m_body->size()) : boost::asio::const_buffer()
+    }};
+    boost::asio::async_write(socket_, buffers,
+      //strand_.wrap(
+      boost::bind(&connection<t_protocol_handler>::handle_write, connection<t_protocol_handler>::shared_from_this(), _1, _2)
+      //)
+      );
+
+    LOG_PRINT_L4("[sock " << socket_.native_handle() << "] Async send requested " << boost::asio::buffer_size(buffers));
+  }
+  //---------------------------------------------------------------------------------
+  template<class t_protocol_handler>
   bool connection<t_protocol_handler>::shutdown()
   {
     // Initiate graceful connection closure.
     boost::system::error_code ignored_ec;
     socket_.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ignored_ec);
     m_was_shutdown = true;
+    // a throttled connection is kept alive by its timers, don't let it linger until they expire
+    CRITICAL_REGION_BEGIN(m_send_que_lock);
+    CRITICAL_REGION_END();
+    auto self = safe_shared_from_this();
+    if(self)
+    {
+      strand_.dispatch([self]() {
+        boost::system::error_code ec;
+      });
+    }
     m_protocol_handler.release_protocol();
     return true;
   }
@@ -389,7 +523,10 @@ PRAGMA_WARNING_DISABLE_VS(4355)
       return;
     }
 
+    m_send_que_bytes -= m_send_que.front().m_head.size() + (m_send_que.front().m_body ? m_send_que.front().m_body->size() : 0);
+    context.m_send_que_bytes = m_send_que_bytes;
     m_send_que.pop_front();
+    m_send_in_progress = false;
     if(m_send_que.empty())
     {
       if(boost::interprocess::ipcdetail::atomic_read32(&m_want_close_connection))
@@ -399,10 +536,7 @@ PRAGMA_WARNING_DISABLE_VS(4355)
     }else
     {
       //have more data to send
-      boost::asio::async_write(socket_, boost::asio::buffer(m_send_que.front().data(), m_send_que.front().size()),
-        //strand_.wrap(
-          boost::bind(&connection<t_protocol_handler>::handle_write, connection<t_protocol_handler>::shared_from_this(), _1, _2));
-        //);
+      start_write();
     }
     CRITICAL_REGION_END();
 
@@ -412,6 +546,19 @@ PRAGMA_WARNING_DISABLE_VS(4355)
     }
     CATCH_ENTRY_L0("connection<t_protocol_handler>::handle_write", void());
   }
+  //---------------------------------------------------------------------------------
+  template<class t_protocol_handler>
+  void connection<t_protocol_handler>::handle_send_timer(const boost::system::error_code& e)
+  {
+    TRY_ENTRY();
+    CRITICAL_REGION_LOCAL(m_send_que_lock);
+    m_send_throttled = false;
+    if(e || m_was_shutdown)
+      return;
+    if(!m_send_in_progress && !m_send_que.empty())
+      start_write();
+    CATCH_ENTRY_L0("connection<t_protocol_handler>::handle_send_timer", void());
+  }
   /************************************************************************/
   /*                                                                      */
   /************************************************************************/
@@ -420,7 +567,7 @@ PRAGMA_WARNING_DISABLE_VS(4355)
     m_io_service_local_instance(new boost::asio::io_service()),
     io_service_(*m_io_service_local_instance.get()),
     acceptor_(io_service_),
-    new_connection_(new connection<t_protocol_handler>(io_service_, m_config, m_sockets_count, m_pfilter)), 
+    new_connection_(new connection<t_protocol_handler>(io_service_, m_config, m_sockets_count, m_pfilter, m_bandwidth_limits)), 
     m_stop_signal_sent(false), m_port(0), m_sockets_count(0), m_threads_count(0), m_pfilter(NULL), m_thread_index(0)
   {
     m_thread_name_prefix = "NET";
@@ -430,7 +577,7 @@ PRAGMA_WARNING_DISABLE_VS(4355)
   boosted_tcp_server<t_protocol_handler>::boosted_tcp_server(boost::asio::io_service& extarnal_io_service):
     io_service_(extarnal_io_service),
     acceptor_(io_service_),
-    new_connection_(new connection<t_protocol_handler>(io_service_, m_config, m_sockets_count, m_pfilter)), 
+    new_connection_(new connection<t_protocol_handler>(io_service_, m_config, m_sockets_count, m_pfilter, m_bandwidth_limits)), 
     m_stop_signal_sent(false), m_port(0), m_sockets_count(0), m_threads_count(0), m_pfilter(NULL), m_thread_index(0)
   {
     m_thread_name_prefix = "NET";
@@ -628,7 +775,7 @@ POP_WARNINGS
     {
       connection_ptr conn(std::move(new_connection_));
 
-      new_connection_.reset(new connection<t_protocol_handler>(io_service_, m_config, m_sockets_count, m_pfilter));
+      new_connection_.reset(new connection<t_protocol_handler>(io_service_, m_config, m_sockets_count, m_pfilter, m_bandwidth_limits));
       acceptor_.async_accept(new_connection_->socket(),
         boost::bind(&boosted_tcp_server<t_protocol_handler>::handle_accept, this,
         boost::asio::placeholders::error));
@@ -646,7 +793,7 @@ POP_WARNINGS
   {
     TRY_ENTRY();
 
-    connection_ptr new_connection_l(new connection<t_protocol_handler>(io_service_, m_config, m_sockets_count, m_pfilter) );
+    connection_ptr new_connection_l(new connection<t_protocol_handler>(io_service_, m_config, m_sockets_count, m_pfilter, m_bandwidth_limits) );
     boost::asio::ip::tcp::socket&  sock_ = new_connection_l->socket();
     
     //////////////////////////////////////////////////////////////////////////
@@ -720,7 +867,7 @@ POP_WARNINGS
     if (r)
     {
       new_connection_l->get_context(conn_context);
-      //new_connection_l.reset(new connection<t_protocol_handler>(io_service_, m_config, m_sockets_count, m_pfilter));
+      //new_connection_l.reset(new connection<t_protocol_handler>(io_service_, m_config, m_sockets_count, m_pfilter, m_bandwidth_limits));
     }
     else
     {
@@ -736,7 +883,7 @@ POP_WARNINGS
   bool boosted_tcp_server<t_protocol_handler>::connect_async(const std::string& adr, const std::string& port, uint32_t conn_timeout, t_callback cb, const std::string& bind_ip)
   {
     TRY_ENTRY();    
-    connection_ptr new_connection_l(new connection<t_protocol_handler>(io_service_, m_config, m_sockets_count, m_pfilter) );
+    connection_ptr new_connection_l(new connection<t_protocol_handler>(io_service_, m_config, m_sockets_count, m_pfilter, m_bandwidth_limits) );
     boost::asio::ip::tcp::socket&  sock_ = new_connection_l->socket();
     
     //////////////////////////////////////////////////////////////////////////
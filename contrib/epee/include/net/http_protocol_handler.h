@@ -48,7 +48,12 @@ namespace net_utils
 		/************************************************************************/
 		struct http_server_config
 		{
+			http_server_config(): m_gzip_level(0), m_gzip_min_size(0)
+			{}
+
 			std::string m_folder;
+			int m_gzip_level;      //zlib level responses are compressed with for clients that accept gzip, 0 means never compress
+			size_t m_gzip_min_size;//smaller bodies are sent as is
 			critical_section m_lock;
 		};
 
@@ -104,17 +109,28 @@ namespace net_utils
 				http_body_transfer_undefined
 			};
 
-			bool handle_buff_in(std::string& buf);
+			enum chunk_state{
+				http_chunk_size,
+				http_chunk_data,
+				http_chunk_data_end,
+				http_chunk_trailer
+			};
 
-			bool analize_cached_request_header_and_invoke_state(size_t pos);
+			bool handle_buff_in(const char* ptr, size_t cb);
 
-			bool handle_invoke_query_line();
-			bool parse_cached_header(http_header_info& body_info, const std::string& m_cache_to_process, size_t pos);
-			std::string::size_type match_end_of_header(const std::string& buf);
+			bool handle_invoke_query_line(size_t line_end);
+			bool handle_header_line(size_t line_end);
+			bool analize_cached_request_header_and_invoke_state();
 			bool get_len_from_content_lenght(const std::string& str, size_t& len);
 			bool handle_retriving_query_body();
 			bool handle_query_measure();
+			bool handle_query_chunked();
+			bool handle_request_done();
+			bool find_line_end(size_t& line_end);
+			void compact_cache();
 			bool set_ready_state();
+			bool send_error_response(int code, const std::string& comment);
+			bool compress_response(const http_request_info& query_info, http_response_info& response);
 			bool slash_to_back_slash(std::string& str);
 			std::string get_file_mime_tipe(const std::string& path);
 			std::string get_response_header(const http_response_info& response);
@@ -127,13 +143,19 @@ namespace net_utils
 
 			std::string m_root_path;
 			std::string m_cache;
+			size_t m_cache_pos;   //start of data not consumed yet
+			size_t m_scan_pos;    //where the search for the end of the current line goes on
+			size_t m_header_start;//start of the header area of the current request
+			std::string* m_plast_field;//value continuation lines go to
 			machine_state m_state;
 			body_transfer_type m_body_transfer_type;
+			chunk_state m_chunk_state;
 			bool m_is_stop_handling;
 			http::http_request_info m_query_info;
 			size_t m_len_summary, m_len_remain;
 			config_type& m_config;
 			bool m_want_close;
+			bool m_keep_alive;
 		protected:
 			i_service_endpoint* m_psnd_hndlr; 
 		};
@@ -25,13 +25,18 @@
 // 
 
 
+#include <limits>
 #include <boost/regex.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/make_shared.hpp>
 #include "http_protocol_handler.h"
 #include "reg_exp_definer.h"
 #include "string_tools.h"
 #include "file_io_utils.h"
 #include "net_parse_helpers.h"
+#ifdef HTTP_ENABLE_GZIP
+#include "gzip_encoding.h"
+#endif
 
 #define HTTP_MAX_URI_LEN		 9000 
 #define HTTP_MAX_HEADER_LEN		 100000
@@ -190,16 +195,125 @@ namespace net_utils
 
 
 
+		//--------------------------------------------------------------------------------------------
+		inline bool http_token_equal(const char* begin, const char* end, const char* token)
+		{
+			for(; begin != end; ++begin, ++token)
+			{
+				if(!*token || tolower((unsigned char)*begin) != tolower((unsigned char)*token))
+					return false;
+			}
+			return !*token;
+		}
+		//--------------------------------------------------------------------------------------------
+		inline void http_trim_spaces(const char*& begin, const char*& end)
+		{
+			while(begin != end && (*begin == ' ' || *begin == '\t'))
+				++begin;
+			while(end != begin && (end[-1] == ' ' || end[-1] == '\t'))
+				--end;
+		}
+		//--------------------------------------------------------------------------------------------
+		//checks comma separated list of tokens, like "Connection:" or "Transfer-Encoding:" value
+		inline bool http_list_has_token(const std::string& list, const char* token)
+		{
+			const char* p = list.data();
+			const char* end = p + list.size();
+			while(p != end)
+			{
+				const char* item_end = std::find(p, end, ',');
+				const char* item_begin = p;
+				const char* item_last = item_end;
+				http_trim_spaces(item_begin, item_last);
+				if(http_token_equal(item_begin, item_last, token))
+					return true;
+				p = item_end == end ? end : item_end + 1;
+			}
+			return false;
+		}
+		//--------------------------------------------------------------------------------------------
+		//checks "Accept-Encoding:" value, codings with "q=0" are refused, explicit "gzip" wins over "*"
+		inline bool http_accepts_gzip(const std::string& accept_encoding)
+		{
+			int gzip = -1, any = -1;
+			const char* p = accept_encoding.data();
+			const char* end = p + accept_encoding.size();
+			while(p != end)
+			{
+				const char* item_end = std::find(p, end, ',');
+				const char* coding_begin = p;
+				const char* coding_end = std::find(p, item_end, ';');
+				const char* param = coding_end;
+				http_trim_spaces(coding_begin, coding_end);
+
+				bool refused = false;
+				while(param != item_end)
+				{
+					const char* param_begin = param + 1;
+					param = std::find(param_begin, item_end, ';');
+					const char* param_end = param;
+					http_trim_spaces(param_begin, param_end);
+					if(param_end - param_begin >= 2 && http_token_equal(param_begin, param_begin + 2, "q="))
+					{
+						refused = true;
+						for(const char* q = param_begin + 2; q != param_end; ++q)
+						{
+							if(*q != '0' && *q != '.')
+								refused = false;
+						}
+					}
+				}
+
+				if(http_token_equal(coding_begin, coding_end, "gzip") || http_token_equal(coding_begin, coding_end, "x-gzip"))
+					gzip = refused ? 0 : 1;
+				else if(http_token_equal(coding_begin, coding_end, "*"))
+					any = refused ? 0 : 1;
+				p = item_end == end ? end : item_end + 1;
+			}
+			return gzip != -1 ? gzip == 1 : any == 1;
+		}
+		//--------------------------------------------------------------------------------------------
+		inline bool http_parse_version(const char* begin, const char* end, int& http_ver_major, int& http_ver_minor)
+		{
+			//HTTP/major.minor
+			if(end - begin < 8 || !http_token_equal(begin, begin + 5, "HTTP/"))
+				return false;
+			const char* p = begin + 5;
+			int* pver = &http_ver_major;
+			*pver = 0;
+			bool have_digits = false;
+			for(; p != end; ++p)
+			{
+				if(*p == '.' && pver == &http_ver_major && have_digits)
+				{
+					pver = &http_ver_minor;
+					*pver = 0;
+					have_digits = false;
+					continue;
+				}
+				if(*p < '0' || *p > '9' || *pver > 1000)
+					return false;
+				*pver = *pver * 10 + (*p - '0');
+				have_digits = true;
+			}
+			return pver == &http_ver_minor && have_digits;
+		}
 		//--------------------------------------------------------------------------------------------
 		template<class t_connection_context>
 		simple_http_connection_handler<t_connection_context>::simple_http_connection_handler(i_service_endpoint* psnd_hndlr, config_type& config):
+		m_cache_pos(0),
+		m_scan_pos(0),
+		m_header_start(0),
+		m_plast_field(NULL),
 		m_state(http_state_retriving_comand_line),
 		m_body_transfer_type(http_body_transfer_undefined),
+		m_chunk_state(http_chunk_size),
         m_is_stop_handling(false),
 		m_len_summary(0),
 		m_len_remain(0),
 		m_config(config), 
 		m_want_close(false),
+		m_keep_alive(true),
         m_psnd_hndlr(psnd_hndlr)
 	{
 
@@ -211,214 +325,342 @@ namespace net_utils
 		m_is_stop_handling = false;
 		m_state = http_state_retriving_comand_line;
 		m_body_transfer_type = http_body_transfer_undefined;
+		m_chunk_state = http_chunk_size;
 		m_query_info.clear();
+		m_plast_field = NULL;
 		m_len_summary = 0;
+		m_len_remain = 0;
 		return true;
 	}
 	//--------------------------------------------------------------------------------------------
   template<class t_connection_context>
 	bool simple_http_connection_handler<t_connection_context>::handle_recv(const void* ptr, size_t cb)
 	{
-		std::string buf((const char*)ptr, cb);
-		//LOG_PRINT_L0("HTTP_RECV: " << ptr << "\r\n" << buf);
-		//file_io_utils::save_string_to_file(string_tools::get_current_module_folder() + "/" + boost::lexical_cast<std::string>(ptr), std::string((const char*)ptr, cb));
-
-		bool res = handle_buff_in(buf);
+		//LOG_PRINT_L0("HTTP_RECV: " << ptr << "\r\n" << std::string((const char*)ptr, cb));
+		bool res = handle_buff_in((const char*)ptr, cb);
 		if(m_want_close/*m_state == http_state_connection_close || m_state == http_state_error*/)
 			return false;
 		return res;
 	}
 	//--------------------------------------------------------------------------------------------
   template<class t_connection_context>
-	bool simple_http_connection_handler<t_connection_context>::handle_buff_in(std::string& buf)
+	bool simple_http_connection_handler<t_connection_context>::handle_buff_in(const char* ptr, size_t cb)
 	{
+		if(m_state == http_state_retriving_body && m_body_transfer_type == http_body_transfer_measure &&
+			m_cache_pos == m_cache.size() && cb < m_len_remain)
+		{
+			//nothing cached and all of it is body: goes to the request directly, not through the cache
+			m_query_info.m_body.append(ptr, cb);
+			m_len_remain -= cb;
+			return true;
+		}
 
-		if(m_cache.size())
-			m_cache += buf;
-		else
-			m_cache.swap(buf);
+		m_cache.append(ptr, cb);
 
+		//requests are taken one after another while data lasts, so pipelined ones are answered in order
+		bool res = true;
 		m_is_stop_handling = false;
-		while(!m_is_stop_handling)
+		while(res && !m_is_stop_handling)
 		{
 			switch(m_state)
 			{
 			case http_state_retriving_comand_line:
-				//The HTTP protocol does not place any a priori limit on the length of a URI.  (c)RFC2616
-				//but we forebly restirct it len to HTTP_MAX_URI_LEN to make it more safely
-				if(!m_cache.size())
-					break;
-
-				//check_and_handle_fake_response();
-				if((m_cache[0] == '\r' || m_cache[0] == '\n'))
 				{
-          //some times it could be that before query line cold be few line breaks
-          //so we have to be calm without panic with assers
-					m_cache.erase(0, 1);
-					break;
-				}
+					//The HTTP protocol does not place any a priori limit on the length of a URI.  (c)RFC2616
+					//but we forebly restirct it len to HTTP_MAX_URI_LEN to make it more safely
 
-				if(std::string::npos != m_cache.find('\n', 0))
-					handle_invoke_query_line();
-				else
-				{
+					//some times it could be that before query line cold be few line breaks
+					//so we have to be calm without panic with assers
+					while(m_cache_pos < m_cache.size() && (m_cache[m_cache_pos] == '\r' || m_cache[m_cache_pos] == '\n'))
+						++m_cache_pos;
+
+					size_t line_end = 0;
+					if(find_line_end(line_end))
+					{
+						res = handle_invoke_query_line(line_end);
+						break;
+					}
 					m_is_stop_handling = true;
-					if(m_cache.size() > HTTP_MAX_URI_LEN)
+					if(m_cache.size() - m_cache_pos > HTTP_MAX_URI_LEN)
 					{
-						LOG_ERROR("simple_http_connection_handler::handle_buff_out: Too long URI line");
+						LOG_ERROR("simple_http_connection_handler::handle_buff_in: Too long URI line");
 						m_state = http_state_error;
-						return false;
+						res = false;
 					}
+					break;
 				}
-				break;
 			case http_state_retriving_header:
 				{
-					std::string::size_type pos = match_end_of_header(m_cache);
-					if(std::string::npos == pos)
+					size_t line_end = 0;
+					if(find_line_end(line_end))
 					{
-						m_is_stop_handling = true;
-						if(m_cache.size() > HTTP_MAX_HEADER_LEN)
-						{
-							LOG_ERROR("simple_http_connection_handler::handle_buff_in: Too long header area");
-							m_state = http_state_error;
-							return false;
-						}	
+						res = handle_header_line(line_end);
 						break;
 					}
-					analize_cached_request_header_and_invoke_state(pos);
+					m_is_stop_handling = true;
+					if(m_cache.size() - m_header_start > HTTP_MAX_HEADER_LEN)
+					{
+						LOG_ERROR("simple_http_connection_handler::handle_buff_in: Too long header area");
+						m_state = http_state_error;
+						res = false;
+					}
 					break;
 				}
 			case http_state_retriving_body:
-				return handle_retriving_query_body();
+				res = handle_retriving_query_body();
+				break;
 			case http_state_connection_close:
-				return false;
+				res = false;
+				break;
 			default:
 				LOG_ERROR("simple_http_connection_handler::handle_char_out: Wrong state: " << m_state);
-				return false;
+				res = false;
+				break;
 			case http_state_error:
 				LOG_ERROR("simple_http_connection_handler::handle_char_out: Error state!!!");
-				return false;
+				res = false;
+				break;
 			}
 
-			if(!m_cache.size())
+			if(m_cache_pos == m_cache.size())
 				m_is_stop_handling = true;
 		}
 
-		return true;
+		if(m_state == http_state_error && !m_want_close)
+			send_error_response(400, "Bad Request");
+
+		compact_cache();
+		return res;
 	}
 	//--------------------------------------------------------------------------------------------
-	inline bool analize_http_method(const boost::smatch& result, http::http_method& method, int& http_ver_major, int& http_ver_minor)
+  template<class t_connection_context>
+	bool simple_http_connection_handler<t_connection_context>::find_line_end(size_t& line_end)
 	{
-		CHECK_AND_ASSERT_MES(result[0].matched, false, "simple_http_connection_handler::analize_http_method() assert failed...");
-		http_ver_major = boost::lexical_cast<int>(result[11]);
-		http_ver_minor = boost::lexical_cast<int>(result[12]);
-		if(result[4].matched)
-			method = http::http_method_get;
-		else if(result[5].matched)
-			method = http::http_method_head;
-		else if(result[6].matched)
-			method = http::http_method_post;
-		else if(result[7].matched)
-			method = http::http_method_put;
-		else 
-			method = http::http_method_etc;
-
+		//lines are looked for once, from where the previous search over this data stopped
+		size_t from = (std::max)(m_scan_pos, m_cache_pos);
+		const void* p = from < m_cache.size() ? memchr(m_cache.data() + from, '\n', m_cache.size() - from) : NULL;
+		if(!p)
+		{
+			m_scan_pos = m_cache.size();
+			return false;
+		}
+		line_end = (const char*)p - m_cache.data();
+		m_scan_pos = line_end + 1;
 		return true;
 	}
-
-  //--------------------------------------------------------------------------------------------
+	//--------------------------------------------------------------------------------------------
+  template<class t_connection_context>
+	void simple_http_connection_handler<t_connection_context>::compact_cache()
+	{
+		//the header area of the request being read is kept for m_request_head
+		size_t keep_from = m_state == http_state_retriving_header ? m_header_start : m_cache_pos;
+		if(keep_from == m_cache.size())
+		{
+			if(m_cache.capacity() > HTTP_MAX_HEADER_LEN)
+				std::string().swap(m_cache);
+			else
+				m_cache.clear();
+			m_cache_pos = m_scan_pos = m_header_start = 0;
+			return;
+		}
+		if(!keep_from)
+			return;
+		m_cache.erase(0, keep_from);
+		m_cache_pos -= keep_from;
+		m_scan_pos = m_scan_pos > keep_from ? m_scan_pos - keep_from : 0;
+		m_header_start = m_header_start > keep_from ? m_header_start - keep_from : 0;
+	}
+	//--------------------------------------------------------------------------------------------
   template<class t_connection_context>
-	bool simple_http_connection_handler<t_connection_context>::handle_invoke_query_line()
+	bool simple_http_connection_handler<t_connection_context>::handle_invoke_query_line(size_t line_end)
 	{ 
 		LOG_FRAME("simple_http_connection_handler<t_connection_context>::handle_recognize_protocol_out(*)", LOG_LEVEL_3);
 
-		STATIC_REGEXP_EXPR_1(rexp_match_command_line, "^(((OPTIONS)|(GET)|(HEAD)|(POST)|(PUT)|(DELETE)|(TRACE)) (\\S+) HTTP/(\\d+).(\\d+))\r?\n", boost::regex::icase | boost::regex::normal);
-		//											    123         4     5      6      7     8        9        10          11     12    
-		//size_t match_len = 0;
-		boost::smatch result;	
-		if(boost::regex_search(m_cache, result, rexp_match_command_line, boost::match_default) && result[0].matched)
-		{
-			analize_http_method(result, m_query_info.m_http_method, m_query_info.m_http_ver_hi, m_query_info.m_http_ver_hi);
-			m_query_info.m_URI = result[10];
-      parse_uri(m_query_info.m_URI, m_query_info.m_uri_content);
-			m_query_info.m_http_method_str = result[2];
-			m_query_info.m_full_request_str = result[0];
-
-			m_cache.erase(m_cache.begin(),  to_nonsonst_iterator(m_cache, result[0].second));
-
-			m_state = http_state_retriving_header;
+		//METHOD SP URI SP HTTP/major.minor [CR] LF
+		const char* begin = m_cache.data() + m_cache_pos;
+		const char* end = m_cache.data() + line_end;
+		if(end != begin && end[-1] == '\r')
+			--end;
+
+		const char* method_end = std::find(begin, end, ' ');
+		const char* version_begin = end;
+		while(version_begin != method_end && version_begin[-1] != ' ')
+			--version_begin;
+		const char* uri_begin = method_end + 1;
+		const char* uri_end = version_begin - 1;
+
+		http::http_method method = http::http_method_unknown;
+		if(http_token_equal(begin, method_end, "GET"))
+			method = http::http_method_get;
+		else if(http_token_equal(begin, method_end, "HEAD"))
+			method = http::http_method_head;
+		else if(http_token_equal(begin, method_end, "POST"))
+			method = http::http_method_post;
+		else if(http_token_equal(begin, method_end, "PUT"))
+			method = http::http_method_put;
+		else if(http_token_equal(begin, method_end, "OPTIONS") || http_token_equal(begin, method_end, "DELETE") || http_token_equal(begin, method_end, "TRACE"))
+			method = http::http_method_etc;
 
-			return true;
-		}else
+		if(http::http_method_unknown == method || method_end == end || version_begin == method_end || uri_begin >= uri_end ||
+			std::find(uri_begin, uri_end, ' ') != uri_end ||
+			!http_parse_version(version_begin, end, m_query_info.m_http_ver_hi, m_query_info.m_http_ver_lo))
 		{
 			m_state = http_state_error;
-			LOG_ERROR("simple_http_connection_handler<t_connection_context>::handle_invoke_query_line(): Failed to match first line: " << m_cache);
+			LOG_ERROR("simple_http_connection_handler<t_connection_context>::handle_invoke_query_line(): Failed to match first line: " << std::string(begin, end));
 			return false;
 		}
 
-		return false;
+		m_query_info.m_http_method = method;
+		m_query_info.m_URI.assign(uri_begin, uri_end);
+		parse_uri(m_query_info.m_URI, m_query_info.m_uri_content);
+		m_query_info.m_http_method_str.assign(begin, method_end);
+		m_query_info.m_full_request_str.assign(m_cache, m_cache_pos, line_end + 1 - m_cache_pos);
+
+		m_cache_pos = line_end + 1;
+		m_header_start = m_cache_pos;
+		m_state = http_state_retriving_header;
+		return true;
 	}
 	//--------------------------------------------------------------------------------------------
   template<class t_connection_context>
-	std::string::size_type simple_http_connection_handler<t_connection_context>::match_end_of_header(const std::string& buf)
+	bool simple_http_connection_handler<t_connection_context>::handle_header_line(size_t line_end)
 	{
+		const char* begin = m_cache.data() + m_cache_pos;
+		const char* end = m_cache.data() + line_end;
+		if(end != begin && end[-1] == '\r')
+			--end;
+		m_cache_pos = line_end + 1;
 
-    //Here we returning head size, including terminating sequence (\r\n\r\n or \n\n)
-		std::string::size_type res = buf.find("\r\n\r\n");
-		if(std::string::npos != res)
-			return res+4;
-		res = buf.find("\n\n");
-		if(std::string::npos != res)
-			return res+2;
-		return res;
+		//empty line ends the header area
+		if(begin == end)
+			return analize_cached_request_header_and_invoke_state();
+
+		if(*begin == ' ' || *begin == '\t')
+		{
+			//obsolete line folding: continues the value of the previous field
+			if(!m_plast_field)
+			{
+				LOG_ERROR("simple_http_connection_handler<t_connection_context>::handle_header_line(): continuation line without field: " << std::string(begin, end));
+				m_state = http_state_error;
+				return false;
+			}
+			http_trim_spaces(begin, end);
+			m_plast_field->append(" ").append(begin, end);
+			return true;
+		}
+
+		const char* name_end = std::find(begin, end, ':');
+		const char* value_begin = name_end + 1;
+		const char* value_end = end;
+		if(name_end == end || name_end == begin)
+		{
+			LOG_ERROR("simple_http_connection_handler<t_connection_context>::handle_header_line(): failed to parse header line: " << std::string(begin, end));
+			m_state = http_state_error;
+			return false;
+		}
+		http_trim_spaces(begin, name_end);
+		http_trim_spaces(value_begin, value_end);
+
+		http_header_info& body_info = m_query_info.m_header_info;
+		std::string* pfield = NULL;
+		if(http_token_equal(begin, name_end, "Connection"))
+			pfield = &body_info.m_connection;
+		else if(http_token_equal(begin, name_end, "Referer"))
+			pfield = &body_info.m_referer;
+		else if(http_token_equal(begin, name_end, "Content-Length"))
+			pfield = &body_info.m_content_length;
+		else if(http_token_equal(begin, name_end, "Content-Type"))
+			pfield = &body_info.m_content_type;
+		else if(http_token_equal(begin, name_end, "Transfer-Encoding"))
+			pfield = &body_info.m_transfer_encoding;
+		else if(http_token_equal(begin, name_end, "Content-Encoding"))
+			pfield = &body_info.m_content_encoding;
+		else if(http_token_equal(begin, name_end, "Host"))
+			pfield = &body_info.m_host;
+		else if(http_token_equal(begin, name_end, "Cookie"))
+			pfield = &body_info.m_cookie;
+		else if(http_token_equal(begin, name_end, "Accept-Encoding"))
+			pfield = &body_info.m_accept_encoding;
+
+		if(pfield)
+		{
+			pfield->assign(value_begin, value_end);
+		}
+		else
+		{
+			body_info.m_etc_fields.push_back(std::pair<std::string, std::string>(std::string(begin, name_end), std::string(value_begin, value_end)));
+			pfield = &body_info.m_etc_fields.back().second;
+		}
+		m_plast_field = pfield;
+		return true;
 	}
 	//--------------------------------------------------------------------------------------------
   template<class t_connection_context>
-	bool simple_http_connection_handler<t_connection_context>::analize_cached_request_header_and_invoke_state(size_t pos)
+	bool simple_http_connection_handler<t_connection_context>::analize_cached_request_header_and_invoke_state()
 	{ 
-		//LOG_PRINT_L4("HTTP HEAD:\r\n" << m_cache.substr(0, pos));
-
 		LOG_FRAME("simple_http_connection_handler<t_connection_context>::analize_cached_request_header_and_invoke_state(*)", LOG_LEVEL_3);
 
-		m_query_info.m_full_request_buf_size = pos;
-    m_query_info.m_request_head.assign(m_cache.begin(), m_cache.begin()+pos); 
+		m_query_info.m_full_request_buf_size = m_cache_pos - m_header_start;
+		m_query_info.m_request_head.assign(m_cache, m_header_start, m_cache_pos - m_header_start);
+		m_plast_field = NULL;
+
+		const http_header_info& header_info = m_query_info.m_header_info;
+		//HTTP/1.1 connections persist unless the client says otherwise, HTTP/1.0 ones only when it asks to
+		if(m_query_info.m_http_ver_hi > 1 || (m_query_info.m_http_ver_hi == 1 && m_query_info.m_http_ver_lo >= 1))
+			m_keep_alive = !http_list_has_token(header_info.m_connection, "close");
+		else
+			m_keep_alive = http_list_has_token(header_info.m_connection, "keep-alive");
 
-		if(!parse_cached_header(m_query_info.m_header_info, m_cache, pos))
+		if(header_info.m_transfer_encoding.size())
 		{
-			LOG_ERROR("simple_http_connection_handler<t_connection_context>::analize_cached_request_header_and_invoke_state(): failed to anilize request header: " << m_cache);
-			m_state = http_state_error;
+			if(!http_list_has_token(header_info.m_transfer_encoding, "chunked"))
+			{
+				LOG_ERROR("simple_http_connection_handler<t_connection_context>::analize_cached_request_header_and_invoke_state(): unsupported transfer encoding: " << header_info.m_transfer_encoding);
+				m_state = http_state_error;
+				return false;
+			}
+			m_state = http_state_retriving_body;
+			m_body_transfer_type = http_body_transfer_chunked;
+			m_chunk_state = http_chunk_size;
+			return true;
 		}
 
-		m_cache.erase(0, pos);
-
-		std::string req_command_str = m_query_info.m_full_request_str;
-    //if we have POST or PUT command, it is very possible tha we will get body
-    //but now, we suppose than we have body only in case of we have "ContentLength" 
-		if(m_query_info.m_header_info.m_content_length.size())
+		//if we have POST or PUT command, it is very possible tha we will get body
+		//but now, we suppose than we have body only in case of we have "ContentLength" 
+		if(header_info.m_content_length.size())
 		{
-			m_state = http_state_retriving_body;
-			m_body_transfer_type = http_body_transfer_measure;
-			if(!get_len_from_content_lenght(m_query_info.m_header_info.m_content_length, m_len_summary))
+			if(!get_len_from_content_lenght(header_info.m_content_length, m_len_summary))
 			{
-				LOG_ERROR("simple_http_connection_handler<t_connection_context>::analize_cached_request_header_and_invoke_state(): Failed to get_len_from_content_lenght();, m_query_info.m_content_length="<<m_query_info.m_header_info.m_content_length);
+				LOG_ERROR("simple_http_connection_handler<t_connection_context>::analize_cached_request_header_and_invoke_state(): Failed to get_len_from_content_lenght();, m_query_info.m_content_length=" << header_info.m_content_length);
 				m_state = http_state_error;
 				return false;
 			}
-			if(0 == m_len_summary)
-			{	//current query finished, next will be next query
-				if(handle_request_and_send_response(m_query_info))
-					set_ready_state();
-				else
-					m_state = http_state_error;
-			}
 			m_len_remain = m_len_summary;
-		}else
-		{//current query finished, next will be next query
-			handle_request_and_send_response(m_query_info);
-			set_ready_state();
+			if(m_len_summary)
+			{
+				m_state = http_state_retriving_body;
+				m_body_transfer_type = http_body_transfer_measure;
+				return true;
+			}
 		}
 
-		return true;
+		//current query finished, next will be next query
+		return handle_request_done();
+	}
+	//-----------------------------------------------------------------------------------
+  template<class t_connection_context>
+	bool simple_http_connection_handler<t_connection_context>::handle_request_done()
+	{
+		if(!handle_request_and_send_response(m_query_info))
+			m_want_close = true;
+		if(m_want_close)
+		{
+			//pipelined requests after this one are not answered
+			m_state = http_state_connection_close;
+			m_is_stop_handling = true;
+			return false;
+		}
+		return set_ready_state();
 	}
 	//-----------------------------------------------------------------------------------
   template<class t_connection_context>
@@ -429,6 +671,7 @@ namespace net_utils
 		case http_body_transfer_measure:
 			return handle_query_measure();
 		case http_body_transfer_chunked:
+			return handle_query_chunked();
 		case http_body_transfer_connection_close:
 		case http_body_transfer_multipart:
 		case http_body_transfer_undefined:
@@ -444,92 +687,146 @@ namespace net_utils
   template<class t_connection_context>
 	bool simple_http_connection_handler<t_connection_context>::handle_query_measure()
 	{
+		size_t len = (std::min)(m_cache.size() - m_cache_pos, m_len_remain);
+		m_query_info.m_body.append(m_cache, m_cache_pos, len);
+		m_cache_pos += len;
+		m_len_remain -= len;
 
-		if(m_len_remain >= m_cache.size())
-		{
-			m_len_remain -= m_cache.size();
-			m_query_info.m_body += m_cache;
-			m_cache.clear();
-		}else
-		{
-			m_query_info.m_body.append(m_cache.begin(), m_cache.begin() + m_len_remain);
-			m_cache.erase(0, m_len_remain);
-			m_len_remain = 0;
-		}
-
-		if(!m_len_remain)
+		if(m_len_remain)
 		{
-			if(handle_request_and_send_response(m_query_info))
-				set_ready_state();
-			else
-				m_state = http_state_error;
+			m_is_stop_handling = true;
+			return true;
 		}
-		return true;
+		return handle_request_done();
 	}
-	//--------------------------------------------------------------------------------------------
+	//-----------------------------------------------------------------------------------
   template<class t_connection_context>
-	bool simple_http_connection_handler<t_connection_context>::parse_cached_header(http_header_info& body_info, const std::string& m_cache_to_process, size_t pos)
-	{ 
-		LOG_FRAME("http_stream_filter::parse_cached_header(*)", LOG_LEVEL_3);
-
-		STATIC_REGEXP_EXPR_1(rexp_mach_field, 
-			"\n?((Connection)|(Referer)|(Content-Length)|(Content-Type)|(Transfer-Encoding)|(Content-Encoding)|(Host)|(Cookie)"
-			//  12            3         4                5              6                   7                  8      9    
-			"|([\\w-]+?)) ?: ?((.*?)(\r?\n))[^\t ]",	
-			//10             1112   13 
-			boost::regex::icase | boost::regex::normal);
-
-		boost::smatch		result;
-		std::string::const_iterator it_current_bound = m_cache_to_process.begin();
-		std::string::const_iterator it_end_bound = m_cache_to_process.begin()+pos;
-
-		body_info.clear();
-
-		//lookup all fields and fill well-known fields
-		while( boost::regex_search( it_current_bound, it_end_bound, result, rexp_mach_field, boost::match_default) && result[0].matched) 
+	bool simple_http_connection_handler<t_connection_context>::handle_query_chunked()
+	{
+		for(;;)
 		{
-			const size_t field_val = 12;
-			const size_t field_etc_name = 10;
-
-			int i = 2; //start position = 2
-			if(result[i++].matched)//"Connection"
-				body_info.m_connection = result[field_val];
-			else if(result[i++].matched)//"Referer"
-				body_info.m_referer = result[field_val];
-			else if(result[i++].matched)//"Content-Length"
-				body_info.m_content_length = result[field_val];
-			else if(result[i++].matched)//"Content-Type"
-				body_info.m_content_type = result[field_val];
-			else if(result[i++].matched)//"Transfer-Encoding"
-				body_info.m_transfer_encoding = result[field_val];
-			else if(result[i++].matched)//"Content-Encoding"
-				body_info.m_content_encoding = result[field_val];
-			else if(result[i++].matched)//"Host"
-				body_info.m_host = result[field_val];
-			else if(result[i++].matched)//"Cookie"
-				body_info.m_cookie = result[field_val];
-			else if(result[i++].matched)//e.t.c (HAVE TO BE MATCHED!)
-				body_info.m_etc_fields.push_back(std::pair<std::string, std::string>(result[field_etc_name], result[field_val]));
-			else
+			size_t line_end = 0;
+			switch(m_chunk_state)
 			{
-				LOG_ERROR("simple_http_connection_handler<t_connection_context>::parse_cached_header() not matched last entry in:"<<m_cache_to_process);
+			case http_chunk_size:
+				{
+					//hex size [; extensions] CRLF
+					if(!find_line_end(line_end))
+					{
+						m_is_stop_handling = true;
+						if(m_cache.size() - m_cache_pos > HTTP_MAX_URI_LEN)
+						{
+							LOG_ERROR("simple_http_connection_handler<t_connection_context>::handle_query_chunked(): Too long chunk size line");
+							m_state = http_state_error;
+							return false;
+						}
+						return true;
+					}
+					const char* p = m_cache.data() + m_cache_pos;
+					const char* end = m_cache.data() + line_end;
+					size_t len = 0;
+					const char* digits_begin = p;
+					for(; p != end; ++p)
+					{
+						int digit = isxdigit((unsigned char)*p) ? (isdigit((unsigned char)*p) ? *p - '0' : tolower((unsigned char)*p) - 'a' + 10) : -1;
+						if(digit < 0)
+							break;
+						if(len > (std::numeric_limits<size_t>::max() >> 4))
+						{
+							digits_begin = p;//overflow
+							break;
+						}
+						len = (len << 4) | digit;
+					}
+					if(p == digits_begin || (p != end && *p != ';' && *p != '\r' && *p != ' ' && *p != '\t'))
+					{
+						LOG_ERROR("simple_http_connection_handler<t_connection_context>::handle_query_chunked(): failed to parse chunk size: " << std::string(m_cache.data() + m_cache_pos, end));
+						m_state = http_state_error;
+						return false;
+					}
+					m_cache_pos = line_end + 1;
+					m_len_remain = len;
+					m_len_summary += len;
+					m_chunk_state = len ? http_chunk_data : http_chunk_trailer;
+					break;
+				}
+			case http_chunk_data:
+				{
+					size_t len = (std::min)(m_cache.size() - m_cache_pos, m_len_remain);
+					m_query_info.m_body.append(m_cache, m_cache_pos, len);
+					m_cache_pos += len;
+					m_len_remain -= len;
+					if(m_len_remain)
+					{
+						m_is_stop_handling = true;
+						return true;
+					}
+					m_chunk_state = http_chunk_data_end;
+					break;
+				}
+			case http_chunk_data_end:
+				{
+					//CRLF right after the data
+					if(!find_line_end(line_end))
+					{
+						m_is_stop_handling = true;
+						if(m_cache.size() - m_cache_pos > 1)
+						{
+							LOG_ERROR("simple_http_connection_handler<t_connection_context>::handle_query_chunked(): chunk data is longer than its size");
+							m_state = http_state_error;
+							return false;
+						}
+						return true;
+					}
+					if(line_end - m_cache_pos > 1 || (line_end != m_cache_pos && m_cache[m_cache_pos] != '\r'))
+					{
+						LOG_ERROR("simple_http_connection_handler<t_connection_context>::handle_query_chunked(): chunk data is longer than its size");
+						m_state = http_state_error;
+						return false;
+					}
+					m_cache_pos = line_end + 1;
+					m_chunk_state = http_chunk_size;
+					break;
+				}
+			case http_chunk_trailer:
+				{
+					//trailer fields are skipped up to the empty line ending the request
+					if(!find_line_end(line_end))
+					{
+						m_is_stop_handling = true;
+						if(m_cache.size() - m_cache_pos > HTTP_MAX_HEADER_LEN)
+						{
+							LOG_ERROR("simple_http_connection_handler<t_connection_context>::handle_query_chunked(): Too long trailer");
+							m_state = http_state_error;
+							return false;
+						}
+						return true;
+					}
+					bool is_last = line_end == m_cache_pos || (line_end - m_cache_pos == 1 && m_cache[m_cache_pos] == '\r');
+					m_cache_pos = line_end + 1;
+					if(is_last)
+						return handle_request_done();
+					break;
+				}
 			}
-
-			it_current_bound = result[(int)result.size()-1]. first;
 		}
-		return  true;
 	}
 	//-----------------------------------------------------------------------------------
   template<class t_connection_context>
 	bool simple_http_connection_handler<t_connection_context>::get_len_from_content_lenght(const std::string& str, size_t& OUT len)
 	{
-		STATIC_REGEXP_EXPR_1(rexp_mach_field, "\\d+", boost::regex::normal);
-		std::string res;
-		boost::smatch result;
-		if(!(boost::regex_search( str, result, rexp_mach_field, boost::match_default) && result[0].matched))
+		const char* p = str.data();
+		const char* end = p + str.size();
+		http_trim_spaces(p, end);
+		if(p == end)
 			return false;
-
-		len = boost::lexical_cast<size_t>(result[0]);
+		len = 0;
+		for(; p != end; ++p)
+		{
+			if(*p < '0' || *p > '9' || len > (std::numeric_limits<size_t>::max() - 9) / 10)
+				return false;
+			len = len * 10 + (*p - '0');
+		}
 		return true;
 	}
 	//-----------------------------------------------------------------------------------
@@ -540,17 +837,55 @@ namespace net_utils
 		bool res = handle_request(query_info, response);
 		//CHECK_AND_ASSERT_MES(res, res, "handle_request(query_info, response) returned false" );
 
+		compress_response(query_info, response);
 		std::string response_data = get_response_header(response);
 		
 		//LOG_PRINT_L0("HTTP_SEND: << \r\n" << response_data + response.m_body);
     LOG_PRINT_L3("HTTP_RESPONSE_HEAD: << \r\n" << response_data);
-		
-		m_psnd_hndlr->do_send((void*)response_data.data(), response_data.size());
-		if(response.m_body.size())
-			m_psnd_hndlr->do_send((void*)response.m_body.data(), response.m_body.size());
+
+		//head and body go out as one queue entry, the body is handed over, not copied;
+		//answer to HEAD has no body, or the next pipelined response would be taken for it
+		shared_buffer body;
+		if(response.m_body.size() && query_info.m_http_method != http::http_method_head)
+			body = boost::make_shared<std::string>(std::move(response.m_body));
+		m_psnd_hndlr->do_send_shared(response_data, body, false);
 		return res;
 	}
 	//-----------------------------------------------------------------------------------
+  template<class t_connection_context>
+	bool simple_http_connection_handler<t_connection_context>::compress_response(const http_request_info& query_info, http_response_info& response)
+	{
+#ifdef HTTP_ENABLE_GZIP
+		if(!m_config.m_gzip_level || response.m_body.empty() || response.m_body.size() < m_config.m_gzip_min_size)
+			return false;
+		if(response.m_header_info.m_content_encoding.size() || !http_accepts_gzip(query_info.m_header_info.m_accept_encoding))
+			return false;
+
+		std::string packed;
+		if(!gzip_compress(response.m_body, packed, m_config.m_gzip_level) || packed.size() >= response.m_body.size())
+			return false;
+
+		LOG_PRINT_L3("HTTP response body gzipped: " << response.m_body.size() << " -> " << packed.size() << " bytes");
+		response.m_body.swap(packed);
+		response.m_header_info.m_content_encoding = "gzip";
+		return true;
+#else
+		return false;
+#endif
+	}
+	//-----------------------------------------------------------------------------------
+  template<class t_connection_context>
+	bool simple_http_connection_handler<t_connection_context>::send_error_response(int code, const std::string& comment)
+	{
+		http_response_info response;
+		response.m_response_code = code;
+		response.m_response_comment = comment;
+		response.m_mime_tipe = "text/plain";
+		m_keep_alive = false;
+		std::string response_data = get_response_header(response);
+		return m_psnd_hndlr->do_send(response_data.data(), response_data.size());
+	}
+	//-----------------------------------------------------------------------------------
   template<class t_connection_context>
 	bool simple_http_connection_handler<t_connection_context>::handle_request(const http::http_request_info& query_info, http_response_info& response)
 	{
@@ -592,6 +927,11 @@ namespace net_utils
 		buf += boost::lexical_cast<std::string>(response.m_body.size()) + "\r\n";
 		buf += "Content-Type: ";
 		buf += response.m_mime_tipe + "\r\n";
+		if(response.m_header_info.m_content_encoding.size())
+		{
+			buf += "Content-Encoding: " + response.m_header_info.m_content_encoding + "\r\n";
+			buf += "Vary: Accept-Encoding\r\n";
+		}
 
 		buf += "Last-Modified: ";
 		time_t tm;
@@ -600,16 +940,16 @@ namespace net_utils
 		buf += "Accept-Ranges: bytes\r\n";
 		//Wed, 01 Dec 2010 03:27:41 GMT"
 
-		string_tools::trim(m_query_info.m_header_info.m_connection);
-		if(m_query_info.m_header_info.m_connection.size())
+		if(!m_keep_alive)
 		{
-			if(!string_tools::compare_no_case("close", m_query_info.m_header_info.m_connection))
-			{
-        //closing connection after sending
-				buf += "Connection: close\r\n";
-				m_state = http_state_connection_close;
-				m_want_close = true;
-			}
+			//closing connection after sending
+			buf += "Connection: close\r\n";
+			m_state = http_state_connection_close;
+			m_want_close = true;
+		}
+		else if(m_query_info.m_http_ver_hi == 1 && m_query_info.m_http_ver_lo == 0)
+		{
+			buf += "Connection: keep-alive\r\n";
 		}
 		//add additional fields, if it is
 		for(fields_list::const_iterator it = response.m_additional_fields.begin(); it!=response.m_additional_fields.end(); it++)
@@ -0,0 +1,127 @@
+// Copyright (c) 2006-2013, Andrey N. Sabelnikov, www.sabelnikov.net
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+// * Neither the name of the Andrey N. Sabelnikov nor the
+// names of its contributors may be used to endorse or promote products
+// derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER  BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+
+
+
+#pragma once
+
+#include <map>
+#include <sstream>
+#include <string>
+#include <stdint.h>
+
+#include "misc_os_dependent.h"
+#include "syncobj.h"
+#include "storages/portable_storage_to_json.h"
+
+//placeholder the JSON-RPC "id" is serialized as in cached responses, see MAP_JON_RPC_CACHED
+#define HTTP_RESPONSE_CACHE_ID_PLACEHOLDER "@response_cache_id@"
+
+namespace epee
+{
+namespace net_utils
+{
+namespace http
+{
+  /************************************************************************/
+  /* Serialized responses, served while the version they were made for is */
+  /* current. Version is whatever the owner bumps on each change of the   */
+  /* data behind the responses, it has to grow monotonically.             */
+  /************************************************************************/
+  class response_cache
+  {
+  public:
+    response_cache(size_t max_entries = 1024): m_version(0), m_max_entries(max_entries)
+    {}
+
+    //max_age_ms limits entries made from data that changes without a version bump, 0 means no limit
+    bool get(const std::string& key, uint64_t version, uint64_t max_age_ms, std::string& body)
+    {
+      CRITICAL_REGION_LOCAL(m_lock);
+      if(version != m_version)
+        return false;
+      auto it = m_entries.find(key);
+      if(it == m_entries.end())
+        return false;
+      if(max_age_ms && misc_utils::get_tick_count() - it->second.m_created > max_age_ms)
+        return false;
+      body = it->second.m_body;
+      return true;
+    }
+
+    void put(const std::string& key, uint64_t version, const std::string& body)
+    {
+      CRITICAL_REGION_LOCAL(m_lock);
+      if(version < m_version)
+        return; //made from data that is already gone
+      if(version != m_version)
+      {
+        m_entries.clear();
+        m_version = version;
+      }
+      //keys come from requests, don't let them grow the cache without a limit
+      if(m_entries.size() >= m_max_entries && !m_entries.count(key))
+        m_entries.clear();
+      entry& e = m_entries[key];
+      e.m_created = misc_utils::get_tick_count();
+      e.m_body = body;
+    }
+
+    void clear()
+    {
+      CRITICAL_REGION_LOCAL(m_lock);
+      m_entries.clear();
+    }
+
+  private:
+    struct entry
+    {
+      uint64_t m_created;
+      std::string m_body;
+    };
+
+    critical_section m_lock;
+    uint64_t m_version;
+    size_t m_max_entries;
+    std::map<std::string, entry> m_entries;
+  };
+
+  //puts request "id" in place of the placeholder of a cached JSON-RPC response
+  inline bool set_cached_json_rpc_id(std::string& body, const epee::serialization::storage_entry& id)
+  {
+    static const std::string placeholder = "\"" HTTP_RESPONSE_CACHE_ID_PLACEHOLDER "\"";
+    size_t pos = body.find(placeholder);
+    if(std::string::npos == pos)
+      return false;
+    std::stringstream ss;
+    epee::serialization::dump_as_json(ss, id, 1, true);
+    body.replace(pos, placeholder.size(), ss.str());
+    return true;
+  }
+}
+}
+}
@@ -27,6 +27,7 @@
 
 #pragma once 
 #include "http_base.h"
+#include "http_response_cache.h"
 #include "jsonrpc_structs.h"
 #include "storages/portable_storage.h"
 #include "storages/portable_storage_template_helper.h"
@@ -80,6 +81,42 @@
       LOG_PRINT( s_pattern << " processed with " << ticks1-ticks << "/"<< ticks2-ticks1 << "/" << ticks3-ticks2 << "ms", LOG_LEVEL_2); \
     }
 
+//cached variants of the handlers below expect in the server class:
+//  m_response_cache - epee::net_utils::http::response_cache
+//  get_response_cache_version() - version of the data responses are made from
+//  can_cache_response(const response_type&) - false for responses that must not be reused, like "busy" ones
+#define MAP_URI_CACHED_JON2(s_pattern, callback_f, command_type, max_age_ms) \
+    else if(query_info.m_URI == s_pattern) \
+    { \
+      handled = true; \
+      uint64_t ticks = misc_utils::get_tick_count(); \
+      boost::value_initialized<command_type::request> req; \
+      bool parse_res = epee::serialization::load_t_from_json(static_cast<command_type::request&>(req), query_info.m_body); \
+      CHECK_AND_ASSERT_MES(parse_res, false, "Failed to parse json: \r\n" << query_info.m_body); \
+      uint64_t cache_version = get_response_cache_version(); \
+      std::string cache_key; \
+      epee::serialization::store_t_to_json(static_cast<command_type::request&>(req), cache_key, 0, false); \
+      cache_key = query_info.m_URI + "\n" + cache_key; \
+      bool cached = m_response_cache.get(cache_key, cache_version, max_age_ms, response_info.m_body); \
+      if(!cached) \
+      { \
+        boost::value_initialized<command_type::response> resp;\
+        if(!callback_f(static_cast<command_type::request&>(req), static_cast<command_type::response&>(resp), m_conn_context)) \
+        { \
+          LOG_ERROR("Failed to " << #callback_f << "()"); \
+          response_info.m_response_code = 500; \
+          response_info.m_response_comment = "Internal Server Error"; \
+          return true; \
+        } \
+        epee::serialization::store_t_to_json(static_cast<command_type::response&>(resp), response_info.m_body); \
+        if(can_cache_response(static_cast<command_type::response&>(resp))) \
+          m_response_cache.put(cache_key, cache_version, response_info.m_body); \
+      } \
+      response_info.m_mime_tipe = "application/json"; \
+      response_info.m_header_info.m_content_type = " application/json"; \
+      LOG_PRINT( s_pattern << " processed with " << misc_utils::get_tick_count()-ticks << "ms" << (cached ? " (cached)" : ""), LOG_LEVEL_2); \
+    }
+
 #define MAP_URI_AUTO_BIN2(s_pattern, callback_f, command_type) \
     else if(query_info.m_URI == s_pattern) \
     { \
@@ -216,6 +253,66 @@
   return true;\
 }
 
+//the response is cached with a placeholder for "id", each request gets its own "id" put in
+#define MAP_JON_RPC_CACHED_BEGIN(method_name, command_type, max_age_ms) \
+  PREPARE_OBJECTS_FROM_JSON(command_type) \
+  uint64_t cache_version = get_response_cache_version(); \
+  std::string cache_key; \
+  { \
+    /*params may be a plain container, the whole request without its id is the key*/ \
+    epee::serialization::storage_entry request_id = req.id; \
+    req.id = epee::serialization::storage_entry(); \
+    epee::serialization::store_t_to_json(req, cache_key, 0, false); \
+    req.id = request_id; \
+  } \
+  bool cached = m_response_cache.get(cache_key, cache_version, max_age_ms, response_info.m_body); \
+  if(!cached) \
+  {
+
+#define MAP_JON_RPC_CACHED_END(method_name) \
+    resp.id = epee::serialization::storage_entry(std::string(HTTP_RESPONSE_CACHE_ID_PLACEHOLDER)); \
+    epee::serialization::store_t_to_json(resp, response_info.m_body); \
+    if(can_cache_response(resp.result)) \
+      m_response_cache.put(cache_key, cache_version, response_info.m_body); \
+  } \
+  epee::net_utils::http::set_cached_json_rpc_id(response_info.m_body, req.id); \
+  response_info.m_mime_tipe = "application/json"; \
+  response_info.m_header_info.m_content_type = " application/json"; \
+  LOG_PRINT( query_info.m_URI << "[" << method_name << "] processed with " << ticks1-ticks << "/" << epee::misc_utils::get_tick_count()-ticks1 << "ms" << (cached ? " (cached)" : ""), LOG_LEVEL_2); \
+  return true;
+
+#define MAP_JON_RPC_CACHED(method_name, callback_f, command_type, max_age_ms) \
+    else if(callback_name == method_name) \
+{ \
+  MAP_JON_RPC_CACHED_BEGIN(method_name, command_type, max_age_ms) \
+    if(!callback_f(req.params, resp.result, m_conn_context)) \
+    { \
+      epee::json_rpc::error_response fail_resp = AUTO_VAL_INIT(fail_resp); \
+      fail_resp.jsonrpc = "2.0"; \
+      fail_resp.id = req.id; \
+      fail_resp.error.code = -32603; \
+      fail_resp.error.message = "Internal error"; \
+      epee::serialization::store_t_to_json(static_cast<epee::json_rpc::error_response&>(fail_resp), response_info.m_body); \
+      return true; \
+    } \
+  MAP_JON_RPC_CACHED_END(method_name) \
+}
+
+#define MAP_JON_RPC_WE_CACHED(method_name, callback_f, command_type, max_age_ms) \
+    else if(callback_name == method_name) \
+{ \
+  MAP_JON_RPC_CACHED_BEGIN(method_name, command_type, max_age_ms) \
+    epee::json_rpc::error_response fail_resp = AUTO_VAL_INIT(fail_resp); \
+    fail_resp.jsonrpc = "2.0"; \
+    fail_resp.id = req.id; \
+    if(!callback_f(req.params, resp.result, fail_resp.error, m_conn_context)) \
+    { \
+      epee::serialization::store_t_to_json(static_cast<epee::json_rpc::error_response&>(fail_resp), response_info.m_body); \
+      return true; \
+    } \
+  MAP_JON_RPC_CACHED_END(method_name) \
+}
+
 #define END_JSON_RPC_MAP() \
   epee::json_rpc::error_response rsp; \
   rsp.id = id_; \
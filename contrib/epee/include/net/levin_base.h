@@ -69,6 +69,7 @@ namespace levin
 
 #define LEVIN_DEFAULT_TIMEOUT_PRECONFIGURED 0
 #define LEVIN_DEFAULT_MAX_PACKET_SIZE 100000000      //100MB by default
+#define LEVIN_RECV_BUFFER_RESERVE_MAX 1048576        //packet body memory reserved before the data arrives
 
 #define LEVIN_PACKET_REQUEST			0x00000001
 #define LEVIN_PACKET_RESPONSE		0x00000002
@@ -72,6 +72,7 @@ public:
   int invoke_async(int command, const std::string& in_buff, boost::uuids::uuid connection_id, callback_t cb, size_t timeout = LEVIN_DEFAULT_TIMEOUT_PRECONFIGURED);
 
   int notify(int command, const std::string& in_buff, boost::uuids::uuid connection_id);
+  int notify(int command, const net_utils::shared_buffer& in_buff, boost::uuids::uuid connection_id, bool urgent = false);
   bool close(boost::uuids::uuid connection_id);
   bool update_connection_context(const t_connection_context& contxt);
   bool request_callback(boost::uuids::uuid connection_id);
@@ -119,7 +120,9 @@ public:
   config_type& m_config;
   t_connection_context& m_connection_context;
 
-  std::string m_cache_in_buffer;
+  char m_head_buff[sizeof(bucket_head2)];
+  size_t m_head_size;
+  std::string m_cache_in_buffer; //body of the current packet
   stream_state m_state;
 
   int32_t m_oponent_protocol_ver;
@@ -216,6 +219,7 @@ public:
             m_pservice_endpoint(psnd_hndlr), 
             m_config(config), 
             m_connection_context(conn_context), 
+            m_head_size(0),
             m_state(stream_state_head)
   {
     m_close_called = 0;
@@ -315,37 +319,38 @@ public:
       return false;
     }
 
-    if(m_cache_in_buffer.size() +  cb > m_config.m_max_packet_size)
+    if(m_head_size + m_cache_in_buffer.size() +  cb > m_config.m_max_packet_size)
     {
       LOG_ERROR_CC(m_connection_context, "Maximum packet size exceed!, m_max_packet_size = " << m_config.m_max_packet_size 
-                          << ", packet received " << m_cache_in_buffer.size() +  cb 
+                          << ", packet received " << m_head_size + m_cache_in_buffer.size() +  cb 
                           << ", connection will be closed.");
       return false;
     }
 
-    m_cache_in_buffer.append((const char*)ptr, cb);
-
-    bool is_continue = true;
-    while(is_continue)
+    // Bytes are copied once, straight to their place in the header or in the body of the current
+    // packet, and a complete body is handed out by swap. Nothing is ever shifted: the body buffer
+    // only holds the current packet and is reserved up front (up to LEVIN_RECV_BUFFER_RESERVE_MAX).
+    const char* pdata = (const char*)ptr;
+    size_t left = cb;
+    while(true)
     {
       switch(m_state)
       {
       case stream_state_body:
-        if(m_cache_in_buffer.size() < m_current_head.m_cb)
-        {
-          is_continue = false;
-          break;
-        }
         {
-          std::string buff_to_invoke;
-          if(m_cache_in_buffer.size()  == m_current_head.m_cb)
-            buff_to_invoke.swap(m_cache_in_buffer);
-          else
+          size_t n = std::min<size_t>(left, (size_t)m_current_head.m_cb - m_cache_in_buffer.size());
+          m_cache_in_buffer.append(pdata, n);
+          pdata += n;
+          left -= n;
+          if(m_cache_in_buffer.size() < m_current_head.m_cb)
           {
-            buff_to_invoke.assign(m_cache_in_buffer, 0, (std::string::size_type)m_current_head.m_cb);
-            m_cache_in_buffer.erase(0, (std::string::size_type)m_current_head.m_cb);
+            m_pservice_endpoint->set_recv_hint((size_t)m_current_head.m_cb - m_cache_in_buffer.size());
+            return true;
           }
 
+          std::string buff_to_invoke;
+          buff_to_invoke.swap(m_cache_in_buffer);
+
           bool is_response = (m_oponent_protocol_ver == LEVIN_PROTOCOL_VER_1 && m_current_head.m_flags&LEVIN_PACKET_RESPONSE);
 
           LOG_PRINT_CC_L4(m_connection_context, "LEVIN_PACKET_RECIEVED. [len=" << m_current_head.m_cb 
@@ -402,10 +407,10 @@ public:
               m_current_head.m_have_to_return_data = false;
               m_current_head.m_protocol_version = LEVIN_PROTOCOL_VER_1;
               m_current_head.m_flags = LEVIN_PACKET_RESPONSE;
-              std::string send_buff((const char*)&m_current_head, sizeof(m_current_head));
-              send_buff += return_buff;
+              std::string send_head((const char*)&m_current_head, sizeof(m_current_head));
+              net_utils::shared_buffer send_body = boost::make_shared<std::string>(std::move(return_buff));
               CRITICAL_REGION_BEGIN(m_send_lock);
-              if(!m_pservice_endpoint->do_send(send_buff.data(), send_buff.size()))
+              if(!m_pservice_endpoint->do_send_shared(send_head, send_body, true))
                 return false;
               CRITICAL_REGION_END();
               LOG_PRINT_CC_L4(m_connection_context, "LEVIN_PACKET_SENT. [len=" << m_current_head.m_cb 
@@ -419,29 +424,36 @@ public:
           }
         }
         m_state = stream_state_head;
+        m_pservice_endpoint->set_recv_hint(0);
         break;
       case stream_state_head:
         {
-          if(m_cache_in_buffer.size() < sizeof(bucket_head2))
+          if(!left)
+            return true;
+          size_t n = std::min(left, sizeof(bucket_head2) - m_head_size);
+          memcpy(m_head_buff + m_head_size, pdata, n);
+          m_head_size += n;
+          pdata += n;
+          left -= n;
+          if(m_head_size < sizeof(bucket_head2))
           {
-            if(m_cache_in_buffer.size() >= sizeof(uint64_t) && *((uint64_t*)m_cache_in_buffer.data()) != LEVIN_SIGNATURE)
+            if(m_head_size >= sizeof(uint64_t) && *((uint64_t*)m_head_buff) != LEVIN_SIGNATURE)
             {
               LOG_ERROR_CC(m_connection_context, "Signature mismatch, connection will be closed");
               return false;
             }
-            is_continue = false;
-            break;
+            return true;
           }
 
-          bucket_head2* phead = (bucket_head2*)m_cache_in_buffer.data();
+          bucket_head2* phead = (bucket_head2*)m_head_buff;
           if(LEVIN_SIGNATURE != phead->m_signature)
           {
             LOG_ERROR_CC(m_connection_context, "Signature mismatch, connection will be closed");
             return false;
           }
           m_current_head = *phead;
+          m_head_size = 0;
 
-          m_cache_in_buffer.erase(0, sizeof(bucket_head2));
           m_state = stream_state_body;
           m_oponent_protocol_ver = m_current_head.m_protocol_version;
           if(m_current_head.m_cb > m_config.m_max_packet_size)
@@ -451,6 +463,7 @@ public:
               << ", connection will be closed.");
             return false;
           }
+          m_cache_in_buffer.reserve(std::min<size_t>((size_t)m_current_head.m_cb, LEVIN_RECV_BUFFER_RESERVE_MAX));
         }
         break;
       default:
@@ -458,8 +471,6 @@ public:
         return false;
       }
     }
-
-    return true;
   }
 
   bool after_init_connection()
@@ -510,14 +521,7 @@ public:
       boost::interprocess::ipcdetail::atomic_write32(&m_invoke_buf_ready, 0);
       CRITICAL_REGION_BEGIN(m_send_lock);
       CRITICAL_REGION_LOCAL1(m_invoke_response_handlers_lock);
-      if(!m_pservice_endpoint->do_send(&head, sizeof(head)))
-      {
-        LOG_ERROR_CC(m_connection_context, "Failed to do_send");
-        err_code = LEVIN_ERROR_CONNECTION;
-        break;
-      }
-
-      if(!m_pservice_endpoint->do_send(in_buff.data(), (int)in_buff.size()))
+      if(!m_pservice_endpoint->do_send_shared(std::string((const char*)&head, sizeof(head)), boost::make_shared<std::string>(in_buff), true))
       {
         LOG_ERROR_CC(m_connection_context, "Failed to do_send");
         err_code = LEVIN_ERROR_CONNECTION;
@@ -567,13 +571,7 @@ public:
 
     boost::interprocess::ipcdetail::atomic_write32(&m_invoke_buf_ready, 0);
     CRITICAL_REGION_BEGIN(m_send_lock);
-    if(!m_pservice_endpoint->do_send(&head, sizeof(head)))
-    {
-      LOG_ERROR_CC(m_connection_context, "Failed to do_send");
-      return LEVIN_ERROR_CONNECTION;
-    }
-
-    if(!m_pservice_endpoint->do_send(in_buff.data(), (int)in_buff.size()))
+    if(!m_pservice_endpoint->do_send_shared(std::string((const char*)&head, sizeof(head)), boost::make_shared<std::string>(in_buff), true))
     {
       LOG_ERROR_CC(m_connection_context, "Failed to do_send");
       return LEVIN_ERROR_CONNECTION;
@@ -612,6 +610,12 @@ public:
   }
 
   int notify(int command, const std::string& in_buff)
+  {
+    return notify(command, boost::make_shared<std::string>(in_buff));
+  }
+
+  //invoke requests and responses are always urgent, notifications only when asked
+  int notify(int command, const net_utils::shared_buffer& in_buff, bool urgent = false)
   {
     misc_utils::auto_scope_leave_caller scope_exit_handler = misc_utils::create_scope_leave_handler(
                           boost::bind(&async_protocol_handler::finish_outer_call, this));
@@ -627,23 +631,17 @@ public:
     bucket_head2 head = {0};
     head.m_signature = LEVIN_SIGNATURE;
     head.m_have_to_return_data = false;
-    head.m_cb = in_buff.size();
+    head.m_cb = in_buff->size();
 
     head.m_command = command;
     head.m_protocol_version = LEVIN_PROTOCOL_VER_1;
     head.m_flags = LEVIN_PACKET_REQUEST;
     CRITICAL_REGION_BEGIN(m_send_lock);
-    if(!m_pservice_endpoint->do_send(&head, sizeof(head)))
+    if(!m_pservice_endpoint->do_send_shared(std::string((const char*)&head, sizeof(head)), in_buff, urgent))
     {
       LOG_ERROR_CC(m_connection_context, "Failed to do_send()");
       return -1;
     }
-
-    if(!m_pservice_endpoint->do_send(in_buff.data(), (int)in_buff.size()))
-    {
-      LOG_ERROR("Failed to do_send()");
-      return -1;
-    }
     CRITICAL_REGION_END();
     LOG_PRINT_CC_L4(m_connection_context, "LEVIN_PACKET_SENT. [len=" << head.m_cb << 
       ", f=" << head.m_flags << 
@@ -741,6 +739,14 @@ int async_protocol_handler_config<t_connection_context>::notify(int command, con
 }
 //------------------------------------------------------------------------------------------
 template<class t_connection_context>
+int async_protocol_handler_config<t_connection_context>::notify(int command, const net_utils::shared_buffer& in_buff, boost::uuids::uuid connection_id, bool urgent)
+{
+  async_protocol_handler<t_connection_context>* aph;
+  int r = find_and_lock_connection(connection_id, aph);
+  return LEVIN_OK == r ? aph->notify(command, in_buff, urgent) : r;
+}
+//------------------------------------------------------------------------------------------
+template<class t_connection_context>
 bool async_protocol_handler_config<t_connection_context>::close(boost::uuids::uuid connection_id)
 {
   CRITICAL_REGION_LOCAL(m_connects_lock);
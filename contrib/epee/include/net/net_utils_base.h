@@ -30,6 +30,7 @@
 #define _NET_UTILS_BASE_H_
 
 #include <boost/uuid/uuid.hpp>
+#include <boost/shared_ptr.hpp>
 #include "string_tools.h"
 
 #ifndef MAKE_IP
@@ -55,6 +56,9 @@ namespace net_utils
     time_t   m_last_send;
     uint64_t m_recv_cnt;
     uint64_t m_send_cnt;
+    uint64_t m_recv_speed;     //bytes per second, recent average
+    uint64_t m_send_speed;     //bytes per second, recent average
+    uint64_t m_send_que_bytes; //queued for sending, not sent yet
 
     connection_context_base(boost::uuids::uuid connection_id,
                             long remote_ip, int remote_port, bool is_income,
@@ -68,7 +72,10 @@ namespace net_utils
                                             m_last_recv(last_recv),
                                             m_last_send(last_send),
                                             m_recv_cnt(recv_cnt),
-                                            m_send_cnt(send_cnt)
+                                            m_send_cnt(send_cnt),
+                                            m_recv_speed(0),
+                                            m_send_speed(0),
+                                            m_send_que_bytes(0)
     {}
 
     connection_context_base(): m_connection_id(),
@@ -79,7 +86,10 @@ namespace net_utils
                                m_last_recv(0),
                                m_last_send(0),
                                m_recv_cnt(0),
-                               m_send_cnt(0)
+                               m_send_cnt(0),
+                               m_recv_speed(0),
+                               m_send_speed(0),
+                               m_send_que_bytes(0)
     {}
 
     connection_context_base& operator=(const connection_context_base& a)
@@ -99,12 +109,26 @@ namespace net_utils
 
 	};
 
+  // immutable buffer that may be queued on several connections at once
+  typedef boost::shared_ptr<const std::string> shared_buffer;
+
 	/************************************************************************/
 	/*                                                                      */
 	/************************************************************************/
 	struct i_service_endpoint
 	{
 		virtual bool do_send(const void* ptr, size_t cb)=0;
+    //sends head followed by body as one queue entry, body is referenced, not copied, by endpoints that support it;
+    //urgent data goes ahead of queued data that is not and isn't held back by bandwidth limits
+    virtual bool do_send_shared(const std::string& head, const shared_buffer& body, bool urgent)
+    {
+      std::string buff = head;
+      if(body)
+        buff += *body;
+      return do_send(buff.data(), buff.size());
+    }
+    //number of bytes the protocol handler is waiting for (rest of the current frame), 0 if none in progress
+    virtual void set_recv_hint(size_t cb) {}
     virtual bool close()=0;
     virtual bool call_run_once_service_io()=0;
     virtual bool request_callback()=0;
@@ -0,0 +1,141 @@
+// Copyright (c) 2006-2013, Andrey N. Sabelnikov, www.sabelnikov.net
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+// * Neither the name of the Andrey N. Sabelnikov nor the
+// names of its contributors may be used to endorse or promote products
+// derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER  BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <stdint.h>
+
+#include "syncobj.h"
+
+namespace epee
+{
+namespace net_utils
+{
+  /************************************************************************/
+  /* Token bucket: up to one second of traffic may go through at once,   */
+  /* bigger chunks put the bucket in debt and following ones wait it out */
+  /************************************************************************/
+  class rate_limiter
+  {
+  public:
+    rate_limiter(uint64_t rate = 0): m_rate(rate), m_tokens(rate),
+      m_last_update(std::chrono::steady_clock::now()), m_window_start(m_last_update), m_window_bytes(0), m_average(0)
+    {}
+
+    //bytes per second, 0 means unlimited
+    void set_rate(uint64_t rate)
+    {
+      if(rate == m_rate.load(std::memory_order_relaxed))
+        return;
+      CRITICAL_REGION_LOCAL(m_lock);
+      m_rate = rate;
+      if(m_tokens > (int64_t)rate)
+        m_tokens = rate;
+    }
+
+    uint64_t get_rate() const { return m_rate.load(std::memory_order_relaxed); }
+
+    //milliseconds to wait before more data may go through, 0 if it may go now
+    uint64_t get_wait_ms()
+    {
+      CRITICAL_REGION_LOCAL(m_lock);
+      update(std::chrono::steady_clock::now());
+      if(!m_rate || m_tokens >= 0)
+        return 0;
+      return (uint64_t)(-m_tokens) * 1000 / m_rate + 1;
+    }
+
+    //accounts bytes that went through
+    void take(size_t cb)
+    {
+      CRITICAL_REGION_LOCAL(m_lock);
+      update(std::chrono::steady_clock::now());
+      m_window_bytes += cb;
+      if(m_rate)
+        m_tokens -= cb;
+    }
+
+    //bytes per second over the last completed measurement window
+    uint64_t get_average()
+    {
+      CRITICAL_REGION_LOCAL(m_lock);
+      update(std::chrono::steady_clock::now());
+      return m_average;
+    }
+
+  private:
+    void update(const std::chrono::steady_clock::time_point& now)
+    {
+      uint64_t rate = m_rate;
+      uint64_t elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(now - m_last_update).count();
+      elapsed_us = (std::min)(elapsed_us, (uint64_t)3600 * 1000000); //keeps rate * elapsed_us in range
+      if(rate && elapsed_us)
+      {
+        m_tokens += (int64_t)(rate * elapsed_us / 1000000);
+        if(m_tokens > (int64_t)rate)
+          m_tokens = rate;
+      }
+      if(!rate || elapsed_us * rate >= 1000000)
+        m_last_update = now; //otherwise keep the fraction of a byte for the next call
+
+      uint64_t window_ms = std::chrono::duration_cast<std::chrono::milliseconds>(now - m_window_start).count();
+      if(window_ms >= 2000)
+      {
+        m_average = m_window_bytes * 1000 / window_ms;
+        m_window_bytes = 0;
+        m_window_start = now;
+      }
+    }
+
+    critical_section m_lock;
+    std::atomic<uint64_t> m_rate;
+    int64_t m_tokens;
+    std::chrono::steady_clock::time_point m_last_update;
+    std::chrono::steady_clock::time_point m_window_start;
+    uint64_t m_window_bytes;
+    uint64_t m_average;
+  };
+
+  /************************************************************************/
+  /*                                                                      */
+  /************************************************************************/
+  struct bandwidth_limits
+  {
+    rate_limiter m_upload;   //whole server
+    rate_limiter m_download; //whole server
+    std::atomic<uint64_t> m_peer_upload_rate;   //each connection, bytes per second, 0 means unlimited
+    std::atomic<uint64_t> m_peer_download_rate; //each connection, bytes per second, 0 means unlimited
+
+    bandwidth_limits(): m_peer_upload_rate(0), m_peer_download_rate(0)
+    {}
+  };
+}
+}
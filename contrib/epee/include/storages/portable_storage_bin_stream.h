@@ -0,0 +1,632 @@
+// Copyright (c) 2006-2013, Andrey N. Sabelnikov, www.sabelnikov.net
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+// * Neither the name of the Andrey N. Sabelnikov nor the
+// names of its contributors may be used to endorse or promote products
+// derived from this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER  BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+
+
+#pragma once 
+
+#include <cstring>
+#include <deque>
+#include <vector>
+
+#include "misc_language.h"
+#include "portable_storage_base.h"
+#include "portable_storage_to_bin.h"
+#include "portable_storage_from_bin.h"
+#include "portable_storage_val_converters.h"
+
+namespace epee
+{
+  namespace serialization
+  {
+    /************************************************************************/
+    /* Writes the portable_storage binary format straight from the         */
+    /* KV_SERIALIZE map, without building the section tree first. Entries  */
+    /* come out in declaration order instead of sorted order, readers do   */
+    /* not care about it.                                                   */
+    /************************************************************************/
+    class portable_storage_bin_writer
+    {
+    public:
+      struct section_state
+      {
+        size_t m_count_offset; //offset of the entries count placeholder in the target
+        size_t m_count;
+      };
+      typedef section_state* hsection;
+      typedef storage_entry meta_entry;
+
+      portable_storage_bin_writer(std::string& target);
+      //closes all the sections left open, nothing may be written after it
+      void      finish();
+
+      template<class t_value>
+      bool      set_value(const char* value_name, const t_value& v, hsection hparent_section);
+      hsection  open_section(const char* section_name, hsection hparent_section, bool create_if_notexist = true);
+      //arrays, the elements count has to be known up front
+      void      open_array(const char* array_name, uint8_t type, size_t count, hsection hparent_section);
+      template<class t_value>
+      void      put_array_value(const t_value& v);
+      hsection  open_array_section(hsection hparent_section);
+
+      static uint8_t type_code(const int64_t&)     {return SERIALIZE_TYPE_INT64;}
+      static uint8_t type_code(const int32_t&)     {return SERIALIZE_TYPE_INT32;}
+      static uint8_t type_code(const int16_t&)     {return SERIALIZE_TYPE_INT16;}
+      static uint8_t type_code(const int8_t&)      {return SERIALIZE_TYPE_INT8;}
+      static uint8_t type_code(const uint64_t&)    {return SERIALIZE_TYPE_UINT64;}
+      static uint8_t type_code(const uint32_t&)    {return SERIALIZE_TYPE_UINT32;}
+      static uint8_t type_code(const uint16_t&)    {return SERIALIZE_TYPE_UINT16;}
+      static uint8_t type_code(const uint8_t&)     {return SERIALIZE_TYPE_UINT8;}
+      static uint8_t type_code(const double&)      {return SERIALIZE_TYPE_DUOBLE;}
+      static uint8_t type_code(const bool&)        {return SERIALIZE_TYPE_BOOL;}
+      static uint8_t type_code(const std::string&) {return SERIALIZE_TYPE_STRING;}
+
+    private:
+      struct string_stream
+      {
+        std::string& m_target;
+        string_stream(std::string& target):m_target(target){}
+        void write(const char* data, size_t size){m_target.append(data, size);}
+      };
+
+      section_state& close_sections_above(hsection hsec);
+      void      close_last_section();
+      void      put_entry_name(const char* name, uint8_t type, hsection hparent_section);
+      void      put_count_placeholder();
+      template<class t_pod_type>
+      void      put_raw(const t_pod_type& v){m_strm.write((const char*)&v, sizeof(v));}
+      void      put_raw(const std::string& v){put_string(m_strm, v);}
+
+      string_stream m_strm;
+      std::deque<section_state> m_sections; //open sections, root first; deque keeps handles valid
+    };
+
+    /************************************************************************/
+    /* Reads the portable_storage binary format in place. Opening a section */
+    /* only indexes its entries (name, type, value offset), values get      */
+    /* decoded when the KV_SERIALIZE map asks for them. The source buffer   */
+    /* has to outlive the reader.                                           */
+    /************************************************************************/
+    class portable_storage_bin_reader
+    {
+    public:
+      struct entry
+      {
+        const char*    m_name;
+        uint8_t        m_name_len;
+        uint8_t        m_type;
+        const uint8_t* m_value;
+      };
+      struct section_index
+      {
+        std::vector<entry> m_entries;
+      };
+      struct array_cursor
+      {
+        uint8_t        m_type;
+        size_t         m_left;
+        const uint8_t* m_pos;
+        section_index  m_element; //current element of an array of sections
+      };
+      typedef section_index* hsection;
+      typedef array_cursor* harray;
+      typedef storage_entry meta_entry;
+
+      portable_storage_bin_reader():m_end(nullptr){}
+      bool      load_from_binary(const std::string& source);
+      bool      load_from_binary(const void* data, size_t size);
+
+      hsection  open_section(const char* section_name, hsection hparent_section, bool create_if_notexist = false);
+      template<class t_value>
+      bool      get_value(const char* value_name, t_value& val, hsection hparent_section);
+      template<class t_value>
+      harray    get_first_value(const char* value_name, t_value& target, hsection hparent_section);
+      template<class t_value>
+      bool      get_next_value(harray hval_array, t_value& target);
+      harray    get_first_section(const char* section_name, hsection& h_child_section, hsection hparent_section);
+      bool      get_next_section(harray hsec_array, hsection& h_child_section);
+
+    private:
+      const entry*   find_entry(const char* name, hsection hsec);
+      const uint8_t* index_section(const uint8_t* p, section_index* psec, size_t depth);
+      const uint8_t* skip_value(uint8_t type, const uint8_t* p, size_t depth);
+      const uint8_t* skip_array(uint8_t type, const uint8_t* p, size_t depth);
+      size_t         read_varint(const uint8_t*& p);
+      void           check_remains(const uint8_t* p, size_t count);
+      template<class t_pod_type>
+      t_pod_type     read_pod(const uint8_t*& p);
+      template<class t_value>
+      void           read_value(uint8_t type, const uint8_t*& p, t_value& v);
+      void           read_value(uint8_t type, const uint8_t*& p, std::string& v);
+      static size_t  pod_size(uint8_t type);
+
+      const uint8_t* m_end;
+      section_index m_root;
+      section_index m_empty; //stands for the sections that are missing when asked to be created
+      std::deque<section_index> m_sections;
+      std::deque<array_cursor> m_arrays;
+    };
+
+    //---------------------------------------------------------------------------------------------------------------
+    // portable_storage_bin_writer
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    portable_storage_bin_writer::portable_storage_bin_writer(std::string& target):m_strm(target)
+    {
+      uint32_t signature_a = PORTABLE_STORAGE_SIGNATUREA;
+      uint32_t signature_b = PORTABLE_STORAGE_SIGNATUREB;
+      uint8_t ver = PORTABLE_STORAGE_FORMAT_VER;
+      put_raw(signature_a);
+      put_raw(signature_b);
+      put_raw(ver);
+      put_count_placeholder();
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    void portable_storage_bin_writer::finish()
+    {
+      while(m_sections.size())
+        close_last_section();
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    void portable_storage_bin_writer::put_count_placeholder()
+    {
+      section_state s = {m_strm.m_target.size(), 0};
+      m_sections.push_back(s);
+      uint8_t placeholder = 0;
+      put_raw(placeholder);
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    void portable_storage_bin_writer::close_last_section()
+    {
+      section_state& s = m_sections.back();
+      if(s.m_count <= 63)
+      {
+        m_strm.m_target[s.m_count_offset] = static_cast<char>(s.m_count << 2);
+      }
+      else
+      {
+        //rare case: wider varint, move the section body to make room for it
+        std::string packed;
+        string_stream strm(packed);
+        pack_varint(strm, s.m_count);
+        m_strm.m_target.replace(s.m_count_offset, 1, packed);
+      }
+      m_sections.pop_back();
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    portable_storage_bin_writer::section_state& portable_storage_bin_writer::close_sections_above(hsection hsec)
+    {
+      CHECK_AND_ASSERT_THROW_MES(m_sections.size(), "portable_storage_bin_writer: write after finish()");
+      section_state* psec = hsec ? hsec : &m_sections.front();
+      while(&m_sections.back() != psec)
+      {
+        CHECK_AND_ASSERT_THROW_MES(m_sections.size() > 1, "portable_storage_bin_writer: write to already closed section");
+        close_last_section();
+      }
+      return *psec;
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    void portable_storage_bin_writer::put_entry_name(const char* name, uint8_t type, hsection hparent_section)
+    {
+      section_state& parent = close_sections_above(hparent_section);
+      size_t len = strlen(name);
+      CHECK_AND_ASSERT_THROW_MES(len < std::numeric_limits<uint8_t>::max(), "storage_entry_name is too long: " << len << ", val: " << name);
+      uint8_t len8 = static_cast<uint8_t>(len);
+      put_raw(len8);
+      m_strm.write(name, len);
+      put_raw(type);
+      ++parent.m_count;
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    template<class t_value>
+    bool portable_storage_bin_writer::set_value(const char* value_name, const t_value& v, hsection hparent_section)
+    {
+      put_entry_name(value_name, type_code(v), hparent_section);
+      put_raw(v);
+      return true;
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    portable_storage_bin_writer::hsection portable_storage_bin_writer::open_section(const char* section_name, hsection hparent_section, bool create_if_notexist)
+    {
+      put_entry_name(section_name, SERIALIZE_TYPE_OBJECT, hparent_section);
+      put_count_placeholder();
+      return &m_sections.back();
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    void portable_storage_bin_writer::open_array(const char* array_name, uint8_t type, size_t count, hsection hparent_section)
+    {
+      put_entry_name(array_name, type|SERIALIZE_FLAG_ARRAY, hparent_section);
+      pack_varint(m_strm, count);
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    template<class t_value>
+    void portable_storage_bin_writer::put_array_value(const t_value& v)
+    {
+      put_raw(v);
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    portable_storage_bin_writer::hsection portable_storage_bin_writer::open_array_section(hsection hparent_section)
+    {
+      close_sections_above(hparent_section);
+      put_count_placeholder();
+      return &m_sections.back();
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    //picked over the generic versions from keyvalue_serialization_overloads.h by ADL, the array is written in one go
+    template<class stl_container>
+    bool serialize_stl_container_t_val(const stl_container& container, portable_storage_bin_writer& stg, portable_storage_bin_writer::hsection hparent_section, const char* pname)
+    {
+      if(!container.size()) return true;
+      stg.open_array(pname, portable_storage_bin_writer::type_code(*container.begin()), container.size(), hparent_section);
+      for(const typename stl_container::value_type& v: container)
+        stg.put_array_value(v);
+      return true;
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    template<class stl_container>
+    bool serialize_stl_container_t_obj(const stl_container& container, portable_storage_bin_writer& stg, portable_storage_bin_writer::hsection hparent_section, const char* pname)
+    {
+      bool res = false;
+      if(!container.size()) return true;
+      stg.open_array(pname, SERIALIZE_TYPE_OBJECT, container.size(), hparent_section);
+      for(const typename stl_container::value_type& v: container)
+        res |= v.store(stg, stg.open_array_section(hparent_section));
+      return res;
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    // portable_storage_bin_reader
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    bool portable_storage_bin_reader::load_from_binary(const std::string& source)
+    {
+      return load_from_binary(source.data(), source.size());
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    bool portable_storage_bin_reader::load_from_binary(const void* data, size_t size)
+    {
+      m_root.m_entries.clear();
+      m_sections.clear();
+      m_arrays.clear();
+      const size_t header_size = sizeof(uint32_t) * 2 + sizeof(uint8_t);
+      if(size < header_size)
+      {
+        LOG_ERROR("portable_storage: wrong binary format, packet size = " << size << " less than expected sizeof(storage_block_header)=" << header_size);
+        return false;
+      }
+      const uint8_t* p = static_cast<const uint8_t*>(data);
+      m_end = p + size;
+      uint32_t signature_a = read_pod<uint32_t>(p);
+      uint32_t signature_b = read_pod<uint32_t>(p);
+      uint8_t ver = read_pod<uint8_t>(p);
+      if(signature_a != PORTABLE_STORAGE_SIGNATUREA || signature_b != PORTABLE_STORAGE_SIGNATUREB)
+      {
+        LOG_ERROR("portable_storage: wrong binary format - signature missmatch");
+        return false;
+      }
+      if(ver != PORTABLE_STORAGE_FORMAT_VER)
+      {
+        LOG_ERROR("portable_storage: wrong binary format - unknown format ver = " << ver);
+        return false;
+      }
+      TRY_ENTRY();
+      //walks the whole buffer once, so everything below may rely on the offsets being in range
+      index_section(p, &m_root, 0);
+      return true;
+      CATCH_ENTRY("portable_storage_bin_reader::load_from_binary", false);
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    void portable_storage_bin_reader::check_remains(const uint8_t* p, size_t count)
+    {
+      CHECK_AND_ASSERT_THROW_MES(static_cast<size_t>(m_end - p) >= count, " attempt to read " << count << " bytes from buffer with " << (m_end - p) << " bytes remained");
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    template<class t_pod_type>
+    t_pod_type portable_storage_bin_reader::read_pod(const uint8_t*& p)
+    {
+      check_remains(p, sizeof(t_pod_type));
+      t_pod_type v;
+      memcpy(&v, p, sizeof(t_pod_type));
+      p += sizeof(t_pod_type);
+      return v;
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    size_t portable_storage_bin_reader::read_varint(const uint8_t*& p)
+    {
+      check_remains(p, 1);
+      size_t v = 0;
+      switch(*p & PORTABLE_RAW_SIZE_MARK_MASK)
+      {
+      case PORTABLE_RAW_SIZE_MARK_BYTE: v = read_pod<uint8_t>(p);break;
+      case PORTABLE_RAW_SIZE_MARK_WORD: v = read_pod<uint16_t>(p);break;
+      case PORTABLE_RAW_SIZE_MARK_DWORD: v = read_pod<uint32_t>(p);break;
+      case PORTABLE_RAW_SIZE_MARK_INT64: v = read_pod<uint64_t>(p);break;
+      }
+      return v >> 2;
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    size_t portable_storage_bin_reader::pod_size(uint8_t type)
+    {
+      switch(type)
+      {
+      case SERIALIZE_TYPE_INT64:  return sizeof(int64_t);
+      case SERIALIZE_TYPE_INT32:  return sizeof(int32_t);
+      case SERIALIZE_TYPE_INT16:  return sizeof(int16_t);
+      case SERIALIZE_TYPE_INT8:   return sizeof(int8_t);
+      case SERIALIZE_TYPE_UINT64: return sizeof(uint64_t);
+      case SERIALIZE_TYPE_UINT32: return sizeof(uint32_t);
+      case SERIALIZE_TYPE_UINT16: return sizeof(uint16_t);
+      case SERIALIZE_TYPE_UINT8:  return sizeof(uint8_t);
+      case SERIALIZE_TYPE_DUOBLE: return sizeof(double);
+      case SERIALIZE_TYPE_BOOL:   return sizeof(bool);
+      default:                    return 0;
+      }
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    const uint8_t* portable_storage_bin_reader::index_section(const uint8_t* p, section_index* psec, size_t depth)
+    {
+      CHECK_AND_ASSERT_THROW_MES(depth < EPEE_PORTABLE_STORAGE_RECURSION_LIMIT_INTERNAL, "Wrong blob data in portable storage: recursion limitation (" << EPEE_PORTABLE_STORAGE_RECURSION_LIMIT_INTERNAL << ") exceeded");
+      size_t count = read_varint(p);
+      if(psec)
+      {
+        psec->m_entries.clear();
+        //every entry takes at least 3 bytes, do not trust the count any further than that
+        psec->m_entries.reserve((std::min)(count, static_cast<size_t>(m_end - p) / 3));
+      }
+      while(count--)
+      {
+        entry e;
+        e.m_name_len = read_pod<uint8_t>(p);
+        check_remains(p, e.m_name_len);
+        e.m_name = reinterpret_cast<const char*>(p);
+        p += e.m_name_len;
+        e.m_type = read_pod<uint8_t>(p);
+        e.m_value = p;
+        p = skip_value(e.m_type, p, depth + 1);
+        if(psec)
+          psec->m_entries.push_back(e);
+      }
+      return p;
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    const uint8_t* portable_storage_bin_reader::skip_value(uint8_t type, const uint8_t* p, size_t depth)
+    {
+      if(type & SERIALIZE_FLAG_ARRAY)
+        return skip_array(type, p, depth);
+
+      size_t size = pod_size(type);
+      if(size)
+      {
+        check_remains(p, size);
+        return p + size;
+      }
+      switch(type)
+      {
+      case SERIALIZE_TYPE_STRING:
+        size = read_varint(p);
+        CHECK_AND_ASSERT_THROW_MES(size < MAX_STRING_LEN_POSSIBLE, "to big string len value in storage: " << size);
+        check_remains(p, size);
+        return p + size;
+      case SERIALIZE_TYPE_OBJECT:
+        return index_section(p, nullptr, depth);
+      case SERIALIZE_TYPE_ARRAY:
+        type = read_pod<uint8_t>(p);
+        CHECK_AND_ASSERT_THROW_MES(type & SERIALIZE_FLAG_ARRAY, "wrong type sequenses");
+        return skip_array(type, p, depth);
+      default:
+        ASSERT_MES_AND_THROW("unknown entry_type code = " << (int)type);
+      }
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    const uint8_t* portable_storage_bin_reader::skip_array(uint8_t type, const uint8_t* p, size_t depth)
+    {
+      CHECK_AND_ASSERT_THROW_MES(depth < EPEE_PORTABLE_STORAGE_RECURSION_LIMIT_INTERNAL, "Wrong blob data in portable storage: recursion limitation (" << EPEE_PORTABLE_STORAGE_RECURSION_LIMIT_INTERNAL << ") exceeded");
+      type &= ~SERIALIZE_FLAG_ARRAY;
+      size_t count = read_varint(p);
+      size_t size = pod_size(type);
+      if(size)
+      {
+        CHECK_AND_ASSERT_THROW_MES(count <= static_cast<size_t>(m_end - p) / size, "array of " << count << " elements goes out of remain storage len " << (m_end - p));
+        return p + count * size;
+      }
+      while(count--)
+        p = skip_value(type, p, depth + 1);
+      return p;
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    const portable_storage_bin_reader::entry* portable_storage_bin_reader::find_entry(const char* name, hsection hsec)
+    {
+      if(!hsec) hsec = &m_root;
+      size_t len = strlen(name);
+      for(const entry& e: hsec->m_entries)
+      {
+        //the first one wins on duplicated names, same as with the std::map based storage
+        if(e.m_name_len == len && !memcmp(e.m_name, name, len))
+          return &e;
+      }
+      return nullptr;
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    template<class t_value>
+    void portable_storage_bin_reader::read_value(uint8_t type, const uint8_t*& p, t_value& v)
+    {
+      switch(type)
+      {
+      case SERIALIZE_TYPE_INT64:  convert_t(read_pod<int64_t>(p), v);  break;
+      case SERIALIZE_TYPE_INT32:  convert_t(read_pod<int32_t>(p), v);  break;
+      case SERIALIZE_TYPE_INT16:  convert_t(read_pod<int16_t>(p), v);  break;
+      case SERIALIZE_TYPE_INT8:   convert_t(read_pod<int8_t>(p), v);   break;
+      case SERIALIZE_TYPE_UINT64: convert_t(read_pod<uint64_t>(p), v); break;
+      case SERIALIZE_TYPE_UINT32: convert_t(read_pod<uint32_t>(p), v); break;
+      case SERIALIZE_TYPE_UINT16: convert_t(read_pod<uint16_t>(p), v); break;
+      case SERIALIZE_TYPE_UINT8:  convert_t(read_pod<uint8_t>(p), v);  break;
+      case SERIALIZE_TYPE_DUOBLE: convert_t(read_pod<double>(p), v);   break;
+      case SERIALIZE_TYPE_BOOL:   convert_t(read_pod<bool>(p), v);     break;
+      default:
+        ASSERT_MES_AND_THROW("WRONG DATA CONVERSION: from type code=" << (int)type << " to type " << typeid(t_value).name());
+      }
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    void portable_storage_bin_reader::read_value(uint8_t type, const uint8_t*& p, std::string& v)
+    {
+      CHECK_AND_ASSERT_THROW_MES(type == SERIALIZE_TYPE_STRING, "WRONG DATA CONVERSION: from type code=" << (int)type << " to type " << typeid(v).name());
+      size_t len = read_varint(p);
+      check_remains(p, len);
+      v.assign(reinterpret_cast<const char*>(p), len);
+      p += len;
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    template<class t_value>
+    bool portable_storage_bin_reader::get_value(const char* value_name, t_value& val, hsection hparent_section)
+    {
+      const entry* pentry = find_entry(value_name, hparent_section);
+      if(!pentry)
+        return false;
+      const uint8_t* p = pentry->m_value;
+      read_value(pentry->m_type, p, val);
+      return true;
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    portable_storage_bin_reader::hsection portable_storage_bin_reader::open_section(const char* section_name, hsection hparent_section, bool create_if_notexist)
+    {
+      const entry* pentry = find_entry(section_name, hparent_section);
+      if(!pentry || pentry->m_type != SERIALIZE_TYPE_OBJECT)
+        return create_if_notexist ? &m_empty : nullptr;
+      m_sections.push_back(section_index());
+      index_section(pentry->m_value, &m_sections.back(), 0);
+      return &m_sections.back();
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    template<class t_value>
+    portable_storage_bin_reader::harray portable_storage_bin_reader::get_first_value(const char* value_name, t_value& target, hsection hparent_section)
+    {
+      const entry* pentry = find_entry(value_name, hparent_section);
+      if(!pentry || !(pentry->m_type & SERIALIZE_FLAG_ARRAY))
+        return nullptr;
+      const uint8_t* p = pentry->m_value;
+      size_t count = read_varint(p);
+      if(!count)
+        return nullptr;
+      m_arrays.push_back(array_cursor());
+      array_cursor& ar = m_arrays.back();
+      ar.m_type = pentry->m_type & ~SERIALIZE_FLAG_ARRAY;
+      read_value(ar.m_type, p, target);
+      ar.m_left = count - 1;
+      ar.m_pos = p;
+      return &ar;
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    template<class t_value>
+    bool portable_storage_bin_reader::get_next_value(harray hval_array, t_value& target)
+    {
+      CHECK_AND_ASSERT(hval_array, false);
+      if(!hval_array->m_left)
+        return false;
+      read_value(hval_array->m_type, hval_array->m_pos, target);
+      --hval_array->m_left;
+      return true;
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    portable_storage_bin_reader::harray portable_storage_bin_reader::get_first_section(const char* section_name, hsection& h_child_section, hsection hparent_section)
+    {
+      const entry* pentry = find_entry(section_name, hparent_section);
+      if(!pentry || pentry->m_type != (SERIALIZE_TYPE_OBJECT|SERIALIZE_FLAG_ARRAY))
+        return nullptr;
+      const uint8_t* p = pentry->m_value;
+      size_t count = read_varint(p);
+      if(!count)
+        return nullptr;
+      m_arrays.push_back(array_cursor());
+      array_cursor& ar = m_arrays.back();
+      ar.m_type = SERIALIZE_TYPE_OBJECT;
+      ar.m_pos = index_section(p, &ar.m_element, 0);
+      ar.m_left = count - 1;
+      h_child_section = &ar.m_element;
+      return &ar;
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    bool portable_storage_bin_reader::get_next_section(harray hsec_array, hsection& h_child_section)
+    {
+      CHECK_AND_ASSERT(hsec_array, false);
+      if(!hsec_array->m_left)
+        return false;
+      hsec_array->m_pos = index_section(hsec_array->m_pos, &hsec_array->m_element, 0);
+      --hsec_array->m_left;
+      h_child_section = &hsec_array->m_element;
+      return true;
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    //vectors get the whole array reserved up front, the element count is known once the array is opened
+    template<class t_type>
+    bool unserialize_stl_container_t_val(std::vector<t_type>& container, portable_storage_bin_reader& stg, portable_storage_bin_reader::hsection hparent_section, const char* pname)
+    {
+      container.clear();
+      t_type exchange_val;
+      portable_storage_bin_reader::harray hval_array = stg.get_first_value(pname, exchange_val, hparent_section);
+      if(!hval_array) return false;
+      container.reserve(hval_array->m_left + 1);
+      container.push_back(std::move(exchange_val));
+      while(stg.get_next_value(hval_array, exchange_val))
+        container.push_back(std::move(exchange_val));
+      return true;
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    template<class t_type>
+    bool unserialize_stl_container_t_obj(std::vector<t_type>& container, portable_storage_bin_reader& stg, portable_storage_bin_reader::hsection hparent_section, const char* pname)
+    {
+      bool res = false;
+      container.clear();
+      portable_storage_bin_reader::hsection hchild_section = nullptr;
+      portable_storage_bin_reader::harray hsec_array = stg.get_first_section(pname, hchild_section, hparent_section);
+      if(!hsec_array || !hchild_section) return false;
+      container.reserve(hsec_array->m_left + 1);
+      do
+      {
+        container.push_back(t_type());
+        res |= container.back()._load(stg, hchild_section);
+      } while(stg.get_next_section(hsec_array, hchild_section));
+      return res;
+    }
+  }
+}
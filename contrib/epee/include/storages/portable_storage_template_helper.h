@@ -30,6 +30,7 @@
 
 #include "parserse_base_utils.h"
 #include "portable_storage.h"
+#include "portable_storage_bin_stream.h"
 #include "file_io_utils.h"
 
 namespace epee
@@ -86,12 +87,12 @@ namespace epee
     template<class t_struct>
     bool load_t_from_binary(t_struct& out, const std::string& binary_buff)
     {
-      portable_storage ps;
-      bool rs = ps.load_from_binary(binary_buff);
+      portable_storage_bin_reader stg;
+      bool rs = stg.load_from_binary(binary_buff);
       if(!rs)
         return false;
 
-      return out.load(ps);
+      return out.load(stg);
     }
     //-----------------------------------------------------------------------------------------------------------
     template<class t_struct>
@@ -107,9 +108,13 @@ namespace epee
     template<class t_struct>
     bool store_t_to_binary(t_struct& str_in, std::string& binary_buff, size_t indent = 0)
     {
-      portable_storage ps;
-      str_in.store(ps);
-      return ps.store_to_binary(binary_buff);
+      TRY_ENTRY();
+      binary_buff.clear();
+      portable_storage_bin_writer stg(binary_buff);
+      str_in.store(stg);
+      stg.finish();
+      return true;
+      CATCH_ENTRY("store_t_to_binary", false);
     }
     //-----------------------------------------------------------------------------------------------------------
     template<class t_struct>
@@ -0,0 +1,151 @@
+// Copyright (c) 2014, AEON, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this file are originally copyright (c) 2012-2013 The Cryptonote developers
+
+
+#include "include_base_utils.h"
+#include "version.h"
+
+using namespace epee;
+#include <boost/program_options.hpp>
+#include "common/command_line.h"
+#include "common/util.h"
+#include "cryptonote_core/cryptonote_core.h"
+#include "cryptonote_core/cryptonote_format_utils.h"
+#include "bootstrap_file.h"
+
+namespace po = boost::program_options;
+using namespace cryptonote;
+
+namespace
+{
+  const command_line::arg_descriptor<std::string> arg_output_file = {"output-file", "Where to write the blocks, defaults to " BOOTSTRAP_FILE_DEFAULT_FILENAME " in the data directory", ""};
+  const command_line::arg_descriptor<uint64_t>    arg_block_stop  = {"block-stop", "Export blocks below this height only, 0 to export all", 0};
+
+  //blockchain storage and the pool referring to each other, like in core
+  struct storage
+  {
+    storage(): m_pool(m_blockchain), m_blockchain(m_pool) {}
+
+    tx_memory_pool m_pool;
+    blockchain_storage m_blockchain;
+  };
+}
+
+int main(int argc, char* argv[])
+{
+  string_tools::set_module_name_and_folder(argv[0]);
+  log_space::get_set_log_detalisation_level(true, LOG_LEVEL_0);
+  log_space::log_singletone::add_logger(LOGGER_CONSOLE, NULL, NULL);
+
+  po::options_description desc_general("General options");
+  command_line::add_arg(desc_general, command_line::arg_help);
+
+  po::options_description desc_params("Export options");
+  command_line::add_arg(desc_params, command_line::arg_data_dir, tools::get_default_data_dir());
+  command_line::add_arg(desc_params, arg_output_file);
+  command_line::add_arg(desc_params, arg_block_stop);
+
+  po::options_description desc_all;
+  desc_all.add(desc_general).add(desc_params);
+
+  po::variables_map vm;
+  bool r = command_line::handle_error_helper(desc_all, [&]()
+  {
+    po::store(command_line::parse_command_line(argc, argv, desc_general, true), vm);
+    if (command_line::get_arg(vm, command_line::arg_help))
+    {
+      std::cout << CRYPTONOTE_NAME << " v" << PROJECT_VERSION_LONG << ENDL;
+      std::cout << "Writes blocks and transactions of the local blockchain to a file for blockchain_import" << ENDL << ENDL;
+      std::cout << desc_all << ENDL;
+      return false;
+    }
+
+    po::store(command_line::parse_command_line(argc, argv, desc_params, false), vm);
+    po::notify(vm);
+    return true;
+  });
+  if (!r)
+    return 1;
+
+  std::string data_dir = command_line::get_arg(vm, command_line::arg_data_dir);
+  std::string output_file = command_line::get_arg(vm, arg_output_file);
+  if (output_file.empty())
+    output_file = data_dir + "/" BOOTSTRAP_FILE_DEFAULT_FILENAME;
+
+  storage st;
+  r = st.m_blockchain.init(data_dir);
+  CHECK_AND_ASSERT_MES(r, 1, "Failed to load blockchain from " << data_dir);
+  CHECK_AND_ASSERT_MES(!st.m_blockchain.get_pruned_height(), 1, "The blockchain is pruned below height " << st.m_blockchain.get_pruned_height() << ", it can't be exported");
+
+  uint64_t height = st.m_blockchain.get_current_blockchain_height();
+  uint64_t block_stop = command_line::get_arg(vm, arg_block_stop);
+  if (block_stop && block_stop < height)
+    height = block_stop;
+
+  bootstrap_file_writer writer;
+  r = writer.open(output_file);
+  if (!r)
+    return 1;
+
+  LOG_PRINT_L0("Exporting " << height << " blocks to " << output_file);
+  uint64_t start_time = misc_utils::get_tick_count();
+  bootstrap_chunk chunk = AUTO_VAL_INIT(chunk);
+  std::vector<block> blocks;
+  for (uint64_t start_height = 0; start_height < height; start_height += blocks.size())
+  {
+    blocks.clear();
+    r = st.m_blockchain.get_blocks(start_height, std::min<uint64_t>(BOOTSTRAP_BLOCKS_PER_CHUNK, height - start_height), blocks);
+    CHECK_AND_ASSERT_MES(r && !blocks.empty(), 1, "Failed to get blocks from height " << start_height);
+
+    chunk.start_height = start_height;
+    chunk.blocks.resize(blocks.size());
+    for (size_t i = 0; i != blocks.size(); ++i)
+    {
+      block_complete_entry& entry = chunk.blocks[i];
+      entry.block = block_to_blob(blocks[i]);
+      entry.txs.clear();
+      std::list<crypto::hash> missed_txs;
+      st.m_blockchain.get_transactions_blobs(blocks[i].tx_hashes, entry.txs, missed_txs);
+      CHECK_AND_ASSERT_MES(missed_txs.empty(), 1, "Transactions of block " << start_height + i << " are missing");
+    }
+    r = writer.write_chunk(chunk);
+    if (!r)
+      return 1;
+
+    if ((start_height / BOOTSTRAP_BLOCKS_PER_CHUNK) % 100 == 0)
+      LOG_PRINT_L0("Exported blocks below " << start_height + blocks.size() << " of " << height);
+  }
+  r = writer.close();
+  CHECK_AND_ASSERT_MES(r, 1, "Failed to write " << output_file);
+
+  uint64_t seconds = std::max<uint64_t>(1, (misc_utils::get_tick_count() - start_time) / 1000);
+  LOG_PRINT_L0("Exported " << height << " blocks in " << seconds << " s, " << height / seconds << " blocks/s");
+  return 0;
+}
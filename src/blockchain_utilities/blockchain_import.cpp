@@ -0,0 +1,197 @@
+// Copyright (c) 2014, AEON, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this file are originally copyright (c) 2012-2013 The Cryptonote developers
+
+
+#include "include_base_utils.h"
+#include "version.h"
+
+using namespace epee;
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+#include "common/command_line.h"
+#include "common/util.h"
+#include "cryptonote_core/cryptonote_core.h"
+#include "cryptonote_core/cryptonote_format_utils.h"
+#include "cryptonote_core/checkpoints_create.h"
+#include "bootstrap_file.h"
+
+namespace po = boost::program_options;
+using namespace cryptonote;
+
+namespace
+{
+  const command_line::arg_descriptor<std::string> arg_input_file  = {"input-file", "File written by blockchain_export, defaults to " BOOTSTRAP_FILE_DEFAULT_FILENAME " in the data directory", ""};
+  const command_line::arg_descriptor<bool>        arg_verify_all  = {"verify-all", "Check proof of work and signatures of blocks in the checkpoint zone too"};
+  const command_line::arg_descriptor<uint64_t>    arg_batch_size  = {"batch-size", "Blocks imported between blockchain saves, 0 to save at the end only", 100000};
+  const command_line::arg_descriptor<std::string> arg_checkpoint_hashes = {"checkpoint-hashes-file", "Hashes of block id groups to check the blocks against, " CRYPTONOTE_CHECKPOINT_HASHES_FILENAME " in the data directory is used if it exists", ""};
+
+  bool import_chunk(core& ccore, const bootstrap_chunk& chunk, uint64_t& imported)
+  {
+    uint64_t height = ccore.get_current_blockchain_height();
+    if (chunk.start_height + chunk.blocks.size() <= height)
+      return true;
+    CHECK_AND_ASSERT_MES(chunk.start_height <= height, false, "Blocks from height " << chunk.start_height << " don't follow the local blockchain of height " << height);
+
+    std::vector<block> blocks(chunk.blocks.size());
+    std::list<crypto::hash> ids;
+    for (size_t i = 0; i != chunk.blocks.size(); ++i)
+    {
+      bool r = parse_and_validate_block_from_blob(chunk.blocks[i].block, blocks[i]);
+      CHECK_AND_ASSERT_MES(r, false, "Failed to parse block " << chunk.start_height + i);
+      ids.push_back(get_block_hash(blocks[i]));
+    }
+    bool r = ccore.prevalidate_block_ids(chunk.start_height, ids);
+    CHECK_AND_ASSERT_MES(r, false, "Blocks from height " << chunk.start_height << " don't match checkpoint hashes");
+
+    for (size_t i = height - chunk.start_height; i != chunk.blocks.size(); ++i)
+    {
+      BOOST_FOREACH(const blobdata& tx_blob, chunk.blocks[i].txs)
+      {
+        tx_verification_context tvc = AUTO_VAL_INIT(tvc);
+        ccore.handle_incoming_tx(tx_blob, tvc, true);
+        CHECK_AND_ASSERT_MES(!tvc.m_verifivation_failed, false, "Transaction of block " << chunk.start_height + i << " failed verification");
+      }
+
+      block_verification_context bvc = AUTO_VAL_INIT(bvc);
+      ccore.handle_incoming_block(blocks[i], bvc, false);
+      CHECK_AND_ASSERT_MES(!bvc.m_verifivation_failed && bvc.m_added_to_main_chain, false, "Block " << chunk.start_height + i << " failed verification");
+      ++imported;
+    }
+    return true;
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  string_tools::set_module_name_and_folder(argv[0]);
+  log_space::get_set_log_detalisation_level(true, LOG_LEVEL_0);
+  log_space::log_singletone::add_logger(LOGGER_CONSOLE, NULL, NULL);
+
+  po::options_description desc_general("General options");
+  command_line::add_arg(desc_general, command_line::arg_help);
+
+  po::options_description desc_params("Import options");
+  command_line::add_arg(desc_params, command_line::arg_data_dir, tools::get_default_data_dir());
+  command_line::add_arg(desc_params, arg_input_file);
+  command_line::add_arg(desc_params, arg_verify_all);
+  command_line::add_arg(desc_params, arg_batch_size);
+  command_line::add_arg(desc_params, arg_checkpoint_hashes);
+  cryptonote::core::init_options(desc_params);
+  cryptonote::miner::init_options(desc_params);
+
+  po::options_description desc_all;
+  desc_all.add(desc_general).add(desc_params);
+
+  po::variables_map vm;
+  bool r = command_line::handle_error_helper(desc_all, [&]()
+  {
+    po::store(command_line::parse_command_line(argc, argv, desc_general, true), vm);
+    if (command_line::get_arg(vm, command_line::arg_help))
+    {
+      std::cout << CRYPTONOTE_NAME << " v" << PROJECT_VERSION_LONG << ENDL;
+      std::cout << "Adds blocks written by blockchain_export to the local blockchain, the daemon must not be running" << ENDL << ENDL;
+      std::cout << desc_all << ENDL;
+      return false;
+    }
+
+    po::store(command_line::parse_command_line(argc, argv, desc_params, false), vm);
+    po::notify(vm);
+    return true;
+  });
+  if (!r)
+    return 1;
+
+  std::string data_dir = command_line::get_arg(vm, command_line::arg_data_dir);
+  std::string input_file = command_line::get_arg(vm, arg_input_file);
+  if (input_file.empty())
+    input_file = data_dir + "/" BOOTSTRAP_FILE_DEFAULT_FILENAME;
+
+  //blocks have to match the checkpoints and checkpoint hashes in any case, but unless --verify-all is given
+  //blocks in the checkpoint zone skip proof of work and signature checks, as they do when synced from peers
+  checkpoints cp;
+  r = create_checkpoints(cp);
+  CHECK_AND_ASSERT_MES(r, 1, "Failed to initialize checkpoints");
+  std::string checkpoint_hashes_file = command_line::get_arg(vm, arg_checkpoint_hashes);
+  std::string default_checkpoint_hashes_file = data_dir + "/" CRYPTONOTE_CHECKPOINT_HASHES_FILENAME;
+  boost::system::error_code ec;
+  if (checkpoint_hashes_file.empty() && boost::filesystem::exists(default_checkpoint_hashes_file, ec))
+    checkpoint_hashes_file = default_checkpoint_hashes_file;
+  if (!checkpoint_hashes_file.empty())
+  {
+    r = cp.load_hashes_from_file(checkpoint_hashes_file);
+    CHECK_AND_ASSERT_MES(r, 1, "Failed to load checkpoint hashes");
+  }
+
+  core ccore(NULL);
+  ccore.set_checkpoints(std::move(cp));
+  ccore.get_blockchain_storage().set_verify_checkpoint_zone(command_line::get_arg(vm, arg_verify_all));
+  r = ccore.init(vm);
+  CHECK_AND_ASSERT_MES(r, 1, "Failed to initialize core");
+
+  bootstrap_file_reader reader;
+  r = reader.open(input_file);
+  if (!r)
+  {
+    ccore.deinit();
+    return 1;
+  }
+
+  LOG_PRINT_L0("Importing blocks from " << input_file << " to blockchain of height " << ccore.get_current_blockchain_height());
+  uint64_t batch_size = command_line::get_arg(vm, arg_batch_size);
+  uint64_t imported = 0, stored = 0, reported = 0;
+  uint64_t start_time = misc_utils::get_tick_count(), report_time = start_time;
+  bootstrap_chunk chunk = AUTO_VAL_INIT(chunk);
+  while (r)
+  {
+    r = reader.read_chunk(chunk) && import_chunk(ccore, chunk, imported);
+    if (!r || chunk.blocks.empty())
+      break;
+
+    if (batch_size && imported - stored >= batch_size)
+    {
+      ccore.get_blockchain_storage().store_blockchain();
+      stored = imported;
+    }
+
+    uint64_t now = misc_utils::get_tick_count();
+    if (now - report_time >= 10000)
+    {
+      LOG_PRINT_L0("Height " << ccore.get_current_blockchain_height() << ", " << (imported - reported) * 1000 / (now - report_time) << " blocks/s, "
+        << reader.get_position() * 100 / std::max<uint64_t>(1, reader.get_file_size()) << "% of the file");
+      reported = imported;
+      report_time = now;
+    }
+  }
+
+  uint64_t ms = std::max<uint64_t>(1, misc_utils::get_tick_count() - start_time);
+  LOG_PRINT_L0("Imported " << imported << " blocks in " << ms / 1000 << " s, " << imported * 1000 / ms << " blocks/s, blockchain height " << ccore.get_current_blockchain_height());
+  ccore.deinit();
+  return r ? 0 : 1;
+}
@@ -0,0 +1,163 @@
+// Copyright (c) 2014, AEON, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this file are originally copyright (c) 2012-2013 The Cryptonote developers
+
+#pragma once
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "include_base_utils.h"
+#include "common/int-util.h"
+#include "cryptonote_protocol/cryptonote_protocol_defs.h"
+#include "storages/portable_storage_template_helper.h"
+
+//file starts with the signature and a little endian uint32 version, then chunks follow,
+//each is a little endian uint32 size and a bootstrap_chunk in portable storage binary format
+#define BOOTSTRAP_FILE_SIGNATURE            "TYCHEBLK"
+#define BOOTSTRAP_FILE_SIGNATURE_SIZE       8
+#define BOOTSTRAP_FILE_VERSION              1
+#define BOOTSTRAP_FILE_DEFAULT_FILENAME     "blockchain.raw"
+#define BOOTSTRAP_BLOCKS_PER_CHUNK          100
+#define BOOTSTRAP_CHUNK_MAX_SIZE            P2P_DEFAULT_PACKET_MAX_SIZE
+
+namespace cryptonote
+{
+  /************************************************************************/
+  /* Blocks of the main chain with their transactions, in height order    */
+  /************************************************************************/
+  struct bootstrap_chunk
+  {
+    uint64_t start_height;
+    std::vector<block_complete_entry> blocks;
+
+    BEGIN_KV_SERIALIZE_MAP()
+      KV_SERIALIZE(start_height)
+      KV_SERIALIZE(blocks)
+    END_KV_SERIALIZE_MAP()
+  };
+
+  class bootstrap_file_writer
+  {
+  public:
+    bool open(const std::string& path)
+    {
+      m_file.open(path, std::ios::binary | std::ios::out | std::ios::trunc);
+      CHECK_AND_ASSERT_MES(m_file.good(), false, "Failed to open " << path << " for writing");
+      m_file.write(BOOTSTRAP_FILE_SIGNATURE, BOOTSTRAP_FILE_SIGNATURE_SIZE);
+      write_uint32(BOOTSTRAP_FILE_VERSION);
+      return m_file.good();
+    }
+
+    bool write_chunk(bootstrap_chunk& chunk)
+    {
+      std::string blob;
+      bool r = epee::serialization::store_t_to_binary(chunk, blob);
+      CHECK_AND_ASSERT_MES(r, false, "Failed to serialize blocks from height " << chunk.start_height);
+      CHECK_AND_ASSERT_MES(blob.size() <= BOOTSTRAP_CHUNK_MAX_SIZE, false, "Blocks from height " << chunk.start_height << " take " << blob.size() << " bytes, too much for one chunk");
+      write_uint32(static_cast<uint32_t>(blob.size()));
+      m_file.write(blob.data(), blob.size());
+      CHECK_AND_ASSERT_MES(m_file.good(), false, "Failed to write blocks from height " << chunk.start_height);
+      return true;
+    }
+
+    bool close()
+    {
+      m_file.close();
+      return !m_file.fail();
+    }
+
+  private:
+    void write_uint32(uint32_t v)
+    {
+      v = swap32le(v);
+      m_file.write(reinterpret_cast<const char*>(&v), sizeof(v));
+    }
+
+    std::ofstream m_file;
+  };
+
+  class bootstrap_file_reader
+  {
+  public:
+    bootstrap_file_reader(): m_file_size(0)
+    {}
+
+    bool open(const std::string& path)
+    {
+      m_file.open(path, std::ios::binary | std::ios::in);
+      CHECK_AND_ASSERT_MES(m_file.good(), false, "Failed to open " << path);
+      m_file.seekg(0, std::ios::end);
+      m_file_size = m_file.tellg();
+      m_file.seekg(0, std::ios::beg);
+
+      char signature[BOOTSTRAP_FILE_SIGNATURE_SIZE];
+      m_file.read(signature, sizeof(signature));
+      uint32_t version = 0;
+      CHECK_AND_ASSERT_MES(m_file.good() && 0 == memcmp(signature, BOOTSTRAP_FILE_SIGNATURE, sizeof(signature)) && read_uint32(version),
+        false, path << " is not a blockchain file");
+      CHECK_AND_ASSERT_MES(version == BOOTSTRAP_FILE_VERSION, false, "Unsupported blockchain file version " << version);
+      return true;
+    }
+
+    //false on errors, true with empty chunk at the end of file
+    bool read_chunk(bootstrap_chunk& chunk)
+    {
+      chunk.start_height = 0;
+      chunk.blocks.clear();
+      uint32_t size = 0;
+      if(m_file.peek() == std::char_traits<char>::eof())
+        return true;
+      CHECK_AND_ASSERT_MES(read_uint32(size), false, "Unexpected end of blockchain file");
+      CHECK_AND_ASSERT_MES(size <= BOOTSTRAP_CHUNK_MAX_SIZE, false, "Wrong chunk size " << size << " in blockchain file");
+      m_buff.resize(size);
+      m_file.read(&m_buff[0], size);
+      CHECK_AND_ASSERT_MES(m_file.good(), false, "Unexpected end of blockchain file");
+      CHECK_AND_ASSERT_MES(epee::serialization::load_t_from_binary(chunk, m_buff), false, "Failed to parse chunk of blockchain file");
+      CHECK_AND_ASSERT_MES(!chunk.blocks.empty(), false, "Empty chunk in blockchain file");
+      return true;
+    }
+
+    uint64_t get_file_size() const { return m_file_size; }
+    uint64_t get_position() { return m_file.tellg(); }
+
+  private:
+    bool read_uint32(uint32_t& v)
+    {
+      m_file.read(reinterpret_cast<char*>(&v), sizeof(v));
+      v = swap32le(v);
+      return m_file.good();
+    }
+
+    std::ifstream m_file;
+    uint64_t m_file_size;
+    std::string m_buff;
+  };
+}
@@ -0,0 +1,125 @@
+// Copyright (c) 2014, AEON, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this file are originally copyright (c) 2012-2013 The Cryptonote developers
+
+
+#include "include_base_utils.h"
+#include "version.h"
+
+using namespace epee;
+#include <boost/program_options.hpp>
+#include "common/command_line.h"
+#include "common/util.h"
+#include "cryptonote_core/cryptonote_core.h"
+#include "cryptonote_core/checkpoints.h"
+#include "file_io_utils.h"
+
+namespace po = boost::program_options;
+using namespace cryptonote;
+
+namespace
+{
+  const command_line::arg_descriptor<std::string> arg_output_file = {"output-file", "Where to write the hashes, defaults to " CRYPTONOTE_CHECKPOINT_HASHES_FILENAME " in the data directory", ""};
+  const command_line::arg_descriptor<uint64_t>    arg_height      = {"height", "Hash blocks below this height only, 0 to leave out the latest blocks that may still be reorganized", 0};
+
+  //blockchain storage and the pool referring to each other, like in core
+  struct storage
+  {
+    storage(): m_pool(m_blockchain), m_blockchain(m_pool) {}
+
+    tx_memory_pool m_pool;
+    blockchain_storage m_blockchain;
+  };
+}
+
+int main(int argc, char* argv[])
+{
+  string_tools::set_module_name_and_folder(argv[0]);
+  log_space::get_set_log_detalisation_level(true, LOG_LEVEL_0);
+  log_space::log_singletone::add_logger(LOGGER_CONSOLE, NULL, NULL);
+
+  po::options_description desc_general("General options");
+  command_line::add_arg(desc_general, command_line::arg_help);
+
+  po::options_description desc_params("Checkpoint hashes options");
+  command_line::add_arg(desc_params, command_line::arg_data_dir, tools::get_default_data_dir());
+  command_line::add_arg(desc_params, arg_output_file);
+  command_line::add_arg(desc_params, arg_height);
+
+  po::options_description desc_all;
+  desc_all.add(desc_general).add(desc_params);
+
+  po::variables_map vm;
+  bool r = command_line::handle_error_helper(desc_all, [&]()
+  {
+    po::store(command_line::parse_command_line(argc, argv, desc_general, true), vm);
+    if (command_line::get_arg(vm, command_line::arg_help))
+    {
+      std::cout << CRYPTONOTE_NAME << " v" << PROJECT_VERSION_LONG << ENDL;
+      std::cout << "Writes hashes of groups of " << CHECKPOINT_HASHES_GROUP_SIZE << " block ids of the local blockchain" << ENDL << ENDL;
+      std::cout << desc_all << ENDL;
+      return false;
+    }
+
+    po::store(command_line::parse_command_line(argc, argv, desc_params, false), vm);
+    po::notify(vm);
+    return true;
+  });
+  if (!r)
+    return 1;
+
+  std::string data_dir = command_line::get_arg(vm, command_line::arg_data_dir);
+  std::string output_file = command_line::get_arg(vm, arg_output_file);
+  if (output_file.empty())
+    output_file = data_dir + "/" CRYPTONOTE_CHECKPOINT_HASHES_FILENAME;
+
+  storage st;
+  r = st.m_blockchain.init(data_dir);
+  CHECK_AND_ASSERT_MES(r, 1, "Failed to load blockchain from " << data_dir);
+
+  uint64_t chain_height = st.m_blockchain.get_current_blockchain_height();
+  uint64_t height = command_line::get_arg(vm, arg_height);
+  if (!height)
+    height = chain_height - std::min<uint64_t>(chain_height, CRYPTONOTE_MINED_MONEY_UNLOCK_WINDOW);
+  CHECK_AND_ASSERT_MES(height <= chain_height, 1, "Blockchain height is " << chain_height << ", can't hash blocks up to " << height);
+
+  std::vector<crypto::hash> group_hashes;
+  std::vector<crypto::hash> ids(CHECKPOINT_HASHES_GROUP_SIZE);
+  for (uint64_t group_start = 0; group_start + CHECKPOINT_HASHES_GROUP_SIZE <= height; group_start += CHECKPOINT_HASHES_GROUP_SIZE)
+  {
+    for (size_t i = 0; i != CHECKPOINT_HASHES_GROUP_SIZE; ++i)
+      ids[i] = st.m_blockchain.get_block_id_by_height(group_start + i);
+    group_hashes.push_back(get_block_ids_group_hash(ids.data(), ids.size()));
+  }
+
+  r = file_io_utils::save_string_to_file(output_file, make_checkpoint_hashes_blob(group_hashes));
+  CHECK_AND_ASSERT_MES(r, 1, "Failed to write " << output_file);
+  LOG_PRINT_L0("Wrote " << group_hashes.size() << " hashes of blocks below height " << group_hashes.size() * CHECKPOINT_HASHES_GROUP_SIZE << " to " << output_file);
+  return 0;
+}
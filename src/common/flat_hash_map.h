@@ -0,0 +1,228 @@
+// Copyright (c) 2014, AEON, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this file are originally copyright (c) 2012-2013 The Cryptonote developers
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace tools
+{
+  /************************************************************************/
+  /* Hash map keeping its entries packed in insertion order, indexed by   */
+  /* an open-addressing table of 8-byte slots: entry number in the low    */
+  /* half, hash tag in the high half. Lookups probe one flat array and    */
+  /* touch an entry only when its tag matches. Up to 2^32 - 1 entries.    */
+  /*                                                                      */
+  /* Entries do not move on insert. Erasing moves the last entry into     */
+  /* the hole, so erase(it) returns it: the moved entry is there now.     */
+  /************************************************************************/
+  template<class Key, class T, class Hash = std::hash<Key> >
+  class flat_hash_map
+  {
+  public:
+    typedef Key key_type;
+    typedef T mapped_type;
+    typedef std::pair<Key, T> value_type;
+    typedef typename std::deque<value_type>::iterator iterator;
+    typedef typename std::deque<value_type>::const_iterator const_iterator;
+
+    flat_hash_map(): m_shift(64)
+    {}
+
+    iterator begin() { return m_entries.begin(); }
+    iterator end() { return m_entries.end(); }
+    const_iterator begin() const { return m_entries.begin(); }
+    const_iterator end() const { return m_entries.end(); }
+    size_t size() const { return m_entries.size(); }
+    bool empty() const { return m_entries.empty(); }
+
+    iterator find(const Key& k)
+    {
+      size_t slot = find_slot(k, hash_of(k));
+      return slot == npos ? m_entries.end() : m_entries.begin() + entry_of(m_slots[slot]);
+    }
+
+    const_iterator find(const Key& k) const
+    {
+      size_t slot = find_slot(k, hash_of(k));
+      return slot == npos ? m_entries.end() : m_entries.begin() + entry_of(m_slots[slot]);
+    }
+
+    size_t count(const Key& k) const
+    {
+      return find_slot(k, hash_of(k)) == npos ? 0 : 1;
+    }
+
+    std::pair<iterator, bool> insert(const value_type& v)
+    {
+      uint64_t h = hash_of(v.first);
+      size_t slot = find_slot(v.first, h);
+      if(slot != npos)
+        return std::make_pair(m_entries.begin() + entry_of(m_slots[slot]), false);
+      if(overloaded(m_entries.size() + 1))
+        rehash(m_slots.empty() ? min_capacity : m_slots.size() * 2);
+      m_entries.push_back(v);
+      place(h, m_entries.size() - 1);
+      return std::make_pair(m_entries.end() - 1, true);
+    }
+
+    T& operator[](const Key& k)
+    {
+      return insert(value_type(k, T())).first->second;
+    }
+
+    iterator erase(iterator it)
+    {
+      size_t entry = it - m_entries.begin();
+      remove_slot(slot_of_entry(entry));
+      size_t last = m_entries.size() - 1;
+      if(entry != last)
+      {
+        //the last entry takes the place of the erased one
+        size_t slot = slot_of_entry(last);
+        m_slots[slot] = (m_slots[slot] & tag_mask) | (entry + 1);
+        m_entries[entry] = std::move(m_entries[last]);
+      }
+      m_entries.pop_back();
+      return m_entries.begin() + entry;
+    }
+
+    size_t erase(const Key& k)
+    {
+      iterator it = find(k);
+      if(it == m_entries.end())
+        return 0;
+      erase(it);
+      return 1;
+    }
+
+    void clear()
+    {
+      m_entries.clear();
+      std::vector<uint64_t>().swap(m_slots);
+      m_shift = 64;
+    }
+
+    void reserve(size_t n)
+    {
+      size_t capacity = m_slots.empty() ? min_capacity : m_slots.size();
+      while(n * max_load_den > capacity * max_load_num)
+        capacity *= 2;
+      if(capacity > m_slots.size())
+        rehash(capacity);
+    }
+
+  private:
+    static const size_t npos = size_t(-1);
+    static const size_t min_capacity = 16;
+    //at most 3/4 of the slots are taken
+    static const size_t max_load_num = 3;
+    static const size_t max_load_den = 4;
+    static const uint64_t tag_mask = 0xffffffff00000000;
+
+    static uint64_t hash_of(const Key& k)
+    {
+      //spread the hash bits, the high ones choose the slot
+      return static_cast<uint64_t>(Hash()(k)) * 0x9e3779b97f4a7c15;
+    }
+    static size_t entry_of(uint64_t slot_value) { return static_cast<uint32_t>(slot_value) - 1; }
+    static uint64_t tag_of(uint64_t h) { return h << 32; }
+
+    size_t mask() const { return m_slots.size() - 1; }
+    size_t home_of(uint64_t h) const { return static_cast<size_t>(h >> m_shift); }
+    bool overloaded(size_t n) const { return n * max_load_den > m_slots.size() * max_load_num; }
+
+    size_t find_slot(const Key& k, uint64_t h) const
+    {
+      if(m_slots.empty())
+        return npos;
+      for(size_t slot = home_of(h);; slot = (slot + 1) & mask())
+      {
+        uint64_t v = m_slots[slot];
+        if(!v)
+          return npos;
+        if((v & tag_mask) == tag_of(h) && m_entries[entry_of(v)].first == k)
+          return slot;
+      }
+    }
+
+    size_t slot_of_entry(size_t entry) const
+    {
+      size_t slot = home_of(hash_of(m_entries[entry].first));
+      while(entry_of(m_slots[slot]) != entry)
+        slot = (slot + 1) & mask();
+      return slot;
+    }
+
+    void place(uint64_t h, size_t entry)
+    {
+      size_t slot = home_of(h);
+      while(m_slots[slot])
+        slot = (slot + 1) & mask();
+      m_slots[slot] = tag_of(h) | (entry + 1);
+    }
+
+    //backward shift deletion: slots after the hole move into it unless that would put
+    //them before their home slot, so probe sequences never cross an empty slot
+    void remove_slot(size_t hole)
+    {
+      for(size_t slot = (hole + 1) & mask(); m_slots[slot]; slot = (slot + 1) & mask())
+      {
+        size_t home = home_of(hash_of(m_entries[entry_of(m_slots[slot])].first));
+        bool stays = hole <= slot ? hole < home && home <= slot : hole < home || home <= slot;
+        if(!stays)
+        {
+          m_slots[hole] = m_slots[slot];
+          hole = slot;
+        }
+      }
+      m_slots[hole] = 0;
+    }
+
+    void rehash(size_t capacity)
+    {
+      m_slots.assign(capacity, 0);
+      m_shift = 64;
+      for(size_t c = capacity; c > 1; c /= 2)
+        --m_shift;
+      for(size_t entry = 0; entry != m_entries.size(); ++entry)
+        place(hash_of(m_entries[entry].first), entry);
+    }
+
+    std::deque<value_type> m_entries;
+    std::vector<uint64_t> m_slots; //power of two sized
+    unsigned m_shift;              //64 - log2(m_slots.size())
+  };
+}
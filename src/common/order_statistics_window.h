@@ -0,0 +1,171 @@
+// Copyright (c) 2014, AEON, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this file are originally copyright (c) 2012-2013 The Cryptonote developers
+
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <set>
+
+namespace tools
+{
+  /************************************************************************/
+  /* Sorted values of a sliding range [begin, end) of some sequence.      */
+  /* Moving the range costs O(log n) per value that enters or leaves it,  */
+  /* two cursors keep values at chosen ranks at hand while it slides.     */
+  /************************************************************************/
+  template<class T>
+  class order_statistics_window
+  {
+  public:
+    static const size_t cursors_count = 2;
+
+    order_statistics_window(): m_begin(0), m_end(0)
+    {
+      clear();
+    }
+    //cursors point into m_values
+    order_statistics_window(const order_statistics_window&) = delete;
+    order_statistics_window& operator=(const order_statistics_window&) = delete;
+
+    size_t begin_index() const { return m_begin; }
+    size_t end_index() const { return m_end; }
+    size_t size() const { return m_values.size(); }
+    bool empty() const { return m_values.empty(); }
+
+    void clear()
+    {
+      m_values.clear();
+      m_begin = m_end = 0;
+      for(auto& c: m_cursors)
+      {
+        c.m_it = m_values.end();
+        c.m_rank = 0;
+      }
+    }
+
+    //moves the range to [begin, end), value_of(i) gives the i-th value of the sequence
+    //and is called only for values that enter or leave the range
+    template<class t_value_of>
+    void move_to(size_t begin, size_t end, t_value_of value_of)
+    {
+      if(end < begin)
+        end = begin;
+      if(begin >= m_end || end <= m_begin)
+      {
+        clear();
+        m_begin = m_end = begin;
+      }
+      while(m_begin < begin)
+        erase(value_of(m_begin++));
+      while(m_end > end)
+        erase(value_of(--m_end));
+      while(m_begin > begin)
+        insert(value_of(--m_begin));
+      while(m_end < end)
+        insert(value_of(m_end++));
+    }
+
+    void insert(const T& v)
+    {
+      //equal values go after the ones already here
+      m_values.insert(v);
+      for(auto& c: m_cursors)
+      {
+        if(c.m_it != m_values.end() && v < *c.m_it)
+          --c.m_it;
+      }
+    }
+
+    bool erase(const T& v)
+    {
+      auto victim = m_values.lower_bound(v);
+      if(victim == m_values.end() || v < *victim)
+        return false;
+      //victim is at or before every cursor pointing to a value not less than it
+      for(auto& c: m_cursors)
+      {
+        if(c.m_it != m_values.end() && !(*c.m_it < v))
+          ++c.m_it;
+      }
+      m_values.erase(victim);
+      return true;
+    }
+
+    //value of the given rank, 0 is the smallest; cursor is moved there, so later calls
+    //for nearby ranks are cheap
+    const T& at_rank(size_t cursor_index, size_t rank)
+    {
+      cursor& c = m_cursors[cursor_index];
+      if(c.m_it == m_values.end())
+      {
+        if(rank < m_values.size() / 2)
+          c.m_it = std::next(m_values.begin(), rank);
+        else
+          c.m_it = std::prev(m_values.end(), m_values.size() - rank);
+      }
+      else if(rank > c.m_rank)
+      {
+        c.m_it = std::next(c.m_it, rank - c.m_rank);
+      }
+      else
+      {
+        c.m_it = std::prev(c.m_it, c.m_rank - rank);
+      }
+      c.m_rank = rank;
+      return *c.m_it;
+    }
+
+    //same as epee::misc_utils::median() of the values
+    T median()
+    {
+      if(m_values.empty())
+        return T();
+      size_t n = m_values.size() / 2;
+      if(m_values.size() % 2)
+        return at_rank(0, n);
+      return (at_rank(0, n - 1) + at_rank(1, n)) / 2;
+    }
+
+  private:
+    typedef std::multiset<T> values_container;
+
+    struct cursor
+    {
+      typename values_container::const_iterator m_it;
+      size_t m_rank;
+    };
+
+    values_container m_values;
+    size_t m_begin;
+    size_t m_end;
+    cursor m_cursors[cursors_count];
+  };
+}
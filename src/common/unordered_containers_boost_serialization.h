@@ -30,9 +30,11 @@
 
 #pragma once
 
+#include <boost/foreach.hpp>
 #include <boost/serialization/split_free.hpp>
 #include <unordered_map>
 #include <unordered_set>
+#include "flat_hash_map.h"
 
 namespace boost
 {
@@ -67,6 +69,35 @@ namespace boost
     }
 
 
+    //same format as std::unordered_map, so the two can replace each other in stored data
+    template <class Archive, class h_key, class hval, class hasher>
+    inline void save(Archive &a, const tools::flat_hash_map<h_key, hval, hasher> &x, const boost::serialization::version_type ver)
+    {
+      size_t s = x.size();
+      a << s;
+      BOOST_FOREACH(auto& v, x)
+      {
+        a << v.first;
+        a << v.second;
+      }
+    }
+
+    template <class Archive, class h_key, class hval, class hasher>
+    inline void load(Archive &a, tools::flat_hash_map<h_key, hval, hasher> &x, const boost::serialization::version_type ver)
+    {
+      x.clear();
+      size_t s = 0;
+      a >> s;
+      for(size_t i = 0; i != s; i++)
+      {
+        std::pair<h_key, hval> v;
+        a >> v.first;
+        a >> v.second;
+        x.insert(v);
+      }
+    }
+
+
     template <class Archive, class h_key, class hval>
     inline void save(Archive &a, const std::unordered_multimap<h_key, hval> &x, const boost::serialization::version_type ver)
     {
@@ -128,6 +159,12 @@ namespace boost
       split_free(a, x, ver);
     }
 
+    template <class Archive, class h_key, class hval, class hasher>
+    inline void serialize(Archive &a, tools::flat_hash_map<h_key, hval, hasher> &x, const boost::serialization::version_type ver)
+    {
+      split_free(a, x, ver);
+    }
+
     template <class Archive, class h_key, class hval>
     inline void serialize(Archive &a, std::unordered_multimap<h_key, hval> &x, const boost::serialization::version_type ver)
     {
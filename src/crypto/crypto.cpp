@@ -276,13 +276,24 @@ POP_WARNINGS
     const public_key *const *pubs, size_t pubs_count,
     const secret_key &sec, size_t sec_index,
     signature *sig) {
-    lock_guard<mutex> lock(random_lock);
     size_t i;
     ge_p3 image_unp;
     ge_dsmp image_pre;
     ec_scalar sum, k, h;
     rs_comm *const buf = reinterpret_cast<rs_comm *>(alloca(rs_comm_size(pubs_count)));
     assert(sec_index < pubs_count);
+    {
+      // draw all random scalars up front, so that the lock is not held during curve operations
+      // and signatures of different inputs can be generated concurrently
+      lock_guard<mutex> lock(random_lock);
+      random_scalar(k);
+      for (i = 0; i < pubs_count; i++) {
+        if (i != sec_index) {
+          random_scalar(sig[i].c);
+          random_scalar(sig[i].r);
+        }
+      }
+    }
 #if !defined(NDEBUG)
     {
       ge_p3 t;
@@ -309,15 +320,12 @@ POP_WARNINGS
       ge_p2 tmp2;
       ge_p3 tmp3;
       if (i == sec_index) {
-        random_scalar(k);
         ge_scalarmult_base(&tmp3, &k);
         ge_p3_tobytes(&buf->ab[i].a, &tmp3);
         hash_to_ec(*pubs[i], tmp3);
         ge_scalarmult(&tmp2, &k, &tmp3);
         ge_tobytes(&buf->ab[i].b, &tmp2);
       } else {
-        random_scalar(sig[i].c);
-        random_scalar(sig[i].r);
         if (ge_frombytes_vartime(&tmp3, &*pubs[i]) != 0) {
           abort();
         }
@@ -50,6 +50,7 @@
 #define CRYPTONOTE_BLOCK_FUTURE_TIME_LIMIT              60*60*2
 
 #define BLOCKCHAIN_TIMESTAMP_CHECK_WINDOW               60
+#define CHECKPOINT_HASHES_GROUP_SIZE                    512 // block ids covered by one hash in the checkpoint hashes file
 
 // MONEY_SUPPLY - total number coins to be generated
 #define MONEY_SUPPLY                                    ((uint64_t)(-1))
@@ -65,6 +66,10 @@
 #define MINIMUM_RELAY_FEE                               ((uint64_t)1000000) // pow(10, 6)
 
 #define ORPHANED_BLOCKS_MAX_COUNT                       100
+#define ALTERNATIVE_BLOCKS_MAX_COUNT                    1000
+#define ALTERNATIVE_BLOCKS_MAX_DEPTH                    720 // alternative chains with the top deeper under the main chain top are dropped
+#define INVALID_BLOCKS_MAX_COUNT                        10000
+#define CRYPTONOTE_PRUNING_DEFAULT_DEPTH                10080 // blocks, two weeks: pruned nodes drop the signatures of transactions deeper under the top
 
 
 #define DIFFICULTY_TARGET                               120   // seconds
@@ -118,6 +123,7 @@
 #define CRYPTONOTE_BLOCKCHAINDATA_FILENAME      "blockchain.bin"
 #define CRYPTONOTE_BLOCKCHAINDATA_TEMP_FILENAME "blockchain.bin.tmp"
 #define P2P_NET_DATA_FILENAME                   "p2pstate.bin"
+#define CRYPTONOTE_CHECKPOINT_HASHES_FILENAME   "checkpoint_hashes.dat"
 #define MINER_CONFIG_FILE_NAME                  "miner_conf.json"
 
 #define THREAD_STACK_SIZE                       5 * 1024 * 1024
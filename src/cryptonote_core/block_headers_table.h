@@ -0,0 +1,102 @@
+// Copyright (c) 2014, AEON, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this file are originally copyright (c) 2012-2013 The Cryptonote developers
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "crypto/hash.h"
+#include "difficulty.h"
+
+namespace cryptonote
+{
+  /************************************************************************/
+  /* Header fields of the main chain blocks, indexed by height with one   */
+  /* array per field. Scans over many blocks read the arrays they need    */
+  /* instead of striding over whole blocks with their transactions.       */
+  /************************************************************************/
+  class block_headers_table
+  {
+  public:
+    size_t size() const { return m_ids.size(); }
+    bool empty() const { return m_ids.empty(); }
+
+    void push_back(const crypto::hash& id, uint64_t timestamp, size_t block_cumulative_size, difficulty_type cumulative_difficulty, uint64_t already_generated_coins)
+    {
+      m_ids.push_back(id);
+      m_timestamps.push_back(timestamp);
+      m_block_cumulative_sizes.push_back(block_cumulative_size);
+      m_cumulative_difficulties.push_back(cumulative_difficulty);
+      m_already_generated_coins.push_back(already_generated_coins);
+    }
+
+    void pop_back()
+    {
+      m_ids.pop_back();
+      m_timestamps.pop_back();
+      m_block_cumulative_sizes.pop_back();
+      m_cumulative_difficulties.pop_back();
+      m_already_generated_coins.pop_back();
+    }
+
+    void clear()
+    {
+      m_ids.clear();
+      m_timestamps.clear();
+      m_block_cumulative_sizes.clear();
+      m_cumulative_difficulties.clear();
+      m_already_generated_coins.clear();
+    }
+
+    void reserve(size_t n)
+    {
+      m_ids.reserve(n);
+      m_timestamps.reserve(n);
+      m_block_cumulative_sizes.reserve(n);
+      m_cumulative_difficulties.reserve(n);
+      m_already_generated_coins.reserve(n);
+    }
+
+    const crypto::hash& id(uint64_t height) const { return m_ids[height]; }
+    uint64_t timestamp(uint64_t height) const { return m_timestamps[height]; }
+    size_t block_cumulative_size(uint64_t height) const { return m_block_cumulative_sizes[height]; }
+    difficulty_type cumulative_difficulty(uint64_t height) const { return m_cumulative_difficulties[height]; }
+    uint64_t already_generated_coins(uint64_t height) const { return m_already_generated_coins[height]; }
+
+  private:
+    std::vector<crypto::hash> m_ids;
+    std::vector<uint64_t> m_timestamps;
+    std::vector<size_t> m_block_cumulative_sizes;
+    std::vector<difficulty_type> m_cumulative_difficulties;
+    std::vector<uint64_t> m_already_generated_coins;
+  };
+}
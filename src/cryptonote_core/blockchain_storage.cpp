@@ -78,8 +78,7 @@ bool blockchain_storage::get_keeper_block_height(const crypto::hash &id, uint64_
 //------------------------------------------------------------------
 bool blockchain_storage::have_tx_keyimg_as_spent(const crypto::key_image &key_im)
 {
-  CRITICAL_REGION_LOCAL(m_blockchain_lock);
-  return  m_spent_keys.find(key_im) != m_spent_keys.end();
+  return m_spent_keys.contains(key_im);
 }
 //------------------------------------------------------------------
 transaction *blockchain_storage::get_tx(const crypto::hash &id)
@@ -104,21 +103,34 @@ bool blockchain_storage::init(const std::string& config_folder)
   m_config_folder = config_folder;
   LOG_PRINT_L0("Loading blockchain...");
   const std::string filename = m_config_folder + "/" CRYPTONOTE_BLOCKCHAINDATA_FILENAME;
+  TIME_MEASURE_START(load_time);
   if(tools::unserialize_obj_from_file(*this, filename))
   {
-    // transactions container
-    BOOST_FOREACH(const auto &e, m_transactions) 
+    TIME_MEASURE_FINISH(load_time);
+    LOG_PRINT_L0("Blockchain loaded in " << load_time << " ms");
+
+    if(m_startup_check == startup_check_full)
+    {
+      TIME_MEASURE_START(check_time);
+      CHECK_AND_ASSERT_MES(check_stored_blockchain(), false, "blockchain.bin invalid");
+      TIME_MEASURE_FINISH(check_time);
+      LOG_PRINT_L0("Blockchain checked in " << check_time << " ms");
+    }else if(m_startup_check == startup_check_background)
+    {
+      m_check_thread = boost::thread(&blockchain_storage::check_stored_blockchain_in_background, this, m_blocks.size());
+    }else
     {
-      CHECK_AND_ASSERT_MES(e.first==get_transaction_hash(e.second.tx),false,"corrupt transactions container");
+      LOG_PRINT_L0("Blockchain check skipped, the local store is trusted");
     }
 
-    // checkpoints
+    // files of older versions may have more alternative and invalid blocks than kept now
+    prune_alternative_chains();
+    while(m_invalid_blocks.size() > INVALID_BLOCKS_MAX_COUNT)
+      m_invalid_blocks.pop_front();
 
-    // mainchain
-    for (size_t height=0; height < m_blocks.size(); ++height)
-    {
-        CHECK_AND_ASSERT_MES((!m_checkpoints.is_in_checkpoint_zone(height)) || m_checkpoints.check_block(height,get_block_hash(m_blocks[height].bl)),false,"checkpoint fail, blockchain.bin invalid");
-    }
+    prune_transactions();
+    if(m_pruned_height)
+      LOG_PRINT_L0("Blockchain is pruned, transactions of blocks below height " << m_pruned_height << " have no signatures");
   }
   else
   {
@@ -139,8 +151,8 @@ bool blockchain_storage::init(const std::string& config_folder)
     add_new_block(bl, bvc);
     CHECK_AND_ASSERT_MES(!bvc.m_verifivation_failed, false, "Failed to add genesis block to blockchain");
   }
-  uint64_t timestamp_diff = time(NULL) - m_blocks.back().bl.timestamp;
-  if(!m_blocks.back().bl.timestamp)
+  uint64_t timestamp_diff = time(NULL) - m_block_headers.timestamp(m_blocks.size() - 1);
+  if(!m_block_headers.timestamp(m_blocks.size() - 1))
     timestamp_diff = time(NULL) - 1341378000;
   LOG_PRINT_GREEN("Blockchain initialized. last block: " << m_blocks.size() - 1 << ", " << epee::misc_utils::get_time_interval_string(timestamp_diff) << " time ago, current difficulty: " << get_difficulty_for_next_block(), LOG_LEVEL_0);
   return true;
@@ -180,26 +192,132 @@ bool blockchain_storage::store_blockchain()
 //------------------------------------------------------------------
 bool blockchain_storage::deinit()
 {
+  m_stop_check = true;
+  if(m_check_thread.joinable())
+    m_check_thread.join();
   return store_blockchain();
 }
 //------------------------------------------------------------------
+bool blockchain_storage::check_stored_blocks(uint64_t start_height, uint64_t end_height, size_t& txs_count)
+{
+  txs_count = 0;
+  std::vector<crypto::hash> group_ids;
+  for(uint64_t height = start_height; height != end_height; ++height)
+  {
+    const block& bl = m_blocks[height].bl;
+
+    // checkpoints and groups of ids, start_height is at the start of a group
+    bool in_hashes_zone = height < m_checkpoints.get_hashes_height();
+    if(in_hashes_zone || m_checkpoints.is_in_checkpoint_zone(height))
+    {
+      crypto::hash id = get_block_hash(bl);
+      CHECK_AND_ASSERT_MES(!m_checkpoints.is_in_checkpoint_zone(height) || m_checkpoints.check_block(height, id), false, "checkpoint fail on height " << height);
+      if(in_hashes_zone)
+        group_ids.push_back(id);
+      if(group_ids.size() == CHECKPOINT_HASHES_GROUP_SIZE)
+      {
+        CHECK_AND_ASSERT_MES(m_checkpoints.check_group(height + 1 - CHECKPOINT_HASHES_GROUP_SIZE, group_ids.data()), false, "checkpoint hashes fail on height " << height);
+        group_ids.clear();
+      }
+    }
+
+    // transactions container
+    auto check_tx = [&](const crypto::hash& tx_id)
+    {
+      auto it = m_transactions.find(tx_id);
+      CHECK_AND_ASSERT_MES(it != m_transactions.end(), false, "transaction " << tx_id << " of block on height " << height << " not found");
+      //the id of a pruned transaction can't be computed without its signatures
+      CHECK_AND_ASSERT_MES(height < m_pruned_height || tx_id == get_transaction_hash(it->second.tx), false, "corrupt transactions container, transaction " << tx_id);
+      return true;
+    };
+    if(!check_tx(get_transaction_hash(bl.miner_tx)))
+      return false;
+    BOOST_FOREACH(const crypto::hash& tx_id, bl.tx_hashes)
+    {
+      if(!check_tx(tx_id))
+        return false;
+    }
+    txs_count += 1 + bl.tx_hashes.size();
+  }
+  return true;
+}
+//------------------------------------------------------------------
+bool blockchain_storage::check_stored_blockchain()
+{
+  //groups of checkpoint hashes are checked whole, so they are the unit of work of the threads
+  std::atomic<uint64_t> next_group(0);
+  std::atomic<size_t> txs_count(0);
+  std::atomic<bool> res(true);
+  uint64_t groups_count = (m_blocks.size() + CHECKPOINT_HASHES_GROUP_SIZE - 1) / CHECKPOINT_HASHES_GROUP_SIZE;
+  auto check_groups = [&]()
+  {
+    for(uint64_t group = next_group++; group < groups_count && res; group = next_group++)
+    {
+      uint64_t start_height = group * CHECKPOINT_HASHES_GROUP_SIZE;
+      size_t group_txs_count = 0;
+      if(!check_stored_blocks(start_height, std::min<uint64_t>(start_height + CHECKPOINT_HASHES_GROUP_SIZE, m_blocks.size()), group_txs_count))
+        res = false;
+      txs_count += group_txs_count;
+    }
+  };
+
+  size_t threads = std::min<uint64_t>(std::max(1u, boost::thread::hardware_concurrency()), groups_count);
+  boost::thread_group checkers;
+  for(size_t t = 1; t < threads; ++t)
+    checkers.create_thread(check_groups);
+  check_groups();
+  checkers.join_all();
+
+  if(!res)
+    return false;
+  CHECK_AND_ASSERT_MES(txs_count == m_transactions.size(), false, "corrupt transactions container: " << m_transactions.size() << " transactions, " << txs_count << " in blocks");
+  return true;
+}
+//------------------------------------------------------------------
+void blockchain_storage::check_stored_blockchain_in_background(uint64_t end_height)
+{
+  LOG_PRINT_L0("Checking blockchain in background...");
+  TIME_MEASURE_START(check_time);
+  //the lock is taken for one group at a time, the blockchain may change in between
+  for(uint64_t start_height = 0; start_height < end_height && !m_stop_check; start_height += CHECKPOINT_HASHES_GROUP_SIZE)
+  {
+    CRITICAL_REGION_LOCAL(m_blockchain_lock);
+    uint64_t group_end_height = std::min<uint64_t>(std::min<uint64_t>(start_height + CHECKPOINT_HASHES_GROUP_SIZE, end_height), m_blocks.size());
+    if(group_end_height <= start_height)
+      break;
+    size_t txs_count = 0;
+    if(!check_stored_blocks(start_height, group_end_height, txs_count))
+    {
+      LOG_ERROR("Background blockchain check failed, " CRYPTONOTE_BLOCKCHAINDATA_FILENAME " is corrupt. Restart with --blockchain-check full or sync it again");
+      return;
+    }
+  }
+  TIME_MEASURE_FINISH(check_time);
+  if(!m_stop_check)
+    LOG_PRINT_L0("Blockchain checked in background in " << check_time << " ms");
+}
+//------------------------------------------------------------------
 bool blockchain_storage::pop_block_from_blockchain()
 {
   CRITICAL_REGION_LOCAL(m_blockchain_lock);
 
   CHECK_AND_ASSERT_MES(m_blocks.size() > 1, false, "pop_block_from_blockchain: can't pop from blockchain with size = " << m_blocks.size());
   size_t h = m_blocks.size()-1;
+  CHECK_AND_ASSERT_MES(h >= m_pruned_height, false, "pop_block_from_blockchain: can't pop pruned block on height " << h);
   block_extended_info& bei = m_blocks[h];
   //crypto::hash id = get_block_hash(bei.bl);
   bool r = purge_block_data_from_blockchain(bei.bl, bei.bl.tx_hashes.size());
   CHECK_AND_ASSERT_MES(r, false, "Failed to purge_block_data_from_blockchain for block " << get_block_hash(bei.bl) << " on height " << h);
 
   //remove from index
-  auto bl_ind = m_blocks_index.find(get_block_hash(bei.bl));
+  auto bl_ind = m_blocks_index.find(m_block_headers.id(h));
   CHECK_AND_ASSERT_MES(bl_ind != m_blocks_index.end(), false, "pop_block_from_blockchain: blockchain id not found in index");
   m_blocks_index.erase(bl_ind);
   //pop block from core
+  update_block_windows(h);
   m_blocks.pop_back();
+  m_block_headers.pop_back();
+  ++m_tip_version;
   m_tx_pool.on_blockchain_dec(m_blocks.size()-1, get_tail_id());
   return true;
 }
@@ -210,8 +328,13 @@ bool blockchain_storage::reset_and_set_genesis_block(const block& b)
   m_transactions.clear();
   m_spent_keys.clear();
   m_blocks.clear();
+  m_block_headers.clear();
+  ++m_tip_version;
+  m_prevalidated_ids.clear();
+  update_block_windows(0);
   m_blocks_index.clear();
   m_alternative_chains.clear();
+  m_alternative_blocks_index.clear();
   m_outputs.clear();
 
   block_verification_context bvc = boost::value_initialized<block_verification_context>();
@@ -231,11 +354,7 @@ bool blockchain_storage::purge_transaction_keyimages_from_blockchain(const trans
     bool operator()(const txin_to_key& inp) const
     {
       //const crypto::key_image& ki = inp.k_image;
-      auto r = m_spent_keys.find(inp.k_image);
-      if(r != m_spent_keys.end())
-      {
-        m_spent_keys.erase(r);
-      }else
+      if(!m_spent_keys.erase(inp.k_image))
       {
         CHECK_AND_ASSERT_MES(!m_strict_check, false, "purge_block_data_from_blockchain: key image in transaction not found");
       }
@@ -315,7 +434,7 @@ crypto::hash blockchain_storage::get_tail_id()
   crypto::hash id = null_hash;
   if(m_blocks.size())
   {
-    get_block_hash(m_blocks.back().bl, id);
+    id = m_block_headers.id(m_blocks.size() - 1);
   }
   return id;
 }
@@ -332,7 +451,7 @@ bool blockchain_storage::get_short_chain_history(std::list<crypto::hash>& ids)
   bool genesis_included = false;
   while(current_back_offset < sz)
   {
-    ids.push_back(get_block_hash(m_blocks[sz-current_back_offset].bl));
+    ids.push_back(m_block_headers.id(sz-current_back_offset));
     if(sz-current_back_offset == 0)
       genesis_included = true;
     if(i < 10)
@@ -345,7 +464,7 @@ bool blockchain_storage::get_short_chain_history(std::list<crypto::hash>& ids)
     ++i;
   }
   if(!genesis_included)
-    ids.push_back(get_block_hash(m_blocks[0].bl));
+    ids.push_back(m_block_headers.id(0));
 
   return true;
 }
@@ -356,7 +475,7 @@ crypto::hash blockchain_storage::get_block_id_by_height(uint64_t height)
   if(height >= m_blocks.size())
     return null_hash;
 
-  return get_block_hash(m_blocks[height].bl);
+  return m_block_headers.id(height);
 }
 //------------------------------------------------------------------
 bool blockchain_storage::get_block_by_hash(const crypto::hash &h, block &blk) {
@@ -388,27 +507,84 @@ void blockchain_storage::get_all_known_block_ids(std::list<crypto::hash> &main,
   BOOST_FOREACH(blocks_ext_by_hash::value_type &v, m_alternative_chains)
     alt.push_back(v.first);
 
-  BOOST_FOREACH(blocks_ext_by_hash::value_type &v, m_invalid_blocks)
-    invalid.push_back(v.first);
+  BOOST_FOREACH(const crypto::hash& id, m_invalid_blocks)
+    invalid.push_back(id);
 }
 //------------------------------------------------------------------
 difficulty_type blockchain_storage::get_difficulty_for_next_block()
 {
   CRITICAL_REGION_LOCAL(m_blockchain_lock);
-  std::vector<uint64_t> timestamps;
-  std::vector<difficulty_type> commulative_difficulties;
-  size_t offset = m_blocks.size() - std::min(m_blocks.size(), static_cast<size_t>(DIFFICULTY_BLOCKS_COUNT));
-  if(!offset)
-    ++offset;//skip genesis block
-  for(; offset < m_blocks.size(); offset++)
+  if(m_next_difficulty && m_next_difficulty_tip_version == m_tip_version)
+    return m_next_difficulty;
+
+  update_block_windows(m_blocks.size());
+  size_t cut_begin, cut_end;
+  if(!get_difficulty_cut(m_difficulty_timestamps.size(), cut_begin, cut_end))
+    return 1;
+  size_t begin = m_difficulty_timestamps.begin_index();
+  uint64_t time_span = m_difficulty_timestamps.at_rank(1, cut_end - 1) - m_difficulty_timestamps.at_rank(0, cut_begin);
+  difficulty_type total_work = m_block_headers.cumulative_difficulty(begin + cut_end - 1) - m_block_headers.cumulative_difficulty(begin + cut_begin);
+
+  m_next_difficulty = next_difficulty(time_span, total_work, m_blocks.size());
+  m_next_difficulty_tip_version = m_tip_version;
+  return m_next_difficulty;
+}
+//------------------------------------------------------------------
+bool blockchain_storage::prevalidate_block_ids(uint64_t start_height, const std::list<crypto::hash>& ids)
+{
+  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  uint64_t hashes_height = m_checkpoints.get_hashes_height();
+  uint64_t end_height = std::min(start_height + ids.size(), hashes_height);
+  //ids below start_height are taken from the main chain, so there must be no gap
+  if(start_height > m_blocks.size() || end_height <= m_blocks.size())
+    return true;
+
+  std::vector<crypto::hash> entry_ids(ids.begin(), ids.end());
+  std::vector<crypto::hash> group_ids(CHECKPOINT_HASHES_GROUP_SIZE);
+  uint64_t group_start = m_blocks.size() - m_blocks.size() % CHECKPOINT_HASHES_GROUP_SIZE;
+  size_t prevalidated_count = 0;
+  for(; group_start + CHECKPOINT_HASHES_GROUP_SIZE <= end_height; group_start += CHECKPOINT_HASHES_GROUP_SIZE)
+  {
+    for(size_t i = 0; i != CHECKPOINT_HASHES_GROUP_SIZE; ++i)
+    {
+      uint64_t height = group_start + i;
+      group_ids[i] = height < start_height ? m_block_headers.id(height) : entry_ids[height - start_height];
+    }
+    if(!m_checkpoints.check_group(group_start, group_ids.data()))
+      return false;
+
+    for(uint64_t height = std::max(group_start, static_cast<uint64_t>(m_blocks.size())); height != group_start + CHECKPOINT_HASHES_GROUP_SIZE; ++height)
+    {
+      m_prevalidated_ids[height] = group_ids[height - group_start];
+      ++prevalidated_count;
+    }
+  }
+  if(prevalidated_count)
+    LOG_PRINT_L1("Checked ids of " << prevalidated_count << " blocks up to height " << group_start << " against checkpoint hashes");
+  return true;
+}
+//------------------------------------------------------------------
+void blockchain_storage::update_block_windows(size_t height)
+{
+  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  if(m_sizes_window.end_index() > m_blocks.size() || m_timestamps_window.end_index() > m_blocks.size() || m_difficulty_timestamps.end_index() > m_blocks.size())
   {
-    timestamps.push_back(m_blocks[offset].bl.timestamp);
-    commulative_difficulties.push_back(m_blocks[offset].cumulative_difficulty);
+    //blocks were replaced behind our back (storage reloaded), start over
+    m_sizes_window.clear();
+    m_timestamps_window.clear();
+    m_difficulty_timestamps.clear();
   }
-  return next_difficulty(timestamps, commulative_difficulties,m_blocks.size());
+
+  size_t begin, end;
+  get_difficulty_window(height, begin, end);
+  m_difficulty_timestamps.move_to(begin, end, [&](size_t i) { return m_block_headers.timestamp(i); });
+  m_sizes_window.move_to(height - std::min(height, static_cast<size_t>(CRYPTONOTE_REWARD_BLOCKS_WINDOW)), height,
+    [&](size_t i) { return m_block_headers.block_cumulative_size(i); });
+  m_timestamps_window.move_to(height - std::min(height, static_cast<size_t>(BLOCKCHAIN_TIMESTAMP_CHECK_WINDOW)), height,
+    [&](size_t i) { return m_block_headers.timestamp(i); });
 }
 //------------------------------------------------------------------
-bool blockchain_storage::rollback_blockchain_switching(std::list<block>& original_chain, size_t rollback_height)
+bool blockchain_storage::rollback_blockchain_switching(std::list<block_extended_info>& original_chain, size_t rollback_height)
 {
   CRITICAL_REGION_LOCAL(m_blockchain_lock);
   //remove failed subchain
@@ -418,10 +594,10 @@ bool blockchain_storage::rollback_blockchain_switching(std::list<block>& origina
     CHECK_AND_ASSERT_MES(r, false, "PANIC!!! failed to remove block while chain switching during the rollback!");
   }
   //return back original chain
-  BOOST_FOREACH(auto& bl, original_chain)
+  BOOST_FOREACH(auto& bei, original_chain)
   {
     block_verification_context bvc = boost::value_initialized<block_verification_context>();
-    bool r = handle_block_to_main_chain(bl, bvc);
+    bool r = handle_block_to_main_chain(bei.bl, get_block_hash(bei.bl), bvc, &bei);
     CHECK_AND_ASSERT_MES(r && bvc.m_added_to_main_chain, false, "PANIC!!! failed to add (again) block while chain switching during the rollback!");
   }
 
@@ -438,13 +614,13 @@ bool blockchain_storage::switch_to_alternative_blockchain(std::list<blocks_ext_b
   CHECK_AND_ASSERT_MES(m_blocks.size() > split_height, false, "switch_to_alternative_blockchain: blockchain size is lower than split height");
 
   //disconnecting old chain
-  std::list<block> disconnected_chain;
+  std::list<block_extended_info> disconnected_chain;
   for(size_t i = m_blocks.size()-1; i >=split_height; i--)
   {
-    block b = m_blocks[i].bl;
+    block_extended_info bei = m_blocks[i];
     bool r = pop_block_from_blockchain();
     CHECK_AND_ASSERT_MES(r, false, "failed to remove block on chain switching");
-    disconnected_chain.push_front(b);
+    disconnected_chain.push_front(bei);
   }
 
   //connecting new alternative chain
@@ -452,7 +628,7 @@ bool blockchain_storage::switch_to_alternative_blockchain(std::list<blocks_ext_b
   {
     auto ch_ent = *alt_ch_iter;
     block_verification_context bvc = boost::value_initialized<block_verification_context>();
-    bool r = handle_block_to_main_chain(ch_ent->second.bl, bvc);
+    bool r = handle_block_to_main_chain(ch_ent->second.bl, ch_ent->first, bvc, &ch_ent->second);
     if(!r || !bvc.m_added_to_main_chain)
     {
       LOG_PRINT_L0("Failed to switch to alternative blockchain");
@@ -460,14 +636,14 @@ bool blockchain_storage::switch_to_alternative_blockchain(std::list<blocks_ext_b
       // dont add block as invalid here because failure may be temporary
       //add_block_as_invalid(ch_ent->second, get_block_hash(ch_ent->second.bl));
       LOG_PRINT_L0("The block was inserted as invalid while connecting new alternative chain,  block_id: " << get_block_hash(ch_ent->second.bl));
-      m_alternative_chains.erase(*alt_ch_iter++);
+      remove_alternative_block(*alt_ch_iter++);
 
       for(auto alt_ch_to_orph_iter = alt_ch_iter; alt_ch_to_orph_iter != alt_chain.end(); )
       {
         //block_verification_context bvc = boost::value_initialized<block_verification_context>();
 	// dont add block as invalid here because failure may be temporary
         //add_block_as_invalid((*alt_ch_to_orph_iter)->second, (*alt_ch_to_orph_iter)->first);
-        m_alternative_chains.erase(*alt_ch_to_orph_iter++);
+        remove_alternative_block(*alt_ch_to_orph_iter++);
       }
       return false;
     }
@@ -479,7 +655,7 @@ bool blockchain_storage::switch_to_alternative_blockchain(std::list<blocks_ext_b
     BOOST_FOREACH(auto& old_ch_ent, disconnected_chain)
     {
       block_verification_context bvc = boost::value_initialized<block_verification_context>();
-      bool r = handle_alternative_block(old_ch_ent, get_block_hash(old_ch_ent), bvc);
+      bool r = handle_alternative_block(old_ch_ent.bl, get_block_hash(old_ch_ent.bl), bvc, &old_ch_ent);
       if(!r)
       {
         LOG_ERROR("Failed to push ex-main chain blocks to alternative chain ");
@@ -492,7 +668,7 @@ bool blockchain_storage::switch_to_alternative_blockchain(std::list<blocks_ext_b
   //removing all_chain entries from alternative chain
   BOOST_FOREACH(auto ch_ent, alt_chain)
   {
-    m_alternative_chains.erase(ch_ent);
+    remove_alternative_block(ch_ent);
   }
 
   LOG_PRINT_GREEN("REORGANIZE SUCCESS! on height: " << split_height << ", new blockchain size: " << m_blocks.size(), LOG_LEVEL_0);
@@ -515,8 +691,8 @@ difficulty_type blockchain_storage::get_next_difficulty_for_alternative_chain(co
       ++main_chain_start_offset; //skip genesis block
     for(; main_chain_start_offset < main_chain_stop_offset; ++main_chain_start_offset)
     {
-      timestamps.push_back(m_blocks[main_chain_start_offset].bl.timestamp);
-      commulative_difficulties.push_back(m_blocks[main_chain_start_offset].cumulative_difficulty);
+      timestamps.push_back(m_block_headers.timestamp(main_chain_start_offset));
+      commulative_difficulties.push_back(m_block_headers.cumulative_difficulty(main_chain_start_offset));
     }
 
     CHECK_AND_ASSERT_MES((alt_chain.size() + timestamps.size()) <= DIFFICULTY_BLOCKS_COUNT, false, "Internal error, alt_chain.size()["<< alt_chain.size()
@@ -574,9 +750,8 @@ bool blockchain_storage::validate_miner_transaction(const block& b, size_t cumul
   BOOST_FOREACH(auto& o, b.miner_tx.vout)
     money_in_use += o.amount;
 
-  std::vector<size_t> last_blocks_sizes;
-  get_last_n_blocks_sizes(last_blocks_sizes, CRYPTONOTE_REWARD_BLOCKS_WINDOW);
-  if (!get_block_reward(epee::misc_utils::median(last_blocks_sizes), cumulative_block_size, already_generated_coins, base_reward, height)) {
+  update_block_windows(m_blocks.size());
+  if (!get_block_reward(m_sizes_window.median(), cumulative_block_size, already_generated_coins, base_reward, height)) {
     LOG_PRINT_L0("block size " << cumulative_block_size << " is bigger than allowed for this blockchain");
     return false;
   }
@@ -601,19 +776,11 @@ bool blockchain_storage::get_backward_blocks_sizes(size_t from_height, std::vect
 
   size_t start_offset = (from_height+1) - std::min((from_height+1), count);
   for(size_t i = start_offset; i != from_height+1; i++)
-    sz.push_back(m_blocks[i].block_cumulative_size);
+    sz.push_back(m_block_headers.block_cumulative_size(i));
 
   return true;
 }
 //------------------------------------------------------------------
-bool blockchain_storage::get_last_n_blocks_sizes(std::vector<size_t>& sz, size_t count)
-{
-  CRITICAL_REGION_LOCAL(m_blockchain_lock);
-  if(!m_blocks.size())
-    return true;
-  return get_backward_blocks_sizes(m_blocks.size() -1, sz, count);
-}
-//------------------------------------------------------------------
 uint64_t blockchain_storage::get_current_comulative_blocksize_limit()
 {
   return m_current_block_cumul_sz_limit;
@@ -634,7 +801,7 @@ bool blockchain_storage::create_block_template(block& b, const account_public_ad
   CHECK_AND_ASSERT_MES(diffic, false, "difficulty owverhead.");
 
   median_size = m_current_block_cumul_sz_limit / 2;
-  already_generated_coins = m_blocks.back().already_generated_coins;
+  already_generated_coins = m_block_headers.already_generated_coins(height - 1);
 
   CRITICAL_REGION_END();
 
@@ -750,7 +917,7 @@ bool blockchain_storage::complete_timestamps_vector(uint64_t start_top_height, s
   size_t stop_offset = start_top_height > need_elements ? start_top_height - need_elements:0;
   do
   {
-    timestamps.push_back(m_blocks[start_top_height].bl.timestamp);
+    timestamps.push_back(m_block_headers.timestamp(start_top_height));
     if(start_top_height == 0)
       break;
     --start_top_height;
@@ -758,7 +925,7 @@ bool blockchain_storage::complete_timestamps_vector(uint64_t start_top_height, s
   return true;
 }
 //------------------------------------------------------------------
-bool blockchain_storage::handle_alternative_block(const block& b, const crypto::hash& id, block_verification_context& bvc)
+bool blockchain_storage::handle_alternative_block(const block& b, const crypto::hash& id, block_verification_context& bvc, const block_extended_info* checked)
 {
   CRITICAL_REGION_LOCAL(m_blockchain_lock);
 
@@ -777,6 +944,15 @@ bool blockchain_storage::handle_alternative_block(const block& b, const crypto::
     bvc.m_verifivation_failed = true;
     return false;
   }
+  //switching to it would return pruned transactions to the pool
+  if (block_height < m_pruned_height)
+  {
+    LOG_PRINT_RED_L0("Block with id: " << id
+      << ENDL << " can't be accepted for alternative chain, block height: " << block_height
+      << ENDL << " the blockchain is pruned below height: " << m_pruned_height);
+    bvc.m_verifivation_failed = true;
+    return false;
+  }
 
   //block is not related with head of main chain
   //first of all - look in alternative chains container
@@ -801,8 +977,7 @@ bool blockchain_storage::handle_alternative_block(const block& b, const crypto::
     {
       //make sure that it has right connection to main chain
       CHECK_AND_ASSERT_MES(m_blocks.size() > alt_chain.front()->second.height, false, "main blockchain wrong height");
-      crypto::hash h = null_hash;
-      get_block_hash(m_blocks[alt_chain.front()->second.height - 1].bl, h);
+      const crypto::hash& h = m_block_headers.id(alt_chain.front()->second.height - 1);
       CHECK_AND_ASSERT_MES(h == alt_chain.front()->second.bl.prev_id, false, "alternative chain have wrong connection to main chain");
       complete_timestamps_vector(alt_chain.front()->second.height - 1, timestamps);
     }else
@@ -837,7 +1012,10 @@ bool blockchain_storage::handle_alternative_block(const block& b, const crypto::
     difficulty_type current_diff = get_next_difficulty_for_alternative_chain(alt_chain, bei);
     CHECK_AND_ASSERT_MES(current_diff, false, "!!!!!!! DIFFICULTY OVERHEAD !!!!!!!");
     crypto::hash proof_of_work = null_hash;
-    get_block_longhash(bei.bl, proof_of_work, bei.height);
+    if(checked && checked->proof_of_work != null_hash)
+      proof_of_work = checked->proof_of_work; // ex-main chain block, its hash was computed when it was added
+    else
+      get_block_longhash(bei.bl, proof_of_work, bei.height);
     if(!check_hash(proof_of_work, current_diff))
     {
       LOG_PRINT_RED_L0("Block with id: " << id
@@ -856,8 +1034,10 @@ bool blockchain_storage::handle_alternative_block(const block& b, const crypto::
 
     }
 
-    bei.cumulative_difficulty = alt_chain.size() ? it_prev->second.cumulative_difficulty: m_blocks[it_main_prev->second].cumulative_difficulty;
+    bei.cumulative_difficulty = alt_chain.size() ? it_prev->second.cumulative_difficulty: m_block_headers.cumulative_difficulty(it_main_prev->second);
     bei.cumulative_difficulty += current_diff;
+    bei.proof_of_work = proof_of_work;
+    bei.inputs_checked = checked && checked->inputs_checked;
 
 #ifdef _DEBUG
     auto i_dres = m_alternative_chains.find(id);
@@ -865,6 +1045,8 @@ bool blockchain_storage::handle_alternative_block(const block& b, const crypto::
 #endif
     auto i_res = m_alternative_chains.insert(blocks_ext_by_hash::value_type(id, bei));
     CHECK_AND_ASSERT_MES(i_res.second, false, "insertion of new alternative block returned as it already exist");
+    alternative_block_ref ref = {id, b.prev_id, bei.height};
+    m_alternative_blocks_index.insert(ref);
     alt_chain.push_back(i_res.first);
 
     if(is_a_checkpoint)
@@ -876,10 +1058,10 @@ bool blockchain_storage::handle_alternative_block(const block& b, const crypto::
       if(r) bvc.m_added_to_main_chain = true;
       else bvc.m_verifivation_failed = true;
       return r;
-    }else if(m_blocks.back().cumulative_difficulty < bei.cumulative_difficulty) //check if difficulty bigger then in main chain
+    }else if(m_block_headers.cumulative_difficulty(m_blocks.size() - 1) < bei.cumulative_difficulty) //check if difficulty bigger then in main chain
     {
       //do reorganize!
-      LOG_PRINT_GREEN("###### REORGANIZE on height: " << alt_chain.front()->second.height << " of " << m_blocks.size() - 1 << " with cum_difficulty " << m_blocks.back().cumulative_difficulty
+      LOG_PRINT_GREEN("###### REORGANIZE on height: " << alt_chain.front()->second.height << " of " << m_blocks.size() - 1 << " with cum_difficulty " << m_block_headers.cumulative_difficulty(m_blocks.size() - 1)
         << ENDL << " alternative blockchain size: " << alt_chain.size() << " with cum_difficulty " << bei.cumulative_difficulty, LOG_LEVEL_0);
       bool r = switch_to_alternative_blockchain(alt_chain, false);
       if(r) bvc.m_added_to_main_chain = true;
@@ -903,11 +1085,12 @@ bool blockchain_storage::handle_alternative_block(const block& b, const crypto::
   return true;
 }
 //------------------------------------------------------------------
-bool blockchain_storage::get_blocks(uint64_t start_offset, size_t count, std::list<block>& blocks, std::list<transaction>& txs)
+bool blockchain_storage::get_blocks(uint64_t start_offset, size_t count, std::vector<block>& blocks, std::vector<transaction>& txs)
 {
   CRITICAL_REGION_LOCAL(m_blockchain_lock);
   if(start_offset >= m_blocks.size())
     return false;
+  blocks.reserve(blocks.size() + (std::min)(count, m_blocks.size() - static_cast<size_t>(start_offset)));
   for(size_t i = start_offset; i < start_offset + count && i < m_blocks.size();i++)
   {
     blocks.push_back(m_blocks[i].bl);
@@ -919,12 +1102,13 @@ bool blockchain_storage::get_blocks(uint64_t start_offset, size_t count, std::li
   return true;
 }
 //------------------------------------------------------------------
-bool blockchain_storage::get_blocks(uint64_t start_offset, size_t count, std::list<block>& blocks)
+bool blockchain_storage::get_blocks(uint64_t start_offset, size_t count, std::vector<block>& blocks)
 {
   CRITICAL_REGION_LOCAL(m_blockchain_lock);
   if(start_offset >= m_blocks.size())
     return false;
 
+  blocks.reserve(blocks.size() + (std::min)(count, m_blocks.size() - static_cast<size_t>(start_offset)));
   for(size_t i = start_offset; i < start_offset + count && i < m_blocks.size();i++)
     blocks.push_back(m_blocks[i].bl);
   return true;
@@ -935,31 +1119,33 @@ bool blockchain_storage::handle_get_objects(NOTIFY_REQUEST_GET_OBJECTS::request&
   CRITICAL_REGION_LOCAL(m_tx_pool);
   CRITICAL_REGION_LOCAL1(m_blockchain_lock);
   rsp.current_blockchain_height = get_current_blockchain_height();
-  std::list<block> blocks;
-  get_blocks(arg.blocks, blocks, rsp.missed_ids);
-
-  BOOST_FOREACH(const auto& bl, blocks)
+  //pack blocks and their transactions straight from the storage, without copying them out first
+  rsp.blocks.reserve(arg.blocks.size());
+  BOOST_FOREACH(const auto& bl_id, arg.blocks)
   {
-    std::list<crypto::hash> missed_tx_id;
-    std::list<transaction> txs;
-    get_transactions(bl.tx_hashes, txs, rsp.missed_ids);
-    CHECK_AND_ASSERT_MES(!missed_tx_id.size(), false, "Internal error: have missed missed_tx_id.size()=" << missed_tx_id.size()
-      << ENDL << "for block id = " << get_block_hash(bl));
-   rsp.blocks.push_back(block_complete_entry());
-   block_complete_entry& e = rsp.blocks.back();
-   //pack block
-   e.block = t_serializable_object_to_blob(bl);
-   //pack transactions
-   BOOST_FOREACH(transaction& tx, txs)
-     e.txs.push_back(t_serializable_object_to_blob(tx));
-
+    auto it = m_blocks_index.find(bl_id);
+    if(it == m_blocks_index.end())
+    {
+      rsp.missed_ids.push_back(bl_id);
+      continue;
+    }
+    CHECK_AND_ASSERT_MES(it->second < m_blocks.size(), false, "Internal error: bl_id=" << epee::string_tools::pod_to_hex(bl_id)
+      << " have index record with offset="<<it->second<< ", bigger then m_blocks.size()=" << m_blocks.size());
+    if(it->second < m_pruned_height)
+    {
+      rsp.missed_ids.push_back(bl_id);
+      continue;
+    }
+    const block& bl = m_blocks[it->second].bl;
+    rsp.blocks.push_back(block_complete_entry());
+    block_complete_entry& e = rsp.blocks.back();
+    e.block = t_serializable_object_to_blob(bl);
+    e.txs.reserve(bl.tx_hashes.size());
+    get_transactions_blobs(bl.tx_hashes, e.txs, rsp.missed_ids);
   }
   //get another transactions, if need
-  std::list<transaction> txs;
-  get_transactions(arg.txs, txs, rsp.missed_ids);
-  //pack aside transactions
-  BOOST_FOREACH(const auto& tx, txs)
-    rsp.txs.push_back(t_serializable_object_to_blob(tx));
+  rsp.txs.reserve(arg.txs.size());
+  get_transactions_blobs(arg.txs, rsp.txs, rsp.missed_ids);
 
   return true;
 }
@@ -1077,10 +1263,10 @@ bool blockchain_storage::find_blockchain_supplement(const std::list<crypto::hash
     return false;
   }
   //check genesis match
-  if(qblock_ids.back() != get_block_hash(m_blocks[0].bl))
+  if(qblock_ids.back() != m_block_headers.id(0))
   {
     LOG_ERROR("Client sent wrong NOTIFY_REQUEST_CHAIN: genesis block missmatch: " << ENDL << "id: "
-      << qblock_ids.back() << ", " << ENDL << "expected: " << get_block_hash(m_blocks[0].bl)
+      << qblock_ids.back() << ", " << ENDL << "expected: " << m_block_headers.id(0)
       << "," << ENDL << " dropping connection");
     return false;
   }
@@ -1119,9 +1305,9 @@ uint64_t blockchain_storage::block_difficulty(size_t i)
   CRITICAL_REGION_LOCAL(m_blockchain_lock);
   CHECK_AND_ASSERT_MES(i < m_blocks.size(), false, "wrong block index i = " << i << " at blockchain_storage::block_difficulty()");
   if(i == 0)
-    return m_blocks[i].cumulative_difficulty;
+    return m_block_headers.cumulative_difficulty(i);
 
-  return m_blocks[i].cumulative_difficulty - m_blocks[i-1].cumulative_difficulty;
+  return m_block_headers.cumulative_difficulty(i) - m_block_headers.cumulative_difficulty(i-1);
 }
 //------------------------------------------------------------------
 void blockchain_storage::print_blockchain(uint64_t start_index, uint64_t end_index)
@@ -1186,11 +1372,11 @@ bool blockchain_storage::find_blockchain_supplement(const std::list<crypto::hash
   resp.total_height = get_current_blockchain_height();
   size_t count = 0;
   for(size_t i = resp.start_height; i != m_blocks.size() && count < BLOCKS_IDS_SYNCHRONIZING_DEFAULT_COUNT; i++, count++)
-    resp.m_block_ids.push_back(get_block_hash(m_blocks[i].bl));
+    resp.m_block_ids.push_back(m_block_headers.id(i));
   return true;
 }
 //------------------------------------------------------------------
-bool blockchain_storage::find_blockchain_supplement(const uint64_t req_start_block, const std::list<crypto::hash>& qblock_ids, std::list<std::pair<block, std::list<transaction> > >& blocks, uint64_t& total_height, uint64_t& start_height, size_t max_count)
+bool blockchain_storage::find_blockchain_supplement(const uint64_t req_start_block, const std::list<crypto::hash>& qblock_ids, std::vector<std::pair<block, std::vector<transaction> > >& blocks, uint64_t& total_height, uint64_t& start_height, size_t max_count)
 {
   CRITICAL_REGION_LOCAL(m_blockchain_lock);
   if(req_start_block > 0) {
@@ -1199,13 +1385,21 @@ bool blockchain_storage::find_blockchain_supplement(const uint64_t req_start_blo
     if(!find_blockchain_supplement(qblock_ids, start_height))
       return false;
   }
+  if(start_height < m_pruned_height)
+  {
+    LOG_PRINT_L1("Blocks from height " << start_height << " requested, but the blockchain is pruned below height " << m_pruned_height);
+    return false;
+  }
 
   total_height = get_current_blockchain_height();
+  if(start_height < m_blocks.size())
+    blocks.reserve(blocks.size() + (std::min)(max_count, m_blocks.size() - static_cast<size_t>(start_height)));
   size_t count = 0;
   for(size_t i = start_height; i != m_blocks.size() && count < max_count; i++, count++)
   {
     blocks.resize(blocks.size()+1);
     blocks.back().first = m_blocks[i].bl;
+    blocks.back().second.reserve(m_blocks[i].bl.tx_hashes.size());
     std::list<crypto::hash> mis;
     get_transactions(m_blocks[i].bl.tx_hashes, blocks.back().second, mis);
     CHECK_AND_ASSERT_MES(!mis.size(), false, "internal error, transaction from block not found");
@@ -1213,22 +1407,141 @@ bool blockchain_storage::find_blockchain_supplement(const uint64_t req_start_blo
   return true;
 }
 //------------------------------------------------------------------
-bool blockchain_storage::add_block_as_invalid(const block& bl, const crypto::hash& h)
+bool blockchain_storage::find_blockchain_supplement(const uint64_t req_start_block, const std::list<crypto::hash>& qblock_ids, std::vector<block_complete_entry>& blocks, uint64_t& total_height, uint64_t& start_height, size_t max_count)
 {
-  block_extended_info bei = AUTO_VAL_INIT(bei);
-  bei.bl = bl;
-  return add_block_as_invalid(bei, h);
+  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  if(req_start_block > 0) {
+     start_height = req_start_block; 
+  } else {
+    if(!find_blockchain_supplement(qblock_ids, start_height))
+      return false;
+  }
+  if(start_height < m_pruned_height)
+  {
+    LOG_PRINT_L1("Blocks from height " << start_height << " requested, but the blockchain is pruned below height " << m_pruned_height);
+    return false;
+  }
+
+  total_height = get_current_blockchain_height();
+  if(start_height < m_blocks.size())
+    blocks.reserve(blocks.size() + (std::min)(max_count, m_blocks.size() - static_cast<size_t>(start_height)));
+  size_t count = 0;
+  for(size_t i = start_height; i != m_blocks.size() && count < max_count; i++, count++)
+  {
+    blocks.push_back(block_complete_entry());
+    block_complete_entry& e = blocks.back();
+    e.block = t_serializable_object_to_blob(m_blocks[i].bl);
+    e.txs.reserve(m_blocks[i].bl.tx_hashes.size());
+    std::list<crypto::hash> mis;
+    get_transactions_blobs(m_blocks[i].bl.tx_hashes, e.txs, mis);
+    CHECK_AND_ASSERT_MES(!mis.size(), false, "internal error, transaction from block not found");
+  }
+  return true;
 }
 //------------------------------------------------------------------
-bool blockchain_storage::add_block_as_invalid(const block_extended_info& bei, const crypto::hash& h)
+bool blockchain_storage::add_block_as_invalid(const block& bl, const crypto::hash& h)
 {
   CRITICAL_REGION_LOCAL(m_blockchain_lock);
-  auto i_res = m_invalid_blocks.insert(std::map<crypto::hash, block_extended_info>::value_type(h, bei));
+  auto i_res = m_invalid_blocks.push_back(h);
   CHECK_AND_ASSERT_MES(i_res.second, false, "at insertion invalid by tx returned status existed");
-  LOG_PRINT_L0("BLOCK ADDED AS INVALID: " << h << ENDL << ", prev_id=" << bei.bl.prev_id << ", m_invalid_blocks count=" << m_invalid_blocks.size());
+  if(m_invalid_blocks.size() > INVALID_BLOCKS_MAX_COUNT)
+    m_invalid_blocks.pop_front();
+  LOG_PRINT_L0("BLOCK ADDED AS INVALID: " << h << ENDL << ", prev_id=" << bl.prev_id << ", m_invalid_blocks count=" << m_invalid_blocks.size());
   return true;
 }
 //------------------------------------------------------------------
+void blockchain_storage::remove_alternative_block(blocks_ext_by_hash::iterator it)
+{
+  m_alternative_blocks_index.get<by_id>().erase(it->first);
+  m_alternative_chains.erase(it);
+}
+//------------------------------------------------------------------
+void blockchain_storage::rebuild_alternative_blocks_index()
+{
+  m_alternative_blocks_index.clear();
+  BOOST_FOREACH(const auto& ab, m_alternative_chains)
+  {
+    alternative_block_ref ref = {ab.first, ab.second.bl.prev_id, ab.second.height};
+    m_alternative_blocks_index.insert(ref);
+  }
+}
+//------------------------------------------------------------------
+void blockchain_storage::rebuild_block_headers()
+{
+  //ids are taken from the index, hashing every block would slow loading down
+  std::vector<crypto::hash> ids(m_blocks.size(), null_hash);
+  BOOST_FOREACH(const auto& v, m_blocks_index)
+  {
+    if(v.second < ids.size())
+      ids[v.second] = v.first;
+  }
+  m_block_headers.clear();
+  m_block_headers.reserve(m_blocks.size());
+  for(size_t height = 0; height != m_blocks.size(); ++height)
+  {
+    const block_extended_info& bei = m_blocks[height];
+    const crypto::hash& id = ids[height] == null_hash ? get_block_hash(bei.bl) : ids[height];
+    m_block_headers.push_back(id, bei.bl.timestamp, bei.block_cumulative_size, bei.cumulative_difficulty, bei.already_generated_coins);
+  }
+}
+//------------------------------------------------------------------
+void blockchain_storage::prune_alternative_chains()
+{
+  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  auto& children = m_alternative_blocks_index.get<by_prev_id>();
+  auto& heights = m_alternative_blocks_index.get<by_height>();
+
+  //drop chains with the top too deep under the main chain, from the top down: a block that
+  //still has children there belongs to a chain that goes above the limit
+  uint64_t min_top_height = m_blocks.size() > ALTERNATIVE_BLOCKS_MAX_DEPTH ? m_blocks.size() - ALTERNATIVE_BLOCKS_MAX_DEPTH : 0;
+  auto it = heights.lower_bound(min_top_height);
+  while(it != heights.begin())
+  {
+    --it;
+    if(children.count(it->id))
+      continue;
+    LOG_PRINT_L1("Alternative block " << it->id << " on height " << it->height << " is too old, dropped");
+    m_alternative_chains.erase(it->id);
+    it = heights.erase(it);
+  }
+
+  //keep the count bounded when flooded with alternative blocks: the deepest fork goes first, being
+  //the cheapest to make and the least likely to win
+  while(m_alternative_chains.size() > ALTERNATIVE_BLOCKS_MAX_COUNT)
+  {
+    LOG_PRINT_L1("Too many alternative blocks, dropped the chain from " << heights.begin()->id << " on height " << heights.begin()->height);
+    std::list<crypto::hash> chain(1, heights.begin()->id);
+    while(!chain.empty())
+    {
+      auto range = children.equal_range(chain.front());
+      for(auto it = range.first; it != range.second; ++it)
+        chain.push_back(it->id);
+      m_alternative_chains.erase(chain.front());
+      m_alternative_blocks_index.get<by_id>().erase(chain.front());
+      chain.pop_front();
+    }
+  }
+}
+//------------------------------------------------------------------
+void blockchain_storage::prune_transactions()
+{
+  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  if(!m_prune_depth || m_blocks.size() <= m_prune_depth)
+    return;
+
+  //prefixes stay: their outputs and key images are still needed to check new transactions
+  for(uint64_t height = m_pruned_height; height < m_blocks.size() - m_prune_depth; ++height)
+  {
+    BOOST_FOREACH(const crypto::hash& tx_id, m_blocks[height].bl.tx_hashes)
+    {
+      auto it = m_transactions.find(tx_id);
+      CHECK_AND_ASSERT_MES(it != m_transactions.end(), void(), "internal error, transaction " << tx_id << " of block on height " << height << " not found");
+      std::vector<std::vector<crypto::signature> >().swap(it->second.tx.signatures);
+    }
+    m_pruned_height = height + 1;
+  }
+}
+//------------------------------------------------------------------
 bool blockchain_storage::have_block(const crypto::hash& id)
 {
   CRITICAL_REGION_LOCAL(m_blockchain_lock);
@@ -1241,7 +1554,7 @@ bool blockchain_storage::have_block(const crypto::hash& id)
 
   /*if(m_orphaned_by_tx.count(id))
     return true;*/
-  if(m_invalid_blocks.count(id))
+  if(m_invalid_blocks.get<by_id>().count(id))
     return true;
 
   return false;
@@ -1322,8 +1635,7 @@ bool blockchain_storage::add_transaction_from_block(const transaction& tx, const
     bool operator()(const txin_to_key& in) const
     {
       const crypto::key_image& ki = in.k_image;
-      auto r = m_spent_keys.insert(ki);
-      if(!r.second)
+      if(!m_spent_keys.insert(ki))
       {
         //double spend detected
         LOG_PRINT_L0("tx with id: " << m_tx_id << " in block id: " << m_bl_id << " have input marked as spent with key image: " << ki << ", block declined");
@@ -1387,7 +1699,7 @@ bool blockchain_storage::check_tx_inputs(const transaction& tx, uint64_t& max_us
   bool res = check_tx_inputs(tx, &max_used_block_height);
   if(!res) return false;
   CHECK_AND_ASSERT_MES(max_used_block_height < m_blocks.size(), false,  "internal error: max used block index=" << max_used_block_height << " is not less then blockchain size = " << m_blocks.size());
-  get_block_hash(m_blocks[max_used_block_height].bl, max_used_block_id);
+  max_used_block_id = m_block_headers.id(max_used_block_height);
   return true;
 }
 //------------------------------------------------------------------
@@ -1525,12 +1837,18 @@ bool blockchain_storage::check_block_timestamp_main(const block& b)
     return false;
   }
 
-  std::vector<uint64_t> timestamps;
-  size_t offset = m_blocks.size() <= BLOCKCHAIN_TIMESTAMP_CHECK_WINDOW ? 0: m_blocks.size()- BLOCKCHAIN_TIMESTAMP_CHECK_WINDOW;
-  for(;offset!= m_blocks.size(); ++offset)
-    timestamps.push_back(m_blocks[offset].bl.timestamp);
+  update_block_windows(m_blocks.size());
+  if(m_timestamps_window.size() < BLOCKCHAIN_TIMESTAMP_CHECK_WINDOW)
+    return true;
 
-  return check_block_timestamp(std::move(timestamps), b);
+  uint64_t median_ts = m_timestamps_window.median();
+  if(b.timestamp < median_ts)
+  {
+    LOG_PRINT_L0("Timestamp of block with id: " << get_block_hash(b) << ", " << b.timestamp << ", less than median of last " << BLOCKCHAIN_TIMESTAMP_CHECK_WINDOW << " blocks, " << median_ts);
+    return false;
+  }
+
+  return true;
 }
 //------------------------------------------------------------------
 bool blockchain_storage::check_block_timestamp(std::vector<uint64_t> timestamps, const block& b)
@@ -1549,7 +1867,7 @@ bool blockchain_storage::check_block_timestamp(std::vector<uint64_t> timestamps,
   return true;
 }
 //------------------------------------------------------------------
-bool blockchain_storage::handle_block_to_main_chain(const block& bl, const crypto::hash& id, block_verification_context& bvc)
+bool blockchain_storage::handle_block_to_main_chain(const block& bl, const crypto::hash& id, block_verification_context& bvc, const block_extended_info* checked)
 {
   TIME_MEASURE_START(block_processing_time);
   CRITICAL_REGION_LOCAL(m_blockchain_lock);
@@ -1578,9 +1896,15 @@ bool blockchain_storage::handle_block_to_main_chain(const block& bl, const crypt
   TIME_MEASURE_START(longhash_calculating_time);
   crypto::hash proof_of_work = null_hash;
 
-  if(!m_checkpoints.is_in_checkpoint_zone(get_current_blockchain_height()))
+  auto prevalidated = m_prevalidated_ids.find(m_blocks.size());
+  bool is_prevalidated = prevalidated != m_prevalidated_ids.end() && prevalidated->second == id;
+  bool in_checkpoint_zone = is_prevalidated || m_checkpoints.is_in_checkpoint_zone(get_current_blockchain_height());
+  if(!in_checkpoint_zone || m_verify_checkpoint_zone)
   {
-    proof_of_work = get_block_longhash(bl, m_blocks.size());
+    if(checked && checked->proof_of_work != null_hash)
+      proof_of_work = checked->proof_of_work;
+    else
+      proof_of_work = get_block_longhash(bl, m_blocks.size());
 
     if(!check_hash(proof_of_work, current_diffic))
     {
@@ -1599,15 +1923,16 @@ bool blockchain_storage::handle_block_to_main_chain(const block& bl, const crypt
     // 1. Match known hashes for block heights in checkpoints_create.h
     // 2. Skip PoW verification to optimize syncing (only on the main chain; alternate blocks still checked)
     // 3. Skip signature verification to optmiize syncing
+    // Blocks with ids checked by prevalidate_block_ids() are in the zone too
 
     m_is_in_checkpoint_zone=true;
+  }
 
-    if(!m_checkpoints.check_block(get_current_blockchain_height(), id))
-    {
-      LOG_ERROR("CHECKPOINT VALIDATION FAILED");
-      bvc.m_verifivation_failed = true;
-      return false;
-    }
+  if(in_checkpoint_zone && !m_checkpoints.check_block(get_current_blockchain_height(), id))
+  {
+    LOG_ERROR("CHECKPOINT VALIDATION FAILED");
+    bvc.m_verifivation_failed = true;
+    return false;
   }
 
   TIME_MEASURE_FINISH(longhash_calculating_time);
@@ -1643,7 +1968,10 @@ bool blockchain_storage::handle_block_to_main_chain(const block& bl, const crypt
       bvc.m_verifivation_failed = true;
       return false;
     }
-    if(!check_tx_inputs(tx))
+    // a block always connects to the same ancestors, so ring signatures checked once stay valid,
+    // only the key images have to be checked against the current chain
+    bool inputs_ok = checked && checked->inputs_checked ? !have_tx_keyimges_as_spent(tx) : check_tx_inputs(tx);
+    if(!inputs_ok)
     {
       LOG_PRINT_L0("Block with id: " << id  << "have at least one transaction (id: " << tx_id << ") with wrong inputs.");
       cryptonote::tx_verification_context tvc = AUTO_VAL_INIT(tvc);
@@ -1671,7 +1999,7 @@ bool blockchain_storage::handle_block_to_main_chain(const block& bl, const crypt
     ++tx_processed_count;
   }
   uint64_t base_reward = 0;
-  uint64_t already_generated_coins = m_blocks.size() ? m_blocks.back().already_generated_coins:0;
+  uint64_t already_generated_coins = m_blocks.size() ? m_block_headers.already_generated_coins(m_blocks.size() - 1):0;
   if(!validate_miner_transaction(bl, cumulative_block_size, fee_summary, base_reward, already_generated_coins, get_current_blockchain_height()))
   {
     LOG_PRINT_L0("Block with id: " << id
@@ -1687,8 +2015,10 @@ bool blockchain_storage::handle_block_to_main_chain(const block& bl, const crypt
   bei.block_cumulative_size = cumulative_block_size;
   bei.cumulative_difficulty = current_diffic;
   bei.already_generated_coins = already_generated_coins + base_reward;
+  bei.proof_of_work = proof_of_work == null_hash && checked ? checked->proof_of_work : proof_of_work;
+  bei.inputs_checked = !m_is_in_checkpoint_zone || (checked && checked->inputs_checked);
   if(m_blocks.size())
-    bei.cumulative_difficulty += m_blocks.back().cumulative_difficulty;
+    bei.cumulative_difficulty += m_block_headers.cumulative_difficulty(m_blocks.size() - 1);
 
   bei.height = m_blocks.size();
 
@@ -1702,6 +2032,10 @@ bool blockchain_storage::handle_block_to_main_chain(const block& bl, const crypt
   }
 
   m_blocks.push_back(bei);
+  m_block_headers.push_back(id, bl.timestamp, bei.block_cumulative_size, bei.cumulative_difficulty, bei.already_generated_coins);
+  ++m_tip_version;
+  m_prevalidated_ids.erase(bei.height);
+  update_block_windows(m_blocks.size());
   update_next_comulative_size_limit();
   TIME_MEASURE_FINISH(block_processing_time);
   LOG_PRINT_L1("+++++ BLOCK SUCCESSFULLY ADDED" << ENDL << "id:\t" << id
@@ -1722,10 +2056,8 @@ bool blockchain_storage::handle_block_to_main_chain(const block& bl, const crypt
 //------------------------------------------------------------------
 bool blockchain_storage::update_next_comulative_size_limit()
 {
-  std::vector<size_t> sz;
-  get_last_n_blocks_sizes(sz, CRYPTONOTE_REWARD_BLOCKS_WINDOW);
-
-  uint64_t median = epee::misc_utils::median(sz);
+  update_block_windows(m_blocks.size());
+  uint64_t median = m_sizes_window.median();
   if(median <= CRYPTONOTE_BLOCK_GRANTED_FULL_REWARD_ZONE)
     median = CRYPTONOTE_BLOCK_GRANTED_FULL_REWARD_ZONE;
 
@@ -1752,11 +2084,17 @@ bool blockchain_storage::add_new_block(const block& bl_, block_verification_cont
   {
     //chain switching or wrong block
     bvc.m_added_to_main_chain = false;
-    return handle_alternative_block(bl, id, bvc);
+    bool r = handle_alternative_block(bl, id, bvc);
+    prune_alternative_chains();
+    prune_transactions();
+    return r;
     //never relay alternative blocks
   }
 
-  return handle_block_to_main_chain(bl, id, bvc);
+  bool r = handle_block_to_main_chain(bl, id, bvc);
+  prune_alternative_chains();
+  prune_transactions();
+  return r;
 }
   void blockchain_storage::lock() const
   {
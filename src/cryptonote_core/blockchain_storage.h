@@ -35,8 +35,12 @@
 #include <boost/multi_index_container.hpp>
 #include <boost/multi_index/global_fun.hpp>
 #include <boost/multi_index/hashed_index.hpp>
+#include <boost/multi_index/identity.hpp>
 #include <boost/multi_index/member.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+#include <boost/multi_index/sequenced_index.hpp>
 #include <boost/foreach.hpp>
+#include <boost/thread/thread.hpp>
 #include <atomic>
 #include <cstddef>
 
@@ -45,6 +49,8 @@
 #include "tx_pool.h"
 #include "cryptonote_basic.h"
 #include "common/util.h"
+#include "common/order_statistics_window.h"
+#include "common/flat_hash_map.h"
 #include "cryptonote_protocol/cryptonote_protocol_defs.h"
 #include "rpc/core_rpc_server_commands_defs.h"
 #include "difficulty.h"
@@ -52,6 +58,8 @@
 #include "verification_context.h"
 #include "crypto/hash.h"
 #include "checkpoints.h"
+#include "key_images_set.h"
+#include "block_headers_table.h"
 
 namespace cryptonote
 {
@@ -76,9 +84,21 @@ namespace cryptonote
       size_t block_cumulative_size;
       difficulty_type cumulative_difficulty;
       uint64_t already_generated_coins;
+      // not stored, kept to make reorganizations cheap: the proof of work if it was computed
+      // (null_hash otherwise) and whether the ring signatures of the block transactions were checked
+      crypto::hash proof_of_work;
+      bool inputs_checked;
     };
 
-    blockchain_storage(tx_memory_pool& tx_pool):m_tx_pool(tx_pool), m_current_block_cumul_sz_limit(0), m_is_in_checkpoint_zone(false), m_is_blockchain_storing(false)
+    // how init() checks the stored blockchain against its hashes and the checkpoints
+    enum startup_check
+    {
+      startup_check_full,       // on all cores before init() returns
+      startup_check_background, // on a background thread once init() returned
+      startup_check_none        // trust the local store
+    };
+
+    blockchain_storage(tx_memory_pool& tx_pool):m_tx_pool(tx_pool), m_current_block_cumul_sz_limit(0), m_is_in_checkpoint_zone(false), m_is_blockchain_storing(false), m_tip_version(0), m_next_difficulty(0), m_next_difficulty_tip_version(0), m_startup_check(startup_check_full), m_stop_check(false), m_prune_depth(0), m_pruned_height(0), m_verify_checkpoint_zone(false)
     {};
 
     bool init() { return init(tools::get_default_data_dir()); }
@@ -86,10 +106,17 @@ namespace cryptonote
     bool deinit();
 
     void set_checkpoints(checkpoints&& chk_pts) { m_checkpoints = chk_pts; }
+    void set_startup_check(startup_check check) { m_startup_check = check; }
+    //check proof of work and signatures of blocks in the checkpoint zone too, they still have to match the checkpoints
+    void set_verify_checkpoint_zone(bool verify) { m_verify_checkpoint_zone = verify; }
+    //drop the signatures of transactions in blocks deeper than depth under the top, 0 keeps them
+    void set_prune_depth(uint64_t depth) { m_prune_depth = depth; }
+    //transactions of blocks below it have no signatures, 0 if the blockchain is not pruned
+    uint64_t get_pruned_height() const { return m_pruned_height; }
 
     //bool push_new_block();
-    bool get_blocks(uint64_t start_offset, size_t count, std::list<block>& blocks, std::list<transaction>& txs);
-    bool get_blocks(uint64_t start_offset, size_t count, std::list<block>& blocks);
+    bool get_blocks(uint64_t start_offset, size_t count, std::vector<block>& blocks, std::vector<transaction>& txs);
+    bool get_blocks(uint64_t start_offset, size_t count, std::vector<block>& blocks);
     bool get_alternative_blocks(std::list<block>& blocks);
     size_t get_alternative_blocks_count();
     crypto::hash get_block_id_by_height(uint64_t height);
@@ -111,6 +138,8 @@ namespace cryptonote
     uint64_t get_current_blockchain_height();
     crypto::hash get_tail_id();
     crypto::hash get_tail_id(uint64_t& height);
+    //changes every time a block is added to or popped from the main chain, readable without the blockchain lock
+    uint64_t get_tip_version() const { return m_tip_version; }
     difficulty_type get_difficulty_for_next_block();
     bool add_new_block(const block& bl_, block_verification_context& bvc);
     bool reset_and_set_genesis_block(const block& b);
@@ -119,9 +148,12 @@ namespace cryptonote
     size_t get_total_transactions();
     bool get_outs(uint64_t amount, std::list<crypto::public_key>& pkeys);
     bool get_short_chain_history(std::list<crypto::hash>& ids);
+    //checks groups of ids from a chain entry against checkpoint hashes, blocks of matching groups skip proof of work and signature checks
+    bool prevalidate_block_ids(uint64_t start_height, const std::list<crypto::hash>& ids);
     bool find_blockchain_supplement(const std::list<crypto::hash>& qblock_ids, NOTIFY_RESPONSE_CHAIN_ENTRY::request& resp);
     bool find_blockchain_supplement(const std::list<crypto::hash>& qblock_ids, uint64_t& starter_offset);
-    bool find_blockchain_supplement(const uint64_t req_start_block, const std::list<crypto::hash>& qblock_ids, std::list<std::pair<block, std::list<transaction> > >& blocks, uint64_t& total_height, uint64_t& start_height, size_t max_count);
+    bool find_blockchain_supplement(const uint64_t req_start_block, const std::list<crypto::hash>& qblock_ids, std::vector<std::pair<block, std::vector<transaction> > >& blocks, uint64_t& total_height, uint64_t& start_height, size_t max_count);
+    bool find_blockchain_supplement(const uint64_t req_start_block, const std::list<crypto::hash>& qblock_ids, std::vector<block_complete_entry>& blocks, uint64_t& total_height, uint64_t& start_height, size_t max_count);
     bool handle_get_objects(NOTIFY_REQUEST_GET_OBJECTS::request& arg, NOTIFY_RESPONSE_GET_OBJECTS::request& rsp);
     bool get_random_outs_for_amounts(const COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::request& req, COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::response& res);
     bool get_backward_blocks_sizes(size_t from_height, std::vector<size_t>& sz, size_t count);
@@ -173,40 +205,99 @@ namespace cryptonote
           else
             txs.push_back(tx);
         }
+        else if(it->second.m_keeper_block_height < m_pruned_height)
+          missed_txs.push_back(tx_id); //pruned, can't be handed out without its signatures
         else
           txs.push_back(it->second.tx);
       }
       return true;
     }
+
+    //same as get_transactions(), but hands out serialized transactions without copying the stored ones
+    template<class t_ids_container, class t_blobs_container, class t_missed_container>
+    bool get_transactions_blobs(const t_ids_container& txs_ids, t_blobs_container& txs, t_missed_container& missed_txs)
+    {
+      CRITICAL_REGION_LOCAL(m_blockchain_lock);
+
+      BOOST_FOREACH(const auto& tx_id, txs_ids)
+      {
+        auto it = m_transactions.find(tx_id);
+        if(it == m_transactions.end())
+        {
+          transaction tx;
+          if(!m_tx_pool.get_transaction(tx_id, tx))
+            missed_txs.push_back(tx_id);
+          else
+            txs.push_back(t_serializable_object_to_blob(tx));
+        }
+        else if(it->second.m_keeper_block_height < m_pruned_height)
+          missed_txs.push_back(tx_id);
+        else
+          txs.push_back(t_serializable_object_to_blob(it->second.tx));
+      }
+      return true;
+    }
     //debug functions
     void print_blockchain(uint64_t start_index, uint64_t end_index);
     void print_blockchain_index();
     void print_blockchain_outs(const std::string& file);
 
   private:
-    typedef std::unordered_map<crypto::hash, size_t> blocks_by_id_index;
-    typedef std::unordered_map<crypto::hash, transaction_chain_entry> transactions_container;
-    typedef std::unordered_set<crypto::key_image> key_images_container;
+    typedef tools::flat_hash_map<crypto::hash, size_t> blocks_by_id_index;
+    typedef tools::flat_hash_map<crypto::hash, transaction_chain_entry> transactions_container;
+    typedef key_images_set key_images_container;
     typedef std::vector<block_extended_info> blocks_container;
     typedef std::unordered_map<crypto::hash, block_extended_info> blocks_ext_by_hash;
     typedef std::map<uint64_t, std::vector<std::pair<crypto::hash, size_t>>> outputs_container; //crypto::hash - tx hash, size_t - index of out in transaction
 
+    struct by_id{};
+    struct by_prev_id{};
+    struct by_height{};
+
+    struct alternative_block_ref
+    {
+      crypto::hash id;
+      crypto::hash prev_id;
+      uint64_t height;
+    };
+
+    typedef boost::multi_index_container<
+      alternative_block_ref,
+      boost::multi_index::indexed_by<
+      boost::multi_index::hashed_unique<boost::multi_index::tag<by_id>, boost::multi_index::member<alternative_block_ref,crypto::hash,&alternative_block_ref::id>, std::hash<crypto::hash> >,
+      // children of a block
+      boost::multi_index::hashed_non_unique<boost::multi_index::tag<by_prev_id>, boost::multi_index::member<alternative_block_ref,crypto::hash,&alternative_block_ref::prev_id>, std::hash<crypto::hash> >,
+      boost::multi_index::ordered_non_unique<boost::multi_index::tag<by_height>, boost::multi_index::member<alternative_block_ref,uint64_t,&alternative_block_ref::height> >
+      >
+    > alternative_blocks_index;
+
+    // ids in the order they were added, the oldest are dropped first
+    typedef boost::multi_index_container<
+      crypto::hash,
+      boost::multi_index::indexed_by<
+      boost::multi_index::sequenced<>,
+      boost::multi_index::hashed_unique<boost::multi_index::tag<by_id>, boost::multi_index::identity<crypto::hash>, std::hash<crypto::hash> >
+      >
+    > invalid_blocks_container;
+
     tx_memory_pool& m_tx_pool;
     mutable epee::critical_section m_blockchain_lock; // TODO: add here reader/writer lock
 
     // main chain
     blocks_container m_blocks;               // height  -> block_extended_info
+    block_headers_table m_block_headers;     // height  -> header fields of m_blocks, not stored
     blocks_by_id_index m_blocks_index;       // crypto::hash -> height
     transactions_container m_transactions;
-    key_images_container m_spent_keys;
+    key_images_container m_spent_keys;       // read without the blockchain lock
     size_t m_current_block_cumul_sz_limit;
 
 
     // all alternative chains
     blocks_ext_by_hash m_alternative_chains; // crypto::hash -> block_extended_info
+    alternative_blocks_index m_alternative_blocks_index; // not stored, rebuilt from m_alternative_chains
 
-    // some invalid blocks
-    blocks_ext_by_hash m_invalid_blocks;     // crypto::hash -> block_extended_info
+    // ids of the latest invalid blocks
+    invalid_blocks_container m_invalid_blocks;
     outputs_container m_outputs;
 
 
@@ -214,6 +305,26 @@ namespace cryptonote
     checkpoints m_checkpoints;
     std::atomic<bool> m_is_in_checkpoint_zone;
     std::atomic<bool> m_is_blockchain_storing;
+    std::atomic<uint64_t> m_tip_version;
+
+    // sorted values of the latest main chain blocks, follow m_blocks as it grows and shrinks
+    tools::order_statistics_window<uint64_t> m_difficulty_timestamps;
+    tools::order_statistics_window<size_t> m_sizes_window;
+    tools::order_statistics_window<uint64_t> m_timestamps_window;
+    difficulty_type m_next_difficulty;
+    uint64_t m_next_difficulty_tip_version;
+
+    // ids above the main chain that passed the checkpoint hashes check, height -> id
+    std::unordered_map<uint64_t, crypto::hash> m_prevalidated_ids;
+
+    startup_check m_startup_check;
+    boost::thread m_check_thread;
+    std::atomic<bool> m_stop_check;
+
+    uint64_t m_prune_depth;
+    std::atomic<uint64_t> m_pruned_height;
+
+    bool m_verify_checkpoint_zone;
 
     bool switch_to_alternative_blockchain(std::list<blocks_ext_by_hash::iterator>& alt_chain, bool discard_disconnected_chain);
     bool pop_block_from_blockchain();
@@ -222,27 +333,34 @@ namespace cryptonote
     bool purge_transaction_keyimages_from_blockchain(const transaction& tx, bool strict_check);
 
     bool handle_block_to_main_chain(const block& bl, block_verification_context& bvc);
-    bool handle_block_to_main_chain(const block& bl, const crypto::hash& id, block_verification_context& bvc);
-    bool handle_alternative_block(const block& b, const crypto::hash& id, block_verification_context& bvc);
+    bool handle_block_to_main_chain(const block& bl, const crypto::hash& id, block_verification_context& bvc, const block_extended_info* checked = NULL);
+    bool handle_alternative_block(const block& b, const crypto::hash& id, block_verification_context& bvc, const block_extended_info* checked = NULL);
     difficulty_type get_next_difficulty_for_alternative_chain(const std::list<blocks_ext_by_hash::iterator>& alt_chain, block_extended_info& bei);
     bool prevalidate_miner_transaction(const block& b, uint64_t height);
     bool validate_miner_transaction(const block& b, size_t cumulative_block_size, uint64_t fee, uint64_t& base_reward, uint64_t already_generated_coins, size_t height);
     bool validate_transaction(const block& b, uint64_t height, const transaction& tx);
-    bool rollback_blockchain_switching(std::list<block>& original_chain, size_t rollback_height);
+    bool rollback_blockchain_switching(std::list<block_extended_info>& original_chain, size_t rollback_height);
     bool add_transaction_from_block(const transaction& tx, const crypto::hash& tx_id, const crypto::hash& bl_id, uint64_t bl_height);
     bool push_transaction_to_global_outs_index(const transaction& tx, const crypto::hash& tx_id, std::vector<uint64_t>& global_indexes);
     bool pop_transaction_from_global_index(const transaction& tx, const crypto::hash& tx_id);
-    bool get_last_n_blocks_sizes(std::vector<size_t>& sz, size_t count);
     bool add_out_to_get_random_outs(std::vector<std::pair<crypto::hash, size_t> >& amount_outs, COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount& result_outs, uint64_t amount, size_t i);
     bool is_tx_spendtime_unlocked(uint64_t unlock_time);
     bool add_block_as_invalid(const block& bl, const crypto::hash& h);
-    bool add_block_as_invalid(const block_extended_info& bei, const crypto::hash& h);
+    void remove_alternative_block(blocks_ext_by_hash::iterator it);
+    void rebuild_alternative_blocks_index();
+    void rebuild_block_headers();
+    void prune_alternative_chains();
+    void prune_transactions();
     size_t find_end_of_allowed_index(const std::vector<std::pair<crypto::hash, size_t> >& amount_outs);
     bool check_block_timestamp_main(const block& b);
     bool check_block_timestamp(std::vector<uint64_t> timestamps, const block& b);
     uint64_t get_adjusted_time();
     bool complete_timestamps_vector(uint64_t start_height, std::vector<uint64_t>& timestamps);
     bool update_next_comulative_size_limit();
+    void update_block_windows(size_t height);
+    bool check_stored_blocks(uint64_t start_height, uint64_t end_height, size_t& txs_count);
+    bool check_stored_blockchain();
+    void check_stored_blockchain_in_background(uint64_t end_height);
   };
 
 
@@ -250,7 +368,7 @@ namespace cryptonote
   /*                                                                      */
   /************************************************************************/
 
-  #define CURRENT_BLOCKCHAIN_STORAGE_ARCHIVE_VER    12
+  #define CURRENT_BLOCKCHAIN_STORAGE_ARCHIVE_VER    14
 
   template<class archive_t>
   void blockchain_storage::serialize(archive_t & ar, const unsigned int version)
@@ -270,8 +388,30 @@ namespace cryptonote
     ar & m_spent_keys;
     ar & m_alternative_chains;
     ar & m_outputs;
-    ar & m_invalid_blocks;
+    if(version < 13)
+    {
+      //invalid blocks were stored whole
+      blocks_ext_by_hash invalid_blocks;
+      ar & invalid_blocks;
+      m_invalid_blocks.clear();
+      BOOST_FOREACH(const auto& ib, invalid_blocks)
+        m_invalid_blocks.push_back(ib.first);
+    }else
+    {
+      ar & m_invalid_blocks;
+    }
     ar & m_current_block_cumul_sz_limit;
+    if(version > 13)
+    {
+      uint64_t pruned_height = m_pruned_height;
+      ar & pruned_height;
+      m_pruned_height = pruned_height;
+    }
+    if(archive_t::is_loading::value)
+    {
+      rebuild_alternative_blocks_index();
+      rebuild_block_headers();
+    }
     /*serialization bug workaround*/
     if(version > 11)
     {
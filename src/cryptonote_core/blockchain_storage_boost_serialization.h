@@ -30,6 +30,7 @@
 
 #pragma once 
 #include <cstddef>
+#include <boost/serialization/split_free.hpp>
 
 namespace boost
 {
@@ -55,6 +56,41 @@ namespace boost
       ar & ei.cumulative_difficulty;
       ar & ei.block_cumulative_size;
       ar & ei.already_generated_coins;
+      if (archive_t::is_loading::value)
+      {
+        ei.proof_of_work = cryptonote::null_hash;
+        ei.inputs_checked = false;
+      }
+    }
+
+    //stored as std::unordered_set<crypto::key_image> was
+    template<class archive_t>
+    void save(archive_t & ar, const cryptonote::key_images_set& s, const unsigned int version)
+    {
+      size_t count = s.size();
+      ar << count;
+      s.for_each([&](const crypto::key_image& ki) { ar << ki; });
+    }
+
+    template<class archive_t>
+    void load(archive_t & ar, cryptonote::key_images_set& s, const unsigned int version)
+    {
+      s.clear();
+      size_t count = 0;
+      ar >> count;
+      s.reserve(count);
+      for(size_t i = 0; i != count; ++i)
+      {
+        crypto::key_image ki;
+        ar >> ki;
+        s.insert(ki);
+      }
+    }
+
+    template<class archive_t>
+    void serialize(archive_t & ar, cryptonote::key_images_set& s, const unsigned int version)
+    {
+      split_free(ar, s, version);
     }
 
   }
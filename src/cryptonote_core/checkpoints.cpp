@@ -32,6 +32,9 @@
 using namespace epee;
 
 #include "checkpoints.h"
+#include "file_io_utils.h"
+#include "common/int-util.h"
+#include "crypto/hash.h"
 
 namespace cryptonote
 {
@@ -84,6 +87,11 @@ namespace cryptonote
     if (0 == block_height)
       return false;
 
+    // The last block of the hashed groups is as final as a checkpoint
+    uint64_t hashes_height = get_hashes_height();
+    if (hashes_height && hashes_height - 1 <= blockchain_height && block_height < hashes_height)
+      return false;
+
     auto it = m_points.upper_bound(blockchain_height);
     // Is blockchain_height before the first checkpoint?
     if (it == m_points.begin())
@@ -93,4 +101,67 @@ namespace cryptonote
     uint64_t checkpoint_height = it->first;
     return checkpoint_height < block_height;
   }
+  //---------------------------------------------------------------------------
+  bool checkpoints::load_hashes_from_file(const std::string& path)
+  {
+    std::string blob;
+    if(!epee::file_io_utils::load_file_to_string(path, blob))
+    {
+      LOG_ERROR("Failed to read checkpoint hashes from " << path);
+      return false;
+    }
+    std::vector<crypto::hash> group_hashes;
+    CHECK_AND_ASSERT_MES(parse_checkpoint_hashes_blob(blob, group_hashes), false, "Wrong checkpoint hashes file " << path);
+    m_group_hashes = std::move(group_hashes);
+    LOG_PRINT_L0("Loaded " << m_group_hashes.size() << " checkpoint hashes, up to height " << get_hashes_height());
+    return true;
+  }
+  //---------------------------------------------------------------------------
+  bool checkpoints::check_group(uint64_t group_start_height, const crypto::hash* ids) const
+  {
+    CHECK_AND_ASSERT_MES(group_start_height % CHECKPOINT_HASHES_GROUP_SIZE == 0, false, "Internal error: wrong group start height " << group_start_height);
+    uint64_t group = group_start_height / CHECKPOINT_HASHES_GROUP_SIZE;
+    if(group >= m_group_hashes.size())
+      return true;
+
+    crypto::hash h = get_block_ids_group_hash(ids, CHECKPOINT_HASHES_GROUP_SIZE);
+    if(h != m_group_hashes[group])
+    {
+      LOG_ERROR("CHECKPOINT HASH FAILED FOR BLOCKS " << group_start_height << "-" << group_start_height + CHECKPOINT_HASHES_GROUP_SIZE - 1
+        << ". EXPECTED HASH: " << m_group_hashes[group] << ", FETCHED HASH: " << h);
+      return false;
+    }
+    return true;
+  }
+  //---------------------------------------------------------------------------
+  crypto::hash get_block_ids_group_hash(const crypto::hash* ids, size_t count)
+  {
+    return crypto::cn_fast_hash(ids, count * sizeof(crypto::hash));
+  }
+  //---------------------------------------------------------------------------
+  std::string make_checkpoint_hashes_blob(const std::vector<crypto::hash>& group_hashes)
+  {
+    uint32_t header[2] = {swap32le(static_cast<uint32_t>(CHECKPOINT_HASHES_GROUP_SIZE)), swap32le(static_cast<uint32_t>(group_hashes.size()))};
+    std::string blob(reinterpret_cast<const char*>(header), sizeof(header));
+    if(!group_hashes.empty())
+      blob.append(reinterpret_cast<const char*>(group_hashes.data()), group_hashes.size() * sizeof(crypto::hash));
+    return blob;
+  }
+  //---------------------------------------------------------------------------
+  bool parse_checkpoint_hashes_blob(const std::string& blob, std::vector<crypto::hash>& group_hashes)
+  {
+    uint32_t header[2];
+    CHECK_AND_ASSERT_MES(blob.size() >= sizeof(header), false, "checkpoint hashes blob is too short: " << blob.size());
+    memcpy(header, blob.data(), sizeof(header));
+    uint32_t group_size = swap32le(header[0]);
+    uint32_t count = swap32le(header[1]);
+    CHECK_AND_ASSERT_MES(group_size == CHECKPOINT_HASHES_GROUP_SIZE, false, "checkpoint hashes are made for groups of " << group_size
+      << " blocks, expected " << CHECKPOINT_HASHES_GROUP_SIZE);
+    CHECK_AND_ASSERT_MES(blob.size() == sizeof(header) + static_cast<uint64_t>(count) * sizeof(crypto::hash), false,
+      "checkpoint hashes blob size " << blob.size() << " doesn't match count " << count);
+    group_hashes.resize(count);
+    if(count)
+      memcpy(group_hashes.data(), blob.data() + sizeof(header), count * sizeof(crypto::hash));
+    return true;
+  }
 }
@@ -30,6 +30,7 @@
 
 #pragma once
 #include <map>
+#include <vector>
 #include "cryptonote_basic_impl.h"
 
 
@@ -45,7 +46,21 @@ namespace cryptonote
     bool check_block(uint64_t height, const crypto::hash& h, bool& is_a_checkpoint) const;
     bool is_alternative_block_allowed(uint64_t blockchain_height, uint64_t block_height) const;
 
+    //hashes of groups of CHECKPOINT_HASHES_GROUP_SIZE consecutive block ids, starting from the genesis block
+    bool load_hashes_from_file(const std::string& path);
+    void set_group_hashes(std::vector<crypto::hash>&& group_hashes) { m_group_hashes = std::move(group_hashes); }
+    //blocks below this height belong to groups with known hashes
+    uint64_t get_hashes_height() const { return m_group_hashes.size() * CHECKPOINT_HASHES_GROUP_SIZE; }
+    //ids are CHECKPOINT_HASHES_GROUP_SIZE ids of the blocks starting from group_start_height
+    bool check_group(uint64_t group_start_height, const crypto::hash* ids) const;
+
   private:
     std::map<uint64_t, crypto::hash> m_points;
+    std::vector<crypto::hash> m_group_hashes;
   };
+
+  crypto::hash get_block_ids_group_hash(const crypto::hash* ids, size_t count);
+  //file layout: group size and count of hashes as little endian uint32, then the hashes
+  std::string make_checkpoint_hashes_blob(const std::vector<crypto::hash>& group_hashes);
+  bool parse_checkpoint_hashes_blob(const std::string& blob, std::vector<crypto::hash>& group_hashes);
 }
@@ -47,6 +47,12 @@ DISABLE_VS_WARNINGS(4355)
 
 namespace cryptonote
 {
+  namespace
+  {
+    const command_line::arg_descriptor<std::string> arg_blockchain_check = {"blockchain-check", "Check of the stored blockchain at startup: full, background (once the node is online) or none (trust the local store)", "full"};
+    const command_line::arg_descriptor<bool>        arg_prune_blockchain = {"prune-blockchain", "Drop the signatures of old transactions, a pruned node can't serve the blocks that hold them to peers and wallets"};
+    const command_line::arg_descriptor<uint64_t>    arg_prune_depth      = {"prune-depth", "Depth under the top of the blockchain below which --prune-blockchain drops signatures", CRYPTONOTE_PRUNING_DEFAULT_DEPTH};
+  }
 
   //-----------------------------------------------------------------------------------------------
   core::core(i_cryptonote_protocol* pprotocol):
@@ -72,13 +78,37 @@ namespace cryptonote
     m_blockchain_storage.set_checkpoints(std::move(chk_pts));
   }
   //-----------------------------------------------------------------------------------
-  void core::init_options(boost::program_options::options_description& /*desc*/)
+  void core::init_options(boost::program_options::options_description& desc)
   {
+    command_line::add_arg(desc, arg_blockchain_check);
+    command_line::add_arg(desc, arg_prune_blockchain);
+    command_line::add_arg(desc, arg_prune_depth);
   }
   //-----------------------------------------------------------------------------------------------
   bool core::handle_command_line(const boost::program_options::variables_map& vm)
   {
     m_config_folder = command_line::get_arg(vm, command_line::arg_data_dir);
+
+    std::string blockchain_check = command_line::get_arg(vm, arg_blockchain_check);
+    if(blockchain_check == "full")
+      m_blockchain_storage.set_startup_check(blockchain_storage::startup_check_full);
+    else if(blockchain_check == "background")
+      m_blockchain_storage.set_startup_check(blockchain_storage::startup_check_background);
+    else if(blockchain_check == "none")
+      m_blockchain_storage.set_startup_check(blockchain_storage::startup_check_none);
+    else
+    {
+      LOG_ERROR("Wrong --" << arg_blockchain_check.name << " value: " << blockchain_check << ", expected full, background or none");
+      return false;
+    }
+
+    if(command_line::get_arg(vm, arg_prune_blockchain))
+    {
+      //blocks above it may still be switched out by a reorganization, their transactions go back to the pool
+      uint64_t prune_depth = command_line::get_arg(vm, arg_prune_depth);
+      CHECK_AND_ASSERT_MES(prune_depth >= ALTERNATIVE_BLOCKS_MAX_DEPTH, false, "--" << arg_prune_depth.name << " must be at least " << ALTERNATIVE_BLOCKS_MAX_DEPTH);
+      m_blockchain_storage.set_prune_depth(prune_depth);
+    }
     return true;
   }
   //-----------------------------------------------------------------------------------------------
@@ -93,12 +123,17 @@ namespace cryptonote
     return true;
   }
   //-----------------------------------------------------------------------------------------------
-  bool core::get_blocks(uint64_t start_offset, size_t count, std::list<block>& blocks, std::list<transaction>& txs)
+  uint64_t core::get_pruned_height()
+  {
+    return m_blockchain_storage.get_pruned_height();
+  }
+  //-----------------------------------------------------------------------------------------------
+  bool core::get_blocks(uint64_t start_offset, size_t count, std::vector<block>& blocks, std::vector<transaction>& txs)
   {
     return m_blockchain_storage.get_blocks(start_offset, count, blocks, txs);
   }
   //-----------------------------------------------------------------------------------------------
-  bool core::get_blocks(uint64_t start_offset, size_t count, std::list<block>& blocks)
+  bool core::get_blocks(uint64_t start_offset, size_t count, std::vector<block>& blocks)
   {
     return m_blockchain_storage.get_blocks(start_offset, count, blocks);
   }  //-----------------------------------------------------------------------------------------------
@@ -120,6 +155,7 @@ namespace cryptonote
   bool core::init(const boost::program_options::variables_map& vm)
   {
     bool r = handle_command_line(vm);
+    CHECK_AND_ASSERT_MES(r, false, "Failed to handle command line");
 
     r = m_mempool.init(m_config_folder);
     CHECK_AND_ASSERT_MES(r, false, "Failed to initialize memory pool");
@@ -370,7 +406,12 @@ namespace cryptonote
     return m_blockchain_storage.find_blockchain_supplement(qblock_ids, resp);
   }
   //-----------------------------------------------------------------------------------------------
-  bool core::find_blockchain_supplement(const uint64_t req_start_block, const std::list<crypto::hash>& qblock_ids, std::list<std::pair<block, std::list<transaction> > >& blocks, uint64_t& total_height, uint64_t& start_height, size_t max_count)
+  bool core::find_blockchain_supplement(const uint64_t req_start_block, const std::list<crypto::hash>& qblock_ids, std::vector<std::pair<block, std::vector<transaction> > >& blocks, uint64_t& total_height, uint64_t& start_height, size_t max_count)
+  {
+    return m_blockchain_storage.find_blockchain_supplement(req_start_block, qblock_ids, blocks, total_height, start_height, max_count);
+  }
+  //-----------------------------------------------------------------------------------------------
+  bool core::find_blockchain_supplement(const uint64_t req_start_block, const std::list<crypto::hash>& qblock_ids, std::vector<block_complete_entry>& blocks, uint64_t& total_height, uint64_t& start_height, size_t max_count)
   {
     return m_blockchain_storage.find_blockchain_supplement(req_start_block, qblock_ids, blocks, total_height, start_height, max_count);
   }
@@ -440,6 +481,7 @@ namespace cryptonote
 
       block_to_blob(b, arg.b.block);
       //pack transactions
+      arg.b.txs.reserve(txs.size());
       BOOST_FOREACH(auto& tx,  txs)
         arg.b.txs.push_back(t_serializable_object_to_blob(tx));
 
@@ -543,6 +585,11 @@ namespace cryptonote
     return m_blockchain_storage.get_short_chain_history(ids);
   }
   //-----------------------------------------------------------------------------------------------
+  bool core::prevalidate_block_ids(uint64_t start_height, const std::list<crypto::hash>& ids)
+  {
+    return m_blockchain_storage.prevalidate_block_ids(start_height, ids);
+  }
+  //-----------------------------------------------------------------------------------------------
   bool core::handle_get_objects(NOTIFY_REQUEST_GET_OBJECTS::request& arg, NOTIFY_RESPONSE_GET_OBJECTS::request& rsp, cryptonote_connection_context& context)
   {
     return m_blockchain_storage.handle_get_objects(arg, rsp);
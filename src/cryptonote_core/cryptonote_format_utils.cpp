@@ -32,7 +32,9 @@
 using namespace epee;
 
 #include "cryptonote_format_utils.h"
+#include <atomic>
 #include <boost/foreach.hpp>
+#include <boost/thread/thread.hpp>
 #include "cryptonote_config.h"
 #include "miner.h"
 #include "crypto/crypto.h"
@@ -321,7 +323,7 @@ namespace cryptonote
     return true;
   }
   //---------------------------------------------------------------
-  bool construct_tx(const account_keys& sender_account_keys, const std::vector<tx_source_entry>& sources, const std::vector<tx_destination_entry>& destinations, std::vector<uint8_t> extra, transaction& tx, uint64_t unlock_time)
+  bool construct_tx(const account_keys& sender_account_keys, const std::vector<tx_source_entry>& sources, const std::vector<tx_destination_entry>& destinations, std::vector<uint8_t> extra, transaction& tx, uint64_t unlock_time, size_t signing_threads)
   {
     tx.vin.clear();
     tx.vout.clear();
@@ -421,26 +423,50 @@ namespace cryptonote
     crypto::hash tx_prefix_hash;
     get_transaction_prefix_hash(tx, tx_prefix_hash);
 
+    //every signature depends only on the prefix hash, so inputs are signed concurrently
+    tx.signatures.resize(sources.size());
+    std::atomic<size_t> next_input(0);
+    auto sign_inputs = [&]()
+    {
+      for (size_t i = next_input++; i < sources.size(); i = next_input++)
+      {
+        const tx_source_entry& src_entr = sources[i];
+        std::vector<const crypto::public_key*> keys_ptrs;
+        BOOST_FOREACH(const tx_source_entry::output_entry& o, src_entr.outputs)
+          keys_ptrs.push_back(&o.second);
+
+        std::vector<crypto::signature>& sigs = tx.signatures[i];
+        sigs.resize(src_entr.outputs.size());
+        crypto::generate_ring_signature(tx_prefix_hash, boost::get<txin_to_key>(tx.vin[i]).k_image, keys_ptrs, in_contexts[i].in_ephemeral.sec, src_entr.real_output, sigs.data());
+      }
+    };
+
+    if (0 == signing_threads)
+      signing_threads = boost::thread::hardware_concurrency();
+    signing_threads = std::min(signing_threads, sources.size());
+    if (1 < signing_threads)
+    {
+      boost::thread_group signers;
+      for (size_t t = 1; t < signing_threads; ++t)
+        signers.create_thread(sign_inputs);
+      sign_inputs();
+      signers.join_all();
+    }
+    else
+    {
+      sign_inputs();
+    }
+
     std::stringstream ss_ring_s;
-    size_t i = 0;
-    BOOST_FOREACH(const tx_source_entry& src_entr,  sources)
+    for (size_t i = 0; i < sources.size(); i++)
     {
+      const tx_source_entry& src_entr = sources[i];
       ss_ring_s << "pub_keys:" << ENDL;
-      std::vector<const crypto::public_key*> keys_ptrs;
       BOOST_FOREACH(const tx_source_entry::output_entry& o, src_entr.outputs)
-      {
-        keys_ptrs.push_back(&o.second);
         ss_ring_s << o.second << ENDL;
-      }
-
-      tx.signatures.push_back(std::vector<crypto::signature>());
-      std::vector<crypto::signature>& sigs = tx.signatures.back();
-      sigs.resize(src_entr.outputs.size());
-      crypto::generate_ring_signature(tx_prefix_hash, boost::get<txin_to_key>(tx.vin[i]).k_image, keys_ptrs, in_contexts[i].in_ephemeral.sec, src_entr.real_output, sigs.data());
       ss_ring_s << "signatures:" << ENDL;
-      std::for_each(sigs.begin(), sigs.end(), [&](const crypto::signature& s){ss_ring_s << s << ENDL;});
+      std::for_each(tx.signatures[i].begin(), tx.signatures[i].end(), [&](const crypto::signature& s){ss_ring_s << s << ENDL;});
       ss_ring_s << "prefix_hash:" << tx_prefix_hash << ENDL << "in_ephemeral_key: " << in_contexts[i].in_ephemeral.sec << ENDL << "real_output: " << src_entr.real_output;
-      i++;
     }
 
     LOG_PRINT2("construct_tx.log", "transaction_created: " << get_transaction_hash(tx) << ENDL << obj_to_json_str(tx) << ENDL << ss_ring_s.str() , LOG_LEVEL_3);
@@ -75,11 +75,6 @@ namespace cryptonote {
   }
 
   difficulty_type next_difficulty(vector<uint64_t> timestamps, vector<difficulty_type> cumulative_difficulties, size_t height) {
-    size_t target_seconds = DIFFICULTY_TARGET;
-
-    if (height < HARDFORK_1_HEIGHT)
-      target_seconds = HARDFORK_1_OLD_TARGET;
-
     //cutoff DIFFICULTY_LAG
     if(timestamps.size() > DIFFICULTY_WINDOW)
     {
@@ -90,13 +85,28 @@ namespace cryptonote {
 
     size_t length = timestamps.size();
     assert(length == cumulative_difficulties.size());
-    if (length <= 1) {
+    size_t cut_begin, cut_end;
+    if (!get_difficulty_cut(length, cut_begin, cut_end)) {
       return 1;
     }
+    sort(timestamps.begin(), timestamps.end());
+    uint64_t time_span = timestamps[cut_end - 1] - timestamps[cut_begin];
+    difficulty_type total_work = cumulative_difficulties[cut_end - 1] - cumulative_difficulties[cut_begin];
+    return next_difficulty(time_span, total_work, height);
+  }
+
+  void get_difficulty_window(size_t height, size_t& begin, size_t& end) {
+    //last DIFFICULTY_BLOCKS_COUNT blocks without genesis, the newest DIFFICULTY_LAG of them are cut off
+    begin = height > (DIFFICULTY_BLOCKS_COUNT) ? height - (DIFFICULTY_BLOCKS_COUNT) : 1;
+    end = std::max(begin, std::min(begin + DIFFICULTY_WINDOW, height));
+  }
+
+  bool get_difficulty_cut(size_t length, size_t& cut_begin, size_t& cut_end) {
+    if (length <= 1) {
+      return false;
+    }
     static_assert(DIFFICULTY_WINDOW >= 2, "Window is too small");
     assert(length <= DIFFICULTY_WINDOW);
-    sort(timestamps.begin(), timestamps.end());
-    size_t cut_begin, cut_end;
     static_assert(2 * DIFFICULTY_CUT <= DIFFICULTY_WINDOW - 2, "Cut length is too large");
     if (length <= DIFFICULTY_WINDOW - 2 * DIFFICULTY_CUT) {
       cut_begin = 0;
@@ -106,11 +116,18 @@ namespace cryptonote {
       cut_end = cut_begin + (DIFFICULTY_WINDOW - 2 * DIFFICULTY_CUT);
     }
     assert(/*cut_begin >= 0 &&*/ cut_begin + 2 <= cut_end && cut_end <= length);
-    uint64_t time_span = timestamps[cut_end - 1] - timestamps[cut_begin];
+    return true;
+  }
+
+  difficulty_type next_difficulty(uint64_t time_span, difficulty_type total_work, size_t height) {
+    size_t target_seconds = DIFFICULTY_TARGET;
+
+    if (height < HARDFORK_1_HEIGHT)
+      target_seconds = HARDFORK_1_OLD_TARGET;
+
     if (time_span == 0) {
       time_span = 1;
     }
-    difficulty_type total_work = cumulative_difficulties[cut_end - 1] - cumulative_difficulties[cut_begin];
     assert(total_work > 0);
     uint64_t low, high;
     mul(total_work, target_seconds, low, high);
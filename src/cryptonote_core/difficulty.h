@@ -42,4 +42,12 @@ namespace cryptonote
     bool check_hash(const crypto::hash &hash, difficulty_type difficulty);
     //    difficulty_type next_difficulty(std::vector<std::uint64_t> timestamps, std::vector<difficulty_type> cumulative_difficulties);
     difficulty_type next_difficulty(std::vector<std::uint64_t> timestamps, std::vector<difficulty_type> cumulative_difficulties, size_t height);
+
+    //blocks [begin, end) of the chain the difficulty of the block at the given height is computed from
+    void get_difficulty_window(size_t height, size_t& begin, size_t& end);
+    //sorted timestamps [cut_begin, cut_end) of a window of the given length are used, false if there are not enough blocks
+    bool get_difficulty_cut(size_t length, size_t& cut_begin, size_t& cut_end);
+    //time_span is between the timestamps at cut_begin and cut_end - 1 ranks, total_work between cumulative
+    //difficulties of the blocks at cut_begin and cut_end - 1 positions of the window
+    difficulty_type next_difficulty(std::uint64_t time_span, difficulty_type total_work, size_t height);
 }
@@ -0,0 +1,235 @@
+// Copyright (c) 2014, AEON, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this file are originally copyright (c) 2012-2013 The Cryptonote developers
+
+
+#include <algorithm>
+#include <cstring>
+#include <boost/thread/thread.hpp>
+
+#include "key_images_set.h"
+#include "common/int-util.h"
+
+namespace cryptonote
+{
+  namespace
+  {
+    const size_t min_capacity = 16;
+
+    //tables are rebuilt 8/15 full and grow by half once 4/5 full, long probe sequences start after that
+    size_t capacity_for(size_t count)
+    {
+      return std::max(min_capacity, count * 15 / 8 + 1);
+    }
+
+    bool is_overloaded(size_t used, size_t capacity)
+    {
+      return used * 5 > capacity * 4;
+    }
+  }
+  //---------------------------------------------------------------------------
+  key_images_set::table::table(size_t capacity_): capacity(capacity_), slots(new slot[capacity_])
+  {
+    for(size_t i = 0; i != capacity; ++i)
+      slots[i].head.store(empty_head, std::memory_order_relaxed);
+  }
+  //---------------------------------------------------------------------------
+  key_images_set::key_images_set(): m_table(new table(min_capacity)), m_size(0), m_used(0), m_epoch(0)
+  {
+    m_readers[0] = 0;
+    m_readers[1] = 0;
+  }
+  //---------------------------------------------------------------------------
+  key_images_set::~key_images_set()
+  {
+    delete m_table.load();
+  }
+  //---------------------------------------------------------------------------
+  uint64_t key_images_set::get_head(const crypto::key_image& ki)
+  {
+    uint64_t head;
+    memcpy(&head, &ki, sizeof(head));
+    return head;
+  }
+  //---------------------------------------------------------------------------
+  const char* key_images_set::get_tail(const crypto::key_image& ki)
+  {
+    return reinterpret_cast<const char*>(&ki) + sizeof(uint64_t);
+  }
+  //---------------------------------------------------------------------------
+  crypto::key_image key_images_set::make_key_image(uint64_t head, const char* tail)
+  {
+    crypto::key_image ki;
+    memcpy(&ki, &head, sizeof(head));
+    memcpy(reinterpret_cast<char*>(&ki) + sizeof(head), tail, tail_size);
+    return ki;
+  }
+  //---------------------------------------------------------------------------
+  bool key_images_set::find_slot(const table& t, uint64_t head, const char* tail, size_t& index)
+  {
+    //linear probing from the head scaled to the capacity, tables always have free slots
+    uint64_t i;
+    mul128(head, t.capacity, &i);
+    while(true)
+    {
+      uint64_t slot_head = t.slots[i].head.load(std::memory_order_acquire);
+      if(slot_head == empty_head)
+      {
+        index = i;
+        return false;
+      }
+      if(slot_head == head && !memcmp(t.slots[i].tail, tail, tail_size))
+      {
+        index = i;
+        return true;
+      }
+      if(++i == t.capacity)
+        i = 0;
+    }
+  }
+  //---------------------------------------------------------------------------
+  bool key_images_set::contains(const crypto::key_image& ki) const
+  {
+    uint64_t head = get_head(ki);
+    if(head <= tombstone_head)
+    {
+      CRITICAL_REGION_LOCAL(m_special_keys_lock);
+      return std::find(m_special_keys.begin(), m_special_keys.end(), ki) != m_special_keys.end();
+    }
+
+    std::atomic<size_t>& readers = m_readers[m_epoch.load() & 1];
+    ++readers;
+    size_t index;
+    bool r = find_slot(*m_table.load(), head, get_tail(ki), index);
+    --readers;
+    return r;
+  }
+  //---------------------------------------------------------------------------
+  bool key_images_set::insert(const crypto::key_image& ki)
+  {
+    uint64_t head = get_head(ki);
+    if(head <= tombstone_head)
+    {
+      CRITICAL_REGION_LOCAL(m_special_keys_lock);
+      if(std::find(m_special_keys.begin(), m_special_keys.end(), ki) != m_special_keys.end())
+        return false;
+      m_special_keys.push_back(ki);
+      ++m_size;
+      return true;
+    }
+
+    size_t index;
+    if(find_slot(*m_table.load(), head, get_tail(ki), index))
+      return false;
+    if(is_overloaded(m_used + 1, m_table.load()->capacity))
+    {
+      rehash(capacity_for(m_size + 1));
+      find_slot(*m_table.load(), head, get_tail(ki), index);
+    }
+    slot& s = m_table.load()->slots[index];
+    memcpy(s.tail, get_tail(ki), tail_size);
+    s.head.store(head, std::memory_order_release);
+    ++m_size;
+    ++m_used;
+    return true;
+  }
+  //---------------------------------------------------------------------------
+  bool key_images_set::erase(const crypto::key_image& ki)
+  {
+    uint64_t head = get_head(ki);
+    if(head <= tombstone_head)
+    {
+      CRITICAL_REGION_LOCAL(m_special_keys_lock);
+      auto it = std::find(m_special_keys.begin(), m_special_keys.end(), ki);
+      if(it == m_special_keys.end())
+        return false;
+      m_special_keys.erase(it);
+      --m_size;
+      return true;
+    }
+
+    table& t = *m_table.load();
+    size_t index;
+    if(!find_slot(t, head, get_tail(ki), index))
+      return false;
+    //the slot isn't reused before the next rehash, readers may still be comparing its tail
+    t.slots[index].head.store(tombstone_head, std::memory_order_release);
+    --m_size;
+    return true;
+  }
+  //---------------------------------------------------------------------------
+  void key_images_set::clear()
+  {
+    table* old = m_table.exchange(new table(min_capacity));
+    synchronize_readers();
+    delete old;
+    m_size = 0;
+    m_used = 0;
+    CRITICAL_REGION_LOCAL(m_special_keys_lock);
+    m_special_keys.clear();
+  }
+  //---------------------------------------------------------------------------
+  void key_images_set::reserve(size_t count)
+  {
+    if(is_overloaded(count, m_table.load()->capacity))
+      rehash(capacity_for(count));
+  }
+  //---------------------------------------------------------------------------
+  void key_images_set::rehash(size_t capacity)
+  {
+    const table* old = m_table.load();
+    std::unique_ptr<table> t(new table(capacity));
+    for(size_t i = 0; i != old->capacity; ++i)
+    {
+      uint64_t head = old->slots[i].head.load(std::memory_order_relaxed);
+      if(head <= tombstone_head)
+        continue;
+      size_t index;
+      find_slot(*t, head, old->slots[i].tail, index);
+      memcpy(t->slots[index].tail, old->slots[i].tail, tail_size);
+      t->slots[index].head.store(head, std::memory_order_relaxed);
+    }
+    m_used = m_size - m_special_keys.size();
+    m_table = t.release();
+    synchronize_readers();
+    delete old;
+  }
+  //---------------------------------------------------------------------------
+  void key_images_set::synchronize_readers()
+  {
+    //a reader that got the old table had counted itself in one of the counters already:
+    //switch the epoch and wait for the counter of the previous one, twice to cover both
+    for(size_t n = 0; n != 2; ++n)
+    {
+      std::atomic<size_t>& readers = m_readers[m_epoch++ & 1];
+      while(readers)
+        boost::this_thread::yield();
+    }
+  }
+}
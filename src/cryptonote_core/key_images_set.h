@@ -0,0 +1,121 @@
+// Copyright (c) 2014, AEON, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this file are originally copyright (c) 2012-2013 The Cryptonote developers
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include <boost/foreach.hpp>
+
+#include "syncobj.h"
+#include "crypto/crypto.h"
+
+namespace cryptonote
+{
+  /************************************************************************/
+  /* Set of key images in one open addressing table, key images are      */
+  /* random enough for their first 8 bytes to do as the hash.             */
+  /* insert(), erase(), clear() and reserve() are to be serialized by     */
+  /* the caller, contains() may run along with them and takes no lock.   */
+  /************************************************************************/
+  class key_images_set
+  {
+  public:
+    key_images_set();
+    ~key_images_set();
+    //readers may hold pointers to the table
+    key_images_set(const key_images_set&) = delete;
+    key_images_set& operator=(const key_images_set&) = delete;
+
+    bool contains(const crypto::key_image& ki) const;
+    //false if the key image is in the set already
+    bool insert(const crypto::key_image& ki);
+    //false if the key image is not in the set
+    bool erase(const crypto::key_image& ki);
+    void clear();
+    void reserve(size_t count);
+    size_t size() const { return m_size; }
+
+    //not to be run along with insert() and erase()
+    template<class t_visitor>
+    void for_each(t_visitor vis) const
+    {
+      const table& t = *m_table.load();
+      for(size_t i = 0; i != t.capacity; ++i)
+      {
+        uint64_t head = t.slots[i].head.load(std::memory_order_relaxed);
+        if(head > tombstone_head)
+          vis(make_key_image(head, t.slots[i].tail));
+      }
+      BOOST_FOREACH(const crypto::key_image& ki, m_special_keys)
+        vis(ki);
+    }
+
+  private:
+    //first 8 bytes of free slots and erased ones, key images starting with them are kept aside
+    static const uint64_t empty_head = 0;
+    static const uint64_t tombstone_head = 1;
+    static const size_t tail_size = sizeof(crypto::key_image) - sizeof(uint64_t);
+
+    struct slot
+    {
+      std::atomic<uint64_t> head; //written last, the tail is set once it is seen
+      char tail[tail_size];
+    };
+
+    struct table
+    {
+      explicit table(size_t capacity_);
+      size_t capacity;
+      std::unique_ptr<slot[]> slots;
+    };
+
+    static uint64_t get_head(const crypto::key_image& ki);
+    static const char* get_tail(const crypto::key_image& ki);
+    static crypto::key_image make_key_image(uint64_t head, const char* tail);
+    //index of the slot holding the key image, or of the free slot ending its probe sequence if it's not there
+    static bool find_slot(const table& t, uint64_t head, const char* tail, size_t& index);
+    void rehash(size_t capacity);
+    //waits for the readers that may still use a table replaced in m_table
+    void synchronize_readers();
+
+    std::atomic<table*> m_table;
+    size_t m_size;
+    size_t m_used; //m_size and erased slots
+    //readers count themselves in the counter of the epoch they started in
+    std::atomic<uint64_t> m_epoch;
+    mutable std::atomic<size_t> m_readers[2];
+
+    std::vector<crypto::key_image> m_special_keys;
+    mutable epee::critical_section m_special_keys_lock;
+  };
+}
@@ -114,33 +114,18 @@ namespace cryptonote
 
     crypto::hash max_used_block_id = null_hash;
     uint64_t max_used_block_height = 0;
-    bool ch_inp_res = m_blockchain.check_tx_inputs(tx, max_used_block_height, max_used_block_id);
+    //transactions related to a block get their inputs checked when the block goes to the main chain, so
+    //they are taken without the check and is_transaction_ready_to_go() checks them if they stay in the pool
+    bool ch_inp_res = kept_by_block || m_blockchain.check_tx_inputs(tx, max_used_block_height, max_used_block_id);
     CRITICAL_REGION_LOCAL(m_transactions_lock);
 
     CHECK_AND_ASSERT_MES(id == get_transaction_hash(tx),false,"refusing to add tx with mismatched hash to pool");
 
     if(!ch_inp_res)
     {
-      if(kept_by_block)
-      {
-        //anyway add this transaction to pool, because it related to block
-        auto txd_p = m_transactions.insert(transactions_container::value_type(id, tx_details()));
-        CHECK_AND_ASSERT_MES(txd_p.second, false, "transaction already exists at inserting in memory pool");
-        txd_p.first->second.blob_size = blob_size;
-        txd_p.first->second.tx = tx;
-        txd_p.first->second.fee = inputs_amount - outputs_amount;
-        txd_p.first->second.max_used_block_id = null_hash;
-        txd_p.first->second.max_used_block_height = 0;
-        txd_p.first->second.kept_by_block = kept_by_block;
-        txd_p.first->second.receive_time = time(nullptr);
-        tvc.m_verifivation_impossible = true;
-        tvc.m_added_to_pool = true;
-      }else
-      {
-        LOG_PRINT_L0("tx used wrong inputs, rejected");
-        tvc.m_verifivation_failed = true;
-        return false;
-      }
+      LOG_PRINT_L0("tx used wrong inputs, rejected");
+      tvc.m_verifivation_failed = true;
+      return false;
     }else
     {
       //update transactions container
@@ -253,8 +238,7 @@ namespace cryptonote
       {
         LOG_PRINT_L0("Tx " << it->first << " removed from tx pool due to outdated, age: " << tx_age );
 	remove_transaction_keyimages(it->second.tx);
-	auto pit = it++;
-        m_transactions.erase(pit);
+        it = m_transactions.erase(it);
       }else
         ++it;
     }
@@ -508,11 +492,12 @@ namespace cryptonote
 
     for (auto it = m_transactions.begin(); it != m_transactions.end(); ) {
       CHECK_AND_ASSERT_MES(it->first == get_transaction_hash(it->second.tx),false,"corrupt tx pool containing id != hash");
-      auto it2 = it++;
-      if (it2->second.blob_size >= TRANSACTION_SIZE_LIMIT) {
-        LOG_PRINT_L0("Transaction " << get_transaction_hash(it2->second.tx) << " is too big (" << it2->second.blob_size << " bytes), removing it from pool");
-        remove_transaction_keyimages(it2->second.tx);
-        m_transactions.erase(it2);
+      if (it->second.blob_size >= TRANSACTION_SIZE_LIMIT) {
+        LOG_PRINT_L0("Transaction " << get_transaction_hash(it->second.tx) << " is too big (" << it->second.blob_size << " bytes), removing it from pool");
+        remove_transaction_keyimages(it->second.tx);
+        it = m_transactions.erase(it);
+      } else {
+        ++it;
       }
     }
 
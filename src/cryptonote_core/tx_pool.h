@@ -43,6 +43,7 @@
 #include "cryptonote_basic_impl.h"
 #include "verification_context.h"
 #include "crypto/hash.h"
+#include "common/flat_hash_map.h"
 
 
 namespace cryptonote
@@ -116,7 +117,7 @@ namespace cryptonote
     static bool append_key_images(std::unordered_set<crypto::key_image>& kic, const transaction& tx);
 
     bool is_transaction_ready_to_go(tx_details& txd) const;
-    typedef std::unordered_map<crypto::hash, tx_details > transactions_container;
+    typedef tools::flat_hash_map<crypto::hash, tx_details> transactions_container;
     typedef std::unordered_map<crypto::key_image, std::unordered_set<crypto::hash> > key_images_container;
 
     mutable epee::critical_section m_transactions_lock;
@@ -31,6 +31,7 @@
 #pragma once
 
 #include <list>
+#include <vector>
 #include "serialization/keyvalue_serialization.h"
 #include "cryptonote_core/cryptonote_basic.h"
 #include "cryptonote_protocol/blobdatatype.h"
@@ -62,6 +63,10 @@ namespace cryptonote
 
     uint64_t live_time;
 
+    uint64_t recv_speed;
+    uint64_t send_speed;
+    uint64_t send_queue_size;
+
     BEGIN_KV_SERIALIZE_MAP()
       KV_SERIALIZE(incoming)
       KV_SERIALIZE(ip)
@@ -73,6 +78,9 @@ namespace cryptonote
       KV_SERIALIZE(send_idle_time)
       KV_SERIALIZE(state)
       KV_SERIALIZE(live_time)
+      KV_SERIALIZE(recv_speed)
+      KV_SERIALIZE(send_speed)
+      KV_SERIALIZE(send_queue_size)
     END_KV_SERIALIZE_MAP()
   };
 
@@ -82,7 +90,7 @@ namespace cryptonote
   struct block_complete_entry
   {
     blobdata block;
-    std::list<blobdata> txs;
+    std::vector<blobdata> txs;
     BEGIN_KV_SERIALIZE_MAP()
       KV_SERIALIZE(block)
       KV_SERIALIZE(txs)
@@ -120,7 +128,7 @@ namespace cryptonote
 
     struct request
     {
-      std::list<blobdata>   txs;
+      std::vector<blobdata> txs;
 
       BEGIN_KV_SERIALIZE_MAP()
         KV_SERIALIZE(txs)
@@ -152,8 +160,8 @@ namespace cryptonote
 
     struct request
     {
-      std::list<blobdata>              txs;
-      std::list<block_complete_entry>  blocks;
+      std::vector<blobdata>              txs;
+      std::vector<block_complete_entry>  blocks;
       std::list<crypto::hash>               missed_ids;
       uint64_t                         current_blockchain_height;
 
@@ -171,10 +179,12 @@ namespace cryptonote
   {
     uint64_t current_height;
     crypto::hash  top_id;
+    uint64_t pruned_height; //blocks below it can't be downloaded from the peer, 0 if it is not pruned
 
     BEGIN_KV_SERIALIZE_MAP()
       KV_SERIALIZE(current_height)
       KV_SERIALIZE_VAL_POD_AS_BLOB(top_id)
+      KV_SERIALIZE(pruned_height)
     END_KV_SERIALIZE_MAP()
   };
 
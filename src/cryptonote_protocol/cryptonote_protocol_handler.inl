@@ -104,6 +104,7 @@ namespace cryptonote
     ss << std::setw(25) << std::left << "Remote Host" 
       << std::setw(20) << "Peer id"
       << std::setw(25) << "Recv/Sent (inactive,sec)"
+      << std::setw(20) << "Down/Up (kB/s)"
       << std::setw(25) << "State"
       << std::setw(20) << "Livetime(seconds)" << ENDL;
 
@@ -113,6 +114,7 @@ namespace cryptonote
         epee::string_tools::get_ip_string_from_int32(cntxt.m_remote_ip) + ":" + std::to_string(cntxt.m_remote_port) 
         << std::setw(20) << std::hex << peer_id
         << std::setw(25) << std::to_string(cntxt.m_recv_cnt)+ "(" + std::to_string(time(NULL) - cntxt.m_last_recv) + ")" + "/" + std::to_string(cntxt.m_send_cnt) + "(" + std::to_string(time(NULL) - cntxt.m_last_send) + ")"
+        << std::setw(20) << std::to_string(cntxt.m_recv_speed / 1024) + "/" + std::to_string(cntxt.m_send_speed / 1024)
         << std::setw(25) << get_protocol_state_string(cntxt.m_state)
         << std::setw(20) << std::to_string(time(NULL) - cntxt.m_started) << ENDL;
       return true;
@@ -150,6 +152,10 @@ namespace cryptonote
       cnx.state = get_protocol_state_string(cntxt.m_state);
 
       cnx.live_time = timestamp - cntxt.m_started;
+
+      cnx.recv_speed = cntxt.m_recv_speed;
+      cnx.send_speed = cntxt.m_send_speed;
+      cnx.send_queue_size = cntxt.m_send_que_bytes;
       
       connections.push_back(cnx);
 
@@ -176,6 +182,14 @@ namespace cryptonote
       return true;
     }
 
+    if(hshd.pruned_height > m_core.get_current_blockchain_height())
+    {
+      //the blocks we miss are pruned there, wait for other peers to bring us above its pruned height
+      LOG_PRINT_CCONTEXT_L1("Remote blockchain is pruned below height " << hshd.pruned_height << ", not synchronizing from it");
+      context.m_state = cryptonote_connection_context::state_idle;
+      return true;
+    }
+
     /* As I don't know if accessing hshd from core could be a good practice, 
     I prefer pushing target height to the core at the same time it is pushed to the user.
     Nz. */
@@ -201,6 +215,7 @@ namespace cryptonote
   {
     m_core.get_blockchain_top(hshd.current_height, hshd.top_id);
     hshd.current_height +=1;
+    hshd.pruned_height = m_core.get_pruned_height();
     return true;
   }
   //------------------------------------------------------------------------------------------------------------------------  
@@ -273,23 +288,28 @@ namespace cryptonote
     if(context.m_state != cryptonote_connection_context::state_normal)
       return 1;
 
-    for(auto tx_blob_it = arg.txs.begin(); tx_blob_it!=arg.txs.end();)
+    //keeps the transactions to relay at the front, moving their blobs over the dropped ones
+    size_t relayed_count = 0;
+    for(size_t i = 0; i != arg.txs.size(); ++i)
     {
       CRITICAL_REGION_LOCAL(m_core.get_mempool());
       CRITICAL_REGION_LOCAL1(m_core.get_blockchain_storage());
 
       cryptonote::tx_verification_context tvc = AUTO_VAL_INIT(tvc);
-      m_core.handle_incoming_tx(*tx_blob_it, tvc, false);
+      m_core.handle_incoming_tx(arg.txs[i], tvc, false);
       if(tvc.m_verifivation_failed)
       {
         LOG_PRINT_CCONTEXT_L0("Tx verification failed, dropping connection");
 	goto drop_connection;
       }
       if(tvc.m_should_be_relayed)
-        ++tx_blob_it;
-      else
-        arg.txs.erase(tx_blob_it++);
+      {
+        if(relayed_count != i)
+          arg.txs[relayed_count] = std::move(arg.txs[i]);
+        ++relayed_count;
+      }
     }
+    arg.txs.resize(relayed_count);
 
     if(arg.txs.size())
     {
@@ -579,6 +599,14 @@ namespace cryptonote
       m_p2p->drop_connection(context);
     }
 
+    if(!m_core.prevalidate_block_ids(arg.start_height, arg.m_block_ids))
+    {
+      LOG_ERROR_CCONTEXT("sent m_block_ids not matching checkpoint hashes, dropping connection");
+      m_p2p->drop_connection(context);
+      m_p2p->add_ip_fail(context.m_remote_ip);
+      return 1;
+    }
+
     BOOST_FOREACH(auto& bl_id, arg.m_block_ids)
     {
       if(!m_core.have_block(bl_id))
@@ -33,6 +33,7 @@
 
 
 #include "include_base_utils.h"
+#include "profile_tools.h"
 #include "version.h"
 
 using namespace epee;
@@ -61,8 +62,10 @@ namespace
   const command_line::arg_descriptor<bool>        arg_os_version  = {"os-version", ""};
   const command_line::arg_descriptor<std::string> arg_log_file    = {"log-file", "", ""};
   const command_line::arg_descriptor<int>         arg_log_level   = {"log-level", "", LOG_LEVEL_0};
+  const command_line::arg_descriptor<size_t>      arg_log_queue_size = {"log-queue-size", "Messages buffered for the background log writer, 0 to write from the logging thread", 16384};
   const command_line::arg_descriptor<bool>        arg_console     = {"no-console", "Disable daemon console commands"};
   const command_line::arg_descriptor<bool>        arg_disable_store = {"disable-save", "Disable automatic blockchain saving"};
+  const command_line::arg_descriptor<std::string> arg_checkpoint_hashes = {"checkpoint-hashes-file", "Hashes of block id groups to sync against, " CRYPTONOTE_CHECKPOINT_HASHES_FILENAME " in the data directory is used if it exists", ""};
 }
 
 bool command_line_preprocessor(const boost::program_options::variables_map& vm);
@@ -92,8 +95,10 @@ int main(int argc, char* argv[])
 
   command_line::add_arg(desc_cmd_sett, arg_log_file);
   command_line::add_arg(desc_cmd_sett, arg_log_level);
+  command_line::add_arg(desc_cmd_sett, arg_log_queue_size);
   command_line::add_arg(desc_cmd_sett, arg_console);
   command_line::add_arg(desc_cmd_sett, arg_disable_store);
+  command_line::add_arg(desc_cmd_sett, arg_checkpoint_hashes);
 
   cryptonote::core::init_options(desc_cmd_sett);
   cryptonote::core_rpc_server::init_options(desc_cmd_sett);
@@ -145,6 +150,9 @@ int main(int argc, char* argv[])
   log_dir = log_file_path.has_parent_path() ? log_file_path.parent_path().string() : log_space::log_singletone::get_default_log_folder();
 
   log_space::log_singletone::add_logger(LOGGER_FILE, log_file_path.filename().string().c_str(), log_dir.c_str());
+  size_t log_queue_size = command_line::get_arg(vm, arg_log_queue_size);
+  if (log_queue_size)
+    log_space::log_singletone::set_async_mode(true, log_queue_size);
   LOG_PRINT_L0(CRYPTONOTE_NAME << " v" << PROJECT_VERSION_LONG);
 
   if (command_line_preprocessor(vm))
@@ -158,6 +166,16 @@ int main(int argc, char* argv[])
   cryptonote::checkpoints checkpoints;
   res = cryptonote::create_checkpoints(checkpoints);
   CHECK_AND_ASSERT_MES(res, 1, "Failed to initialize checkpoints");
+  std::string checkpoint_hashes_file = command_line::get_arg(vm, arg_checkpoint_hashes);
+  std::string default_checkpoint_hashes_file = command_line::get_arg(vm, command_line::arg_data_dir) + "/" CRYPTONOTE_CHECKPOINT_HASHES_FILENAME;
+  boost::system::error_code ec;
+  if (checkpoint_hashes_file.empty() && boost::filesystem::exists(default_checkpoint_hashes_file, ec))
+    checkpoint_hashes_file = default_checkpoint_hashes_file;
+  if (!checkpoint_hashes_file.empty())
+  {
+    res = checkpoints.load_hashes_from_file(checkpoint_hashes_file);
+    CHECK_AND_ASSERT_MES(res, 1, "Failed to load checkpoint hashes");
+  }
 
   //create objects and link them
   cryptonote::core ccore(NULL);
@@ -170,10 +188,13 @@ int main(int argc, char* argv[])
   daemon_cmmands_handler dch(p2psrv);
 
   //initialize objects
+  TIME_MEASURE_START(startup_time);
   LOG_PRINT_L0("Initializing p2p server...");
+  TIME_MEASURE_START(p2p_init_time);
   res = p2psrv.init(vm);
   CHECK_AND_ASSERT_MES(res, 1, "Failed to initialize p2p server.");
-  LOG_PRINT_L0("P2p server initialized OK");
+  TIME_MEASURE_FINISH(p2p_init_time);
+  LOG_PRINT_L0("P2p server initialized OK in " << p2p_init_time << " ms");
 
   LOG_PRINT_L0("Initializing cryptonote protocol...");
   res = cprotocol.init(vm);
@@ -181,15 +202,19 @@ int main(int argc, char* argv[])
   LOG_PRINT_L0("Cryptonote protocol initialized OK");
 
   LOG_PRINT_L0("Initializing core rpc server...");
+  TIME_MEASURE_START(rpc_init_time);
   res = rpc_server.init(vm);
   CHECK_AND_ASSERT_MES(res, 1, "Failed to initialize core rpc server.");
-  LOG_PRINT_GREEN("Core rpc server initialized OK on port: " << rpc_server.get_binded_port(), LOG_LEVEL_0);
+  TIME_MEASURE_FINISH(rpc_init_time);
+  LOG_PRINT_GREEN("Core rpc server initialized OK on port: " << rpc_server.get_binded_port() << " in " << rpc_init_time << " ms", LOG_LEVEL_0);
 
   //initialize core here
   LOG_PRINT_L0("Initializing core...");
+  TIME_MEASURE_START(core_init_time);
   res = ccore.init(vm);
   CHECK_AND_ASSERT_MES(res, 1, "Failed to initialize core");
-  LOG_PRINT_L0("Core initialized OK");
+  TIME_MEASURE_FINISH(core_init_time);
+  LOG_PRINT_L0("Core initialized OK in " << core_init_time << " ms");
   
   // start components
   if(!command_line::has_arg(vm, arg_console))
@@ -206,6 +231,8 @@ int main(int argc, char* argv[])
   res = rpc_server.run(2, false);
   CHECK_AND_ASSERT_MES(res, 1, "Failed to initialize core rpc server.");
   LOG_PRINT_L0("Core rpc server started ok");
+  TIME_MEASURE_FINISH(startup_time);
+  LOG_PRINT_GREEN("Daemon started in " << startup_time << " ms (p2p " << p2p_init_time << " ms, rpc " << rpc_init_time << " ms, core " << core_init_time << " ms)", LOG_LEVEL_0);
 
   tools::signal_handler::install([&dch, &p2psrv] {
     dch.stop_handling();
@@ -236,6 +263,7 @@ int main(int argc, char* argv[])
   cprotocol.set_p2p_endpoint(NULL);
 
   LOG_PRINT("Node stopped.", LOG_LEVEL_0);
+  log_space::log_singletone::set_async_mode(false);
   return 0;
 
   CATCH_ENTRY_L0("main", 1);
@@ -238,7 +238,7 @@ private:
   //--------------------------------------------------------------------------------
   bool print_block_by_height(uint64_t height)
   {
-    std::list<cryptonote::block> blocks;
+    std::vector<cryptonote::block> blocks;
     m_srv.get_payload_object().get_core().get_blocks(height, 1, blocks);
 
     if (1 == blocks.size())
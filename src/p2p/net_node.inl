@@ -65,6 +65,10 @@ namespace nodetool
     const command_line::arg_descriptor<std::vector<std::string> > arg_p2p_seed_node   = {"seed-node", "Connect to a node to retrieve peer addresses, and disconnect"};
     const command_line::arg_descriptor<bool> arg_p2p_hide_my_port   =    {"hide-my-port", "Do not announce yourself as peerlist candidate", false, true};
     const command_line::arg_descriptor<bool>        arg_no_igd				= {"no-igd", "Disable UPnP port mapping"};
+    const command_line::arg_descriptor<uint64_t>    arg_limit_rate_up      = {"limit-rate-up", "Limit total upload rate to kB/s, 0 for no limit", 0};
+    const command_line::arg_descriptor<uint64_t>    arg_limit_rate_down    = {"limit-rate-down", "Limit total download rate to kB/s, 0 for no limit", 0};
+    const command_line::arg_descriptor<uint64_t>    arg_limit_rate_up_peer   = {"limit-rate-up-peer", "Limit upload rate of each peer to kB/s, 0 for no limit", 0};
+    const command_line::arg_descriptor<uint64_t>    arg_limit_rate_down_peer = {"limit-rate-down-peer", "Limit download rate of each peer to kB/s, 0 for no limit", 0};
   }
 
   //-----------------------------------------------------------------------------------
@@ -81,6 +85,10 @@ namespace nodetool
     command_line::add_arg(desc, arg_p2p_seed_node);    
     command_line::add_arg(desc, arg_p2p_hide_my_port);
     command_line::add_arg(desc, arg_no_igd);
+    command_line::add_arg(desc, arg_limit_rate_up);
+    command_line::add_arg(desc, arg_limit_rate_down);
+    command_line::add_arg(desc, arg_limit_rate_up_peer);
+    command_line::add_arg(desc, arg_limit_rate_down_peer);
   }
   //-----------------------------------------------------------------------------------
   template<class t_payload_net_handler>
@@ -217,6 +225,12 @@ namespace nodetool
     if(command_line::has_arg(vm, arg_p2p_hide_my_port))
       m_hide_my_port = true;
 
+    epee::net_utils::bandwidth_limits& limits = m_net_server.get_bandwidth_limits();
+    limits.m_upload.set_rate(command_line::get_arg(vm, arg_limit_rate_up) * 1024);
+    limits.m_download.set_rate(command_line::get_arg(vm, arg_limit_rate_down) * 1024);
+    limits.m_peer_upload_rate = command_line::get_arg(vm, arg_limit_rate_up_peer) * 1024;
+    limits.m_peer_download_rate = command_line::get_arg(vm, arg_limit_rate_down_peer) * 1024;
+
     return true;
   }
   //-----------------------------------------------------------------------------------
@@ -994,9 +1008,12 @@ namespace nodetool
       return true;
     });
 
+    // one immutable copy of the payload is shared by the send queues of all peers,
+    // relayed blocks and transactions go ahead of bulk data and bandwidth limits
+    epee::net_utils::shared_buffer shared_data = boost::make_shared<std::string>(data_buff);
     BOOST_FOREACH(const auto& c_id, connections)
     {
-      m_net_server.get_config_object().notify(command, data_buff, c_id);
+      m_net_server.get_config_object().notify(command, shared_data, c_id, true);
     }
     return true;
   }
@@ -47,6 +47,8 @@ namespace cryptonote
   {
     const command_line::arg_descriptor<std::string> arg_rpc_bind_ip   = {"rpc-bind-ip", "", "127.0.0.1"};
     const command_line::arg_descriptor<std::string> arg_rpc_bind_port = {"rpc-bind-port", "", std::to_string(RPC_DEFAULT_PORT)};
+    const command_line::arg_descriptor<int>         arg_rpc_gzip_level    = {"rpc-gzip-level", "Compression level (1-9) of responses to clients that accept gzip, 0 to disable", 1};
+    const command_line::arg_descriptor<size_t>      arg_rpc_gzip_min_size = {"rpc-gzip-min-size", "Responses smaller than this many bytes are not compressed", 4096};
   }
 
   //-----------------------------------------------------------------------------------
@@ -54,15 +56,20 @@ namespace cryptonote
   {
     command_line::add_arg(desc, arg_rpc_bind_ip);
     command_line::add_arg(desc, arg_rpc_bind_port);
+    command_line::add_arg(desc, arg_rpc_gzip_level);
+    command_line::add_arg(desc, arg_rpc_gzip_min_size);
   }
   //------------------------------------------------------------------------------------------------------------------------------
-  core_rpc_server::core_rpc_server(core& cr, nodetool::node_server<cryptonote::t_cryptonote_protocol_handler<cryptonote::core> >& p2p):m_core(cr), m_p2p(p2p)
+  core_rpc_server::core_rpc_server(core& cr, nodetool::node_server<cryptonote::t_cryptonote_protocol_handler<cryptonote::core> >& p2p):m_core(cr), m_p2p(p2p), m_gzip_level(0), m_gzip_min_size(0)
   {}
   //------------------------------------------------------------------------------------------------------------------------------
   bool core_rpc_server::handle_command_line(const boost::program_options::variables_map& vm)
   {
     m_bind_ip = command_line::get_arg(vm, arg_rpc_bind_ip);
     m_port = command_line::get_arg(vm, arg_rpc_bind_port);
+    m_gzip_level = command_line::get_arg(vm, arg_rpc_gzip_level);
+    m_gzip_min_size = command_line::get_arg(vm, arg_rpc_gzip_min_size);
+    CHECK_AND_ASSERT_MES(0 <= m_gzip_level && m_gzip_level <= 9, false, "rpc-gzip-level must be between 0 and 9");
     return true;
   }
   //------------------------------------------------------------------------------------------------------------------------------
@@ -71,6 +78,8 @@ namespace cryptonote
     m_net_server.set_threads_prefix("RPC");
     bool r = handle_command_line(vm);
     CHECK_AND_ASSERT_MES(r, false, "Failed to process command line in core_rpc_server");
+    m_net_server.get_config_object().m_gzip_level = m_gzip_level;
+    m_net_server.get_config_object().m_gzip_min_size = m_gzip_min_size;
     return epee::http_server_impl_base<core_rpc_server, connection_context>::init(m_port, m_bind_ip);
   }
   //------------------------------------------------------------------------------------------------------------------------------
@@ -124,24 +133,13 @@ namespace cryptonote
   bool core_rpc_server::on_get_blocks(const COMMAND_RPC_GET_BLOCKS_FAST::request& req, COMMAND_RPC_GET_BLOCKS_FAST::response& res, connection_context& cntx)
   {
     CHECK_CORE_BUSY();
-    std::list<std::pair<block, std::list<transaction> > > bs;
-
-    if(!m_core.find_blockchain_supplement(req.start_height, req.block_ids, bs, res.current_height, res.start_height, COMMAND_RPC_GET_BLOCKS_FAST_MAX_COUNT))
+    //blobs are serialized right into the response, nothing is copied on the way
+    if(!m_core.find_blockchain_supplement(req.start_height, req.block_ids, res.blocks, res.current_height, res.start_height, COMMAND_RPC_GET_BLOCKS_FAST_MAX_COUNT))
     {
       res.status = "Failed";
       return false;
     }
 
-    BOOST_FOREACH(auto& b, bs)
-    {
-      res.blocks.resize(res.blocks.size()+1);
-      res.blocks.back().block = block_to_blob(b.first);
-      BOOST_FOREACH(auto& t, b.second)
-      {
-        res.blocks.back().txs.push_back(tx_to_blob(t));
-      }
-    }
-
     res.status = CORE_RPC_STATUS_OK;
     return true;
   }
@@ -271,7 +269,7 @@ namespace cryptonote
     }
 
     NOTIFY_NEW_TRANSACTIONS::request r;
-    r.txs.push_back(tx_blob);
+    r.txs.push_back(std::move(tx_blob));
     m_core.get_protocol()->relay_transactions(r, fake_context);
     //TODO: make sure that tx has reached other nodes here, probably wait to receive reflections from other nodes
     res.status = CORE_RPC_STATUS_OK;
@@ -39,6 +39,9 @@
 #include "p2p/net_node.h"
 #include "cryptonote_protocol/cryptonote_protocol_handler.h"
 
+//pool size and connection counts change between blocks, info responses are made again after this time
+#define RPC_INFO_CACHE_MAX_AGE_MS 1000
+
 namespace cryptonote
 {
   /************************************************************************/
@@ -58,7 +61,7 @@ namespace cryptonote
     CHAIN_HTTP_TO_MAP2(connection_context); //forward http requests to uri map
 
     BEGIN_URI_MAP2()
-      MAP_URI_AUTO_JON2("/getheight", on_get_height, COMMAND_RPC_GET_HEIGHT)
+      MAP_URI_CACHED_JON2("/getheight", on_get_height, COMMAND_RPC_GET_HEIGHT, 0)
       MAP_URI_AUTO_BIN2("/getblocks.bin", on_get_blocks, COMMAND_RPC_GET_BLOCKS_FAST)
       MAP_URI_AUTO_BIN2("/get_o_indexes.bin", on_get_indexes, COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES)      
       MAP_URI_AUTO_BIN2("/getrandom_outs.bin", on_get_random_outs, COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS)      
@@ -68,17 +71,17 @@ namespace cryptonote
       MAP_URI_AUTO_JON2("/stop_mining", on_stop_mining, COMMAND_RPC_STOP_MINING)
       MAP_URI_AUTO_JON2("/mining_status", on_mining_status, COMMAND_RPC_MINING_STATUS)
       MAP_URI_AUTO_JON2("/save_bc", on_save_bc, COMMAND_RPC_SAVE_BC)
-      MAP_URI_AUTO_JON2("/getinfo", on_get_info, COMMAND_RPC_GET_INFO)
+      MAP_URI_CACHED_JON2("/getinfo", on_get_info, COMMAND_RPC_GET_INFO, RPC_INFO_CACHE_MAX_AGE_MS)
       BEGIN_JSON_RPC_MAP("/json_rpc")
-        MAP_JON_RPC("getblockcount",             on_getblockcount,              COMMAND_RPC_GETBLOCKCOUNT)
+        MAP_JON_RPC_CACHED("getblockcount",      on_getblockcount,              COMMAND_RPC_GETBLOCKCOUNT, 0)
         MAP_JON_RPC_WE("on_getblockhash",        on_getblockhash,               COMMAND_RPC_GETBLOCKHASH)
         MAP_JON_RPC_WE("getblocktemplate",       on_getblocktemplate,           COMMAND_RPC_GETBLOCKTEMPLATE)
         MAP_JON_RPC_WE("submitblock",            on_submitblock,                COMMAND_RPC_SUBMITBLOCK)
-        MAP_JON_RPC_WE("getlastblockheader",     on_get_last_block_header,      COMMAND_RPC_GET_LAST_BLOCK_HEADER)
+        MAP_JON_RPC_WE_CACHED("getlastblockheader",     on_get_last_block_header,      COMMAND_RPC_GET_LAST_BLOCK_HEADER, 0)
         MAP_JON_RPC_WE("getblockheaderbyhash",   on_get_block_header_by_hash,   COMMAND_RPC_GET_BLOCK_HEADER_BY_HASH)
-        MAP_JON_RPC_WE("getblockheaderbyheight", on_get_block_header_by_height, COMMAND_RPC_GET_BLOCK_HEADER_BY_HEIGHT)
+        MAP_JON_RPC_WE_CACHED("getblockheaderbyheight", on_get_block_header_by_height, COMMAND_RPC_GET_BLOCK_HEADER_BY_HEIGHT, 0)
         MAP_JON_RPC_WE("get_connections",        on_get_connections,            COMMAND_RPC_GET_CONNECTIONS)
-        MAP_JON_RPC_WE("get_info",               on_get_info_json,              COMMAND_RPC_GET_INFO)
+        MAP_JON_RPC_WE_CACHED("get_info",               on_get_info_json,              COMMAND_RPC_GET_INFO, RPC_INFO_CACHE_MAX_AGE_MS)
       END_JSON_RPC_MAP()
     END_URI_MAP2()
 
@@ -108,6 +111,11 @@ namespace cryptonote
     bool handle_command_line(const boost::program_options::variables_map& vm);
     bool check_core_busy();
     bool check_core_ready();
+
+    //cached responses are made for the current main chain tip
+    uint64_t get_response_cache_version() { return m_core.get_blockchain_storage().get_tip_version(); }
+    template<class t_response>
+    bool can_cache_response(const t_response& res) { return res.status == CORE_RPC_STATUS_OK; }
     
     //utils
     uint64_t get_block_reward(const block& blk);
@@ -117,5 +125,8 @@ namespace cryptonote
     nodetool::node_server<cryptonote::t_cryptonote_protocol_handler<cryptonote::core> >& m_p2p;
     std::string m_port;
     std::string m_bind_ip;
+    int m_gzip_level;
+    size_t m_gzip_min_size;
+    epee::net_utils::http::response_cache m_response_cache;
   };
 }
@@ -0,0 +1,166 @@
+// Copyright (c) 2014, AEON, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <fstream>
+#include <boost/program_options.hpp>
+#include "include_base_utils.h"
+#include "common/command_line.h"
+#include "common/util.h"
+#include "cryptonote_config.h"
+#include "cryptonote_core/cryptonote_basic_impl.h"
+#include "view_scanner_rpc_server.h"
+#include "version.h"
+
+using namespace epee;
+namespace po = boost::program_options;
+
+namespace
+{
+  const command_line::arg_descriptor<std::string> arg_daemon_address = {"daemon-address", "Use daemon instance at <host>:<port>", ""};
+  const command_line::arg_descriptor<std::string> arg_daemon_host = {"daemon-host", "Use daemon instance at host <arg> instead of localhost", ""};
+  const command_line::arg_descriptor<int> arg_daemon_port = {"daemon-port", "Use daemon instance at port <arg> instead of the default rpc port", 0};
+  const command_line::arg_descriptor<std::string> arg_accounts_file = {"accounts-file", "Load accounts from file, one \"<address> <view key> [<start height>]\" per line", ""};
+  const command_line::arg_descriptor<uint32_t> arg_scan_threads = {"scan-threads", "Number of threads testing outputs, 0 means one per cpu", 0};
+  const command_line::arg_descriptor<uint32_t> arg_log_level = {"set_log", "", 0, true};
+
+  bool load_accounts(tools::view_scanner& scanner, const std::string& path)
+  {
+    std::ifstream in(path);
+    CHECK_AND_ASSERT_MES(in, false, "Failed to open accounts file " << path);
+
+    std::string line;
+    size_t line_number = 0;
+    while (std::getline(in, line))
+    {
+      ++line_number;
+      std::istringstream ss(line);
+      std::string address_str, view_key_str;
+      uint64_t start_height = 0;
+      if (!(ss >> address_str) || '#' == address_str[0])
+        continue;
+      ss >> view_key_str >> start_height;
+
+      cryptonote::account_public_address address;
+      crypto::secret_key view_key;
+      CHECK_AND_ASSERT_MES(cryptonote::get_account_address_from_str(address, address_str), false, path << ":" << line_number << ": invalid address");
+      CHECK_AND_ASSERT_MES(string_tools::hex_to_pod(view_key_str, view_key), false, path << ":" << line_number << ": invalid view key");
+      if (!scanner.add_account(address, view_key, start_height))
+        LOG_PRINT_RED_L0(path << ":" << line_number << ": view key doesn't match the address or account is a duplicate, skipped");
+    }
+    LOG_PRINT_L0("Loaded " << scanner.get_accounts_count() << " account(s) from " << path);
+    return true;
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  string_tools::set_module_name_and_folder(argv[0]);
+
+  po::options_description desc_general("General options");
+  command_line::add_arg(desc_general, command_line::arg_help);
+  command_line::add_arg(desc_general, command_line::arg_version);
+
+  po::options_description desc_params("View scanner options");
+  command_line::add_arg(desc_params, arg_daemon_address);
+  command_line::add_arg(desc_params, arg_daemon_host);
+  command_line::add_arg(desc_params, arg_daemon_port);
+  command_line::add_arg(desc_params, arg_accounts_file);
+  command_line::add_arg(desc_params, arg_scan_threads);
+  command_line::add_arg(desc_params, arg_log_level);
+  tools::view_scanner_rpc_server::init_options(desc_params);
+
+  po::options_description desc_all;
+  desc_all.add(desc_general).add(desc_params);
+  po::variables_map vm;
+  bool r = command_line::handle_error_helper(desc_all, [&]()
+  {
+    po::store(command_line::parse_command_line(argc, argv, desc_all), vm);
+
+    if (command_line::get_arg(vm, command_line::arg_help))
+    {
+      std::cout << CRYPTONOTE_NAME << " view scanner v" << PROJECT_VERSION_LONG << ENDL;
+      std::cout << "Usage: view_scanner --rpc-bind-port=<port> [--accounts-file=<file>] [--daemon-address=<host>:<port>]" << ENDL;
+      std::cout << desc_all << ENDL;
+      return false;
+    }
+    else if (command_line::get_arg(vm, command_line::arg_version))
+    {
+      std::cout << CRYPTONOTE_NAME << " view scanner v" << PROJECT_VERSION_LONG << ENDL;
+      return false;
+    }
+
+    po::notify(vm);
+    return true;
+  });
+  if (!r)
+    return 0;
+
+  log_space::get_set_log_detalisation_level(true, LOG_LEVEL_0);
+  log_space::log_singletone::add_logger(LOGGER_CONSOLE, NULL, NULL);
+  log_space::log_singletone::add_logger(LOGGER_FILE,
+    log_space::log_singletone::get_default_log_file().c_str(),
+    log_space::log_singletone::get_default_log_folder().c_str());
+  LOG_PRINT_L0(CRYPTONOTE_NAME << " view scanner v" << PROJECT_VERSION_LONG);
+
+  if(command_line::has_arg(vm, arg_log_level))
+  {
+    LOG_PRINT_L0("Setting log level = " << command_line::get_arg(vm, arg_log_level));
+    log_space::get_set_log_detalisation_level(true, command_line::get_arg(vm, arg_log_level));
+  }
+
+  std::string daemon_address = command_line::get_arg(vm, arg_daemon_address);
+  std::string daemon_host = command_line::get_arg(vm, arg_daemon_host);
+  int daemon_port = command_line::get_arg(vm, arg_daemon_port);
+  if (daemon_host.empty())
+    daemon_host = "localhost";
+  if (!daemon_port)
+    daemon_port = RPC_DEFAULT_PORT;
+  if (daemon_address.empty())
+    daemon_address = std::string("http://") + daemon_host + ":" + std::to_string(daemon_port);
+
+  tools::view_scanner scanner;
+  scanner.init(daemon_address, command_line::get_arg(vm, arg_scan_threads));
+  if (command_line::has_arg(vm, arg_accounts_file))
+  {
+    r = load_accounts(scanner, command_line::get_arg(vm, arg_accounts_file));
+    CHECK_AND_ASSERT_MES(r, 1, "Failed to load accounts");
+  }
+
+  tools::view_scanner_rpc_server srpc(scanner);
+  r = srpc.init(vm);
+  CHECK_AND_ASSERT_MES(r, 1, "Failed to initialize view scanner rpc server");
+
+  tools::signal_handler::install([&srpc, &scanner] {
+    scanner.stop();
+    srpc.send_stop_signal();
+  });
+  LOG_PRINT_L0("Starting view scanner rpc server");
+  srpc.run();
+  LOG_PRINT_L0("Stopped view scanner rpc server");
+  return 0;
+}
@@ -0,0 +1,164 @@
+// Copyright (c) 2014, AEON, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "include_base_utils.h"
+using namespace epee;
+
+#include "view_scanner_rpc_server.h"
+#include "common/command_line.h"
+#include "cryptonote_core/cryptonote_format_utils.h"
+#include "misc_language.h"
+#include "string_tools.h"
+
+namespace tools
+{
+  //-----------------------------------------------------------------------------------
+  const command_line::arg_descriptor<std::string> view_scanner_rpc_server::arg_rpc_bind_port = {"rpc-bind-port", "Sets bind port for the view scanner rpc server", "", true};
+  const command_line::arg_descriptor<std::string> view_scanner_rpc_server::arg_rpc_bind_ip = {"rpc-bind-ip", "Specify ip to bind rpc server", "127.0.0.1"};
+  const command_line::arg_descriptor<uint32_t> view_scanner_rpc_server::arg_refresh_interval = {"refresh-interval", "Seconds between blockchain refreshes", 20};
+
+  void view_scanner_rpc_server::init_options(boost::program_options::options_description& desc)
+  {
+    command_line::add_arg(desc, arg_rpc_bind_ip);
+    command_line::add_arg(desc, arg_rpc_bind_port);
+    command_line::add_arg(desc, arg_refresh_interval);
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  view_scanner_rpc_server::view_scanner_rpc_server(view_scanner& scanner):m_scanner(scanner), m_refresh_interval(20)
+  {}
+  //------------------------------------------------------------------------------------------------------------------------------
+  bool view_scanner_rpc_server::run()
+  {
+    m_net_server.add_idle_handler([this](){
+      try
+      {
+        m_scanner.refresh();
+      }
+      catch (const std::exception& e)
+      {
+        LOG_ERROR("Refresh failed: " << e.what());
+      }
+      return true;
+    }, m_refresh_interval * 1000);
+
+    // the idle handler may keep one thread busy scanning, the other one serves requests
+    return epee::http_server_impl_base<view_scanner_rpc_server, connection_context>::run(2, true);
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  bool view_scanner_rpc_server::handle_command_line(const boost::program_options::variables_map& vm)
+  {
+    m_bind_ip = command_line::get_arg(vm, arg_rpc_bind_ip);
+    m_port = command_line::get_arg(vm, arg_rpc_bind_port);
+    m_refresh_interval = std::max<uint32_t>(1, command_line::get_arg(vm, arg_refresh_interval));
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  bool view_scanner_rpc_server::init(const boost::program_options::variables_map& vm)
+  {
+    m_net_server.set_threads_prefix("RPC");
+    bool r = handle_command_line(vm);
+    CHECK_AND_ASSERT_MES(r, false, "Failed to process command line in view_scanner_rpc_server");
+    return epee::http_server_impl_base<view_scanner_rpc_server, connection_context>::init(m_port, m_bind_ip);
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  bool view_scanner_rpc_server::on_add_account(const view_scanner_rpc::COMMAND_RPC_ADD_ACCOUNT::request& req, view_scanner_rpc::COMMAND_RPC_ADD_ACCOUNT::response& res, epee::json_rpc::error& er, connection_context& cntx)
+  {
+    cryptonote::account_public_address address;
+    if (!get_account_address_from_str(address, req.address))
+    {
+      er.code = VIEW_SCANNER_RPC_ERROR_CODE_WRONG_ADDRESS;
+      er.message = "Invalid address: " + req.address;
+      return false;
+    }
+
+    crypto::secret_key view_key;
+    if (!epee::string_tools::hex_to_pod(req.view_key, view_key))
+    {
+      er.code = VIEW_SCANNER_RPC_ERROR_CODE_WRONG_KEY;
+      er.message = "View key has invalid format";
+      return false;
+    }
+
+    view_scanner::account_info info;
+    if (m_scanner.get_account(address, std::numeric_limits<uint64_t>::max(), info))
+    {
+      er.code = VIEW_SCANNER_RPC_ERROR_CODE_ACCOUNT_EXISTS;
+      er.message = "Account is already registered: " + req.address;
+      return false;
+    }
+
+    if (!m_scanner.add_account(address, view_key, req.start_height))
+    {
+      er.code = VIEW_SCANNER_RPC_ERROR_CODE_WRONG_KEY;
+      er.message = "View key doesn't match the address";
+      return false;
+    }
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  bool view_scanner_rpc_server::on_get_transfers(const view_scanner_rpc::COMMAND_RPC_GET_TRANSFERS::request& req, view_scanner_rpc::COMMAND_RPC_GET_TRANSFERS::response& res, epee::json_rpc::error& er, connection_context& cntx)
+  {
+    cryptonote::account_public_address address;
+    if (!get_account_address_from_str(address, req.address))
+    {
+      er.code = VIEW_SCANNER_RPC_ERROR_CODE_WRONG_ADDRESS;
+      er.message = "Invalid address: " + req.address;
+      return false;
+    }
+
+    view_scanner::account_info info;
+    if (!m_scanner.get_account(address, req.min_block_height, info))
+    {
+      er.code = VIEW_SCANNER_RPC_ERROR_CODE_ACCOUNT_NOT_FOUND;
+      er.message = "Account is not registered: " + req.address;
+      return false;
+    }
+
+    res.scanned_height = info.m_scanned_height;
+    res.received_total = info.m_received_total;
+    for (const auto& out : info.m_outputs)
+    {
+      view_scanner_rpc::received_output rpc_out;
+      rpc_out.tx_hash      = epee::string_tools::pod_to_hex(out.m_tx_hash);
+      rpc_out.payment_id   = out.m_payment_id == cryptonote::null_hash ? std::string() : epee::string_tools::pod_to_hex(out.m_payment_id);
+      rpc_out.amount       = out.m_amount;
+      rpc_out.block_height = out.m_block_height;
+      rpc_out.unlock_time  = out.m_unlock_time;
+      rpc_out.output_index = out.m_internal_output_index;
+      res.transfers.push_back(std::move(rpc_out));
+    }
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  bool view_scanner_rpc_server::on_getheight(const view_scanner_rpc::COMMAND_RPC_GET_HEIGHT::request& req, view_scanner_rpc::COMMAND_RPC_GET_HEIGHT::response& res, epee::json_rpc::error& er, connection_context& cntx)
+  {
+    res.height = m_scanner.get_blockchain_current_height();
+    res.accounts_count = m_scanner.get_accounts_count();
+    return true;
+  }
+}
@@ -0,0 +1,80 @@
+// Copyright (c) 2014, AEON, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma  once
+
+#include <boost/program_options/options_description.hpp>
+#include <boost/program_options/variables_map.hpp>
+#include "net/http_server_impl_base.h"
+#include "view_scanner_rpc_server_commands_defs.h"
+#include "wallet/view_scanner.h"
+#include "common/command_line.h"
+namespace tools
+{
+  /************************************************************************/
+  /*                                                                      */
+  /************************************************************************/
+  class view_scanner_rpc_server: public epee::http_server_impl_base<view_scanner_rpc_server>
+  {
+  public:
+    typedef epee::net_utils::connection_context_base connection_context;
+
+    view_scanner_rpc_server(view_scanner& scanner);
+
+    const static command_line::arg_descriptor<std::string> arg_rpc_bind_port;
+    const static command_line::arg_descriptor<std::string> arg_rpc_bind_ip;
+    const static command_line::arg_descriptor<uint32_t> arg_refresh_interval;
+
+    static void init_options(boost::program_options::options_description& desc);
+    bool init(const boost::program_options::variables_map& vm);
+    bool run();
+  private:
+
+    CHAIN_HTTP_TO_MAP2(connection_context); //forward http requests to uri map
+
+    BEGIN_URI_MAP2()
+      BEGIN_JSON_RPC_MAP("/json_rpc")
+        MAP_JON_RPC_WE("add_account",        on_add_account,        view_scanner_rpc::COMMAND_RPC_ADD_ACCOUNT)
+        MAP_JON_RPC_WE("get_transfers",      on_get_transfers,      view_scanner_rpc::COMMAND_RPC_GET_TRANSFERS)
+        MAP_JON_RPC_WE("getheight",          on_getheight,          view_scanner_rpc::COMMAND_RPC_GET_HEIGHT)
+      END_JSON_RPC_MAP()
+    END_URI_MAP2()
+
+      //json_rpc
+      bool on_add_account(const view_scanner_rpc::COMMAND_RPC_ADD_ACCOUNT::request& req, view_scanner_rpc::COMMAND_RPC_ADD_ACCOUNT::response& res, epee::json_rpc::error& er, connection_context& cntx);
+      bool on_get_transfers(const view_scanner_rpc::COMMAND_RPC_GET_TRANSFERS::request& req, view_scanner_rpc::COMMAND_RPC_GET_TRANSFERS::response& res, epee::json_rpc::error& er, connection_context& cntx);
+      bool on_getheight(const view_scanner_rpc::COMMAND_RPC_GET_HEIGHT::request& req, view_scanner_rpc::COMMAND_RPC_GET_HEIGHT::response& res, epee::json_rpc::error& er, connection_context& cntx);
+
+      bool handle_command_line(const boost::program_options::variables_map& vm);
+
+      view_scanner& m_scanner;
+      std::string m_port;
+      std::string m_bind_ip;
+      uint32_t m_refresh_interval;
+  };
+}
@@ -0,0 +1,458 @@
+// Copyright (c) 2014, AEON, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+#include <functional>
+#include <boost/thread/thread.hpp>
+
+#include "include_base_utils.h"
+#include "view_scanner.h"
+#include "wallet2.h"
+#include "cryptonote_core/cryptonote_format_utils.h"
+#include "rpc/core_rpc_server_commands_defs.h"
+#include "storages/http_abstract_invoke.h"
+#include "profile_tools.h"
+
+using namespace epee;
+using namespace cryptonote;
+
+namespace tools
+{
+//----------------------------------------------------------------------------------------------------
+view_scanner::view_scanner() : m_threads(1), m_local_bc_height(1), m_run(true)
+{
+  block b;
+  generate_genesis_block(b);
+  m_blockchain.push_back(get_block_hash(b));
+}
+//----------------------------------------------------------------------------------------------------
+void view_scanner::init(const std::string& daemon_address, size_t threads)
+{
+  m_daemon_address = daemon_address;
+  m_threads = threads ? threads : std::max<size_t>(1, boost::thread::hardware_concurrency());
+}
+//----------------------------------------------------------------------------------------------------
+bool view_scanner::add_account(const account_public_address& address, const crypto::secret_key& view_secret_key, uint64_t start_height)
+{
+  crypto::public_key view_public_key;
+  if (!crypto::secret_key_to_public_key(view_secret_key, view_public_key) || view_public_key != address.m_view_public_key)
+    return false;
+
+  CRITICAL_REGION_LOCAL(m_accounts_lock);
+  std::string address_str = get_account_address_as_str(address);
+  if (m_accounts_index.count(address_str))
+    return false;
+
+  account acc = AUTO_VAL_INIT(acc);
+  acc.m_view_secret_key = view_secret_key;
+  acc.m_spend_public_key = address.m_spend_public_key;
+  acc.m_info.m_address = address;
+  acc.m_info.m_start_height = start_height;
+  // blocks below the start height will never be scanned for this account
+  acc.m_info.m_scanned_height = std::min<uint64_t>(start_height, m_local_bc_height);
+  m_accounts_index[address_str] = m_accounts.size();
+  m_accounts.push_back(acc);
+  LOG_PRINT_L1("Added account " << address_str << ", start height " << start_height);
+  return true;
+}
+//----------------------------------------------------------------------------------------------------
+bool view_scanner::get_account(const account_public_address& address, uint64_t min_height, account_info& info) const
+{
+  CRITICAL_REGION_LOCAL(m_accounts_lock);
+  auto it = m_accounts_index.find(get_account_address_as_str(address));
+  if (it == m_accounts_index.end())
+    return false;
+
+  const account_info& src = m_accounts[it->second].m_info;
+  info.m_address = src.m_address;
+  info.m_start_height = src.m_start_height;
+  info.m_scanned_height = src.m_scanned_height;
+  info.m_received_total = src.m_received_total;
+  info.m_outputs.clear();
+  // outputs are appended in height order
+  auto first = std::lower_bound(src.m_outputs.begin(), src.m_outputs.end(), min_height,
+    [](const received_output& out, uint64_t height) { return out.m_block_height < height; });
+  info.m_outputs.assign(first, src.m_outputs.end());
+  return true;
+}
+//----------------------------------------------------------------------------------------------------
+size_t view_scanner::get_accounts_count() const
+{
+  CRITICAL_REGION_LOCAL(m_accounts_lock);
+  return m_accounts.size();
+}
+//----------------------------------------------------------------------------------------------------
+void view_scanner::get_short_chain_history(std::list<crypto::hash>& ids) const
+{
+  size_t i = 0;
+  size_t current_multiplier = 1;
+  size_t sz = m_blockchain.size();
+  size_t current_back_offset = 1;
+  bool genesis_included = false;
+  while(current_back_offset < sz)
+  {
+    ids.push_back(m_blockchain[sz-current_back_offset]);
+    if(sz-current_back_offset == 0)
+      genesis_included = true;
+    if(i < 10)
+    {
+      ++current_back_offset;
+    }else
+    {
+      current_back_offset += current_multiplier *= 2;
+    }
+    ++i;
+  }
+  if(!genesis_included)
+    ids.push_back(m_blockchain[0]);
+}
+//----------------------------------------------------------------------------------------------------
+void view_scanner::add_scan_tx(const transaction& tx, uint64_t height, std::vector<scan_tx>& txs) const
+{
+  std::vector<tx_extra_field> tx_extra_fields;
+  parse_tx_extra(tx.extra, tx_extra_fields);
+  tx_extra_pub_key pub_key_field;
+  if(!find_tx_extra_field_by_type(tx_extra_fields, pub_key_field))
+  {
+    LOG_PRINT_L1("Public key wasn't found in the transaction extra. Skipping transaction " << get_transaction_hash(tx));
+    return;
+  }
+
+  scan_tx stx;
+  stx.m_hash = get_transaction_hash(tx);
+  stx.m_pub_key = pub_key_field.pub_key;
+  stx.m_payment_id = null_hash;
+  stx.m_block_height = height;
+  stx.m_unlock_time = tx.unlock_time;
+  tx_extra_nonce extra_nonce;
+  if (find_tx_extra_field_by_type(tx_extra_fields, extra_nonce))
+    get_payment_id_from_tx_extra_nonce(extra_nonce.nonce, stx.m_payment_id);
+
+  stx.m_out_keys.reserve(tx.vout.size());
+  stx.m_amounts.reserve(tx.vout.size());
+  BOOST_FOREACH(const tx_out& o, tx.vout)
+  {
+    THROW_WALLET_EXCEPTION_IF(o.target.type() != typeid(txout_to_key), error::wallet_internal_error,
+      "wrong type id in transaction out, tx " + string_tools::pod_to_hex(stx.m_hash));
+    stx.m_out_keys.push_back(boost::get<txout_to_key>(o.target).key);
+    stx.m_amounts.push_back(o.amount);
+  }
+  txs.push_back(std::move(stx));
+}
+//----------------------------------------------------------------------------------------------------
+void view_scanner::parse_block_entry(const block_complete_entry& bl_entry, uint64_t height, crypto::hash& bl_id, std::vector<scan_tx>& txs) const
+{
+  block bl;
+  bool r = parse_and_validate_block_from_blob(bl_entry.block, bl);
+  THROW_WALLET_EXCEPTION_IF(!r, error::block_parse_error, bl_entry.block);
+  bl_id = get_block_hash(bl);
+
+  add_scan_tx(bl.miner_tx, height, txs);
+  BOOST_FOREACH(auto& txblob, bl_entry.txs)
+  {
+    transaction tx;
+    r = parse_and_validate_tx_from_blob(txblob, tx);
+    THROW_WALLET_EXCEPTION_IF(!r, error::tx_parse_error, txblob);
+    add_scan_tx(tx, height, txs);
+  }
+}
+//----------------------------------------------------------------------------------------------------
+// Tests every output of txs against every account in keys. Transactions are the outer loop so that
+// a transaction stays in cache while all accounts are tried; accounts are split over m_threads.
+void view_scanner::scan(const std::vector<scan_tx>& txs, const std::vector<scan_keys>& keys, std::vector<std::vector<received_output> >& found) const
+{
+  found.clear();
+  found.resize(keys.size());
+
+  auto scan_range = [&](size_t begin, size_t end) {
+    BOOST_FOREACH(const scan_tx& stx, txs)
+    {
+      for (size_t a = begin; a != end; ++a)
+      {
+        const scan_keys& k = keys[a];
+        if (stx.m_block_height < k.m_from_height)
+          continue;
+
+        // one derivation per transaction and account, not per output
+        crypto::key_derivation derivation;
+        if (!crypto::generate_key_derivation(stx.m_pub_key, k.m_view_secret_key, derivation))
+          break;
+        for (size_t i = 0; i != stx.m_out_keys.size(); ++i)
+        {
+          crypto::public_key pk;
+          if (!crypto::derive_public_key(derivation, i, k.m_spend_public_key, pk) || pk != stx.m_out_keys[i])
+            continue;
+          received_output out;
+          out.m_tx_hash = stx.m_hash;
+          out.m_payment_id = stx.m_payment_id;
+          out.m_block_height = stx.m_block_height;
+          out.m_unlock_time = stx.m_unlock_time;
+          out.m_amount = stx.m_amounts[i];
+          out.m_internal_output_index = i;
+          found[a].push_back(out);
+        }
+      }
+    }
+  };
+
+  size_t threads = std::min(m_threads, keys.size());
+  if (threads <= 1)
+  {
+    scan_range(0, keys.size());
+    return;
+  }
+
+  boost::thread_group workers;
+  size_t chunk = (keys.size() + threads - 1) / threads;
+  for (size_t begin = chunk; begin < keys.size(); begin += chunk)
+    workers.create_thread(std::bind(scan_range, begin, std::min(begin + chunk, keys.size())));
+  scan_range(0, chunk);
+  workers.join_all();
+}
+//----------------------------------------------------------------------------------------------------
+// Extends the chain with the next batch of blocks and scans it for all accounts that are up to date.
+size_t view_scanner::pull_blocks()
+{
+  COMMAND_RPC_GET_BLOCKS_FAST::request req = AUTO_VAL_INIT(req);
+  COMMAND_RPC_GET_BLOCKS_FAST::response res = AUTO_VAL_INIT(res);
+  get_short_chain_history(req.block_ids);
+  req.start_height = 0;
+  bool r = net_utils::invoke_http_bin_remote_command2(m_daemon_address + "/getblocks.bin", req, res, m_http_client, WALLET_RCP_CONNECTION_TIMEOUT);
+  THROW_WALLET_EXCEPTION_IF(!r, error::no_connection_to_daemon, "getblocks.bin");
+  THROW_WALLET_EXCEPTION_IF(res.status == CORE_RPC_STATUS_BUSY, error::daemon_busy, "getblocks.bin");
+  THROW_WALLET_EXCEPTION_IF(res.status != CORE_RPC_STATUS_OK, error::get_blocks_error, res.status);
+
+  TIME_MEASURE_START(parse_time);
+  std::vector<scan_tx> txs;
+  std::vector<crypto::hash> new_ids;
+  uint64_t current_index = res.start_height;
+  BOOST_FOREACH(auto& bl_entry, res.blocks)
+  {
+    crypto::hash bl_id;
+    if(current_index < m_blockchain.size())
+    {
+      block bl;
+      r = parse_and_validate_block_from_blob(bl_entry.block, bl);
+      THROW_WALLET_EXCEPTION_IF(!r, error::block_parse_error, bl_entry.block);
+      bl_id = get_block_hash(bl);
+      if(bl_id == m_blockchain[current_index])
+      {
+        ++current_index;
+        continue;
+      }
+      //split detected here !!!
+      THROW_WALLET_EXCEPTION_IF(current_index == res.start_height, error::wallet_internal_error,
+        "wrong daemon response: split starts from the first block in response " + string_tools::pod_to_hex(bl_id) +
+        " (height " + std::to_string(res.start_height) + "), local block id at this height: " +
+        string_tools::pod_to_hex(m_blockchain[current_index]));
+      detach_blockchain(current_index);
+    }
+    parse_block_entry(bl_entry, current_index, bl_id, txs);
+    new_ids.push_back(bl_id);
+    ++current_index;
+  }
+  TIME_MEASURE_FINISH(parse_time);
+  if (new_ids.empty())
+    return 0;
+
+  const uint64_t batch_start = m_blockchain.size();
+  const uint64_t batch_end = batch_start + new_ids.size();
+  std::vector<scan_keys> keys;
+  std::vector<size_t> keys_accounts;
+  {
+    CRITICAL_REGION_LOCAL(m_accounts_lock);
+    for (size_t a = 0; a != m_accounts.size(); ++a)
+    {
+      // accounts that are behind are scanned by catch_up_accounts()
+      const account& acc = m_accounts[a];
+      if (acc.m_info.m_scanned_height < batch_start)
+        continue;
+      scan_keys k;
+      k.m_view_secret_key = acc.m_view_secret_key;
+      k.m_spend_public_key = acc.m_spend_public_key;
+      k.m_from_height = acc.m_info.m_start_height;
+      keys.push_back(k);
+      keys_accounts.push_back(a);
+    }
+  }
+
+  TIME_MEASURE_START(scan_time);
+  std::vector<std::vector<received_output> > found;
+  scan(txs, keys, found);
+  TIME_MEASURE_FINISH(scan_time);
+
+  {
+    CRITICAL_REGION_LOCAL(m_accounts_lock);
+    for (size_t k = 0; k != keys_accounts.size(); ++k)
+    {
+      account_info& info = m_accounts[keys_accounts[k]].m_info;
+      BOOST_FOREACH(const received_output& out, found[k])
+      {
+        info.m_received_total += out.m_amount;
+        info.m_outputs.push_back(out);
+      }
+      info.m_scanned_height = std::max(info.m_scanned_height, batch_end);
+    }
+    m_blockchain.insert(m_blockchain.end(), new_ids.begin(), new_ids.end());
+    m_local_bc_height = m_blockchain.size();
+  }
+
+  LOG_PRINT_L2("Scanned blocks " << batch_start << "-" << batch_end - 1 << ": " << txs.size() << " txs, " << keys.size() << " accounts, "
+    << parse_time + scan_time << "(" << parse_time << "/" << scan_time << ")ms");
+  return new_ids.size();
+}
+//----------------------------------------------------------------------------------------------------
+// Scans the blocks the scanner already passed for accounts registered behind it, one batch per call.
+// Returns false when there is nothing left to catch up.
+bool view_scanner::catch_up_accounts()
+{
+  std::vector<scan_keys> keys;
+  std::vector<size_t> keys_accounts;
+  uint64_t start_height = m_blockchain.size();
+  {
+    CRITICAL_REGION_LOCAL(m_accounts_lock);
+    for (size_t a = 0; a != m_accounts.size(); ++a)
+    {
+      const account& acc = m_accounts[a];
+      if (acc.m_info.m_scanned_height >= m_blockchain.size())
+        continue;
+      scan_keys k;
+      k.m_view_secret_key = acc.m_view_secret_key;
+      k.m_spend_public_key = acc.m_spend_public_key;
+      k.m_from_height = std::max(acc.m_info.m_start_height, acc.m_info.m_scanned_height);
+      keys.push_back(k);
+      keys_accounts.push_back(a);
+      start_height = std::min(start_height, acc.m_info.m_scanned_height);
+    }
+  }
+  if (keys.empty())
+    return false;
+
+  COMMAND_RPC_GET_BLOCKS_FAST::request req = AUTO_VAL_INIT(req);
+  COMMAND_RPC_GET_BLOCKS_FAST::response res = AUTO_VAL_INIT(res);
+  // a non zero start height is used as is, zero makes the daemon start from the genesis block
+  req.block_ids.push_back(m_blockchain[0]);
+  req.start_height = start_height;
+  bool r = net_utils::invoke_http_bin_remote_command2(m_daemon_address + "/getblocks.bin", req, res, m_http_client, WALLET_RCP_CONNECTION_TIMEOUT);
+  THROW_WALLET_EXCEPTION_IF(!r, error::no_connection_to_daemon, "getblocks.bin");
+  THROW_WALLET_EXCEPTION_IF(res.status == CORE_RPC_STATUS_BUSY, error::daemon_busy, "getblocks.bin");
+  THROW_WALLET_EXCEPTION_IF(res.status != CORE_RPC_STATUS_OK, error::get_blocks_error, res.status);
+  THROW_WALLET_EXCEPTION_IF(res.start_height != start_height, error::wallet_internal_error,
+    "wrong daemon response: blocks start at height " + std::to_string(res.start_height) + ", requested " + std::to_string(start_height));
+
+  std::vector<scan_tx> txs;
+  uint64_t current_index = start_height;
+  BOOST_FOREACH(auto& bl_entry, res.blocks)
+  {
+    if (current_index >= m_blockchain.size())
+      break;
+    crypto::hash bl_id;
+    size_t txs_count = txs.size();
+    parse_block_entry(bl_entry, current_index, bl_id, txs);
+    if (bl_id != m_blockchain[current_index])
+    {
+      // the daemon switched to another chain, pull_blocks() will detach ours
+      txs.resize(txs_count);
+      break;
+    }
+    ++current_index;
+  }
+  if (current_index == start_height)
+    return false;
+
+  std::vector<std::vector<received_output> > found;
+  scan(txs, keys, found);
+
+  CRITICAL_REGION_LOCAL(m_accounts_lock);
+  for (size_t k = 0; k != keys_accounts.size(); ++k)
+  {
+    account_info& info = m_accounts[keys_accounts[k]].m_info;
+    if (info.m_scanned_height >= current_index)
+      continue;
+    BOOST_FOREACH(const received_output& out, found[k])
+    {
+      info.m_received_total += out.m_amount;
+      info.m_outputs.push_back(out);
+    }
+    info.m_scanned_height = current_index;
+  }
+  LOG_PRINT_L1("Caught up " << keys.size() << " account(s) to height " << current_index);
+  return true;
+}
+//----------------------------------------------------------------------------------------------------
+void view_scanner::detach_blockchain(uint64_t height)
+{
+  LOG_PRINT_L0("Detaching blockchain on height " << height);
+  CRITICAL_REGION_LOCAL(m_accounts_lock);
+  BOOST_FOREACH(account& acc, m_accounts)
+  {
+    account_info& info = acc.m_info;
+    while (!info.m_outputs.empty() && info.m_outputs.back().m_block_height >= height)
+    {
+      info.m_received_total -= info.m_outputs.back().m_amount;
+      info.m_outputs.pop_back();
+    }
+    info.m_scanned_height = std::min(info.m_scanned_height, height);
+  }
+  m_blockchain.erase(m_blockchain.begin() + height, m_blockchain.end());
+  m_local_bc_height = m_blockchain.size();
+}
+//----------------------------------------------------------------------------------------------------
+void view_scanner::refresh()
+{
+  size_t blocks_fetched = 0;
+  size_t try_count = 0;
+  while(m_run.load(std::memory_order_relaxed))
+  {
+    try
+    {
+      // catch up first so that accounts join the main scan as early as possible
+      if (catch_up_accounts())
+        continue;
+      size_t added_blocks = pull_blocks();
+      blocks_fetched += added_blocks;
+      if(!added_blocks)
+        break;
+    }
+    catch (const std::exception&)
+    {
+      if(try_count < 3)
+      {
+        LOG_PRINT_L1("Another try pull_blocks (try_count=" << try_count << ")...");
+        ++try_count;
+      }
+      else
+      {
+        LOG_ERROR("pull_blocks failed, try_count=" << try_count);
+        throw;
+      }
+    }
+  }
+  LOG_PRINT_L1("Refresh done, blocks received: " << blocks_fetched << ", height: " << m_local_bc_height);
+}
+}
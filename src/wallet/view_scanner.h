@@ -0,0 +1,135 @@
+// Copyright (c) 2014, AEON, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <atomic>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "cryptonote_core/cryptonote_basic.h"
+#include "cryptonote_protocol/cryptonote_protocol_defs.h"
+#include "crypto/crypto.h"
+#include "crypto/hash.h"
+#include "net/http_client.h"
+#include "syncobj.h"
+
+namespace tools
+{
+  /************************************************************************/
+  /* Scans the blockchain for incoming outputs of many view-only accounts */
+  /* at once: every block is downloaded and parsed a single time and its  */
+  /* outputs are tested against all registered view keys.                 */
+  /************************************************************************/
+  class view_scanner
+  {
+  public:
+    struct received_output
+    {
+      crypto::hash m_tx_hash;
+      crypto::hash m_payment_id; // null_hash if the transaction has none
+      uint64_t m_block_height;
+      uint64_t m_unlock_time;
+      uint64_t m_amount;
+      size_t m_internal_output_index;
+    };
+
+    struct account_info
+    {
+      cryptonote::account_public_address m_address;
+      uint64_t m_start_height;
+      uint64_t m_scanned_height; // blocks below this height are scanned for the account
+      uint64_t m_received_total;
+      std::vector<received_output> m_outputs;
+    };
+
+    view_scanner();
+
+    // threads == 0 means one per hardware thread
+    void init(const std::string& daemon_address = "http://localhost:8080", size_t threads = 0);
+    void stop() { m_run.store(false, std::memory_order_relaxed); }
+
+    // Accounts may be added at any time, blocks the scanner already passed are scanned
+    // for them on the next refresh(). Spends can't be detected without the spend key.
+    bool add_account(const cryptonote::account_public_address& address, const crypto::secret_key& view_secret_key, uint64_t start_height);
+    bool get_account(const cryptonote::account_public_address& address, uint64_t min_height, account_info& info) const;
+    size_t get_accounts_count() const;
+    uint64_t get_blockchain_current_height() const { return m_local_bc_height; }
+
+    void refresh();
+
+  private:
+    struct account
+    {
+      crypto::secret_key m_view_secret_key;
+      crypto::public_key m_spend_public_key;
+      account_info m_info;
+    };
+
+    // transaction data shared by all accounts, derived once per block batch
+    struct scan_tx
+    {
+      crypto::hash m_hash;
+      crypto::public_key m_pub_key;
+      crypto::hash m_payment_id;
+      uint64_t m_block_height;
+      uint64_t m_unlock_time;
+      std::vector<crypto::public_key> m_out_keys;
+      std::vector<uint64_t> m_amounts;
+    };
+
+    // keys of an account taking part in a scan, kept contiguous for the inner loop
+    struct scan_keys
+    {
+      crypto::secret_key m_view_secret_key;
+      crypto::public_key m_spend_public_key;
+      uint64_t m_from_height;
+    };
+
+    void get_short_chain_history(std::list<crypto::hash>& ids) const;
+    void add_scan_tx(const cryptonote::transaction& tx, uint64_t height, std::vector<scan_tx>& txs) const;
+    void parse_block_entry(const cryptonote::block_complete_entry& bl_entry, uint64_t height, crypto::hash& bl_id, std::vector<scan_tx>& txs) const;
+    void scan(const std::vector<scan_tx>& txs, const std::vector<scan_keys>& keys, std::vector<std::vector<received_output> >& found) const;
+    size_t pull_blocks();
+    bool catch_up_accounts();
+    void detach_blockchain(uint64_t height);
+
+    std::string m_daemon_address;
+    epee::net_utils::http::http_simple_client m_http_client;
+    size_t m_threads;
+    std::vector<crypto::hash> m_blockchain;
+    std::atomic<uint64_t> m_local_bc_height;
+    std::atomic<bool> m_run;
+
+    mutable epee::critical_section m_accounts_lock;
+    std::vector<account> m_accounts;
+    std::unordered_map<std::string, size_t> m_accounts_index; // by address string
+  };
+}
@@ -28,6 +28,7 @@
 // 
 // Parts of this file are originally copyright (c) 2012-2013 The Cryptonote developers
 
+#include <random>
 #include <boost/archive/binary_oarchive.hpp>
 #include <boost/archive/binary_iarchive.hpp>
 
@@ -74,9 +75,6 @@ void do_prepare_file_names(const std::string& file_path, std::string& keys_file,
 
 namespace tools
 {
-// for now, limit to 30 attempts.  TODO: discuss a good number to limit to.
-const size_t MAX_SPLIT_ATTEMPTS = 30;
-
 //----------------------------------------------------------------------------------------------------
 void wallet2::init(const std::string& daemon_address, uint64_t upper_transaction_size_limit)
 {
@@ -155,6 +153,7 @@ void wallet2::process_new_transaction(const cryptonote::transaction& tx, uint64_
         error::wallet_internal_error, "key_image generated ephemeral public key not matched with output_key");
 
       m_key_images[td.m_key_image] = m_transfers.size()-1;
+      index_transfer(m_transfers.size()-1);
       LOG_PRINT_L0("Received money: " << print_money(td.amount()) << ", with tx: " << get_transaction_hash(tx));
       if (0 != m_callback)
         m_callback->on_money_received(height, td.m_tx, td.m_internal_output_index);
@@ -173,7 +172,7 @@ void wallet2::process_new_transaction(const cryptonote::transaction& tx, uint64_
       LOG_PRINT_L0("Spent money: " << print_money(boost::get<cryptonote::txin_to_key>(in).amount) << ", with tx: " << get_transaction_hash(tx));
       tx_money_spent_in_ins += boost::get<cryptonote::txin_to_key>(in).amount;
       transfer_details& td = m_transfers[it->second];
-      td.m_spent = true;
+      set_transfer_spent(it->second, true);
       if (0 != m_callback)
         m_callback->on_money_spent(height, td.m_tx, td.m_internal_output_index, tx);
     }
@@ -395,6 +394,7 @@ void wallet2::detach_blockchain(uint64_t height)
   size_t blocks_detached = m_blockchain.end() - (m_blockchain.begin()+height);
   m_blockchain.erase(m_blockchain.begin()+height, m_blockchain.end());
   m_local_bc_height -= blocks_detached;
+  rebuild_transfer_index();
 
   for (auto it = m_payments.begin(); it != m_payments.end(); )
   {
@@ -416,6 +416,7 @@ bool wallet2::clear()
 {
   m_blockchain.clear();
   m_transfers.clear();
+  rebuild_transfer_index();
   cryptonote::block b;
   cryptonote::generate_genesis_block(b);
   m_blockchain.push_back(get_block_hash(b));
@@ -576,6 +577,7 @@ void wallet2::load(const std::string& wallet_, const std::string& password)
     m_blockchain.push_back(get_block_hash(b));
   }
   m_local_bc_height = m_blockchain.size();
+  rebuild_transfer_index();
 }
 //----------------------------------------------------------------------------------------------------
 void wallet2::store()
@@ -586,20 +588,13 @@ void wallet2::store()
 //----------------------------------------------------------------------------------------------------
 uint64_t wallet2::unlocked_balance()
 {
-  uint64_t amount = 0;
-  BOOST_FOREACH(transfer_details& td, m_transfers)
-    if(!td.m_spent && is_transfer_unlocked(td))
-      amount += td.amount();
-
-  return amount;
+  update_unlocked_transfers();
+  return m_unlocked_balance_total;
 }
 //----------------------------------------------------------------------------------------------------
 uint64_t wallet2::balance()
 {
-  uint64_t amount = 0;
-  BOOST_FOREACH(auto& td, m_transfers)
-    if(!td.m_spent)
-      amount += td.amount();
+  uint64_t amount = m_balance_total;
 
 
   BOOST_FOREACH(auto& utx, m_unconfirmed_txs)
@@ -624,6 +619,98 @@ void wallet2::get_payments(const crypto::hash& payment_id, std::list<wallet2::pa
   });
 }
 //----------------------------------------------------------------------------------------------------
+uint64_t wallet2::get_transfer_unlock_height(const transfer_details& td) const
+{
+  // blockchain size at which is_transfer_unlocked() starts to hold for block index unlock times
+  uint64_t unlock_height = td.m_block_height + DEFAULT_TX_SPENDABLE_AGE;
+  if(td.m_tx.unlock_time < CRYPTONOTE_MAX_BLOCK_NUMBER && unlock_height + CRYPTONOTE_LOCKED_TX_ALLOWED_DELTA_BLOCKS <= td.m_tx.unlock_time)
+    unlock_height = td.m_tx.unlock_time + 1 - CRYPTONOTE_LOCKED_TX_ALLOWED_DELTA_BLOCKS;
+  return unlock_height;
+}
+//----------------------------------------------------------------------------------------------------
+void wallet2::index_transfer(size_t idx)
+{
+  const transfer_details& td = m_transfers[idx];
+  if(td.m_spent)
+    return;
+
+  m_balance_total += td.amount();
+  if(td.m_tx.unlock_time < CRYPTONOTE_MAX_BLOCK_NUMBER)
+    m_height_locked_transfers.insert(std::make_pair(get_transfer_unlock_height(td), idx));
+  else
+    m_time_locked_transfers.insert(std::make_pair(td.m_tx.unlock_time - CRYPTONOTE_LOCKED_TX_ALLOWED_DELTA_SECONDS, idx));
+}
+//----------------------------------------------------------------------------------------------------
+void wallet2::unindex_transfer(size_t idx)
+{
+  const transfer_details& td = m_transfers[idx];
+  if(td.m_spent)
+    return;
+
+  m_balance_total -= td.amount();
+  if(m_unlocked_transfers.erase(std::make_pair(td.amount(), idx)))
+  {
+    m_unlocked_balance_total -= td.amount();
+    return;
+  }
+  if(m_height_locked_transfers.erase(std::make_pair(get_transfer_unlock_height(td), idx)))
+    return;
+  bool r = td.m_tx.unlock_time >= CRYPTONOTE_MAX_BLOCK_NUMBER &&
+    m_time_locked_transfers.erase(std::make_pair(td.m_tx.unlock_time - CRYPTONOTE_LOCKED_TX_ALLOWED_DELTA_SECONDS, idx));
+  THROW_WALLET_EXCEPTION_IF(!r, error::wallet_internal_error, "transfer " + std::to_string(idx) + " not found in unspent transfers index");
+}
+//----------------------------------------------------------------------------------------------------
+void wallet2::rebuild_transfer_index()
+{
+  m_unlocked_transfers.clear();
+  m_height_locked_transfers.clear();
+  m_time_locked_transfers.clear();
+  m_balance_total = 0;
+  m_unlocked_balance_total = 0;
+  for(size_t i = 0; i < m_transfers.size(); ++i)
+    index_transfer(i);
+}
+//----------------------------------------------------------------------------------------------------
+// Moves transfers which became spendable since the last call into m_unlocked_transfers.
+// Blockchain size only grows between rebuilds, so each transfer is moved at most twice.
+void wallet2::update_unlocked_transfers()
+{
+  uint64_t now = static_cast<uint64_t>(time(NULL));
+  while(!m_time_locked_transfers.empty() && m_time_locked_transfers.begin()->first <= now)
+  {
+    size_t idx = m_time_locked_transfers.begin()->second;
+    m_time_locked_transfers.erase(m_time_locked_transfers.begin());
+    m_height_locked_transfers.insert(std::make_pair(get_transfer_unlock_height(m_transfers[idx]), idx));
+  }
+
+  uint64_t height = m_blockchain.size();
+  while(!m_height_locked_transfers.empty() && m_height_locked_transfers.begin()->first <= height)
+  {
+    size_t idx = m_height_locked_transfers.begin()->second;
+    m_height_locked_transfers.erase(m_height_locked_transfers.begin());
+    m_unlocked_transfers.insert(std::make_pair(m_transfers[idx].amount(), idx));
+    m_unlocked_balance_total += m_transfers[idx].amount();
+  }
+}
+//----------------------------------------------------------------------------------------------------
+void wallet2::set_transfer_spent(size_t idx, bool spent)
+{
+  transfer_details& td = m_transfers[idx];
+  if(td.m_spent == spent)
+    return;
+
+  if(spent)
+  {
+    unindex_transfer(idx);
+    td.m_spent = true;
+  }
+  else
+  {
+    td.m_spent = false;
+    index_transfer(idx);
+  }
+}
+//----------------------------------------------------------------------------------------------------
 bool wallet2::is_transfer_unlocked(const transfer_details& td) const
 {
   if(!is_tx_spendtime_unlocked(td.m_tx.unlock_time))
@@ -686,17 +773,12 @@ uint64_t wallet2::select_transfers(uint64_t needed_money, bool add_dust, uint64_
 
   // aggregate sources available for transfers
   // if dust needed, take dust from only one source (so require source has at least dust amount)
-  for (size_t i = 0; i < m_transfers.size(); ++i)
-  {
-    const transfer_details& td = m_transfers[i];
-    if (!td.m_spent && is_transfer_unlocked(td))
-    {
-      if (dust < td.amount())
-        unused_transfers_indices.push_back(i);
-      else
-        unused_dust_indices.push_back(i);
-    }
-  }
+  update_unlocked_transfers();
+  auto dust_end = m_unlocked_transfers.upper_bound(std::make_pair(dust, std::numeric_limits<size_t>::max()));
+  for (auto it = m_unlocked_transfers.begin(); it != dust_end; ++it)
+    unused_dust_indices.push_back(it->second);
+  for (auto it = dust_end; it != m_unlocked_transfers.end(); ++it)
+    unused_transfers_indices.push_back(it->second);
 
   bool select_one_dust = add_dust && !unused_dust_indices.empty();
   uint64_t found_money = 0;
@@ -743,52 +825,79 @@ void wallet2::transfer(const std::vector<cryptonote::tx_destination_entry>& dsts
   transfer(dsts, fake_outputs_count, unlock_time, fee, extra, tx, ptx);
 }
 
-namespace {
-// split_amounts(vector<cryptonote::tx_destination_entry> dsts, size_t num_splits)
-//
-// split amount for each dst in dsts into num_splits parts
-// and make num_splits new vector<crypt...> instances to hold these new amounts
-std::vector<std::vector<cryptonote::tx_destination_entry>> split_amounts(
-    std::vector<cryptonote::tx_destination_entry> dsts, size_t num_splits)
+//----------------------------------------------------------------------------------------------------
+void wallet2::get_random_outs(const std::list<transfer_container::iterator>& selected_transfers, size_t fake_outputs_count,
+                              std::vector<cryptonote::COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount>& outs)
 {
-  std::vector<std::vector<cryptonote::tx_destination_entry>> retVal;
-
-  if (num_splits <= 1)
+  COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::request req = AUTO_VAL_INIT(req);
+  COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::response daemon_resp = AUTO_VAL_INIT(daemon_resp);
+  req.outs_count = fake_outputs_count + 1;// add one to make possible (if need) to skip real output key
+  BOOST_FOREACH(transfer_container::iterator it, selected_transfers)
   {
-    retVal.push_back(dsts);
-    return retVal;
+    THROW_WALLET_EXCEPTION_IF(it->m_tx.vout.size() <= it->m_internal_output_index, error::wallet_internal_error,
+      "m_internal_output_index = " + std::to_string(it->m_internal_output_index) +
+      " is greater or equal to outputs count = " + std::to_string(it->m_tx.vout.size()));
+    req.amounts.push_back(it->amount());
   }
 
-  // for each split required
-  for (size_t i=0; i < num_splits; i++)
-  {
-    std::vector<cryptonote::tx_destination_entry> new_dsts;
+  bool r = epee::net_utils::invoke_http_bin_remote_command2(m_daemon_address + "/getrandom_outs.bin", req, daemon_resp, m_http_client, 200000);
+  THROW_WALLET_EXCEPTION_IF(!r, error::no_connection_to_daemon, "getrandom_outs.bin");
+  THROW_WALLET_EXCEPTION_IF(daemon_resp.status == CORE_RPC_STATUS_BUSY, error::daemon_busy, "getrandom_outs.bin");
+  THROW_WALLET_EXCEPTION_IF(daemon_resp.status != CORE_RPC_STATUS_OK, error::get_random_outs_error, daemon_resp.status);
+  THROW_WALLET_EXCEPTION_IF(daemon_resp.outs.size() != selected_transfers.size(), error::wallet_internal_error,
+    "daemon returned wrong response for getrandom_outs.bin, wrong amounts count = " +
+    std::to_string(daemon_resp.outs.size()) + ", expected " +  std::to_string(selected_transfers.size()));
 
-    // for each destination
-    for (size_t j=0; j < dsts.size(); j++)
+  std::vector<COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount> scanty_outs;
+  BOOST_FOREACH(COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount& amount_outs, daemon_resp.outs)
+  {
+    if (amount_outs.outs.size() < fake_outputs_count)
     {
-      cryptonote::tx_destination_entry de;
-      uint64_t amount;
-
-      amount = dsts[j].amount;
-      amount = amount / num_splits;
+      scanty_outs.push_back(amount_outs);
+    }
+  }
+  THROW_WALLET_EXCEPTION_IF(!scanty_outs.empty(), error::not_enough_outs_to_mix, scanty_outs, fake_outputs_count);
 
-      // if last split, add remainder
-      if (i + 1 == num_splits)
-      {
-        amount += dsts[j].amount % num_splits;
-      }
-      
-      de.addr = dsts[j].addr;
-      de.amount = amount;
+  outs.swap(daemon_resp.outs);
+}
 
-      new_dsts.push_back(de);
-    }
+namespace {
+size_t varint_size(uint64_t v)
+{
+  size_t size = 1;
+  for (; v >= 0x80; v >>= 7)
+    ++size;
+  return size;
+}
 
-    retVal.push_back(new_dsts);
-  }
+// number of outputs digit_split_strategy makes out of the amount
+size_t digit_split_outputs_count(uint64_t amount, uint64_t dust_threshold, bool count_dust)
+{
+  size_t count = 0;
+  cryptonote::decompose_amount_into_digits(amount, dust_threshold,
+    [&](uint64_t) { ++count; },
+    [&](uint64_t) { if (count_dust) ++count; });
+  return count;
+}
 
-  return retVal;
+// upper bound of the binary blob size of a transaction with txin_to_key inputs and txout_to_key outputs
+size_t estimate_tx_size(size_t inputs_count, size_t ring_size, size_t outputs_count, uint64_t unlock_time, size_t extra_size)
+{
+  const size_t max_amount_size = varint_size(std::numeric_limits<uint64_t>::max());
+  const size_t max_offset_size = varint_size(std::numeric_limits<uint32_t>::max());
+
+  size_t size = varint_size(CURRENT_TRANSACTION_VERSION) + varint_size(unlock_time);
+  // vin: variant tag, amount, key offsets, key image, and a ring signature per input
+  size += varint_size(inputs_count);
+  size += inputs_count * (1 + max_amount_size + varint_size(ring_size) + ring_size * max_offset_size + sizeof(crypto::key_image));
+  size += inputs_count * ring_size * sizeof(crypto::signature);
+  // vout: amount, variant tag, key
+  size += varint_size(outputs_count);
+  size += outputs_count * (max_amount_size + 1 + sizeof(crypto::public_key));
+  // extra: tx public key is prepended by construct_tx()
+  extra_size += 1 + sizeof(crypto::public_key);
+  size += varint_size(extra_size) + extra_size;
+  return size;
 }
 } // anonymous namespace
 
@@ -810,7 +919,7 @@ void wallet2::commit_tx(pending_tx& ptx)
   LOG_PRINT_L2("transaction " << get_transaction_hash(ptx.tx) << " generated ok and sent to daemon, key_images: [" << ptx.key_images << "]");
 
   BOOST_FOREACH(transfer_container::iterator it, ptx.selected_transfers)
-    it->m_spent = true;
+    set_transfer_spent(it - m_transfers.begin(), true);
 
   LOG_PRINT_L0("Transaction successfully sent. <" << get_transaction_hash(ptx.tx) << ">" << ENDL
             << "Commission: " << print_money(ptx.fee+ptx.dust) << " (dust: " << print_money(ptx.dust) << ")" << ENDL
@@ -827,91 +936,185 @@ void wallet2::commit_tx(std::vector<pending_tx>& ptx_vector)
   }
 }
 
+namespace detail
+{
 //----------------------------------------------------------------------------------------------------
-// separated the call(s) to wallet2::transfer into their own function
-//
-// this function will make multiple calls to wallet2::transfer if multiple
-// transactions will be required
-std::vector<wallet2::pending_tx> wallet2::create_transactions(std::vector<cryptonote::tx_destination_entry> dsts, const size_t fake_outs_count, const uint64_t unlock_time, const uint64_t fee, const std::vector<uint8_t> extra)
+// Destinations are packed into a transaction, together with inputs covering them, for as long as
+// its estimated size stays below tx_size_limit. A destination that does not fit into an empty
+// transaction is paid partially and the rest is carried over to the next one.
+std::vector<tx_plan> plan_transactions(const std::vector<cryptonote::tx_destination_entry>& dsts, std::vector<std::pair<size_t, uint64_t> > inputs_pool,
+  uint64_t fee, size_t ring_size, uint64_t unlock_time, size_t extra_size, uint64_t tx_size_limit)
 {
-
-  // failsafe split attempt counter
-  size_t attempt_count = 0;
-
-  for(attempt_count = 1; ;attempt_count++)
+  uint64_t needed_money = 0;
+  BOOST_FOREACH(auto& dt, dsts)
+    needed_money += dt.amount;
+  uint64_t available_money = 0;
+  BOOST_FOREACH(auto& input, inputs_pool)
+    available_money += input.second;
+
+  // same policy as transfer(): dust threshold is the fee
+  const uint64_t dust_threshold = fee;
+  auto fits = [&](size_t inputs_count, size_t outputs_count) {
+    return estimate_tx_size(inputs_count, ring_size, outputs_count, unlock_time, extra_size) < tx_size_limit;
+  };
+  auto change_outputs_count = [&](uint64_t change) { return digit_split_outputs_count(change, dust_threshold, false); };
+  auto take_input = [&](tx_plan& plan) {
+    plan.inputs.push_back(inputs_pool.back());
+    plan.found_money += inputs_pool.back().second;
+    inputs_pool.pop_back();
+  };
+  auto return_input = [&](tx_plan& plan) {
+    inputs_pool.push_back(plan.inputs.back());
+    plan.found_money -= plan.inputs.back().second;
+    plan.inputs.pop_back();
+  };
+
+  std::vector<tx_plan> plans;
+  std::deque<std::pair<size_t, cryptonote::tx_destination_entry> > pending_dsts;
+  for (size_t i = 0; i < dsts.size(); ++i)
+    pending_dsts.push_back(std::make_pair(i, dsts[i]));
+  while (!pending_dsts.empty())
   {
-    auto split_values = split_amounts(dsts, attempt_count);
+    plans.push_back(tx_plan());
+    tx_plan& plan = plans.back();
+    plan.found_money = 0;
+    plan.outputs_count = 0;
+    uint64_t tx_needed_money = fee;
 
-    // Throw if split_amounts comes back with a vector of size different than it should
-    if (split_values.size() != attempt_count)
+    while (!pending_dsts.empty())
     {
-      throw std::runtime_error("Splitting transactions returned a number of potential tx not equal to what was requested");
-    }
-
-    std::vector<pending_tx> ptx_vector;
-    try
-    {
-      // for each new destination vector (i.e. for each new tx)
-      for (auto & dst_vector : split_values)
+      cryptonote::tx_destination_entry& de = pending_dsts.front().second;
+      size_t inputs_count = plan.inputs.size();
+      while (plan.found_money < tx_needed_money + de.amount && !inputs_pool.empty())
+        take_input(plan);
+      THROW_WALLET_EXCEPTION_IF(plan.found_money < tx_needed_money + de.amount, error::not_enough_money, available_money, needed_money, fee * plans.size());
+
+      size_t outputs_count = plan.outputs_count + digit_split_outputs_count(de.amount, dust_threshold, true);
+      if (fits(plan.inputs.size(), outputs_count + change_outputs_count(plan.found_money - tx_needed_money - de.amount)))
       {
-        cryptonote::transaction tx;
-        pending_tx ptx;
-        transfer(dst_vector, fake_outs_count, unlock_time, fee, extra, tx, ptx);
-        ptx_vector.push_back(ptx);
-
-        // mark transfers to be used as "spent"
-        BOOST_FOREACH(transfer_container::iterator it, ptx.selected_transfers)
-          it->m_spent = true;
+        plan.dsts.push_back(de);
+        plan.dsts_indices.push_back(pending_dsts.front().first);
+        plan.outputs_count = outputs_count;
+        tx_needed_money += de.amount;
+        pending_dsts.pop_front();
+        continue;
       }
 
-      // if we made it this far, we've selected our transactions.  committing them will mark them spent,
-      // so this is a failsafe in case they don't go through
-      // unmark pending tx transfers as spent
-      for (auto & ptx : ptx_vector)
-      {
-        // mark transfers to be used as not spent
-        BOOST_FOREACH(transfer_container::iterator it2, ptx.selected_transfers)
-          it2->m_spent = false;
+      while (plan.inputs.size() > inputs_count)
+        return_input(plan);
+      if (!plan.dsts.empty())
+        break;
 
+      // destination doesn't fit into a transaction on its own: pay as much of it as fits
+      while (!inputs_pool.empty())
+      {
+        take_input(plan);
+        uint64_t part = std::min(plan.found_money > fee ? plan.found_money - fee : 0, de.amount);
+        if (!fits(plan.inputs.size(), digit_split_outputs_count(part, dust_threshold, true) + change_outputs_count(plan.found_money - fee - part)))
+        {
+          return_input(plan);
+          break;
+        }
       }
-
-      // if we made it this far, we're OK to actually send the transactions
-      return ptx_vector;
-
+      THROW_WALLET_EXCEPTION_IF(plan.found_money <= fee, error::tx_too_big, cryptonote::transaction(), tx_size_limit);
+      uint64_t part = std::min(plan.found_money - fee, de.amount);
+      plan.dsts.push_back(cryptonote::tx_destination_entry(part, de.addr));
+      plan.dsts_indices.push_back(pending_dsts.front().first);
+      if (part == de.amount)
+        pending_dsts.pop_front();
+      else
+        de.amount -= part;
+      break;
     }
-    // only catch this here, other exceptions need to pass through to the calling function
-    catch (const tools::error::tx_too_big& e)
-    {
+  }
+  return plans;
+}
+}
+//----------------------------------------------------------------------------------------------------
+// Plans all the transactions needed to pay dsts in one pass with detail::plan_transactions() from
+// randomly ordered inputs, and builds each of them once. Decoys for all planned inputs are requested
+// with a single getrandom_outs.bin call.
+std::vector<wallet2::pending_tx> wallet2::create_transactions(std::vector<cryptonote::tx_destination_entry> dsts, const size_t fake_outs_count, const uint64_t unlock_time, const uint64_t fee, const std::vector<uint8_t> extra)
+{
+  // throw if attempting a transaction with no destinations
+  THROW_WALLET_EXCEPTION_IF(dsts.empty(), error::zero_destination);
 
-      // unmark pending tx transfers as spent
-      for (auto & ptx : ptx_vector)
-      {
-        // mark transfers to be used as not spent
-        BOOST_FOREACH(transfer_container::iterator it2, ptx.selected_transfers)
-          it2->m_spent = false;
+  uint64_t needed_money = 0;
+  BOOST_FOREACH(auto& dt, dsts)
+  {
+    THROW_WALLET_EXCEPTION_IF(0 == dt.amount, error::zero_destination);
+    needed_money += dt.amount;
+    THROW_WALLET_EXCEPTION_IF(needed_money < dt.amount, error::tx_sum_overflow, dsts, fee);
+  }
 
-      }
+  // same policy as transfer(): dust threshold is the fee, dust inputs are used only
+  // after all other inputs, except for one taken first when mixing is not requested
+  const uint64_t dust_threshold = fee;
+  std::vector<std::pair<size_t, uint64_t> > unused_transfers;
+  std::vector<std::pair<size_t, uint64_t> > unused_dust;
+  update_unlocked_transfers();
+  auto dust_end = m_unlocked_transfers.upper_bound(std::make_pair(dust_threshold, std::numeric_limits<size_t>::max()));
+  for (auto it = m_unlocked_transfers.begin(); it != dust_end; ++it)
+    unused_dust.push_back(std::make_pair(it->second, it->first));
+  for (auto it = dust_end; it != m_unlocked_transfers.end(); ++it)
+    unused_transfers.push_back(std::make_pair(it->second, it->first));
+  std::mt19937_64 rng(crypto::rand<uint64_t>());
+  std::shuffle(unused_dust.begin(), unused_dust.end(), rng);
+  std::shuffle(unused_transfers.begin(), unused_transfers.end(), rng);
+
+  // inputs are taken from the back
+  std::vector<std::pair<size_t, uint64_t> > inputs_pool(unused_dust.begin(), unused_dust.end());
+  if (0 == fake_outs_count && !inputs_pool.empty())
+  {
+    std::pair<size_t, uint64_t> first_dust = inputs_pool.back();
+    inputs_pool.pop_back();
+    inputs_pool.insert(inputs_pool.end(), unused_transfers.begin(), unused_transfers.end());
+    inputs_pool.push_back(first_dust);
+  }
+  else
+  {
+    inputs_pool.insert(inputs_pool.end(), unused_transfers.begin(), unused_transfers.end());
+  }
 
-      if (attempt_count >= MAX_SPLIT_ATTEMPTS)
-      {
-        throw;
-      }
-    }
-    catch (...)
-    {
-      // in case of some other exception, make sure any tx in queue are marked unspent again
+  std::vector<detail::tx_plan> plans = detail::plan_transactions(dsts, std::move(inputs_pool), fee, fake_outs_count + 1, unlock_time, extra.size(), m_upper_transaction_size_limit);
+  LOG_PRINT_L1("Planned " << plans.size() << " transaction(s) for " << dsts.size() << " destination(s)");
 
-      // unmark pending tx transfers as spent
-      for (auto & ptx : ptx_vector)
-      {
-        // mark transfers to be used as not spent
-        BOOST_FOREACH(transfer_container::iterator it2, ptx.selected_transfers)
-          it2->m_spent = false;
+  std::vector<std::list<transfer_container::iterator> > selected_transfers(plans.size());
+  for (size_t i = 0; i < plans.size(); ++i)
+  {
+    BOOST_FOREACH(auto& input, plans[i].inputs)
+      selected_transfers[i].push_back(m_transfers.begin() + input.first);
+  }
 
-      }
+  std::vector<COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount> outs;
+  if (fake_outs_count)
+  {
+    std::list<transfer_container::iterator> all_selected_transfers;
+    BOOST_FOREACH(auto& transfers, selected_transfers)
+      all_selected_transfers.insert(all_selected_transfers.end(), transfers.begin(), transfers.end());
+    get_random_outs(all_selected_transfers, fake_outs_count, outs);
+  }
 
-      throw;
+  std::vector<pending_tx> ptx_vector;
+  size_t outs_offset = 0;
+  for (size_t i = 0; i < plans.size(); ++i)
+  {
+    const detail::tx_plan& plan = plans[i];
+    std::vector<COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount> tx_outs;
+    if (fake_outs_count)
+    {
+      tx_outs.assign(std::make_move_iterator(outs.begin() + outs_offset), std::make_move_iterator(outs.begin() + outs_offset + plan.inputs.size()));
+      outs_offset += plan.inputs.size();
     }
+
+    cryptonote::transaction tx;
+    pending_tx ptx;
+    construct_pending_tx(plan.dsts, selected_transfers[i], plan.found_money, tx_outs, fake_outs_count, unlock_time, fee, extra,
+      detail::digit_split_strategy, tx_dust_policy(fee), tx, ptx);
+    ptx.dsts_indices = plan.dsts_indices;
+    ptx_vector.push_back(ptx);
   }
+
+  return ptx_vector;
 }
 }
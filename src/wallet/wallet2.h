@@ -31,6 +31,7 @@
 #pragma once
 
 #include <memory>
+#include <set>
 #include <boost/serialization/list.hpp>
 #include <boost/serialization/vector.hpp>
 #include <atomic>
@@ -43,6 +44,7 @@
 #include "storages/http_abstract_invoke.h"
 #include "rpc/core_rpc_server_commands_defs.h"
 #include "cryptonote_core/cryptonote_format_utils.h"
+#include "common/flat_hash_map.h"
 #include "common/unordered_containers_boost_serialization.h"
 #include "crypto/chacha8.h"
 #include "crypto/hash.h"
@@ -79,9 +81,9 @@ namespace tools
 
   class wallet2
   {
-    wallet2(const wallet2&) : m_run(true), m_callback(0) {};
+    wallet2(const wallet2&) : m_balance_total(0), m_unlocked_balance_total(0), m_run(true), m_callback(0) {};
   public:
-    wallet2() : m_run(true), m_callback(0) {};
+    wallet2() : m_balance_total(0), m_unlocked_balance_total(0), m_run(true), m_callback(0) {};
     struct transfer_details
     {
       uint64_t m_block_height;
@@ -111,6 +113,8 @@ namespace tools
 
     typedef std::vector<transfer_details> transfer_container;
     typedef std::unordered_multimap<crypto::hash, payment_details> payment_container;
+    // (key, index in m_transfers) pairs, ordered by key
+    typedef std::set<std::pair<uint64_t, size_t> > transfer_index;
 
     struct pending_tx
     {
@@ -119,6 +123,7 @@ namespace tools
       cryptonote::tx_destination_entry change_dts;
       std::list<transfer_container::iterator> selected_transfers;
       std::string key_images;
+      std::vector<size_t> dsts_indices; // create_transactions() destinations paid (maybe partially) by this tx
     };
 
     struct keys_file_data
@@ -205,6 +210,17 @@ namespace tools
     bool clear();
     void pull_blocks(uint64_t start_height, size_t& blocks_added);
     uint64_t select_transfers(uint64_t needed_money, bool add_dust, uint64_t dust, std::list<transfer_container::iterator>& selected_transfers);
+    void get_random_outs(const std::list<transfer_container::iterator>& selected_transfers, size_t fake_outputs_count, std::vector<cryptonote::COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount>& outs);
+    template<typename T>
+    void construct_pending_tx(const std::vector<cryptonote::tx_destination_entry>& dsts, const std::list<transfer_container::iterator>& selected_transfers, uint64_t found_money,
+      std::vector<cryptonote::COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount>& outs, size_t fake_outputs_count, uint64_t unlock_time, uint64_t fee,
+      const std::vector<uint8_t>& extra, T destination_split_strategy, const tx_dust_policy& dust_policy, cryptonote::transaction& tx, pending_tx& ptx);
+    uint64_t get_transfer_unlock_height(const transfer_details& td) const;
+    void index_transfer(size_t idx);
+    void unindex_transfer(size_t idx);
+    void rebuild_transfer_index();
+    void update_unlocked_transfers();
+    void set_transfer_spent(size_t idx, bool spent);
     bool prepare_file_names(const std::string& file_path);
     void process_unconfirmed(const cryptonote::transaction& tx);
     void add_unconfirmed_tx(const cryptonote::transaction& tx, uint64_t change_amount);
@@ -220,7 +236,13 @@ namespace tools
 
     transfer_container m_transfers;
     payment_container m_payments;
-    std::unordered_map<crypto::key_image, size_t> m_key_images;
+    tools::flat_hash_map<crypto::key_image, size_t> m_key_images;
+    // unspent transfers only, not serialized: rebuilt from m_transfers on load and detach
+    transfer_index m_unlocked_transfers;      // by amount
+    transfer_index m_height_locked_transfers; // by blockchain size at which transfer becomes spendable
+    transfer_index m_time_locked_transfers;   // by timestamp at which unlock_time is reached
+    uint64_t m_balance_total;
+    uint64_t m_unlocked_balance_total;
     cryptonote::account_public_address m_account_public_address;
     uint64_t m_upper_transaction_size_limit; //TODO: auto-calc this value or request from daemon, now use some fixed value
 
@@ -271,6 +293,21 @@ namespace tools
   namespace detail
   {
     //----------------------------------------------------------------------------------------------------
+    // A transaction planned by wallet2::create_transactions(). Inputs are (transfer index, amount) pairs.
+    struct tx_plan
+    {
+      std::vector<cryptonote::tx_destination_entry> dsts;
+      std::vector<size_t> dsts_indices;
+      std::vector<std::pair<size_t, uint64_t> > inputs;
+      uint64_t found_money;
+      size_t outputs_count;
+    };
+
+    // Splits dsts into transactions smaller than tx_size_limit, taking inputs from the back of inputs_pool.
+    // Throws error::not_enough_money and error::tx_too_big.
+    std::vector<tx_plan> plan_transactions(const std::vector<cryptonote::tx_destination_entry>& dsts, std::vector<std::pair<size_t, uint64_t> > inputs_pool,
+      uint64_t fee, size_t ring_size, uint64_t unlock_time, size_t extra_size, uint64_t tx_size_limit);
+    //----------------------------------------------------------------------------------------------------
     inline void digit_split_strategy(const std::vector<cryptonote::tx_destination_entry>& dsts,
       const cryptonote::tx_destination_entry& change_dst, uint64_t dust_threshold,
       std::vector<cryptonote::tx_destination_entry>& splitted_dsts, uint64_t& dust)
@@ -365,40 +402,25 @@ namespace tools
     uint64_t found_money = select_transfers(needed_money, 0 == fake_outputs_count, dust_policy.dust_threshold, selected_transfers);
     THROW_WALLET_EXCEPTION_IF(found_money < needed_money, error::not_enough_money, found_money, needed_money - fee, fee);
 
-    typedef COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::out_entry out_entry;
-    typedef cryptonote::tx_source_entry::output_entry tx_output_entry;
-
-    COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::response daemon_resp = AUTO_VAL_INIT(daemon_resp);
+    std::vector<COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount> outs;
     if(fake_outputs_count)
-    {
-      COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::request req = AUTO_VAL_INIT(req);
-      req.outs_count = fake_outputs_count + 1;// add one to make possible (if need) to skip real output key
-      BOOST_FOREACH(transfer_container::iterator it, selected_transfers)
-      {
-        THROW_WALLET_EXCEPTION_IF(it->m_tx.vout.size() <= it->m_internal_output_index, error::wallet_internal_error,
-          "m_internal_output_index = " + std::to_string(it->m_internal_output_index) +
-          " is greater or equal to outputs count = " + std::to_string(it->m_tx.vout.size()));
-        req.amounts.push_back(it->amount());
-      }
+      get_random_outs(selected_transfers, fake_outputs_count, outs);
 
-      bool r = epee::net_utils::invoke_http_bin_remote_command2(m_daemon_address + "/getrandom_outs.bin", req, daemon_resp, m_http_client, 200000);
-      THROW_WALLET_EXCEPTION_IF(!r, error::no_connection_to_daemon, "getrandom_outs.bin");
-      THROW_WALLET_EXCEPTION_IF(daemon_resp.status == CORE_RPC_STATUS_BUSY, error::daemon_busy, "getrandom_outs.bin");
-      THROW_WALLET_EXCEPTION_IF(daemon_resp.status != CORE_RPC_STATUS_OK, error::get_random_outs_error, daemon_resp.status);
-      THROW_WALLET_EXCEPTION_IF(daemon_resp.outs.size() != selected_transfers.size(), error::wallet_internal_error,
-        "daemon returned wrong response for getrandom_outs.bin, wrong amounts count = " +
-        std::to_string(daemon_resp.outs.size()) + ", expected " +  std::to_string(selected_transfers.size()));
+    construct_pending_tx(dsts, selected_transfers, found_money, outs, fake_outputs_count, unlock_time, fee, extra, destination_split_strategy, dust_policy, tx, ptx);
+  }
 
-      std::vector<COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount> scanty_outs;
-      BOOST_FOREACH(COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount& amount_outs, daemon_resp.outs)
-      {
-        if (amount_outs.outs.size() < fake_outputs_count)
-        {
-          scanty_outs.push_back(amount_outs);
-        }
-      }
-      THROW_WALLET_EXCEPTION_IF(!scanty_outs.empty(), error::not_enough_outs_to_mix, scanty_outs, fake_outputs_count);
-    }
+  template<typename T>
+  void wallet2::construct_pending_tx(const std::vector<cryptonote::tx_destination_entry>& dsts, const std::list<transfer_container::iterator>& selected_transfers, uint64_t found_money,
+    std::vector<cryptonote::COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount>& outs, size_t fake_outputs_count, uint64_t unlock_time, uint64_t fee,
+    const std::vector<uint8_t>& extra, T destination_split_strategy, const tx_dust_policy& dust_policy, cryptonote::transaction& tx, pending_tx& ptx)
+  {
+    using namespace cryptonote;
+    typedef COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::out_entry out_entry;
+    typedef cryptonote::tx_source_entry::output_entry tx_output_entry;
+
+    uint64_t needed_money = fee;
+    BOOST_FOREACH(auto& dt, dsts)
+      needed_money += dt.amount;
 
     //prepare inputs
     size_t i = 0;
@@ -410,10 +432,10 @@ namespace tools
       transfer_details& td = *it;
       src.amount = td.amount();
       //paste mixin transaction
-      if(daemon_resp.outs.size())
+      if(outs.size())
       {
-        daemon_resp.outs[i].outs.sort([](const out_entry& a, const out_entry& b){return a.global_amount_index < b.global_amount_index;});
-        BOOST_FOREACH(out_entry& daemon_oe, daemon_resp.outs[i].outs)
+        outs[i].outs.sort([](const out_entry& a, const out_entry& b){return a.global_amount_index < b.global_amount_index;});
+        BOOST_FOREACH(out_entry& daemon_oe, outs[i].outs)
         {
           if(td.m_global_output_index == daemon_oe.global_amount_index)
             continue;
@@ -460,7 +482,8 @@ namespace tools
       splitted_dsts.push_back(cryptonote::tx_destination_entry(dust, dust_policy.addr_for_dust));
     }
 
-    bool r = cryptonote::construct_tx(m_account.get_keys(), sources, splitted_dsts, extra, tx, unlock_time);
+    // the wallet builds few, often multi-input, transactions: sign them on all hardware threads
+    bool r = cryptonote::construct_tx(m_account.get_keys(), sources, splitted_dsts, extra, tx, unlock_time, 0);
     THROW_WALLET_EXCEPTION_IF(!r, error::tx_not_constructed, sources, splitted_dsts, unlock_time);
     THROW_WALLET_EXCEPTION_IF(m_upper_transaction_size_limit <= get_object_blobsize(tx), error::tx_too_big, tx, m_upper_transaction_size_limit);
 
@@ -40,6 +40,14 @@ using namespace epee;
 #include "string_tools.h"
 #include "crypto/hash.h"
 
+namespace
+{
+  // finished batch transfer jobs kept around for get_batch_transfer_status
+  const size_t BATCH_TRANSFER_JOBS_KEPT = 16;
+  // background batch transfer jobs waiting for the worker
+  const size_t BATCH_TRANSFER_JOBS_QUEUED = 4;
+}
+
 namespace tools
 {
   //-----------------------------------------------------------------------------------
@@ -52,18 +60,28 @@ namespace tools
     command_line::add_arg(desc, arg_rpc_bind_port);
   }
   //------------------------------------------------------------------------------------------------------------------------------
-  wallet_rpc_server::wallet_rpc_server(wallet2& w):m_wallet(w)
+  wallet_rpc_server::wallet_rpc_server(wallet2& w):m_wallet(w), m_next_batch_job_id(1), m_batch_worker_stop(false)
   {}
   //------------------------------------------------------------------------------------------------------------------------------
+  wallet_rpc_server::~wallet_rpc_server()
+  {
+    stop_batch_worker();
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
   bool wallet_rpc_server::run()
   {
     m_net_server.add_idle_handler([this](){
-      m_wallet.refresh();
+      // skip the refresh while a batch transfer is being built and sent
+      boost::unique_lock<boost::mutex> lock(m_wallet_lock, boost::try_to_lock);
+      if (lock.owns_lock())
+        m_wallet.refresh();
       return true;
     }, 20000);
 
     //DO NOT START THIS SERVER IN MORE THEN 1 THREADS WITHOUT REFACTORING
-    return epee::http_server_impl_base<wallet_rpc_server, connection_context>::run(1, true);
+    bool r = epee::http_server_impl_base<wallet_rpc_server, connection_context>::run(1, true);
+    stop_batch_worker();
+    return r;
   }
   //------------------------------------------------------------------------------------------------------------------------------
   bool wallet_rpc_server::handle_command_line(const boost::program_options::variables_map& vm)
@@ -81,8 +99,24 @@ namespace tools
     return epee::http_server_impl_base<wallet_rpc_server, connection_context>::init(m_port, m_bind_ip);
   }
   //------------------------------------------------------------------------------------------------------------------------------
+  bool wallet_rpc_server::lock_wallet(boost::unique_lock<boost::mutex>& lock, epee::json_rpc::error& er)
+  {
+    lock = boost::unique_lock<boost::mutex>(m_wallet_lock, boost::try_to_lock);
+    if (!lock.owns_lock())
+    {
+      er.code = WALLET_RPC_ERROR_CODE_WALLET_BUSY;
+      er.message = "Wallet is busy with a batch transfer, try again later";
+      return false;
+    }
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
   bool wallet_rpc_server::on_getbalance(const wallet_rpc::COMMAND_RPC_GET_BALANCE::request& req, wallet_rpc::COMMAND_RPC_GET_BALANCE::response& res, epee::json_rpc::error& er, connection_context& cntx)
   {
+    boost::unique_lock<boost::mutex> lock;
+    if (!lock_wallet(lock, er))
+      return false;
+
     try
     {
       res.balance = m_wallet.balance();
@@ -169,6 +203,10 @@ namespace tools
       return false;
     }
 
+    boost::unique_lock<boost::mutex> lock;
+    if (!lock_wallet(lock, er))
+      return false;
+
     try
     {
       std::vector<wallet2::pending_tx> ptx_vector = m_wallet.create_transactions(dsts, req.mixin, req.unlock_time, req.fee, extra);
@@ -220,6 +258,10 @@ namespace tools
       return false;
     }
 
+    boost::unique_lock<boost::mutex> lock;
+    if (!lock_wallet(lock, er))
+      return false;
+
     try
     {
       std::vector<wallet2::pending_tx> ptx_vector = m_wallet.create_transactions(dsts, req.mixin, req.unlock_time, req.fee, extra);
@@ -255,8 +297,220 @@ namespace tools
     return true;
   }
   //------------------------------------------------------------------------------------------------------------------------------
+  // Builds all the transactions of the job with a single create_transactions() call and sends them,
+  // filling per destination results. Must be called with m_wallet_lock held.
+  void wallet_rpc_server::run_batch_transfer(const batch_transfer_job& job, wallet_rpc::batch_transfer_status& status)
+  {
+    auto fail_pending = [&](const std::string& error) {
+      for (auto& result : status.results)
+      {
+        if (result.status != "pending")
+          continue;
+        result.status = result.tx_hash_list.empty() ? "failed" : "partially_sent";
+        result.error = error;
+      }
+      status.status = "failed";
+      status.error = error;
+    };
+
+    if (job.dsts.empty())
+    {
+      fail_pending("No valid destinations");
+      return;
+    }
+
+    std::vector<wallet2::pending_tx> ptx_vector;
+    try
+    {
+      ptx_vector = m_wallet.create_transactions(job.dsts, job.mixin, job.unlock_time, job.fee, job.extra);
+    }
+    catch (const std::exception& e)
+    {
+      fail_pending(e.what());
+      return;
+    }
+
+    // a destination may be split over several transactions
+    std::vector<size_t> unsent_txs(job.dsts.size(), 0);
+    for (const auto& ptx : ptx_vector)
+    {
+      for (size_t i : ptx.dsts_indices)
+        ++unsent_txs[i];
+    }
+
+    for (auto& ptx : ptx_vector)
+    {
+      // stop at the first failure, the rest would most likely fail the same way
+      try
+      {
+        m_wallet.commit_tx(ptx);
+      }
+      catch (const std::exception& e)
+      {
+        fail_pending(e.what());
+        return;
+      }
+
+      std::string tx_hash = epee::string_tools::pod_to_hex(cryptonote::get_transaction_hash(ptx.tx));
+      status.tx_hash_list.push_back(tx_hash);
+      for (size_t i : ptx.dsts_indices)
+      {
+        wallet_rpc::batch_transfer_result& result = status.results[job.dsts_results[i]];
+        result.tx_hash_list.push_back(tx_hash);
+        if (0 == --unsent_txs[i])
+          result.status = "sent";
+      }
+    }
+    status.status = "done";
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  bool wallet_rpc_server::on_batch_transfer(const wallet_rpc::COMMAND_RPC_BATCH_TRANSFER::request& req, wallet_rpc::COMMAND_RPC_BATCH_TRANSFER::response& res, epee::json_rpc::error& er, connection_context& cntx)
+  {
+    std::shared_ptr<batch_transfer_job> job = std::make_shared<batch_transfer_job>();
+    job->fee = req.fee;
+    job->mixin = req.mixin;
+    job->unlock_time = req.unlock_time;
+
+    // only the payment id fails the whole batch, bad destinations are reported in their results
+    if (!validate_transfer(std::list<wallet_rpc::transfer_destination>(), req.payment_id, job->dsts, job->extra, er))
+    {
+      return false;
+    }
+
+    job->status.job_id = 0;
+    job->status.status = "queued";
+    job->status.results.reserve(req.destinations.size());
+    for (const auto& destination : req.destinations)
+    {
+      wallet_rpc::batch_transfer_result result = AUTO_VAL_INIT(result);
+      result.amount = destination.amount;
+      result.address = destination.address;
+      result.status = "pending";
+
+      cryptonote::tx_destination_entry de;
+      if (!get_account_address_from_str(de.addr, destination.address))
+      {
+        result.status = "invalid";
+        result.error = "Invalid address";
+      }
+      else if (0 == destination.amount)
+      {
+        result.status = "invalid";
+        result.error = "Zero amount";
+      }
+      else
+      {
+        de.amount = destination.amount;
+        job->dsts.push_back(de);
+        job->dsts_results.push_back(job->status.results.size());
+      }
+      job->status.results.push_back(result);
+    }
+
+    if (!req.background)
+    {
+      boost::unique_lock<boost::mutex> lock;
+      if (!lock_wallet(lock, er))
+        return false;
+
+      res = job->status;
+      res.status = "running";
+      run_batch_transfer(*job, res);
+      return true;
+    }
+
+    boost::lock_guard<boost::mutex> lock(m_batch_jobs_lock);
+    if (m_batch_queue.size() >= BATCH_TRANSFER_JOBS_QUEUED)
+    {
+      er.code = WALLET_RPC_ERROR_CODE_WALLET_BUSY;
+      er.message = "Too many batch transfers are queued";
+      return false;
+    }
+
+    job->status.job_id = m_next_batch_job_id++;
+    m_batch_jobs[job->status.job_id] = job;
+    while (m_batch_jobs.size() > BATCH_TRANSFER_JOBS_KEPT)
+      m_batch_jobs.erase(m_batch_jobs.begin());
+    res = job->status;
+
+    m_batch_queue.push_back(job);
+    if (!m_batch_worker.joinable())
+      m_batch_worker = boost::thread(&wallet_rpc_server::batch_worker, this);
+    m_batch_queue_cond.notify_one();
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  void wallet_rpc_server::batch_worker()
+  {
+    boost::unique_lock<boost::mutex> jobs_lock(m_batch_jobs_lock);
+    while (true)
+    {
+      while (!m_batch_worker_stop && m_batch_queue.empty())
+        m_batch_queue_cond.wait(jobs_lock);
+      if (m_batch_worker_stop)
+        break;
+
+      std::shared_ptr<batch_transfer_job> job = m_batch_queue.front();
+      m_batch_queue.pop_front();
+      job->status.status = "running";
+      wallet_rpc::batch_transfer_status status = job->status;
+      jobs_lock.unlock();
+
+      {
+        boost::unique_lock<boost::mutex> lock(m_wallet_lock);
+        run_batch_transfer(*job, status);
+      }
+      LOG_PRINT_L0("Batch transfer " << status.job_id << " " << status.status << ", " << status.tx_hash_list.size() << " transaction(s) sent");
+
+      jobs_lock.lock();
+      job->status = status;
+    }
+
+    // jobs left in the queue are never run
+    for (auto& job : m_batch_queue)
+    {
+      for (auto& result : job->status.results)
+      {
+        if (result.status == "pending")
+          result.status = "failed";
+      }
+      job->status.status = "failed";
+      job->status.error = "Wallet RPC server stopped";
+    }
+    m_batch_queue.clear();
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  void wallet_rpc_server::stop_batch_worker()
+  {
+    {
+      boost::lock_guard<boost::mutex> lock(m_batch_jobs_lock);
+      m_batch_worker_stop = true;
+      m_batch_queue_cond.notify_one();
+    }
+    if (m_batch_worker.joinable())
+      m_batch_worker.join();
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  bool wallet_rpc_server::on_get_batch_transfer_status(const wallet_rpc::COMMAND_RPC_GET_BATCH_TRANSFER_STATUS::request& req, wallet_rpc::COMMAND_RPC_GET_BATCH_TRANSFER_STATUS::response& res, epee::json_rpc::error& er, connection_context& cntx)
+  {
+    boost::lock_guard<boost::mutex> lock(m_batch_jobs_lock);
+    auto it = m_batch_jobs.find(req.job_id);
+    if (it == m_batch_jobs.end())
+    {
+      er.code = WALLET_RPC_ERROR_CODE_WRONG_JOB_ID;
+      er.message = "Unknown batch transfer job id";
+      return false;
+    }
+    res = it->second->status;
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
   bool wallet_rpc_server::on_store(const wallet_rpc::COMMAND_RPC_STORE::request& req, wallet_rpc::COMMAND_RPC_STORE::response& res, epee::json_rpc::error& er, connection_context& cntx)
   {
+    boost::unique_lock<boost::mutex> lock;
+    if (!lock_wallet(lock, er))
+      return false;
+
     try
     {
       m_wallet.store();
@@ -290,6 +544,10 @@ namespace tools
 
     payment_id = *reinterpret_cast<const crypto::hash*>(payment_id_blob.data());
 
+    boost::unique_lock<boost::mutex> lock;
+    if (!lock_wallet(lock, er))
+      return false;
+
     res.payments.clear();
     std::list<wallet2::payment_details> payment_list;
     m_wallet.get_payments(payment_id, payment_list);
@@ -309,6 +567,10 @@ namespace tools
   //------------------------------------------------------------------------------------------------------------------------------
   bool wallet_rpc_server::on_get_bulk_payments(const wallet_rpc::COMMAND_RPC_GET_BULK_PAYMENTS::request& req, wallet_rpc::COMMAND_RPC_GET_BULK_PAYMENTS::response& res, epee::json_rpc::error& er, connection_context& cntx)
   {
+    boost::unique_lock<boost::mutex> lock;
+    if (!lock_wallet(lock, er))
+      return false;
+
     res.payments.clear();
 
     for (auto & payment_id_str : req.payment_ids)
@@ -374,6 +636,10 @@ namespace tools
       available = false;
     }
 
+    boost::unique_lock<boost::mutex> lock;
+    if (!lock_wallet(lock, er))
+      return false;
+
     wallet2::transfer_container transfers;
     m_wallet.get_transfers(transfers);
 
@@ -32,6 +32,12 @@
 
 #include <boost/program_options/options_description.hpp>
 #include <boost/program_options/variables_map.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <deque>
+#include <map>
+#include <memory>
 #include "net/http_server_impl_base.h"
 #include "wallet_rpc_server_commands_defs.h"
 #include "wallet2.h"
@@ -47,6 +53,7 @@ namespace tools
     typedef epee::net_utils::connection_context_base connection_context;
 
     wallet_rpc_server(wallet2& cr);
+    ~wallet_rpc_server();
 
     const static command_line::arg_descriptor<std::string> arg_rpc_bind_port;
     const static command_line::arg_descriptor<std::string> arg_rpc_bind_ip;
@@ -65,6 +72,8 @@ namespace tools
         MAP_JON_RPC_WE("getaddress",         on_getaddress,         wallet_rpc::COMMAND_RPC_GET_ADDRESS)
         MAP_JON_RPC_WE("transfer",           on_transfer,           wallet_rpc::COMMAND_RPC_TRANSFER)
         MAP_JON_RPC_WE("transfer_split",     on_transfer_split,     wallet_rpc::COMMAND_RPC_TRANSFER_SPLIT)
+        MAP_JON_RPC_WE("batch_transfer",     on_batch_transfer,     wallet_rpc::COMMAND_RPC_BATCH_TRANSFER)
+        MAP_JON_RPC_WE("get_batch_transfer_status", on_get_batch_transfer_status, wallet_rpc::COMMAND_RPC_GET_BATCH_TRANSFER_STATUS)
         MAP_JON_RPC_WE("store",              on_store,              wallet_rpc::COMMAND_RPC_STORE)
         MAP_JON_RPC_WE("get_payments",       on_get_payments,       wallet_rpc::COMMAND_RPC_GET_PAYMENTS)
         MAP_JON_RPC_WE("get_bulk_payments",  on_get_bulk_payments,  wallet_rpc::COMMAND_RPC_GET_BULK_PAYMENTS)
@@ -79,6 +88,8 @@ namespace tools
       bool validate_transfer(const std::list<wallet_rpc::transfer_destination> destinations, const std::string payment_id, std::vector<cryptonote::tx_destination_entry>& dsts, std::vector<uint8_t>& extra, epee::json_rpc::error& er);
       bool on_transfer(const wallet_rpc::COMMAND_RPC_TRANSFER::request& req, wallet_rpc::COMMAND_RPC_TRANSFER::response& res, epee::json_rpc::error& er, connection_context& cntx);
       bool on_transfer_split(const wallet_rpc::COMMAND_RPC_TRANSFER_SPLIT::request& req, wallet_rpc::COMMAND_RPC_TRANSFER_SPLIT::response& res, epee::json_rpc::error& er, connection_context& cntx);
+      bool on_batch_transfer(const wallet_rpc::COMMAND_RPC_BATCH_TRANSFER::request& req, wallet_rpc::COMMAND_RPC_BATCH_TRANSFER::response& res, epee::json_rpc::error& er, connection_context& cntx);
+      bool on_get_batch_transfer_status(const wallet_rpc::COMMAND_RPC_GET_BATCH_TRANSFER_STATUS::request& req, wallet_rpc::COMMAND_RPC_GET_BATCH_TRANSFER_STATUS::response& res, epee::json_rpc::error& er, connection_context& cntx);
       bool on_store(const wallet_rpc::COMMAND_RPC_STORE::request& req, wallet_rpc::COMMAND_RPC_STORE::response& res, epee::json_rpc::error& er, connection_context& cntx);
       bool on_get_payments(const wallet_rpc::COMMAND_RPC_GET_PAYMENTS::request& req, wallet_rpc::COMMAND_RPC_GET_PAYMENTS::response& res, epee::json_rpc::error& er, connection_context& cntx);
       bool on_get_bulk_payments(const wallet_rpc::COMMAND_RPC_GET_BULK_PAYMENTS::request& req, wallet_rpc::COMMAND_RPC_GET_BULK_PAYMENTS::response& res, epee::json_rpc::error& er, connection_context& cntx);
@@ -86,11 +97,39 @@ namespace tools
 
       bool handle_command_line(const boost::program_options::variables_map& vm);
 
+      struct batch_transfer_job
+      {
+        std::vector<cryptonote::tx_destination_entry> dsts;
+        std::vector<size_t> dsts_results; // index in status.results of each dsts entry
+        std::vector<uint8_t> extra;
+        uint64_t fee;
+        uint64_t mixin;
+        uint64_t unlock_time;
+        wallet_rpc::batch_transfer_status status;
+      };
+
+      bool lock_wallet(boost::unique_lock<boost::mutex>& lock, epee::json_rpc::error& er);
+      void run_batch_transfer(const batch_transfer_job& job, wallet_rpc::batch_transfer_status& status);
+      void batch_worker();
+      void stop_batch_worker();
+
       //json rpc v2
       bool on_query_key(const wallet_rpc::COMMAND_RPC_QUERY_KEY::request& req, wallet_rpc::COMMAND_RPC_QUERY_KEY::response& res, epee::json_rpc::error& er, connection_context& cntx);
 
       wallet2& m_wallet;
       std::string m_port;
       std::string m_bind_ip;
+
+      // wallet2 is not thread safe: the server thread and the batch transfer worker
+      // touch m_wallet only with this lock held
+      boost::mutex m_wallet_lock;
+      boost::mutex m_batch_jobs_lock;
+      std::map<uint64_t, std::shared_ptr<batch_transfer_job> > m_batch_jobs;
+      uint64_t m_next_batch_job_id;
+      // background jobs are run in order by a single worker thread, started on the first one
+      std::deque<std::shared_ptr<batch_transfer_job> > m_batch_queue;
+      boost::condition_variable m_batch_queue_cond;
+      boost::thread m_batch_worker;
+      bool m_batch_worker_stop;
   };
 }
@@ -146,6 +146,78 @@ namespace wallet_rpc
     };
   };
 
+  struct batch_transfer_result
+  {
+    uint64_t amount;
+    std::string address;
+    std::string status;   // "sent", "partially_sent", "failed" or "invalid"; "pending" until the job is done
+    std::string error;
+    std::list<std::string> tx_hash_list;
+
+    BEGIN_KV_SERIALIZE_MAP()
+      KV_SERIALIZE(amount)
+      KV_SERIALIZE(address)
+      KV_SERIALIZE(status)
+      KV_SERIALIZE(error)
+      KV_SERIALIZE(tx_hash_list)
+    END_KV_SERIALIZE_MAP()
+  };
+
+  struct batch_transfer_status
+  {
+    uint64_t job_id;
+    std::string status;   // "queued", "running", "done" or "failed"
+    std::string error;
+    std::list<std::string> tx_hash_list;
+    std::vector<batch_transfer_result> results; // one per requested destination, in request order
+
+    BEGIN_KV_SERIALIZE_MAP()
+      KV_SERIALIZE(job_id)
+      KV_SERIALIZE(status)
+      KV_SERIALIZE(error)
+      KV_SERIALIZE(tx_hash_list)
+      KV_SERIALIZE(results)
+    END_KV_SERIALIZE_MAP()
+  };
+
+  struct COMMAND_RPC_BATCH_TRANSFER
+  {
+    struct request
+    {
+      std::list<transfer_destination> destinations;
+      uint64_t fee;
+      uint64_t mixin;
+      uint64_t unlock_time;
+      std::string payment_id;
+      bool background;
+
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE(destinations)
+        KV_SERIALIZE(fee)
+        KV_SERIALIZE(mixin)
+        KV_SERIALIZE(unlock_time)
+        KV_SERIALIZE(payment_id)
+        KV_SERIALIZE(background)
+      END_KV_SERIALIZE_MAP()
+    };
+
+    typedef batch_transfer_status response;
+  };
+
+  struct COMMAND_RPC_GET_BATCH_TRANSFER_STATUS
+  {
+    struct request
+    {
+      uint64_t job_id;
+
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE(job_id)
+      END_KV_SERIALIZE_MAP()
+    };
+
+    typedef batch_transfer_status response;
+  };
+
   struct COMMAND_RPC_STORE
   {
     struct request
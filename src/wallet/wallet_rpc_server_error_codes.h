@@ -37,3 +37,5 @@
 #define WALLET_RPC_ERROR_CODE_GENERIC_TRANSFER_ERROR  -4
 #define WALLET_RPC_ERROR_CODE_WRONG_PAYMENT_ID        -5
 #define WALLET_RPC_ERROR_CODE_TRANSFER_TYPE           -6
+#define WALLET_RPC_ERROR_CODE_WALLET_BUSY             -7
+#define WALLET_RPC_ERROR_CODE_WRONG_JOB_ID            -8
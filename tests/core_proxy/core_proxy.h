@@ -89,9 +89,11 @@ namespace tests
     bool init(const boost::program_options::variables_map& vm);
     bool deinit(){return true;}
     bool get_short_chain_history(std::list<crypto::hash>& ids);
+    bool prevalidate_block_ids(uint64_t start_height, const std::list<crypto::hash>& ids){return true;}
     bool get_stat_info(cryptonote::core_stat_info& st_inf){return true;}
     bool have_block(const crypto::hash& id);
     bool get_blockchain_top(uint64_t& height, crypto::hash& top_id);
+    uint64_t get_pruned_height(){return 0;}
     bool handle_incoming_tx(const cryptonote::blobdata& tx_blob, cryptonote::tx_verification_context& tvc, bool keeped_by_block);
     bool parse_incoming_blockblob(const cryptonote::blobdata& block_blob, cryptonote::block &b, cryptonote::block_verification_context& bvc);
     bool handle_incoming_block(const cryptonote::block& b, cryptonote::block_verification_context& bvc, bool update_miner_blocktemplate = true);
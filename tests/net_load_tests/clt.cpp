@@ -620,6 +620,60 @@ TEST_F(net_load_test_clt, permament_open_and_close_and_connections_closed_by_ser
   ASSERT_EQ(RESERVED_CONN_CNT, m_tcp_server.get_config_object().get_connections_count());
 }
 
+TEST_F(net_load_test_clt, relay_fan_out)
+{
+  static const size_t RELAY_CONN_COUNT = 50;
+  static const size_t RELAY_DATA_SIZE = 200 * 1024;
+  static const size_t RELAY_COUNT = 20;
+
+  // Open connections
+  t_connection_opener_1 connection_opener(m_tcp_server, RELAY_CONN_COUNT);
+  parallel_exec([&] {
+    while (connection_opener.open());
+  });
+
+  EXPECT_TRUE(busy_wait_for(DEFAULT_OPERATION_TIMEOUT, [&]{ return RELAY_CONN_COUNT + RESERVED_CONN_CNT <= m_commands_handler.new_connection_counter() + connection_opener.error_count(); }));
+  ASSERT_EQ(0, connection_opener.error_count());
+
+  // Wait for server accepts all connections
+  CMD_GET_STATISTICS::response srv_stat;
+  ASSERT_TRUE(busy_wait_for_server_statistics(srv_stat, [](const CMD_GET_STATISTICS::response& stat) { return RELAY_CONN_COUNT + RESERVED_CONN_CNT <= stat.opened_connections_count; }));
+
+  // Ask server to relay data to all connections but the command one
+  std::atomic<int> req_status(0);
+  CMD_RELAY_DATA::response relay_rsp;
+  CMD_RELAY_DATA::request req;
+  req.data_size = RELAY_DATA_SIZE;
+  req.relay_count = RELAY_COUNT;
+  auto start = std::chrono::steady_clock::now();
+  ASSERT_TRUE(epee::net_utils::async_invoke_remote_command2<CMD_RELAY_DATA::response>(m_cmd_conn_id, CMD_RELAY_DATA::ID, req,
+    m_tcp_server.get_config_object(), [&](int code, const CMD_RELAY_DATA::response& rsp, const test_connection_context&) {
+      if (0 < code)
+        relay_rsp = rsp;
+      req_status.store(0 < code ? 1 : -1, std::memory_order_seq_cst);
+  }));
+
+  EXPECT_TRUE(busy_wait_for(DEFAULT_OPERATION_TIMEOUT, [&]{ return 0 != req_status.load(std::memory_order_seq_cst); }));
+  ASSERT_EQ(1, req_status.load(std::memory_order_seq_cst));
+  ASSERT_EQ(RELAY_CONN_COUNT * RELAY_COUNT, relay_rsp.notified_count);
+
+  // Wait for all notifications to arrive
+  EXPECT_TRUE(busy_wait_for(DEFAULT_OPERATION_TIMEOUT, [&]{ return RELAY_CONN_COUNT * RELAY_COUNT <= m_commands_handler.notify_counter(); }, 1));
+  uint64_t elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+  ASSERT_EQ(RELAY_CONN_COUNT * RELAY_COUNT, m_commands_handler.notify_counter());
+
+  LOG_PRINT_L0("relay fan-out: " << RELAY_COUNT << " x " << RELAY_DATA_SIZE << " bytes to " << RELAY_CONN_COUNT <<
+    " connections, server queuing time " << relay_rsp.elapsed_us << " us (" << relay_rsp.elapsed_us / (RELAY_COUNT * RELAY_CONN_COUNT) <<
+    " us per notification), delivered in " << elapsed_us << " us");
+
+  // Close connections
+  for (size_t i = 0; i < RELAY_CONN_COUNT; ++i)
+    connection_opener.close(i);
+
+  EXPECT_TRUE(busy_wait_for(DEFAULT_OPERATION_TIMEOUT, [&]{ return m_commands_handler.new_connection_counter() - RESERVED_CONN_CNT <= m_commands_handler.close_connection_counter(); }));
+  ASSERT_EQ(RESERVED_CONN_CNT, m_tcp_server.get_config_object().get_connections_count());
+}
+
 int main(int argc, char** argv)
 {
   epee::debug::get_set_enable_assert(true, false);
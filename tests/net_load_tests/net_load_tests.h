@@ -75,7 +75,7 @@ namespace net_load_tests
 
     virtual int notify(int command, const std::string& in_buff, test_connection_context& context)
     {
-      //m_notify_counter.inc();
+      m_notify_counter.inc();
       //std::unique_lock<std::mutex> lock(m_mutex);
       //m_last_command = command;
       //m_last_in_buf = in_buff;
@@ -102,7 +102,7 @@ namespace net_load_tests
     }
 
     //size_t invoke_counter() const { return m_invoke_counter.get(); }
-    //size_t notify_counter() const { return m_notify_counter.get(); }
+    size_t notify_counter() const { return m_notify_counter.get(); }
     //size_t callback_counter() const { return m_callback_counter.get(); }
     size_t new_connection_counter() const { return m_new_connection_counter.get(); }
     size_t close_connection_counter() const { return m_close_connection_counter.get(); }
@@ -118,7 +118,7 @@ namespace net_load_tests
 
   protected:
     //unit_test::call_counter m_invoke_counter;
-    //unit_test::call_counter m_notify_counter;
+    unit_test::call_counter m_notify_counter;
     //unit_test::call_counter m_callback_counter;
     unit_test::call_counter m_new_connection_counter;
     unit_test::call_counter m_close_connection_counter;
@@ -218,7 +218,9 @@ namespace net_load_tests
     cmd_reset_statistics_id,
     cmd_shutdown_id,
     cmd_send_data_requests_id,
-    cmd_data_request_id
+    cmd_data_request_id,
+    cmd_relay_data_id,
+    cmd_relayed_data_id
   };
 
   struct CMD_CLOSE_ALL_CONNECTIONS
@@ -352,4 +354,31 @@ namespace net_load_tests
       END_KV_SERIALIZE_MAP()
     };
   };
+
+  struct CMD_RELAY_DATA
+  {
+    const static int ID = cmd_relay_data_id;
+
+    struct request
+    {
+      uint64_t data_size;
+      uint64_t relay_count;
+
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE(data_size)
+        KV_SERIALIZE(relay_count)
+      END_KV_SERIALIZE_MAP()
+    };
+
+    struct response
+    {
+      uint64_t notified_count;
+      uint64_t elapsed_us;
+
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE(notified_count)
+        KV_SERIALIZE(elapsed_us)
+      END_KV_SERIALIZE_MAP()
+    };
+  };
 }
@@ -28,6 +28,8 @@
 // 
 // Parts of this file are originally copyright (c) 2012-2013 The Cryptonote developers
 
+#include <chrono>
+#include <list>
 #include <mutex>
 #include <thread>
 
@@ -88,6 +90,7 @@ namespace
       HANDLE_INVOKE_T2(CMD_GET_STATISTICS, &srv_levin_commands_handler::handle_get_statistics)
       HANDLE_INVOKE_T2(CMD_RESET_STATISTICS, &srv_levin_commands_handler::handle_reset_statistics)
       HANDLE_INVOKE_T2(CMD_START_OPEN_CLOSE_TEST, &srv_levin_commands_handler::handle_start_open_close_test)
+      HANDLE_INVOKE_T2(CMD_RELAY_DATA, &srv_levin_commands_handler::handle_relay_data)
     END_INVOKE_MAP2()
 
     int handle_close_all_connections(int command, const CMD_CLOSE_ALL_CONNECTIONS::request& req, test_connection_context& context)
@@ -162,6 +165,36 @@ namespace
       return 1;
     }
 
+    int handle_relay_data(int /*command*/, const CMD_RELAY_DATA::request& req, CMD_RELAY_DATA::response& rsp, test_connection_context& context)
+    {
+      // Same fan-out as node_server::relay_notify_to_all(): the payload is copied once and
+      // its buffer is shared by the send queues of all notified connections
+      boost::uuids::uuid cmd_conn_id = context.m_connection_id;
+      rsp.notified_count = 0;
+
+      auto start = std::chrono::steady_clock::now();
+      for (uint64_t i = 0; i < req.relay_count; ++i)
+      {
+        std::list<boost::uuids::uuid> connections;
+        m_tcp_server.get_config_object().foreach_connection([&](test_connection_context& ctx) {
+          if (ctx.m_connection_id != cmd_conn_id)
+            connections.push_back(ctx.m_connection_id);
+          return true;
+        });
+
+        epee::net_utils::shared_buffer data = boost::make_shared<std::string>(req.data_size, 'x');
+        for (const auto& conn_id : connections)
+        {
+          if (0 < m_tcp_server.get_config_object().notify(cmd_relayed_data_id, data, conn_id))
+            ++rsp.notified_count;
+        }
+      }
+      rsp.elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+      LOG_PRINT_L0("Relayed " << req.relay_count << " x " << req.data_size << " bytes, " << rsp.notified_count << " notifications queued in " << rsp.elapsed_us << " us");
+      return 1;
+    }
+
   private:
     void close_connections(boost::uuids::uuid cmd_conn_id)
     {
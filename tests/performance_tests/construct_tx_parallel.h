@@ -0,0 +1,78 @@
+// Copyright (c) 2014, AEON, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this file are originally copyright (c) 2012-2013 The Cryptonote developers
+
+#pragma once
+
+#include "cryptonote_core/account.h"
+#include "cryptonote_core/cryptonote_basic.h"
+#include "cryptonote_core/cryptonote_format_utils.h"
+
+#include "multi_tx_test_base.h"
+
+template<size_t a_in_count, size_t a_ring_size, size_t a_signing_threads>
+class test_construct_tx_parallel : private multi_tx_test_base<a_ring_size>
+{
+  static_assert(0 < a_in_count, "in_count must be greater than 0");
+  static_assert(0 < a_signing_threads, "signing_threads must be greater than 0");
+
+public:
+  static const size_t loop_count = 10;
+  static const size_t in_count = a_in_count;
+  static const size_t ring_size = a_ring_size;
+  static const size_t signing_threads = a_signing_threads;
+
+  typedef multi_tx_test_base<a_ring_size> base_class;
+
+  bool init()
+  {
+    using namespace cryptonote;
+
+    if (!base_class::init())
+      return false;
+
+    // every input spends the same output, construct_tx doesn't check key images for duplicates
+    this->m_sources.resize(in_count, this->m_sources.front());
+
+    m_alice.generate();
+    m_destinations.push_back(tx_destination_entry(this->m_source_amount * in_count, m_alice.get_keys().m_account_address));
+
+    return true;
+  }
+
+  bool test()
+  {
+    return cryptonote::construct_tx(this->m_miners[this->real_source_idx].get_keys(), this->m_sources, m_destinations, std::vector<uint8_t>(), m_tx, 0, signing_threads);
+  }
+
+private:
+  cryptonote::account_base m_alice;
+  std::vector<cryptonote::tx_destination_entry> m_destinations;
+  cryptonote::transaction m_tx;
+};
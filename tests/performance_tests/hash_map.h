@@ -0,0 +1,147 @@
+// Copyright (c) 2014, AEON, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this file are originally copyright (c) 2012-2013 The Cryptonote developers
+
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+#include "common/flat_hash_map.h"
+#include "crypto/hash.h"
+
+namespace hash_map_test
+{
+  // Layout of the block id index of the blockchain storage
+  typedef std::unordered_map<crypto::hash, size_t> std_map;
+  typedef tools::flat_hash_map<crypto::hash, size_t> flat_map;
+
+  const size_t entries_count = 1 << 20;
+
+  inline std::vector<crypto::hash> make_keys(size_t count, uint64_t seed)
+  {
+    std::vector<crypto::hash> keys(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+      uint64_t v[2] = {seed, i};
+      crypto::cn_fast_hash(v, sizeof(v), keys[i]);
+    }
+    return keys;
+  }
+
+  inline size_t heap_in_use()
+  {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+    // large blocks are mapped apart from the heap arena
+    struct mallinfo2 mi = mallinfo2();
+    return mi.uordblks + mi.hblkhd;
+#else
+    return 0;
+#endif
+  }
+}
+
+template<class t_map>
+class test_hash_map_insert
+{
+public:
+  static const size_t loop_count = 10;
+
+  bool init()
+  {
+    m_keys = hash_map_test::make_keys(hash_map_test::entries_count, 0);
+
+    size_t heap_before = hash_map_test::heap_in_use();
+    {
+      t_map m;
+      fill(m);
+      size_t heap_after = hash_map_test::heap_in_use();
+      if (heap_after > heap_before)
+        std::cout << "Memory per entry: " << (heap_after - heap_before) / m.size() << " bytes" << std::endl;
+    }
+    return true;
+  }
+
+  bool test()
+  {
+    t_map m;
+    fill(m);
+    return m.size() == m_keys.size();
+  }
+
+private:
+  void fill(t_map& m) const
+  {
+    for (size_t i = 0; i < m_keys.size(); ++i)
+      m.insert(typename t_map::value_type(m_keys[i], i));
+  }
+
+  std::vector<crypto::hash> m_keys;
+};
+
+// Looks up every stored key and as many absent ones
+template<class t_map>
+class test_hash_map_find
+{
+public:
+  static const size_t loop_count = 10;
+
+  bool init()
+  {
+    m_keys = hash_map_test::make_keys(hash_map_test::entries_count, 0);
+    m_absent_keys = hash_map_test::make_keys(hash_map_test::entries_count, 1);
+    for (size_t i = 0; i < m_keys.size(); ++i)
+      m_map.insert(typename t_map::value_type(m_keys[i], i));
+    return true;
+  }
+
+  bool test()
+  {
+    for (size_t i = 0; i < m_keys.size(); ++i)
+    {
+      auto it = m_map.find(m_keys[i]);
+      if (it == m_map.end() || it->second != i)
+        return false;
+    }
+    for (size_t i = 0; i < m_absent_keys.size(); ++i)
+    {
+      if (m_map.find(m_absent_keys[i]) != m_map.end())
+        return false;
+    }
+    return true;
+  }
+
+private:
+  std::vector<crypto::hash> m_keys;
+  std::vector<crypto::hash> m_absent_keys;
+  t_map m_map;
+};
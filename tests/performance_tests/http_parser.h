@@ -0,0 +1,238 @@
+// Copyright (c) 2014, AEON, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this file are originally copyright (c) 2012-2013 The Cryptonote developers
+#pragma once
+
+#include <boost/regex.hpp>
+
+#include "include_base_utils.h"
+#include "net/http_protocol_handler.h"
+
+namespace http_parser_test
+{
+  // Typical wallet request, repeated back to back on one keep-alive connection
+  inline std::string make_requests(size_t count)
+  {
+    const std::string body(128, 'b');
+    std::string request =
+      "POST /getblocks.bin HTTP/1.1\r\n"
+      "Host: 127.0.0.1:18081\r\n"
+      "User-Agent: tycheclient/1.0\r\n"
+      "Accept: */*\r\n"
+      "Connection: keep-alive\r\n"
+      "Content-Type: application/octet-stream\r\n"
+      "Content-Length: " + std::to_string(body.size()) + "\r\n"
+      "\r\n" + body;
+
+    std::string requests;
+    for (size_t i = 0; i < count; ++i)
+      requests += request;
+    return requests;
+  }
+
+  struct null_endpoint : public epee::net_utils::i_service_endpoint
+  {
+    virtual bool do_send(const void* ptr, size_t cb) { m_sent += cb; return true; }
+    virtual bool close() { return true; }
+    virtual bool call_run_once_service_io() { return true; }
+    virtual bool request_callback() { return true; }
+    virtual boost::asio::io_service& get_io_service() { return m_io_service; }
+    virtual bool add_ref() { return true; }
+    virtual bool release() { return true; }
+
+    null_endpoint(): m_sent(0) {}
+
+    boost::asio::io_service m_io_service;
+    size_t m_sent;
+  };
+
+  class counting_handler : public epee::net_utils::http::simple_http_connection_handler<>
+  {
+  public:
+    counting_handler(epee::net_utils::i_service_endpoint* psnd_hndlr, config_type& config)
+      : epee::net_utils::http::simple_http_connection_handler<>(psnd_hndlr, config), m_requests(0)
+    {
+    }
+
+    virtual bool handle_request(const epee::net_utils::http::http_request_info& query_info, epee::net_utils::http::http_response_info& response)
+    {
+      ++m_requests;
+      response.m_response_code = 200;
+      response.m_response_comment = "OK";
+      return true;
+    }
+
+    size_t m_requests;
+  };
+
+  // Request parsing as the handler did it before the state machine parser,
+  // kept here as the baseline
+  class regex_parser
+  {
+  public:
+    regex_parser(): m_in_body(false), m_len_remain(0), m_requests(0) {}
+
+    bool handle_recv(const void* ptr, size_t cb)
+    {
+      std::string buf((const char*)ptr, cb);
+      m_cache += buf;
+
+      while (!m_cache.empty())
+      {
+        if (m_in_body)
+        {
+          size_t len = (std::min)(m_len_remain, m_cache.size());
+          m_body.append(m_cache, 0, len);
+          m_cache.erase(0, len);
+          m_len_remain -= len;
+          if (m_len_remain)
+            return true;
+          m_in_body = false;
+          ++m_requests;
+          continue;
+        }
+
+        size_t head_end = m_cache.find("\r\n\r\n");
+        if (std::string::npos == head_end)
+          return true;
+        head_end += 4;
+
+        static const boost::regex rexp_match_command_line("^(((OPTIONS)|(GET)|(HEAD)|(POST)|(PUT)|(DELETE)|(TRACE)) (\\S+) HTTP/(\\d+).(\\d+))\r?\n", boost::regex::icase | boost::regex::normal);
+        boost::smatch result;
+        if (!(boost::regex_search(m_cache, result, rexp_match_command_line, boost::match_default) && result[0].matched))
+          return false;
+        m_uri = result[10];
+        size_t line_len = result[0].length();
+
+        static const boost::regex rexp_match_uri("^([^?#]*)(\\?([^#]*))?(#(.*))?", boost::regex::icase | boost::regex::normal);
+        boost::smatch uri_result;
+        if (!boost::regex_search(m_uri, uri_result, rexp_match_uri, boost::match_default))
+          return false;
+
+        static const boost::regex rexp_mach_field(
+          "\n?((Connection)|(Referer)|(Content-Length)|(Content-Type)|(Transfer-Encoding)|(Content-Encoding)|(Host)|(Cookie)"
+          "|([\\w-]+?)) ?: ?((.*?)(\r?\n))[^\t ]",
+          boost::regex::icase | boost::regex::normal);
+        m_content_length.clear();
+        std::string::const_iterator it_current_bound = m_cache.begin() + line_len;
+        std::string::const_iterator it_end_bound = m_cache.begin() + head_end;
+        while (boost::regex_search(it_current_bound, it_end_bound, result, rexp_mach_field, boost::match_default) && result[0].matched)
+        {
+          if (result[4].matched)
+            m_content_length = result[12];
+          it_current_bound = result[(int)result.size() - 1].first;
+        }
+        m_cache.erase(0, head_end);
+
+        static const boost::regex rexp_match_digits("\\d+", boost::regex::normal);
+        if (!(boost::regex_search(m_content_length, result, rexp_match_digits, boost::match_default) && result[0].matched))
+          return false;
+        m_len_remain = boost::lexical_cast<size_t>(result[0]);
+        m_body.clear();
+        m_in_body = true;
+      }
+      return true;
+    }
+
+    size_t requests() const { return m_requests; }
+
+  private:
+    std::string m_cache;
+    std::string m_uri;
+    std::string m_content_length;
+    std::string m_body;
+    bool m_in_body;
+    size_t m_len_remain;
+    size_t m_requests;
+  };
+
+  const size_t requests_per_call = 10000;
+
+  template<class t_parser>
+  bool feed(t_parser& parser, const std::string& data, size_t read_size)
+  {
+    for (size_t pos = 0; pos < data.size(); pos += read_size)
+    {
+      if (!parser.handle_recv(data.data() + pos, (std::min)(read_size, data.size() - pos)))
+        return false;
+    }
+    return true;
+  }
+}
+
+// read_size is the number of bytes each socket read delivers
+template<size_t read_size>
+class test_http_parser
+{
+public:
+  static const size_t loop_count = 10;
+
+  bool init()
+  {
+    m_requests = http_parser_test::make_requests(http_parser_test::requests_per_call);
+    return true;
+  }
+
+  bool test()
+  {
+    http_parser_test::null_endpoint endpoint;
+    epee::net_utils::http::http_server_config config;
+    http_parser_test::counting_handler handler(&endpoint, config);
+    if (!http_parser_test::feed(handler, m_requests, read_size))
+      return false;
+    return http_parser_test::requests_per_call == handler.m_requests;
+  }
+
+private:
+  std::string m_requests;
+};
+
+template<size_t read_size>
+class test_http_parser_regex
+{
+public:
+  static const size_t loop_count = 10;
+
+  bool init()
+  {
+    m_requests = http_parser_test::make_requests(http_parser_test::requests_per_call);
+    return true;
+  }
+
+  bool test()
+  {
+    http_parser_test::regex_parser parser;
+    if (!http_parser_test::feed(parser, m_requests, read_size))
+      return false;
+    return http_parser_test::requests_per_call == parser.requests();
+  }
+
+private:
+  std::string m_requests;
+};
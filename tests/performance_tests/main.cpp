@@ -33,6 +33,7 @@
 
 // tests
 #include "construct_tx.h"
+#include "construct_tx_parallel.h"
 #include "check_ring_signature.h"
 #include "cn_slow_hash.h"
 #include "derive_public_key.h"
@@ -40,6 +41,8 @@
 #include "generate_key_derivation.h"
 #include "generate_key_image.h"
 #include "generate_key_image_helper.h"
+#include "hash_map.h"
+#include "http_parser.h"
 #include "is_out_to_acc.h"
 
 int main(int argc, char** argv)
@@ -85,6 +88,29 @@ int main(int argc, char** argv)
 
   TEST_PERFORMANCE0(test_cn_slow_hash);
 
+  TEST_PERFORMANCE1(test_http_parser, 16384);
+  TEST_PERFORMANCE1(test_http_parser, 1460);
+  TEST_PERFORMANCE1(test_http_parser, 64);
+  TEST_PERFORMANCE1(test_http_parser_regex, 16384);
+  TEST_PERFORMANCE1(test_http_parser_regex, 1460);
+  TEST_PERFORMANCE1(test_http_parser_regex, 64);
+
+  TEST_PERFORMANCE1(test_hash_map_insert, hash_map_test::std_map);
+  TEST_PERFORMANCE1(test_hash_map_insert, hash_map_test::flat_map);
+  TEST_PERFORMANCE1(test_hash_map_find, hash_map_test::std_map);
+  TEST_PERFORMANCE1(test_hash_map_find, hash_map_test::flat_map);
+
+  // signing threads inherit affinity of the thread which creates them
+  reset_process_affinity();
+
+  TEST_PERFORMANCE3(test_construct_tx_parallel, 10, 11, 1);
+  TEST_PERFORMANCE3(test_construct_tx_parallel, 10, 11, 2);
+  TEST_PERFORMANCE3(test_construct_tx_parallel, 10, 11, 4);
+  TEST_PERFORMANCE3(test_construct_tx_parallel, 50, 11, 1);
+  TEST_PERFORMANCE3(test_construct_tx_parallel, 50, 11, 2);
+  TEST_PERFORMANCE3(test_construct_tx_parallel, 50, 11, 4);
+  TEST_PERFORMANCE3(test_construct_tx_parallel, 50, 11, 8);
+
   std::cout << "Tests finished. Elapsed time: " << timer.elapsed_ms() / 1000 << " sec" << std::endl;
 
   return 0;
@@ -60,6 +60,32 @@ void set_process_affinity(int core)
 #endif
 }
 
+// Allows the calling thread, and threads it creates afterwards, to run on any core
+void reset_process_affinity()
+{
+#if defined (__APPLE__)
+    return;
+#elif defined(BOOST_WINDOWS)
+  DWORD_PTR process_mask = 0;
+  DWORD_PTR system_mask = 0;
+  if (::GetProcessAffinityMask(::GetCurrentProcess(), &process_mask, &system_mask))
+  {
+    ::SetProcessAffinityMask(::GetCurrentProcess(), system_mask);
+  }
+#elif defined(BOOST_HAS_PTHREADS)
+  cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  for (int i = 0; i < CPU_SETSIZE; ++i)
+  {
+    CPU_SET(i, &cpuset);
+  }
+  if (0 != ::pthread_setaffinity_np(::pthread_self(), sizeof(cpuset), &cpuset))
+  {
+    std::cout << "pthread_setaffinity_np - ERROR" << std::endl;
+  }
+#endif
+}
+
 void set_thread_high_priority()
 {
 #if defined(__APPLE__)
@@ -0,0 +1,182 @@
+// Copyright (c) 2014, AEON, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this file are originally copyright (c) 2012-2013 The Cryptonote developers
+
+
+#include "gtest/gtest.h"
+
+#include <boost/filesystem.hpp>
+
+#include "blockchain_utilities/bootstrap_file.h"
+
+using namespace cryptonote;
+
+namespace
+{
+  class bootstrap_file : public ::testing::Test
+  {
+  protected:
+    virtual void SetUp()
+    {
+      m_path = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()).string();
+    }
+
+    virtual void TearDown()
+    {
+      boost::system::error_code ec;
+      boost::filesystem::remove(m_path, ec);
+    }
+
+    static bootstrap_chunk make_chunk(uint64_t start_height, size_t count)
+    {
+      bootstrap_chunk chunk = AUTO_VAL_INIT(chunk);
+      chunk.start_height = start_height;
+      for (size_t i = 0; i < count; ++i)
+      {
+        block_complete_entry entry;
+        entry.block = "block " + std::to_string(start_height + i);
+        for (size_t j = 0; j < i % 3; ++j)
+          entry.txs.push_back("tx " + std::to_string(j) + " of block " + std::to_string(start_height + i));
+        chunk.blocks.push_back(entry);
+      }
+      return chunk;
+    }
+
+    void write_chunks(const std::vector<bootstrap_chunk>& chunks)
+    {
+      bootstrap_file_writer writer;
+      ASSERT_TRUE(writer.open(m_path));
+      for (bootstrap_chunk chunk : chunks)
+        ASSERT_TRUE(writer.write_chunk(chunk));
+      ASSERT_TRUE(writer.close());
+    }
+
+    static void check_chunk(const bootstrap_chunk& expected, const bootstrap_chunk& chunk)
+    {
+      ASSERT_EQ(expected.start_height, chunk.start_height);
+      ASSERT_EQ(expected.blocks.size(), chunk.blocks.size());
+      for (size_t i = 0; i < expected.blocks.size(); ++i)
+      {
+        ASSERT_EQ(expected.blocks[i].block, chunk.blocks[i].block);
+        ASSERT_EQ(expected.blocks[i].txs, chunk.blocks[i].txs);
+      }
+    }
+
+    std::string m_path;
+  };
+}
+
+TEST_F(bootstrap_file, round_trip)
+{
+  std::vector<bootstrap_chunk> chunks;
+  chunks.push_back(make_chunk(0, BOOTSTRAP_BLOCKS_PER_CHUNK));
+  chunks.push_back(make_chunk(BOOTSTRAP_BLOCKS_PER_CHUNK, BOOTSTRAP_BLOCKS_PER_CHUNK));
+  chunks.push_back(make_chunk(2 * BOOTSTRAP_BLOCKS_PER_CHUNK, 7));
+  write_chunks(chunks);
+
+  bootstrap_file_reader reader;
+  ASSERT_TRUE(reader.open(m_path));
+  ASSERT_EQ(boost::filesystem::file_size(m_path), reader.get_file_size());
+  bootstrap_chunk chunk;
+  for (const bootstrap_chunk& expected : chunks)
+  {
+    ASSERT_TRUE(reader.read_chunk(chunk));
+    check_chunk(expected, chunk);
+  }
+
+  // end of file
+  ASSERT_TRUE(reader.read_chunk(chunk));
+  ASSERT_TRUE(chunk.blocks.empty());
+}
+
+TEST_F(bootstrap_file, empty_file_has_no_chunks)
+{
+  write_chunks(std::vector<bootstrap_chunk>());
+
+  bootstrap_file_reader reader;
+  ASSERT_TRUE(reader.open(m_path));
+  bootstrap_chunk chunk;
+  ASSERT_TRUE(reader.read_chunk(chunk));
+  ASSERT_TRUE(chunk.blocks.empty());
+}
+
+TEST_F(bootstrap_file, truncated_final_chunk_is_an_error)
+{
+  std::vector<bootstrap_chunk> chunks;
+  chunks.push_back(make_chunk(0, BOOTSTRAP_BLOCKS_PER_CHUNK));
+  chunks.push_back(make_chunk(BOOTSTRAP_BLOCKS_PER_CHUNK, 10));
+  write_chunks(chunks);
+  boost::filesystem::resize_file(m_path, boost::filesystem::file_size(m_path) - 5);
+
+  bootstrap_file_reader reader;
+  ASSERT_TRUE(reader.open(m_path));
+  bootstrap_chunk chunk;
+  ASSERT_TRUE(reader.read_chunk(chunk));
+  check_chunk(chunks[0], chunk);
+  ASSERT_FALSE(reader.read_chunk(chunk));
+}
+
+TEST_F(bootstrap_file, truncated_chunk_size_is_an_error)
+{
+  std::vector<bootstrap_chunk> chunks;
+  chunks.push_back(make_chunk(0, 10));
+  write_chunks(chunks);
+  uint64_t first_chunk_end = boost::filesystem::file_size(m_path);
+  chunks.push_back(make_chunk(10, 10));
+  write_chunks(chunks);
+  // keeps 2 of the 4 bytes of the size of the second chunk
+  boost::filesystem::resize_file(m_path, first_chunk_end + 2);
+
+  bootstrap_file_reader reader;
+  ASSERT_TRUE(reader.open(m_path));
+  bootstrap_chunk chunk;
+  ASSERT_TRUE(reader.read_chunk(chunk));
+  check_chunk(chunks[0], chunk);
+  ASSERT_FALSE(reader.read_chunk(chunk));
+}
+
+TEST_F(bootstrap_file, rejects_wrong_signature)
+{
+  {
+    std::ofstream file(m_path, std::ios::binary);
+    file << "NOTABLKS" << std::string(4, '\0');
+  }
+  bootstrap_file_reader reader;
+  ASSERT_FALSE(reader.open(m_path));
+}
+
+TEST_F(bootstrap_file, rejects_truncated_header)
+{
+  {
+    std::ofstream file(m_path, std::ios::binary);
+    file << BOOTSTRAP_FILE_SIGNATURE;
+  }
+  bootstrap_file_reader reader;
+  ASSERT_FALSE(reader.open(m_path));
+}
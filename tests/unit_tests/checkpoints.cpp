@@ -164,3 +164,58 @@ TEST(checkpoints_is_alternative_block_allowed, handles_two_and_more_checkpoints)
   ASSERT_TRUE (cp.is_alternative_block_allowed(11, 10));
   ASSERT_TRUE (cp.is_alternative_block_allowed(11, 11));
 }
+
+namespace
+{
+  std::vector<crypto::hash> make_block_ids(size_t count)
+  {
+    std::vector<crypto::hash> ids(count);
+    for(size_t i = 0; i != count; ++i)
+      ids[i] = crypto::cn_fast_hash(&i, sizeof(i));
+    return ids;
+  }
+}
+
+TEST(checkpoint_hashes, blob_round_trip)
+{
+  std::vector<crypto::hash> group_hashes = make_block_ids(3);
+  std::string blob = make_checkpoint_hashes_blob(group_hashes);
+  ASSERT_EQ(8 + 3 * sizeof(crypto::hash), blob.size());
+
+  std::vector<crypto::hash> parsed;
+  ASSERT_TRUE(parse_checkpoint_hashes_blob(blob, parsed));
+  ASSERT_EQ(group_hashes, parsed);
+
+  ASSERT_FALSE(parse_checkpoint_hashes_blob(blob.substr(0, blob.size() - 1), parsed));
+  ASSERT_FALSE(parse_checkpoint_hashes_blob(blob.substr(0, 4), parsed));
+  blob[0] ^= 1;
+  ASSERT_FALSE(parse_checkpoint_hashes_blob(blob, parsed));
+}
+
+TEST(checkpoint_hashes, checks_groups_of_block_ids)
+{
+  std::vector<crypto::hash> ids = make_block_ids(2 * CHECKPOINT_HASHES_GROUP_SIZE);
+  checkpoints cp;
+  cp.set_group_hashes(std::vector<crypto::hash>(1, get_block_ids_group_hash(ids.data(), CHECKPOINT_HASHES_GROUP_SIZE)));
+  ASSERT_EQ(CHECKPOINT_HASHES_GROUP_SIZE, cp.get_hashes_height());
+
+  ASSERT_TRUE(cp.check_group(0, ids.data()));
+  //no hash for the second group
+  ASSERT_TRUE(cp.check_group(CHECKPOINT_HASHES_GROUP_SIZE, ids.data() + CHECKPOINT_HASHES_GROUP_SIZE));
+  ASSERT_FALSE(cp.check_group(1, ids.data() + 1));
+
+  ids[CHECKPOINT_HASHES_GROUP_SIZE - 1] = ids[0];
+  ASSERT_FALSE(cp.check_group(0, ids.data()));
+}
+
+TEST(checkpoint_hashes, limit_alternative_blocks)
+{
+  std::vector<crypto::hash> ids = make_block_ids(CHECKPOINT_HASHES_GROUP_SIZE);
+  checkpoints cp;
+  cp.set_group_hashes(std::vector<crypto::hash>(1, get_block_ids_group_hash(ids.data(), CHECKPOINT_HASHES_GROUP_SIZE)));
+
+  ASSERT_TRUE (cp.is_alternative_block_allowed(CHECKPOINT_HASHES_GROUP_SIZE - 2, 5));
+  ASSERT_FALSE(cp.is_alternative_block_allowed(CHECKPOINT_HASHES_GROUP_SIZE - 1, 5));
+  ASSERT_FALSE(cp.is_alternative_block_allowed(CHECKPOINT_HASHES_GROUP_SIZE + 10, CHECKPOINT_HASHES_GROUP_SIZE - 1));
+  ASSERT_TRUE (cp.is_alternative_block_allowed(CHECKPOINT_HASHES_GROUP_SIZE + 10, CHECKPOINT_HASHES_GROUP_SIZE));
+}
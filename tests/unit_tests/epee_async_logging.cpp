@@ -0,0 +1,277 @@
+// Copyright (c) 2014, AEON, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this file are originally copyright (c) 2012-2013 The Cryptonote developers
+
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "include_base_utils.h"
+#include "lockfree_ring_buffer.h"
+
+using namespace epee;
+
+namespace
+{
+  //collects what the logger writes, optionally holding the writer until released
+  struct capture_stream : public log_space::ibase_log_stream
+  {
+    capture_stream(): m_blocked(false), m_writes(0) {}
+
+    virtual bool out_buffer(const char* buffer, int buffer_len, int /*log_level*/, int /*color*/, const char* /*plog_name*/ = NULL)
+    {
+      std::unique_lock<std::mutex> lock(m_lock);
+      ++m_writes;
+      m_cond.wait(lock, [this](){ return !m_blocked; });
+      m_text.append(buffer, buffer_len);
+      return true;
+    }
+    virtual int get_type(){return LOGGER_NULL;}
+
+    void block(bool v)
+    {
+      std::lock_guard<std::mutex> lock(m_lock);
+      m_blocked = v;
+      m_cond.notify_all();
+    }
+
+    std::string text()
+    {
+      std::lock_guard<std::mutex> lock(m_lock);
+      return m_text;
+    }
+
+    size_t writes()
+    {
+      std::lock_guard<std::mutex> lock(m_lock);
+      return m_writes;
+    }
+
+    std::mutex m_lock;
+    std::condition_variable m_cond;
+    bool m_blocked;
+    size_t m_writes;
+    std::string m_text;
+  };
+
+  std::vector<std::string> split_lines(const std::string& text)
+  {
+    std::vector<std::string> lines;
+    std::istringstream ss(text);
+    std::string line;
+    while (std::getline(ss, line))
+      lines.push_back(line);
+    return lines;
+  }
+}
+
+TEST(lockfree_ring_buffer, rounds_capacity_up_to_power_of_two)
+{
+  ASSERT_EQ(2, lockfree_ring_buffer<int>(0).capacity());
+  ASSERT_EQ(8, lockfree_ring_buffer<int>(5).capacity());
+  ASSERT_EQ(16, lockfree_ring_buffer<int>(16).capacity());
+}
+
+TEST(lockfree_ring_buffer, keeps_order_and_rejects_when_full)
+{
+  lockfree_ring_buffer<std::string> queue(4);
+  for (int i = 0; i < 4; ++i)
+    ASSERT_TRUE(queue.try_push(std::to_string(i)));
+
+  std::string extra = "extra";
+  ASSERT_FALSE(queue.try_push(std::move(extra)));
+  ASSERT_EQ("extra", extra);
+  ASSERT_EQ(4, queue.size_approx());
+
+  // Wrap around a few times
+  for (int i = 4; i < 20; ++i)
+  {
+    std::string v;
+    ASSERT_TRUE(queue.try_pop(v));
+    ASSERT_EQ(std::to_string(i - 4), v);
+    ASSERT_TRUE(queue.try_push(std::to_string(i)));
+  }
+
+  std::string v;
+  for (int i = 16; i < 20; ++i)
+  {
+    ASSERT_TRUE(queue.try_pop(v));
+    ASSERT_EQ(std::to_string(i), v);
+  }
+  ASSERT_FALSE(queue.try_pop(v));
+  ASSERT_TRUE(queue.empty_approx());
+}
+
+TEST(lockfree_ring_buffer, delivers_everything_from_many_producers)
+{
+  const size_t producers = 4;
+  const size_t per_producer = 20000;
+  lockfree_ring_buffer<uint64_t> queue(64);
+
+  std::vector<std::thread> threads;
+  for (size_t p = 0; p < producers; ++p)
+  {
+    threads.push_back(std::thread([&queue, p, per_producer]()
+    {
+      for (uint64_t i = 0; i < per_producer; ++i)
+      {
+        while (!queue.try_push((p << 32) | i))
+          std::this_thread::yield();
+      }
+    }));
+  }
+
+  std::vector<uint64_t> next(producers, 0);
+  size_t received = 0;
+  while (received < producers * per_producer)
+  {
+    uint64_t v;
+    if (!queue.try_pop(v))
+    {
+      std::this_thread::yield();
+      continue;
+    }
+    size_t p = v >> 32;
+    ASSERT_LT(p, producers);
+    // Each producer's values come out in the order they went in
+    ASSERT_EQ(next[p], v & 0xffffffff);
+    ++next[p];
+    ++received;
+  }
+
+  for (auto& t : threads)
+    t.join();
+  uint64_t v;
+  ASSERT_FALSE(queue.try_pop(v));
+}
+
+TEST(log_message_stream, resets_formatting_between_messages)
+{
+  {
+    log_space::log_message_stream s;
+    s.stream() << std::hex << std::setfill('0') << std::setw(4) << 255;
+    ASSERT_EQ("00ff", s.str());
+  }
+  log_space::log_message_stream s;
+  s.stream() << 255;
+  ASSERT_EQ("255", s.str());
+}
+
+TEST(log_message_stream, nested_messages_get_own_buffers)
+{
+  log_space::log_message_stream outer;
+  outer.stream() << "outer ";
+  {
+    log_space::log_message_stream inner;
+    inner.stream() << "inner";
+    ASSERT_EQ("inner", inner.str());
+  }
+  outer.stream() << "done";
+  ASSERT_EQ("outer done", outer.str());
+}
+
+TEST(async_logger, writes_all_messages_in_per_thread_order)
+{
+  const int threads_count = 4;
+  const int per_thread = 2000;
+
+  log_space::logger log;
+  capture_stream* pstream = new capture_stream();
+  log.add_logger(pstream, LOG_LEVEL_4);
+  ASSERT_TRUE(log.start_async(128));
+  ASSERT_TRUE(log.is_async());
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < threads_count; ++t)
+  {
+    threads.push_back(std::thread([&log, t, per_thread]()
+    {
+      for (int i = 0; i < per_thread; ++i)
+      {
+        // Level 0 is never dropped
+        log.do_log_message(std::to_string(t) + " " + std::to_string(i) + "\n", LOG_LEVEL_0, log_space::console_color_default);
+      }
+    }));
+  }
+  for (auto& t : threads)
+    t.join();
+  ASSERT_TRUE(log.stop_async());
+  ASSERT_FALSE(log.is_async());
+
+  std::vector<std::string> lines = split_lines(pstream->text());
+  ASSERT_EQ(threads_count * per_thread, lines.size());
+  std::vector<int> next(threads_count, 0);
+  for (const auto& line : lines)
+  {
+    size_t space = line.find(' ');
+    int t = std::stoi(line.substr(0, space));
+    ASSERT_LT(t, threads_count);
+    // Level 0 producers wait for room instead of writing past the queue, so order holds
+    ASSERT_EQ(next[t], std::stoi(line.substr(space + 1)));
+    ++next[t];
+  }
+  for (int t = 0; t < threads_count; ++t)
+    ASSERT_EQ(per_thread, next[t]);
+
+  // Batching joins neighbour messages into one write
+  ASSERT_LT(pstream->writes(), lines.size());
+}
+
+TEST(async_logger, drops_low_priority_messages_when_queue_is_full)
+{
+  log_space::logger log;
+  capture_stream* pstream = new capture_stream();
+  log.add_logger(pstream, LOG_LEVEL_4);
+  ASSERT_TRUE(log.start_async(8));
+
+  // Hold the writer in the stream so nothing leaves the queue
+  pstream->block(true);
+  ASSERT_TRUE(log.do_log_message("first\n", LOG_LEVEL_1, log_space::console_color_default));
+  while (pstream->writes() == 0)
+    std::this_thread::yield();
+
+  size_t accepted = 0;
+  while (log.do_log_message("message\n", LOG_LEVEL_1, log_space::console_color_default))
+    ++accepted;
+  ASSERT_EQ(8, accepted);
+  ASSERT_FALSE(log.do_log_message("message\n", LOG_LEVEL_2, log_space::console_color_default));
+  ASSERT_EQ(2, log.get_dropped_count());
+
+  pstream->block(false);
+  ASSERT_TRUE(log.stop_async());
+
+  std::string text = pstream->text();
+  ASSERT_NE(std::string::npos, text.find("2 log messages dropped"));
+  ASSERT_EQ(1 + 8 + 1, split_lines(text).size());
+}
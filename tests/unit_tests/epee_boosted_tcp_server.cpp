@@ -81,6 +81,60 @@ namespace
   };
 
   typedef epee::net_utils::boosted_tcp_server<test_protocol_handler> test_tcp_server;
+
+  // tells the test when the connection received data and when it is destroyed
+  struct throttled_protocol_handler_config
+  {
+    std::mutex m_lock;
+    std::condition_variable m_cond;
+    epee::net_utils::i_service_endpoint* m_endpoint = nullptr;
+    bool m_destroyed = false;
+  };
+
+  struct throttled_protocol_handler
+  {
+    typedef test_connection_context connection_context;
+    typedef throttled_protocol_handler_config config_type;
+
+    throttled_protocol_handler(epee::net_utils::i_service_endpoint* psnd_hndlr, config_type& config, connection_context& /*conn_context*/)
+      : m_endpoint(psnd_hndlr)
+      , m_config(config)
+    {
+    }
+
+    ~throttled_protocol_handler()
+    {
+      std::unique_lock<std::mutex> lock(m_config.m_lock);
+      m_config.m_destroyed = true;
+      m_config.m_cond.notify_all();
+    }
+
+    void after_init_connection()
+    {
+    }
+
+    void handle_qued_callback()
+    {
+    }
+
+    bool release_protocol()
+    {
+      return true;
+    }
+
+    bool handle_recv(const void* /*data*/, size_t /*size*/)
+    {
+      std::unique_lock<std::mutex> lock(m_config.m_lock);
+      m_config.m_endpoint = m_endpoint;
+      m_config.m_cond.notify_all();
+      return true;
+    }
+
+    epee::net_utils::i_service_endpoint* m_endpoint;
+    config_type& m_config;
+  };
+
+  typedef epee::net_utils::boosted_tcp_server<throttled_protocol_handler> throttled_tcp_server;
 }
 
 TEST(boosted_tcp_server, worker_threads_are_exception_resistant)
@@ -133,3 +187,37 @@ TEST(boosted_tcp_server, worker_threads_are_exception_resistant)
   ASSERT_TRUE(srv.timed_wait_server_stop(5 * 1000));
   ASSERT_TRUE(srv.deinit_server());
 }
+
+TEST(boosted_tcp_server, throttled_connection_is_released_on_close)
+{
+  throttled_tcp_server srv;
+  ASSERT_TRUE(srv.init_server(test_server_port, test_server_host));
+  srv.get_bandwidth_limits().m_download.set_rate(1);
+  ASSERT_TRUE(srv.run_server(2, false));
+  throttled_protocol_handler_config& config = srv.get_config_object();
+
+  boost::asio::io_service io_service;
+  boost::asio::ip::tcp::socket socket(io_service);
+  socket.connect(boost::asio::ip::tcp::endpoint(boost::asio::ip::address::from_string(test_server_host), test_server_port));
+  std::string data(100, 'x');
+  boost::asio::write(socket, boost::asio::buffer(data));
+
+  // the next read now waits for the download limit on a timer
+  {
+    std::unique_lock<std::mutex> lock(config.m_lock);
+    ASSERT_TRUE(config.m_cond.wait_for(lock, std::chrono::seconds(5), [&]() { return nullptr != config.m_endpoint; }));
+  }
+
+  auto close_time = std::chrono::steady_clock::now();
+  config.m_endpoint->close();
+  {
+    std::unique_lock<std::mutex> lock(config.m_lock);
+    ASSERT_TRUE(config.m_cond.wait_for(lock, std::chrono::seconds(5), [&]() { return config.m_destroyed; }));
+  }
+  // the timer is cancelled rather than left to expire after ABSTRACT_SERVER_THROTTLE_MAX_WAIT_MS
+  ASSERT_GT(ABSTRACT_SERVER_THROTTLE_MAX_WAIT_MS / 2, std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - close_time).count());
+
+  srv.send_stop_signal();
+  ASSERT_TRUE(srv.timed_wait_server_stop(5 * 1000));
+  ASSERT_TRUE(srv.deinit_server());
+}
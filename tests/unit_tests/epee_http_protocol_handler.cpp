@@ -0,0 +1,374 @@
+// Copyright (c) 2014, AEON, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this file are originally copyright (c) 2012-2013 The Cryptonote developers
+
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "include_base_utils.h"
+#include "net/http_protocol_handler.h"
+
+using namespace epee::net_utils;
+
+namespace
+{
+  struct test_endpoint : public i_service_endpoint
+  {
+    virtual bool do_send(const void* ptr, size_t cb)
+    {
+      m_sent.append((const char*)ptr, cb);
+      ++m_send_calls;
+      return true;
+    }
+    virtual bool close() { return true; }
+    virtual bool call_run_once_service_io() { return true; }
+    virtual bool request_callback() { return true; }
+    virtual boost::asio::io_service& get_io_service() { return m_io_service; }
+    virtual bool add_ref() { return true; }
+    virtual bool release() { return true; }
+
+    test_endpoint(): m_send_calls(0) {}
+    ~test_endpoint() noexcept {}
+
+    boost::asio::io_service m_io_service;
+    std::string m_sent;
+    size_t m_send_calls;
+  };
+
+  // Answers with the URI followed by the request body
+  class echo_handler : public http::simple_http_connection_handler<>
+  {
+  public:
+    echo_handler(i_service_endpoint* psnd_hndlr, config_type& config)
+      : http::simple_http_connection_handler<>(psnd_hndlr, config)
+    {
+    }
+
+    virtual bool handle_request(const http::http_request_info& query_info, http::http_response_info& response)
+    {
+      m_requests.push_back(query_info);
+      response.m_response_code = 200;
+      response.m_response_comment = "OK";
+      response.m_mime_tipe = "text/plain";
+      response.m_body = query_info.m_URI + ":" + query_info.m_body;
+      return true;
+    }
+
+    std::vector<http::http_request_info> m_requests;
+  };
+
+  class http_protocol_handler_test : public ::testing::Test
+  {
+  protected:
+    http_protocol_handler_test()
+      : m_handler(&m_endpoint, m_config)
+    {
+    }
+
+    bool recv(const std::string& data)
+    {
+      return m_handler.handle_recv(data.data(), data.size());
+    }
+
+    // Returns bodies of the responses sent so far
+    std::vector<std::string> response_bodies()
+    {
+      std::vector<std::string> bodies;
+      size_t pos = 0;
+      while (pos < m_endpoint.m_sent.size())
+      {
+        size_t head_end = m_endpoint.m_sent.find("\r\n\r\n", pos);
+        if (std::string::npos == head_end)
+          break;
+        size_t len_pos = m_endpoint.m_sent.find("Content-Length: ", pos);
+        size_t len = std::stoul(m_endpoint.m_sent.substr(len_pos + 16));
+        bodies.push_back(m_endpoint.m_sent.substr(head_end + 4, len));
+        pos = head_end + 4 + len;
+      }
+      return bodies;
+    }
+
+    test_endpoint m_endpoint;
+    http::http_server_config m_config;
+    echo_handler m_handler;
+  };
+}
+
+TEST_F(http_protocol_handler_test, parses_request_fed_byte_by_byte)
+{
+  std::string request =
+    "\r\nPOST /json_rpc?a=1#frag HTTP/1.1\r\n"
+    "Host: localhost\r\n"
+    "content-length: 4\r\n"
+    "X-Folded: one\r\n"
+    "  two\r\n"
+    "X-Other:three \r\n"
+    "\r\n"
+    "body";
+
+  for (size_t i = 0; i < request.size(); ++i)
+    ASSERT_TRUE(recv(request.substr(i, 1)));
+
+  ASSERT_EQ(1, m_handler.m_requests.size());
+  const http::http_request_info& info = m_handler.m_requests[0];
+  ASSERT_EQ(http::http_method_post, info.m_http_method);
+  ASSERT_EQ("POST", info.m_http_method_str);
+  ASSERT_EQ("/json_rpc?a=1#frag", info.m_URI);
+  ASSERT_EQ("/json_rpc", info.m_uri_content.m_path);
+  ASSERT_EQ("a=1", info.m_uri_content.m_query);
+  ASSERT_EQ("frag", info.m_uri_content.m_fragment);
+  ASSERT_EQ(1, info.m_http_ver_hi);
+  ASSERT_EQ(1, info.m_http_ver_lo);
+  ASSERT_EQ("POST /json_rpc?a=1#frag HTTP/1.1\r\n", info.m_full_request_str);
+  ASSERT_EQ("localhost", info.m_header_info.m_host);
+  ASSERT_EQ("4", info.m_header_info.m_content_length);
+  ASSERT_EQ(2, info.m_header_info.m_etc_fields.size());
+  ASSERT_EQ("one two", http::get_value_from_fields_list("x-folded", info.m_header_info.m_etc_fields));
+  ASSERT_EQ("three", http::get_value_from_fields_list("X-Other", info.m_header_info.m_etc_fields));
+  ASSERT_EQ(request.size() - 2 - info.m_full_request_str.size() - 4, info.m_request_head.size());
+  ASSERT_EQ("body", info.m_body);
+
+  std::vector<std::string> bodies = response_bodies();
+  ASSERT_EQ(1, bodies.size());
+  ASSERT_EQ("/json_rpc?a=1#frag:body", bodies[0]);
+  // Head and body go out in one send
+  ASSERT_EQ(1, m_endpoint.m_send_calls);
+}
+
+TEST_F(http_protocol_handler_test, answers_pipelined_requests_in_order)
+{
+  std::string requests =
+    "GET /first HTTP/1.1\r\n\r\n"
+    "POST /second HTTP/1.1\r\nContent-Length: 3\r\n\r\nabc"
+    "GET /third HTTP/1.1\r\nHost: x\r\n\r\n"
+    "GET /fourth HTTP/1.1\r\n";
+
+  ASSERT_TRUE(recv(requests));
+  ASSERT_EQ(3, m_handler.m_requests.size());
+  ASSERT_TRUE(recv("\r\n"));
+
+  std::vector<std::string> bodies = response_bodies();
+  ASSERT_EQ(4, bodies.size());
+  ASSERT_EQ("/first:", bodies[0]);
+  ASSERT_EQ("/second:abc", bodies[1]);
+  ASSERT_EQ("/third:", bodies[2]);
+  ASSERT_EQ("/fourth:", bodies[3]);
+  ASSERT_EQ(std::string::npos, m_endpoint.m_sent.find("Connection:"));
+}
+
+TEST_F(http_protocol_handler_test, large_body_split_across_reads)
+{
+  std::string body(100000, 'x');
+  std::string head = "POST /big HTTP/1.1\r\nContent-Length: " + std::to_string(body.size()) + "\r\n\r\n";
+  ASSERT_TRUE(recv(head + body.substr(0, 10)));
+  for (size_t pos = 10; pos < body.size(); pos += 4096)
+    ASSERT_TRUE(recv(body.substr(pos, 4096)));
+
+  ASSERT_EQ(1, m_handler.m_requests.size());
+  ASSERT_EQ(body, m_handler.m_requests[0].m_body);
+}
+
+TEST_F(http_protocol_handler_test, closes_after_connection_close)
+{
+  ASSERT_FALSE(recv("GET /a HTTP/1.1\r\nConnection: Close\r\n\r\nGET /b HTTP/1.1\r\n\r\n"));
+  ASSERT_EQ(1, m_handler.m_requests.size());
+  ASSERT_NE(std::string::npos, m_endpoint.m_sent.find("Connection: close\r\n"));
+}
+
+TEST_F(http_protocol_handler_test, http_1_0_closes_unless_keep_alive_is_asked)
+{
+  ASSERT_TRUE(recv("GET /a HTTP/1.0\r\nConnection: keep-alive\r\n\r\n"));
+  ASSERT_NE(std::string::npos, m_endpoint.m_sent.find("Connection: keep-alive\r\n"));
+
+  ASSERT_FALSE(recv("GET /b HTTP/1.0\r\n\r\n"));
+  ASSERT_NE(std::string::npos, m_endpoint.m_sent.find("Connection: close\r\n"));
+  ASSERT_EQ(2, m_handler.m_requests.size());
+}
+
+TEST_F(http_protocol_handler_test, reads_chunked_body)
+{
+  ASSERT_TRUE(recv("POST /c HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n4;ext=1\r\nWiki\r\n"));
+  ASSERT_TRUE(m_handler.m_requests.empty());
+  ASSERT_TRUE(recv("A\r\n0123456789\r\n0\r\nTrailer: x\r\n\r\nGET /next HTTP/1.1\r\n\r\n"));
+
+  ASSERT_EQ(2, m_handler.m_requests.size());
+  ASSERT_EQ("Wiki0123456789", m_handler.m_requests[0].m_body);
+  ASSERT_EQ("/next", m_handler.m_requests[1].m_URI);
+}
+
+TEST_F(http_protocol_handler_test, head_response_has_no_body)
+{
+  ASSERT_TRUE(recv("HEAD /h HTTP/1.1\r\n\r\nGET /g HTTP/1.1\r\n\r\n"));
+  ASSERT_EQ(2, m_handler.m_requests.size());
+  // Content-Length of the HEAD response is that of the body it would have had
+  ASSERT_EQ(0, m_endpoint.m_sent.find("HTTP/1.1 200 OK\r\n"));
+  size_t second = m_endpoint.m_sent.find("HTTP/1.1 200 OK\r\n", 1);
+  ASSERT_NE(std::string::npos, second);
+  ASSERT_EQ("\r\n\r\n", m_endpoint.m_sent.substr(second - 4, 4));
+}
+
+TEST_F(http_protocol_handler_test, rejects_malformed_requests)
+{
+  ASSERT_FALSE(recv("GET /a b HTTP/1.1\r\n\r\n"));
+  ASSERT_TRUE(m_handler.m_requests.empty());
+  ASSERT_EQ(0, m_endpoint.m_sent.find("HTTP/1.1 400 Bad Request\r\n"));
+}
+
+TEST(http_protocol_handler, rejects_bad_headers)
+{
+  const char* requests[] = {
+    "FETCH /a HTTP/1.1\r\n\r\n",
+    "GET /a HTTP/x.1\r\n\r\n",
+    "GET /a\r\n\r\n",
+    "GET /a HTTP/1.1\r\nno colon\r\n\r\n",
+    "GET /a HTTP/1.1\r\n folded first\r\n\r\n",
+    "POST /a HTTP/1.1\r\nContent-Length: 12a\r\n\r\n",
+    "POST /a HTTP/1.1\r\nTransfer-Encoding: gzip\r\n\r\n",
+    "POST /a HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\nzz\r\n",
+    "POST /a HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n1\r\nabc\r\n"
+  };
+  for (const char* request : requests)
+  {
+    test_endpoint endpoint;
+    http::http_server_config config;
+    echo_handler handler(&endpoint, config);
+    ASSERT_FALSE(handler.handle_recv(request, strlen(request))) << request;
+    ASSERT_TRUE(handler.m_requests.empty()) << request;
+  }
+}
+
+TEST(http_protocol_handler, rejects_too_long_lines)
+{
+  test_endpoint endpoint;
+  http::http_server_config config;
+  echo_handler handler(&endpoint, config);
+  std::string request = "GET /" + std::string(HTTP_MAX_URI_LEN + 1, 'a');
+  ASSERT_FALSE(handler.handle_recv(request.data(), request.size()));
+}
+
+#ifdef HTTP_ENABLE_GZIP
+
+#include "gzip_encoding.h"
+
+namespace
+{
+  struct collecting_target : public i_target_handler
+  {
+    virtual bool handle_target_data(std::string& piece_of_transfer)
+    {
+      m_data += piece_of_transfer;
+      piece_of_transfer.clear();
+      return true;
+    }
+
+    std::string m_data;
+  };
+
+  std::string gunzip(const std::string& packed, size_t piece_size)
+  {
+    collecting_target target;
+    content_encoding_gzip decoder(&target);
+    for (size_t pos = 0; pos < packed.size(); pos += piece_size)
+    {
+      std::string piece = packed.substr(pos, piece_size);
+      decoder.update_in(piece);
+    }
+    return target.m_data;
+  }
+}
+
+TEST(http_accepts_gzip, parses_codings_and_weights)
+{
+  ASSERT_TRUE(http::http_accepts_gzip("gzip"));
+  ASSERT_TRUE(http::http_accepts_gzip("deflate, GZip;q=0.5"));
+  ASSERT_TRUE(http::http_accepts_gzip("x-gzip"));
+  ASSERT_TRUE(http::http_accepts_gzip("identity, *"));
+  ASSERT_FALSE(http::http_accepts_gzip(""));
+  ASSERT_FALSE(http::http_accepts_gzip("deflate, identity"));
+  ASSERT_FALSE(http::http_accepts_gzip("gzip;q=0"));
+  ASSERT_FALSE(http::http_accepts_gzip("gzip ; q=0.000, deflate"));
+  ASSERT_FALSE(http::http_accepts_gzip("*, gzip;q=0"));
+  ASSERT_FALSE(http::http_accepts_gzip("*;q=0"));
+  ASSERT_FALSE(http::http_accepts_gzip("gzipx"));
+}
+
+TEST(gzip_compress, round_trips_through_decoder)
+{
+  std::string data;
+  for (size_t i = 0; i < 100000; ++i)
+    data += static_cast<char>(i % 7 == 0 ? i : 'a');
+  std::string packed;
+  ASSERT_TRUE(gzip_compress(data, packed, 1));
+  ASSERT_LT(packed.size(), data.size());
+  ASSERT_EQ(data, gunzip(packed, packed.size()));
+  ASSERT_EQ(data, gunzip(packed, 100));
+
+  // Decoder output buffer is sized from the input piece, highly compressible data overflows it
+  std::string zeros(1000000, '\0');
+  ASSERT_TRUE(gzip_compress(zeros, packed, 9));
+  ASSERT_EQ(zeros, gunzip(packed, packed.size()));
+}
+
+TEST_F(http_protocol_handler_test, compresses_large_responses_for_gzip_clients)
+{
+  m_config.m_gzip_level = 1;
+  m_config.m_gzip_min_size = 1000;
+  std::string body(10000, 'z');
+  std::string request = "POST /bin HTTP/1.1\r\nAccept-Encoding: deflate, gzip\r\nContent-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+  ASSERT_TRUE(recv(request));
+
+  ASSERT_NE(std::string::npos, m_endpoint.m_sent.find("Content-Encoding: gzip\r\n"));
+  ASSERT_NE(std::string::npos, m_endpoint.m_sent.find("Vary: Accept-Encoding\r\n"));
+  std::vector<std::string> bodies = response_bodies();
+  ASSERT_EQ(1, bodies.size());
+  ASSERT_LT(bodies[0].size(), body.size());
+  ASSERT_EQ("/bin:" + body, gunzip(bodies[0], 512));
+}
+
+TEST_F(http_protocol_handler_test, sends_identity_unless_gzip_helps)
+{
+  m_config.m_gzip_level = 1;
+  m_config.m_gzip_min_size = 1000;
+  std::string body(10000, 'z');
+  std::string head = "POST /bin HTTP/1.1\r\nContent-Length: " + std::to_string(body.size()) + "\r\n";
+  // No Accept-Encoding, gzip refused, body under the threshold
+  ASSERT_TRUE(recv(head + "\r\n" + body));
+  ASSERT_TRUE(recv(head + "Accept-Encoding: gzip;q=0\r\n\r\n" + body));
+  ASSERT_TRUE(recv("POST /bin HTTP/1.1\r\nAccept-Encoding: gzip\r\nContent-Length: 10\r\n\r\n" + body.substr(0, 10)));
+
+  ASSERT_EQ(std::string::npos, m_endpoint.m_sent.find("Content-Encoding"));
+  std::vector<std::string> bodies = response_bodies();
+  ASSERT_EQ(3, bodies.size());
+  ASSERT_EQ("/bin:" + body, bodies[0]);
+  ASSERT_EQ("/bin:" + body, bodies[1]);
+}
+
+#endif
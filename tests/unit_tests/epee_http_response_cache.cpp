@@ -0,0 +1,133 @@
+// Copyright (c) 2014, AEON, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this file are originally copyright (c) 2012-2013 The Cryptonote developers
+
+#include "gtest/gtest.h"
+
+#include "include_base_utils.h"
+#include "net/http_response_cache.h"
+#include "net/jsonrpc_structs.h"
+#include "storages/portable_storage_template_helper.h"
+
+using namespace epee::net_utils::http;
+
+TEST(http_response_cache, serves_entries_of_current_version_only)
+{
+  response_cache cache;
+  std::string body;
+  ASSERT_FALSE(cache.get("a", 0, 0, body));
+
+  cache.put("a", 1, "a1");
+  cache.put("b", 1, "b1");
+  ASSERT_FALSE(cache.get("a", 0, 0, body));
+  ASSERT_TRUE(cache.get("a", 1, 0, body));
+  ASSERT_EQ("a1", body);
+  ASSERT_TRUE(cache.get("b", 1, 0, body));
+  ASSERT_EQ("b1", body);
+
+  // New version drops everything made before it
+  cache.put("a", 2, "a2");
+  ASSERT_FALSE(cache.get("b", 2, 0, body));
+  ASSERT_TRUE(cache.get("a", 2, 0, body));
+  ASSERT_EQ("a2", body);
+
+  // Late put from a request that started before the version changed
+  cache.put("b", 1, "b1");
+  ASSERT_FALSE(cache.get("b", 2, 0, body));
+  ASSERT_FALSE(cache.get("b", 1, 0, body));
+}
+
+TEST(http_response_cache, expires_entries_by_age)
+{
+  response_cache cache;
+  std::string body;
+  cache.put("a", 1, "a1");
+  ASSERT_TRUE(cache.get("a", 1, 60000, body));
+  epee::misc_utils::sleep_no_w(30);
+  ASSERT_FALSE(cache.get("a", 1, 10, body));
+  ASSERT_TRUE(cache.get("a", 1, 0, body));
+}
+
+TEST(http_response_cache, keeps_number_of_entries_bounded)
+{
+  response_cache cache(4);
+  std::string body;
+  for (int i = 0; i < 4; ++i)
+    cache.put(std::to_string(i), 1, "x");
+  cache.put("0", 1, "y");
+  ASSERT_TRUE(cache.get("3", 1, 0, body));
+  cache.put("4", 1, "z");
+  ASSERT_FALSE(cache.get("3", 1, 0, body));
+  ASSERT_TRUE(cache.get("4", 1, 0, body));
+}
+
+namespace
+{
+  struct test_result
+  {
+    uint64_t count;
+    std::string status;
+
+    BEGIN_KV_SERIALIZE_MAP()
+      KV_SERIALIZE(count)
+      KV_SERIALIZE(status)
+    END_KV_SERIALIZE_MAP()
+  };
+
+  std::string make_response(const epee::serialization::storage_entry& id)
+  {
+    epee::json_rpc::response<test_result, epee::json_rpc::dummy_error> resp;
+    resp.jsonrpc = "2.0";
+    resp.id = id;
+    resp.result.count = 12345;
+    resp.result.status = "OK";
+    std::string body;
+    epee::serialization::store_t_to_json(resp, body);
+    return body;
+  }
+}
+
+TEST(http_response_cache, puts_request_id_into_cached_json_rpc_response)
+{
+  std::string cached = make_response(epee::serialization::storage_entry(std::string(HTTP_RESPONSE_CACHE_ID_PLACEHOLDER)));
+
+  std::vector<epee::serialization::storage_entry> ids;
+  ids.push_back(epee::serialization::storage_entry(std::string("0")));
+  ids.push_back(epee::serialization::storage_entry(std::string("with \"quotes\"")));
+  ids.push_back(epee::serialization::storage_entry(uint64_t(42)));
+  for (const auto& id : ids)
+  {
+    std::string body = cached;
+    ASSERT_TRUE(set_cached_json_rpc_id(body, id));
+    ASSERT_EQ(make_response(id), body);
+  }
+
+  std::string body = make_response(ids[0]);
+  ASSERT_FALSE(set_cached_json_rpc_id(body, ids[0]));
+}
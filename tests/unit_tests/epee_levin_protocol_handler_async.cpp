@@ -131,6 +131,7 @@ namespace
       : m_io_service(io_service)
       , m_protocol_handler(this, protocol_config, m_context)
       , m_send_return(true)
+      , m_recv_hint(0)
     {
     }
 
@@ -149,6 +150,7 @@ namespace
       return m_send_return;
     }
 
+    virtual void set_recv_hint(size_t cb)             { m_recv_hint = cb; }
     virtual bool close()                              { /*std::cout << "test_connection::close()" << std::endl; */return true; }
     virtual bool call_run_once_service_io()           { std::cout << "test_connection::call_run_once_service_io()" << std::endl; return true; }
     virtual bool request_callback()                   { std::cout << "test_connection::request_callback()" << std::endl; return true; }
@@ -164,6 +166,8 @@ namespace
     bool send_return() const { return m_send_return; }
     void send_return(bool v) { m_send_return = v; }
 
+    size_t recv_hint() const { return m_recv_hint; }
+
   public:
     test_levin_protocol_handler m_protocol_handler;
 
@@ -177,6 +181,7 @@ namespace
     std::string m_last_send_data;
 
     bool m_send_return;
+    size_t m_recv_hint;
   };
 
   class async_protocol_handler_test : public ::testing::Test
@@ -530,3 +535,57 @@ TEST_F(test_levin_protocol_handler__hanle_recv_with_invalid_data, handles_unexpe
 
   ASSERT_FALSE(m_conn->m_protocol_handler.handle_recv(m_buf.data(), m_buf.size()));
 }
+
+TEST_F(test_levin_protocol_handler__hanle_recv_with_invalid_data, hints_rest_of_chunked_body)
+{
+  prepare_buf();
+
+  size_t buf1_size = sizeof(m_req_head) + 100;
+  ASSERT_TRUE(m_conn->m_protocol_handler.handle_recv(m_buf.data(), buf1_size));
+  ASSERT_EQ(m_buf.size() - buf1_size, m_conn->recv_hint());
+
+  ASSERT_TRUE(m_conn->m_protocol_handler.handle_recv(m_buf.data() + buf1_size, 50));
+  ASSERT_EQ(m_buf.size() - buf1_size - 50, m_conn->recv_hint());
+
+  ASSERT_TRUE(m_conn->m_protocol_handler.handle_recv(m_buf.data() + buf1_size + 50, m_buf.size() - buf1_size - 50));
+  ASSERT_EQ(1, m_commands_handler.invoke_counter());
+  ASSERT_EQ(0, m_conn->recv_hint());
+}
+
+TEST_F(test_levin_protocol_handler__hanle_recv_with_invalid_data, resets_hint_when_body_ends_with_partial_header)
+{
+  prepare_buf();
+  std::string buf = m_buf + m_buf.substr(0, sizeof(m_req_head) / 2);
+
+  size_t buf1_size = sizeof(m_req_head) + 100;
+  ASSERT_TRUE(m_conn->m_protocol_handler.handle_recv(buf.data(), buf1_size));
+  ASSERT_NE(0, m_conn->recv_hint());
+
+  ASSERT_TRUE(m_conn->m_protocol_handler.handle_recv(buf.data() + buf1_size, buf.size() - buf1_size));
+  ASSERT_EQ(1, m_commands_handler.invoke_counter());
+  ASSERT_EQ(0, m_conn->recv_hint());
+}
+
+TEST_F(test_levin_protocol_handler__hanle_recv_with_invalid_data, resets_hint_when_body_ends_with_next_packet)
+{
+  prepare_buf();
+  std::string buf = m_buf + m_buf;
+
+  size_t buf1_size = sizeof(m_req_head) + 100;
+  ASSERT_TRUE(m_conn->m_protocol_handler.handle_recv(buf.data(), buf1_size));
+  ASSERT_NE(0, m_conn->recv_hint());
+
+  ASSERT_TRUE(m_conn->m_protocol_handler.handle_recv(buf.data() + buf1_size, buf.size() - buf1_size));
+  ASSERT_EQ(2, m_commands_handler.invoke_counter());
+  ASSERT_EQ(0, m_conn->recv_hint());
+}
+
+TEST_F(test_levin_protocol_handler__hanle_recv_with_invalid_data, hints_body_of_next_packet)
+{
+  prepare_buf();
+  std::string buf = m_buf + m_buf.substr(0, sizeof(m_req_head) + 10);
+
+  ASSERT_TRUE(m_conn->m_protocol_handler.handle_recv(buf.data(), buf.size()));
+  ASSERT_EQ(1, m_commands_handler.invoke_counter());
+  ASSERT_EQ(m_in_data.size() - 10, m_conn->recv_hint());
+}
@@ -0,0 +1,286 @@
+// Copyright (c) 2014, AEON, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this file are originally copyright (c) 2012-2013 The Cryptonote developers
+
+
+#include "gtest/gtest.h"
+
+#include "include_base_utils.h"
+#include "cryptonote_protocol/cryptonote_protocol_defs.h"
+#include "p2p/p2p_protocol_defs.h"
+#include "rpc/core_rpc_server_commands_defs.h"
+#include "storages/portable_storage_template_helper.h"
+
+namespace
+{
+  template<class t_struct>
+  std::string store_legacy(const t_struct& s)
+  {
+    epee::serialization::portable_storage ps;
+    s.store(ps);
+    std::string buff;
+    ps.store_to_binary(buff);
+    return buff;
+  }
+
+  template<class t_struct>
+  bool load_legacy(t_struct& s, const std::string& buff)
+  {
+    epee::serialization::portable_storage ps;
+    if(!ps.load_from_binary(buff))
+      return false;
+    return s.load(ps);
+  }
+
+  // The legacy writer emits the entries sorted by name, the streaming one in declaration order
+  std::string canonical(const std::string& buff)
+  {
+    epee::serialization::portable_storage ps;
+    if(!ps.load_from_binary(buff))
+      return std::string();
+    std::string res;
+    ps.store_to_binary(res);
+    return res;
+  }
+
+  // Stores with both writers, loads each output with both readers and checks that all of them agree
+  template<class t_struct>
+  void check_wire_compatible(const t_struct& s)
+  {
+    std::string legacy = store_legacy(s);
+    std::string streamed;
+    ASSERT_TRUE(epee::serialization::store_t_to_binary(s, streamed));
+    ASSERT_EQ(legacy, canonical(streamed));
+
+    t_struct from_streamed;
+    ASSERT_TRUE(load_legacy(from_streamed, streamed));
+    ASSERT_EQ(legacy, store_legacy(from_streamed));
+
+    t_struct from_legacy;
+    ASSERT_TRUE(epee::serialization::load_t_from_binary(from_legacy, legacy));
+    ASSERT_EQ(legacy, store_legacy(from_legacy));
+
+    t_struct round_trip;
+    ASSERT_TRUE(epee::serialization::load_t_from_binary(round_trip, streamed));
+    ASSERT_EQ(legacy, store_legacy(round_trip));
+  }
+
+  crypto::hash make_hash(uint64_t n)
+  {
+    crypto::hash h = AUTO_VAL_INIT(h);
+    memcpy(&h, &n, sizeof(n));
+    return h;
+  }
+
+  cryptonote::block_complete_entry make_block_entry(size_t n)
+  {
+    cryptonote::block_complete_entry e;
+    e.block = std::string(100 + n, static_cast<char>(n));
+    for(size_t i = 0; i < n % 5; ++i)
+      e.txs.push_back(std::string(300 + i, static_cast<char>(i)));
+    return e;
+  }
+
+  struct narrow_values
+  {
+    uint8_t u8;
+    uint32_t u32;
+    int16_t i16;
+
+    BEGIN_KV_SERIALIZE_MAP()
+      KV_SERIALIZE_N(u8, "a")
+      KV_SERIALIZE_N(u32, "b")
+      KV_SERIALIZE_N(i16, "c")
+    END_KV_SERIALIZE_MAP()
+  };
+
+  struct wide_values
+  {
+    uint64_t u64;
+    uint64_t u64_2;
+    int64_t i64;
+
+    BEGIN_KV_SERIALIZE_MAP()
+      KV_SERIALIZE_N(u64, "a")
+      KV_SERIALIZE_N(u64_2, "b")
+      KV_SERIALIZE_N(i64, "c")
+    END_KV_SERIALIZE_MAP()
+  };
+}
+
+TEST(portable_storage_bin_stream, get_objects)
+{
+  cryptonote::NOTIFY_RESPONSE_GET_OBJECTS::request r;
+  for(size_t i = 0; i < 300; ++i)
+    r.blocks.push_back(make_block_entry(i));
+  for(size_t i = 0; i < 70; ++i)
+    r.txs.push_back(std::string(i, 'x'));
+  for(uint64_t i = 0; i < 10; ++i)
+    r.missed_ids.push_back(make_hash(i));
+  r.current_blockchain_height = 123456789;
+  check_wire_compatible(r);
+}
+
+TEST(portable_storage_bin_stream, empty_containers)
+{
+  cryptonote::NOTIFY_RESPONSE_GET_OBJECTS::request r;
+  r.current_blockchain_height = 0;
+  check_wire_compatible(r);
+
+  cryptonote::NOTIFY_RESPONSE_GET_OBJECTS::request r2;
+  r2.blocks.push_back(cryptonote::block_complete_entry());
+  r2.current_blockchain_height = 1;
+  check_wire_compatible(r2);
+}
+
+TEST(portable_storage_bin_stream, get_blocks_fast)
+{
+  cryptonote::COMMAND_RPC_GET_BLOCKS_FAST::request req;
+  for(uint64_t i = 0; i < 20000; ++i)
+    req.block_ids.push_back(make_hash(i));
+  req.start_height = 42;
+  check_wire_compatible(req);
+
+  cryptonote::COMMAND_RPC_GET_BLOCKS_FAST::response res;
+  for(size_t i = 0; i < 1000; ++i)
+    res.blocks.push_back(make_block_entry(i));
+  res.start_height = 1;
+  res.current_height = 1001;
+  res.status = CORE_RPC_STATUS_OK;
+  check_wire_compatible(res);
+}
+
+TEST(portable_storage_bin_stream, get_connections)
+{
+  cryptonote::COMMAND_RPC_GET_CONNECTIONS::response res;
+  res.status = CORE_RPC_STATUS_OK;
+  for(size_t i = 0; i < 100; ++i)
+  {
+    cryptonote::connection_info ci = AUTO_VAL_INIT(ci);
+    ci.incoming = i % 2;
+    ci.ip = "10.0.0." + std::to_string(i);
+    ci.port = "18080";
+    ci.peer_id = std::to_string(i * 7919);
+    ci.recv_count = i * 1000;
+    ci.send_count = i * 2000;
+    ci.state = "state_normal";
+    ci.live_time = i;
+    ci.recv_speed = i * 3;
+    res.connections.push_back(ci);
+  }
+  check_wire_compatible(res);
+}
+
+TEST(portable_storage_bin_stream, handshake)
+{
+  nodetool::COMMAND_HANDSHAKE_T<cryptonote::CORE_SYNC_DATA>::response res;
+  res.node_data.network_id = boost::uuids::uuid{{1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16}};
+  res.node_data.peer_id = 0x123456789abcdef0;
+  res.node_data.local_time = 1400000000;
+  res.node_data.my_port = 18080;
+  res.payload_data.current_height = 1000;
+  res.payload_data.top_id = make_hash(999);
+  for(uint32_t i = 0; i < 250; ++i)
+  {
+    nodetool::peerlist_entry pe = AUTO_VAL_INIT(pe);
+    pe.adr.ip = i;
+    pe.adr.port = 18080;
+    pe.id = i * 31;
+    pe.last_seen = -static_cast<int64_t>(i);
+    res.local_peerlist.push_back(pe);
+  }
+  check_wire_compatible(res);
+
+  nodetool::COMMAND_HANDSHAKE_T<cryptonote::CORE_SYNC_DATA>::response loaded;
+  ASSERT_TRUE(epee::serialization::load_t_from_binary(loaded, epee::serialization::store_t_to_binary(res)));
+  ASSERT_EQ(res.node_data.network_id, loaded.node_data.network_id);
+  ASSERT_EQ(res.node_data.peer_id, loaded.node_data.peer_id);
+  ASSERT_EQ(res.payload_data.top_id, loaded.payload_data.top_id);
+  ASSERT_EQ(250, loaded.local_peerlist.size());
+  ASSERT_EQ(-249, loaded.local_peerlist.back().last_seen);
+}
+
+TEST(portable_storage_bin_stream, integer_widths_are_converted)
+{
+  narrow_values n;
+  n.u8 = 200;
+  n.u32 = 4000000000;
+  n.i16 = -3;
+  std::string buff;
+  ASSERT_TRUE(epee::serialization::store_t_to_binary(n, buff));
+
+  wide_values w;
+  ASSERT_TRUE(epee::serialization::load_t_from_binary(w, buff));
+  ASSERT_EQ(200, w.u64);
+  ASSERT_EQ(4000000000, w.u64_2);
+  ASSERT_EQ(-3, w.i64);
+
+  // out of range value fails the same way as with the legacy reader
+  w.u64_2 = 1ULL << 40;
+  ASSERT_TRUE(epee::serialization::store_t_to_binary(w, buff));
+  ASSERT_FALSE(load_legacy(n, buff));
+  ASSERT_FALSE(epee::serialization::load_t_from_binary(n, buff));
+}
+
+TEST(portable_storage_bin_stream, truncated_input_is_rejected)
+{
+  cryptonote::NOTIFY_RESPONSE_GET_OBJECTS::request r;
+  for(size_t i = 0; i < 5; ++i)
+    r.blocks.push_back(make_block_entry(i));
+  r.missed_ids.push_back(make_hash(1));
+  r.current_blockchain_height = 5;
+  std::string buff = epee::serialization::store_t_to_binary(r);
+
+  for(size_t size = 0; size < buff.size(); ++size)
+  {
+    cryptonote::NOTIFY_RESPONSE_GET_OBJECTS::request loaded;
+    ASSERT_FALSE(epee::serialization::load_t_from_binary(loaded, buff.substr(0, size))) << "size " << size;
+  }
+}
+
+TEST(portable_storage_bin_stream, garbage_input_is_rejected)
+{
+  cryptonote::NOTIFY_REQUEST_CHAIN::request loaded;
+  const std::string header = epee::serialization::store_t_to_binary(loaded).substr(0, 9);
+
+  // deeply nested sections
+  std::string nested = header;
+  for(size_t i = 0; i < 1000; ++i)
+    nested += std::string("\x04\x01" "a\x0c", 4);
+  nested.append(1, 0);
+  ASSERT_FALSE(epee::serialization::load_t_from_binary(loaded, nested));
+  ASSERT_FALSE(load_legacy(loaded, nested));
+
+  // array count way beyond the buffer
+  std::string huge = header;
+  huge += std::string("\x04\x01" "a", 3);
+  huge.append(1, static_cast<char>(SERIALIZE_TYPE_UINT64 | SERIALIZE_FLAG_ARRAY));
+  huge += std::string("\xfe\xff\xff\xff", 4);
+  ASSERT_FALSE(epee::serialization::load_t_from_binary(loaded, huge));
+}
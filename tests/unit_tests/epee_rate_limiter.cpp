@@ -0,0 +1,111 @@
+// Copyright (c) 2014, AEON, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this file are originally copyright (c) 2012-2013 The Cryptonote developers
+
+
+#include "gtest/gtest.h"
+
+#include <thread>
+
+#include "net/rate_limiter.h"
+
+using epee::net_utils::rate_limiter;
+
+TEST(rate_limiter, unlimited_never_waits)
+{
+  rate_limiter limiter;
+  ASSERT_EQ(0, limiter.get_rate());
+  limiter.take(100 * 1024 * 1024);
+  ASSERT_EQ(0, limiter.get_wait_ms());
+}
+
+TEST(rate_limiter, one_second_of_traffic_goes_through_at_once)
+{
+  rate_limiter limiter(1000);
+  limiter.take(600);
+  ASSERT_EQ(0, limiter.get_wait_ms());
+  limiter.take(400);
+  ASSERT_EQ(0, limiter.get_wait_ms());
+}
+
+TEST(rate_limiter, debt_is_waited_out)
+{
+  rate_limiter limiter(1000);
+  limiter.take(3000);
+  // 2000 bytes of debt at 1000 bytes per second
+  uint64_t wait_ms = limiter.get_wait_ms();
+  ASSERT_LT(1900, wait_ms);
+  ASSERT_GE(2001, wait_ms);
+}
+
+TEST(rate_limiter, bucket_refills_with_time)
+{
+  rate_limiter limiter(10000);
+  limiter.take(10500);
+  ASSERT_LT(0, limiter.get_wait_ms());
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  ASSERT_EQ(0, limiter.get_wait_ms());
+}
+
+TEST(rate_limiter, bucket_does_not_hold_more_than_one_second)
+{
+  rate_limiter limiter(1000);
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  limiter.take(1100);
+  ASSERT_LT(0, limiter.get_wait_ms());
+}
+
+TEST(rate_limiter, lower_rate_caps_tokens)
+{
+  rate_limiter limiter(1000000);
+  limiter.set_rate(100);
+  ASSERT_EQ(100, limiter.get_rate());
+  limiter.take(200);
+  ASSERT_LT(900, limiter.get_wait_ms());
+}
+
+TEST(rate_limiter, removed_limit_ends_wait)
+{
+  rate_limiter limiter(100);
+  limiter.take(1000);
+  ASSERT_LT(0, limiter.get_wait_ms());
+  limiter.set_rate(0);
+  ASSERT_EQ(0, limiter.get_wait_ms());
+}
+
+TEST(rate_limiter, average_is_measured_over_two_seconds)
+{
+  rate_limiter limiter;
+  ASSERT_EQ(0, limiter.get_average());
+  limiter.take(4000);
+  std::this_thread::sleep_for(std::chrono::milliseconds(2000));
+  uint64_t average = limiter.get_average();
+  ASSERT_LT(1500, average);
+  ASSERT_GE(2000, average);
+}
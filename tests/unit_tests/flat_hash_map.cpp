@@ -0,0 +1,176 @@
+// Copyright (c) 2014, AEON, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this file are originally copyright (c) 2012-2013 The Cryptonote developers
+
+
+#include "gtest/gtest.h"
+
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/archive/binary_oarchive.hpp>
+
+#include "crypto/hash.h"
+#include "common/flat_hash_map.h"
+#include "common/unordered_containers_boost_serialization.h"
+
+namespace
+{
+  //few distinct hashes, so probe sequences are long and wrap around the table end
+  struct colliding_hash
+  {
+    size_t operator()(uint64_t v) const { return v % 7; }
+  };
+
+  typedef tools::flat_hash_map<uint64_t, uint64_t, colliding_hash> colliding_map;
+
+  template<class t_map>
+  void check_same(const t_map& m, const std::unordered_map<uint64_t, uint64_t>& expected)
+  {
+    ASSERT_EQ(expected.size(), m.size());
+    for(const auto& v: expected)
+    {
+      auto it = m.find(v.first);
+      ASSERT_TRUE(it != m.end());
+      ASSERT_EQ(v.second, it->second);
+    }
+    size_t visited = 0;
+    for(const auto& v: m)
+    {
+      ASSERT_EQ(1, expected.count(v.first));
+      ++visited;
+    }
+    ASSERT_EQ(expected.size(), visited);
+  }
+}
+
+TEST(flat_hash_map, inserts_finds_and_erases)
+{
+  tools::flat_hash_map<crypto::hash, size_t> m;
+  crypto::hash a = crypto::cn_fast_hash("a", 1);
+  crypto::hash b = crypto::cn_fast_hash("b", 1);
+
+  ASSERT_TRUE(m.empty());
+  ASSERT_TRUE(m.find(a) == m.end());
+  ASSERT_TRUE(m.insert(std::make_pair(a, 1)).second);
+  auto r = m.insert(std::make_pair(a, 2));
+  ASSERT_FALSE(r.second);
+  ASSERT_EQ(1, r.first->second);
+  m[b] = 3;
+  ASSERT_EQ(2, m.size());
+  ASSERT_EQ(1, m.count(a));
+  ASSERT_EQ(3, m.find(b)->second);
+
+  ASSERT_EQ(1, m.erase(a));
+  ASSERT_EQ(0, m.erase(a));
+  ASSERT_EQ(0, m.count(a));
+  ASSERT_EQ(3, m[b]);
+  ASSERT_EQ(1, m.size());
+
+  m.clear();
+  ASSERT_TRUE(m.empty());
+  ASSERT_TRUE(m.find(b) == m.end());
+}
+
+TEST(flat_hash_map, matches_unordered_map_with_colliding_hashes)
+{
+  colliding_map m;
+  std::unordered_map<uint64_t, uint64_t> expected;
+  uint64_t seed = 0;
+  for(size_t i = 0; i != 20000; ++i)
+  {
+    seed = seed * 6364136223846793005 + 1442695040888963407;
+    uint64_t k = (seed >> 33) % 500;
+    if(seed & (1 << 10))
+    {
+      m[k] = i;
+      expected[k] = i;
+    }else
+    {
+      ASSERT_EQ(expected.erase(k), m.erase(k));
+    }
+  }
+  check_same(m, expected);
+}
+
+TEST(flat_hash_map, erases_while_iterating)
+{
+  colliding_map m;
+  std::unordered_map<uint64_t, uint64_t> expected;
+  for(uint64_t k = 0; k != 1000; ++k)
+  {
+    m[k] = k;
+    if(k % 3)
+      expected[k] = k;
+  }
+  //erase returns the position of the entry moved into the erased one
+  size_t visited = 0;
+  for(auto it = m.begin(); it != m.end();)
+  {
+    ++visited;
+    if(it->first % 3 == 0)
+      it = m.erase(it);
+    else
+      ++it;
+  }
+  ASSERT_EQ(1000, visited);
+  check_same(m, expected);
+}
+
+TEST(flat_hash_map, is_stored_like_unordered_map)
+{
+  std::unordered_map<uint64_t, uint64_t> expected;
+  for(uint64_t k = 0; k != 1000; ++k)
+    expected[k * k] = k;
+
+  std::stringstream ss;
+  {
+    boost::archive::binary_oarchive a(ss);
+    a << expected;
+  }
+  tools::flat_hash_map<uint64_t, uint64_t> m;
+  {
+    boost::archive::binary_iarchive a(ss);
+    a >> m;
+  }
+  check_same(m, expected);
+
+  std::stringstream ss2;
+  {
+    boost::archive::binary_oarchive a(ss2);
+    a << m;
+  }
+  std::unordered_map<uint64_t, uint64_t> loaded;
+  {
+    boost::archive::binary_iarchive a(ss2);
+    a >> loaded;
+  }
+  ASSERT_EQ(expected, loaded);
+}
@@ -0,0 +1,184 @@
+// Copyright (c) 2014, AEON, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this file are originally copyright (c) 2012-2013 The Cryptonote developers
+
+
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <cstring>
+#include <unordered_set>
+#include <vector>
+#include <boost/thread/thread.hpp>
+
+#include "crypto/crypto.h"
+#include "crypto/hash.h"
+#include "cryptonote_core/key_images_set.h"
+
+using namespace cryptonote;
+
+namespace
+{
+  crypto::key_image make_key_image(uint64_t head, uint64_t n)
+  {
+    crypto::key_image ki;
+    memset(&ki, 0x5a, sizeof(ki));
+    memcpy(&ki, &head, sizeof(head));
+    memcpy(reinterpret_cast<char*>(&ki) + sizeof(ki) - sizeof(n), &n, sizeof(n));
+    return ki;
+  }
+
+  std::vector<crypto::key_image> make_key_images(size_t count, uint64_t seed)
+  {
+    std::vector<crypto::key_image> kis;
+    for(size_t i = 0; i != count; ++i)
+    {
+      ++seed;
+      crypto::hash h = crypto::cn_fast_hash(&seed, sizeof(seed));
+      kis.push_back(reinterpret_cast<const crypto::key_image&>(h));
+    }
+    return kis;
+  }
+}
+
+TEST(key_images_set, inserts_and_erases)
+{
+  key_images_set s;
+  crypto::key_image a = make_key_image(100, 1);
+  crypto::key_image b = make_key_image(100, 2);
+
+  ASSERT_FALSE(s.contains(a));
+  ASSERT_TRUE(s.insert(a));
+  ASSERT_FALSE(s.insert(a));
+  ASSERT_TRUE(s.contains(a));
+  ASSERT_FALSE(s.contains(b));
+  ASSERT_TRUE(s.insert(b));
+  ASSERT_EQ(2, s.size());
+
+  ASSERT_TRUE(s.erase(a));
+  ASSERT_FALSE(s.erase(a));
+  ASSERT_FALSE(s.contains(a));
+  ASSERT_TRUE(s.contains(b));
+  ASSERT_EQ(1, s.size());
+
+  //erased slots don't break probe sequences through them
+  ASSERT_TRUE(s.insert(a));
+  ASSERT_TRUE(s.contains(a));
+  ASSERT_TRUE(s.contains(b));
+}
+
+TEST(key_images_set, keeps_key_images_with_reserved_heads)
+{
+  key_images_set s;
+  crypto::key_image zero = make_key_image(0, 1);
+  crypto::key_image one = make_key_image(1, 1);
+
+  ASSERT_TRUE(s.insert(zero));
+  ASSERT_TRUE(s.insert(one));
+  ASSERT_FALSE(s.insert(one));
+  ASSERT_TRUE(s.contains(zero));
+  ASSERT_TRUE(s.contains(one));
+  ASSERT_FALSE(s.contains(make_key_image(0, 2)));
+  ASSERT_EQ(2, s.size());
+
+  ASSERT_TRUE(s.erase(zero));
+  ASSERT_FALSE(s.contains(zero));
+  ASSERT_TRUE(s.contains(one));
+  ASSERT_EQ(1, s.size());
+}
+
+TEST(key_images_set, grows_and_visits_all)
+{
+  key_images_set s;
+  std::vector<crypto::key_image> kis = make_key_images(10000, 0);
+  for(size_t i = 0; i != kis.size(); ++i)
+    ASSERT_TRUE(s.insert(kis[i]));
+  for(size_t i = 0; i != kis.size(); i += 2)
+    ASSERT_TRUE(s.erase(kis[i]));
+  //rehashes drop the erased slots
+  std::vector<crypto::key_image> more = make_key_images(10000, 20000);
+  for(size_t i = 0; i != more.size(); ++i)
+    ASSERT_TRUE(s.insert(more[i]));
+
+  ASSERT_EQ(15000, s.size());
+  for(size_t i = 0; i != kis.size(); ++i)
+    ASSERT_EQ(i % 2 == 1, s.contains(kis[i]));
+  for(size_t i = 0; i != more.size(); ++i)
+    ASSERT_TRUE(s.contains(more[i]));
+  ASSERT_FALSE(s.contains(make_key_images(1, 40000).front()));
+
+  std::unordered_set<crypto::key_image> visited;
+  s.for_each([&](const crypto::key_image& ki) { visited.insert(ki); });
+  ASSERT_EQ(15000, visited.size());
+  ASSERT_EQ(1, visited.count(kis[1]));
+  ASSERT_EQ(0, visited.count(kis[0]));
+
+  s.clear();
+  ASSERT_EQ(0, s.size());
+  ASSERT_FALSE(s.contains(kis[1]));
+}
+
+TEST(key_images_set, is_read_while_written)
+{
+  key_images_set s;
+  std::vector<crypto::key_image> kept = make_key_images(1000, 0);
+  std::vector<crypto::key_image> added = make_key_images(100000, 10000);
+  for(size_t i = 0; i != kept.size(); ++i)
+    s.insert(kept[i]);
+
+  std::atomic<bool> done(false);
+  std::atomic<size_t> misses(0);
+  boost::thread_group readers;
+  for(size_t t = 0; t != 4; ++t)
+  {
+    readers.create_thread([&]()
+    {
+      while(!done)
+      {
+        for(size_t i = 0; i != kept.size(); ++i)
+        {
+          if(!s.contains(kept[i]))
+            ++misses;
+        }
+      }
+    });
+  }
+  //tables get replaced many times under the readers
+  for(size_t i = 0; i != added.size(); ++i)
+  {
+    s.insert(added[i]);
+    if(i % 3 == 0)
+      s.erase(added[i]);
+  }
+  done = true;
+  readers.join_all();
+
+  ASSERT_EQ(0, misses);
+  ASSERT_EQ(kept.size() + added.size() - (added.size() + 2) / 3, s.size());
+}
@@ -0,0 +1,154 @@
+// Copyright (c) 2014, AEON, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this file are originally copyright (c) 2012-2013 The Cryptonote developers
+
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+#include "misc_language.h"
+#include "common/order_statistics_window.h"
+#include "cryptonote_config.h"
+#include "cryptonote_core/difficulty.h"
+
+namespace
+{
+  std::vector<uint64_t> make_values(size_t count, uint64_t spread)
+  {
+    std::vector<uint64_t> values;
+    srand(0);
+    for(size_t i = 0; i != count; ++i)
+      values.push_back(rand() % spread);
+    return values;
+  }
+
+  std::vector<uint64_t> sorted_range(const std::vector<uint64_t>& values, size_t begin, size_t end)
+  {
+    std::vector<uint64_t> r(values.begin() + begin, values.begin() + end);
+    std::sort(r.begin(), r.end());
+    return r;
+  }
+
+  //--------------------------------------------------------------------------------------------------------------------
+  TEST(order_statistics_window, matches_sorted_range_while_sliding)
+  {
+    //small spread gives a lot of equal values
+    std::vector<uint64_t> values = make_values(2000, 50);
+    tools::order_statistics_window<uint64_t> window;
+    auto value_of = [&](size_t i) { return values[i]; };
+
+    size_t begin = 0, end = 0;
+    for(size_t step = 0; step != 3000; ++step)
+    {
+      switch(rand() % 4)
+      {
+      case 0: end = std::min(values.size(), end + rand() % 5); break;
+      case 1: end = std::max(begin, end - std::min(end, static_cast<size_t>(rand() % 3))); break;
+      case 2: begin = std::min(end, begin + rand() % 4); break;
+      default: begin -= std::min(begin, static_cast<size_t>(rand() % 3)); break;
+      }
+      window.move_to(begin, end, value_of);
+      ASSERT_EQ(begin, window.begin_index());
+      ASSERT_EQ(end, window.end_index());
+
+      std::vector<uint64_t> expected = sorted_range(values, begin, end);
+      ASSERT_EQ(expected.size(), window.size());
+      if(expected.empty())
+        continue;
+      size_t r0 = rand() % expected.size();
+      size_t r1 = expected.size() - 1 - rand() % (expected.size() - r0);
+      ASSERT_EQ(expected[r0], window.at_rank(0, r0));
+      ASSERT_EQ(expected[r1], window.at_rank(1, r1));
+      ASSERT_EQ(epee::misc_utils::median(expected), window.median());
+    }
+  }
+
+  TEST(order_statistics_window, rebuilds_on_jump)
+  {
+    std::vector<uint64_t> values = make_values(100, 1000);
+    tools::order_statistics_window<uint64_t> window;
+    auto value_of = [&](size_t i) { return values[i]; };
+
+    window.move_to(0, 10, value_of);
+    window.move_to(50, 60, value_of);
+    std::vector<uint64_t> expected = sorted_range(values, 50, 60);
+    ASSERT_EQ(expected.size(), window.size());
+    for(size_t i = 0; i != expected.size(); ++i)
+      ASSERT_EQ(expected[i], window.at_rank(0, i));
+
+    window.clear();
+    ASSERT_TRUE(window.empty());
+    ASSERT_EQ(0u, window.median());
+  }
+
+  TEST(order_statistics_window, gives_same_difficulty_as_full_recalculation)
+  {
+    //timestamps go back and forth so the sorted order differs from the chain order
+    std::vector<uint64_t> timestamps;
+    std::vector<cryptonote::difficulty_type> cumulative_difficulties;
+    srand(0);
+    uint64_t t = 1400000000;
+    cryptonote::difficulty_type cumulative = 0;
+    for(size_t i = 0; i != DIFFICULTY_BLOCKS_COUNT * 2; ++i)
+    {
+      t += rand() % (DIFFICULTY_TARGET * 3);
+      timestamps.push_back(t - rand() % (DIFFICULTY_TARGET * 5));
+      cumulative += 1000 + rand() % 1000;
+      cumulative_difficulties.push_back(cumulative);
+    }
+
+    tools::order_statistics_window<uint64_t> window;
+    for(size_t height = 1; height <= timestamps.size(); ++height)
+    {
+      //the way blockchain_storage collected the blocks before the window was introduced
+      size_t offset = height - std::min(height, static_cast<size_t>(DIFFICULTY_BLOCKS_COUNT));
+      if(!offset)
+        ++offset;
+      std::vector<uint64_t> ts(timestamps.begin() + offset, timestamps.begin() + std::max(offset, height));
+      std::vector<cryptonote::difficulty_type> cd(cumulative_difficulties.begin() + offset, cumulative_difficulties.begin() + std::max(offset, height));
+      cryptonote::difficulty_type expected = cryptonote::next_difficulty(ts, cd, height);
+
+      size_t begin, end;
+      cryptonote::get_difficulty_window(height, begin, end);
+      window.move_to(begin, end, [&](size_t i) { return timestamps[i]; });
+      size_t cut_begin, cut_end;
+      if(!cryptonote::get_difficulty_cut(window.size(), cut_begin, cut_end))
+      {
+        ASSERT_EQ(1u, expected);
+        continue;
+      }
+      uint64_t time_span = window.at_rank(1, cut_end - 1) - window.at_rank(0, cut_begin);
+      cryptonote::difficulty_type total_work = cumulative_difficulties[begin + cut_end - 1] - cumulative_difficulties[begin + cut_begin];
+      ASSERT_EQ(expected, cryptonote::next_difficulty(time_span, total_work, height));
+    }
+  }
+}
@@ -0,0 +1,172 @@
+// Copyright (c) 2014, AEON, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this file are originally copyright (c) 2012-2013 The Cryptonote developers
+
+
+#include "gtest/gtest.h"
+
+#include <set>
+#include <vector>
+
+#include "wallet/wallet2.h"
+#include "wallet/wallet_errors.h"
+
+using namespace tools;
+
+namespace
+{
+  const uint64_t fee = 10;
+  const size_t ring_size = 1;
+
+  std::vector<cryptonote::tx_destination_entry> make_dsts(const std::vector<uint64_t>& amounts)
+  {
+    std::vector<cryptonote::tx_destination_entry> dsts;
+    for (uint64_t amount : amounts)
+      dsts.push_back(cryptonote::tx_destination_entry(amount, cryptonote::account_public_address()));
+    return dsts;
+  }
+
+  std::vector<std::pair<size_t, uint64_t> > make_inputs(size_t count, uint64_t amount)
+  {
+    std::vector<std::pair<size_t, uint64_t> > inputs;
+    for (size_t i = 0; i < count; ++i)
+      inputs.push_back(std::make_pair(i, amount));
+    return inputs;
+  }
+
+  std::vector<detail::tx_plan> plan(const std::vector<uint64_t>& amounts, const std::vector<std::pair<size_t, uint64_t> >& inputs, uint64_t tx_size_limit)
+  {
+    return detail::plan_transactions(make_dsts(amounts), inputs, fee, ring_size, 0, 0, tx_size_limit);
+  }
+
+  // every destination is paid in full, every input is spent at most once and covers its plan
+  void check_plans(const std::vector<detail::tx_plan>& plans, const std::vector<uint64_t>& amounts)
+  {
+    std::vector<uint64_t> paid(amounts.size(), 0);
+    std::set<size_t> spent;
+    for (const detail::tx_plan& p : plans)
+    {
+      ASSERT_FALSE(p.dsts.empty());
+      ASSERT_EQ(p.dsts.size(), p.dsts_indices.size());
+      uint64_t needed = fee;
+      for (size_t i = 0; i < p.dsts.size(); ++i)
+      {
+        paid[p.dsts_indices[i]] += p.dsts[i].amount;
+        needed += p.dsts[i].amount;
+      }
+      uint64_t found = 0;
+      for (auto& input : p.inputs)
+      {
+        ASSERT_TRUE(spent.insert(input.first).second);
+        found += input.second;
+      }
+      ASSERT_EQ(found, p.found_money);
+      ASSERT_LE(needed, p.found_money);
+    }
+    ASSERT_EQ(amounts, paid);
+  }
+}
+
+TEST(wallet_plan_transactions, fits_into_one_transaction)
+{
+  std::vector<uint64_t> amounts = {100, 200};
+  std::vector<detail::tx_plan> plans = plan(amounts, make_inputs(3, 1000), 100000);
+  ASSERT_EQ(1, plans.size());
+  ASSERT_EQ(1, plans[0].inputs.size());
+  ASSERT_EQ(2, plans[0].inputs[0].first);
+  check_plans(plans, amounts);
+}
+
+TEST(wallet_plan_transactions, splits_destinations_between_transactions)
+{
+  std::vector<uint64_t> amounts = {300, 300, 300};
+  std::vector<detail::tx_plan> plans = plan(amounts, make_inputs(3, 1000), 300);
+  ASSERT_EQ(3, plans.size());
+  for (size_t i = 0; i < plans.size(); ++i)
+  {
+    ASSERT_EQ(1, plans[i].dsts.size());
+    ASSERT_EQ(i, plans[i].dsts_indices[0]);
+  }
+  check_plans(plans, amounts);
+}
+
+TEST(wallet_plan_transactions, pays_oversized_destination_partially)
+{
+  std::vector<uint64_t> amounts = {500};
+  std::vector<detail::tx_plan> plans = plan(amounts, make_inputs(10, 100), 450);
+  ASSERT_LT(1, plans.size());
+  for (const detail::tx_plan& p : plans)
+  {
+    ASSERT_EQ(1, p.dsts.size());
+    ASSERT_EQ(0, p.dsts_indices[0]);
+  }
+  check_plans(plans, amounts);
+}
+
+TEST(wallet_plan_transactions, carries_rest_of_oversized_destination_to_next_destinations)
+{
+  std::vector<uint64_t> amounts = {500, 30};
+  std::vector<detail::tx_plan> plans = plan(amounts, make_inputs(10, 100), 450);
+  ASSERT_LT(1, plans.size());
+  ASSERT_EQ(1, plans.back().dsts_indices.back());
+  check_plans(plans, amounts);
+}
+
+TEST(wallet_plan_transactions, throws_not_enough_money)
+{
+  std::vector<std::pair<size_t, uint64_t> > inputs = make_inputs(3, 100);
+  try
+  {
+    plan({150, 150}, inputs, 100000);
+    FAIL() << "expected not_enough_money";
+  }
+  catch (const error::not_enough_money& e)
+  {
+    ASSERT_EQ(300, e.available());
+    ASSERT_EQ(300, e.tx_amount());
+  }
+}
+
+TEST(wallet_plan_transactions, throws_not_enough_money_without_inputs)
+{
+  ASSERT_THROW(plan({100}, std::vector<std::pair<size_t, uint64_t> >(), 100000), error::not_enough_money);
+}
+
+TEST(wallet_plan_transactions, throws_tx_too_big)
+{
+  try
+  {
+    plan({100}, make_inputs(3, 1000), 100);
+    FAIL() << "expected tx_too_big";
+  }
+  catch (const error::tx_too_big& e)
+  {
+    ASSERT_EQ(100, e.tx_size_limit());
+  }
+}
@@ -0,0 +1,190 @@
+// Copyright (c) 2014, AEON, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this file are originally copyright (c) 2012-2013 The Cryptonote developers
+
+
+#include "gtest/gtest.h"
+
+#include <boost/thread/thread.hpp>
+
+#include "cryptonote_core/account.h"
+#include "cryptonote_core/cryptonote_basic_impl.h"
+#include "net/jsonrpc_structs.h"
+#include "storages/portable_storage_template_helper.h"
+#include "wallet/wallet_rpc_server.h"
+#include "wallet/wallet_rpc_server_error_codes.h"
+
+using namespace tools;
+
+namespace
+{
+  // calls the wallet RPC server the way its HTTP connections do, without a socket
+  class wallet_rpc_batch_transfer : public ::testing::Test
+  {
+  protected:
+    wallet_rpc_batch_transfer()
+      : m_server(m_wallet)
+    {
+      cryptonote::account_base account;
+      account.generate();
+      m_address = cryptonote::get_account_address_as_str(account.get_keys().m_account_address);
+    }
+
+    template<class t_request>
+    bool invoke(const std::string& method, const t_request& params, wallet_rpc::batch_transfer_status& result, epee::json_rpc::error& error)
+    {
+      epee::json_rpc::request<t_request> req = AUTO_VAL_INIT(req);
+      req.jsonrpc = "2.0";
+      req.method = method;
+      req.params = params;
+
+      epee::net_utils::http::http_request_info query_info;
+      query_info.m_URI = "/json_rpc";
+      epee::serialization::store_t_to_json(req, query_info.m_body);
+      epee::net_utils::http::http_response_info response;
+      wallet_rpc_server::connection_context context = AUTO_VAL_INIT(context);
+      epee::net_utils::http::i_http_server_handler<wallet_rpc_server::connection_context>& handler = m_server;
+      if (!handler.handle_http_request(query_info, response, context))
+        return false;
+
+      epee::json_rpc::response<wallet_rpc::batch_transfer_status, epee::json_rpc::error> res = AUTO_VAL_INIT(res);
+      if (!epee::serialization::load_t_from_json(res, response.m_body))
+        return false;
+      result = res.result;
+      error = res.error;
+      return 0 == error.code;
+    }
+
+    wallet_rpc::COMMAND_RPC_BATCH_TRANSFER::request make_request(bool background)
+    {
+      wallet_rpc::COMMAND_RPC_BATCH_TRANSFER::request req = AUTO_VAL_INIT(req);
+      wallet_rpc::transfer_destination de = AUTO_VAL_INIT(de);
+      de.address = m_address;
+      de.amount = 1000;
+      req.destinations.push_back(de);
+      de.address = "invalid";
+      req.destinations.push_back(de);
+      de.address = m_address;
+      de.amount = 0;
+      req.destinations.push_back(de);
+      req.fee = 10;
+      req.background = background;
+      return req;
+    }
+
+    bool wait_for_job(uint64_t job_id, wallet_rpc::batch_transfer_status& status)
+    {
+      wallet_rpc::COMMAND_RPC_GET_BATCH_TRANSFER_STATUS::request req = AUTO_VAL_INIT(req);
+      req.job_id = job_id;
+      epee::json_rpc::error error = AUTO_VAL_INIT(error);
+      for (size_t i = 0; i < 1000; ++i)
+      {
+        if (!invoke("get_batch_transfer_status", req, status, error))
+          return false;
+        if (status.status != "queued" && status.status != "running")
+          return true;
+        boost::this_thread::sleep_for(boost::chrono::milliseconds(10));
+      }
+      return false;
+    }
+
+    // the wallet is empty: the valid destination fails with not enough money
+    void check_failed_job(const wallet_rpc::batch_transfer_status& status)
+    {
+      ASSERT_EQ("failed", status.status);
+      ASSERT_EQ("not enough money", status.error);
+      ASSERT_TRUE(status.tx_hash_list.empty());
+      ASSERT_EQ(3, status.results.size());
+      ASSERT_EQ("failed", status.results[0].status);
+      ASSERT_EQ("invalid", status.results[1].status);
+      ASSERT_EQ("Invalid address", status.results[1].error);
+      ASSERT_EQ("invalid", status.results[2].status);
+      ASSERT_EQ("Zero amount", status.results[2].error);
+    }
+
+    wallet2 m_wallet;
+    wallet_rpc_server m_server;
+    std::string m_address;
+  };
+}
+
+TEST_F(wallet_rpc_batch_transfer, runs_in_request)
+{
+  wallet_rpc::batch_transfer_status status;
+  epee::json_rpc::error error;
+  ASSERT_TRUE(invoke("batch_transfer", make_request(false), status, error));
+  ASSERT_EQ(0, status.job_id);
+  check_failed_job(status);
+}
+
+TEST_F(wallet_rpc_batch_transfer, runs_in_background)
+{
+  wallet_rpc::batch_transfer_status status;
+  epee::json_rpc::error error;
+  ASSERT_TRUE(invoke("batch_transfer", make_request(true), status, error));
+  ASSERT_NE(0, status.job_id);
+  ASSERT_EQ("queued", status.status);
+
+  ASSERT_TRUE(wait_for_job(status.job_id, status));
+  check_failed_job(status);
+}
+
+TEST_F(wallet_rpc_batch_transfer, runs_many_background_jobs)
+{
+  std::vector<uint64_t> job_ids;
+  for (size_t i = 0; i < 50; ++i)
+  {
+    wallet_rpc::batch_transfer_status status;
+    epee::json_rpc::error error;
+    if (invoke("batch_transfer", make_request(true), status, error))
+      job_ids.push_back(status.job_id);
+    else
+      ASSERT_EQ(WALLET_RPC_ERROR_CODE_WALLET_BUSY, error.code);
+    // jobs kept for get_batch_transfer_status are limited, check them before they are dropped
+    if (job_ids.size() == 4 || i + 1 == 50)
+    {
+      for (uint64_t job_id : job_ids)
+      {
+        ASSERT_TRUE(wait_for_job(job_id, status));
+        check_failed_job(status);
+      }
+      job_ids.clear();
+    }
+  }
+}
+
+TEST_F(wallet_rpc_batch_transfer, reports_unknown_job)
+{
+  wallet_rpc::COMMAND_RPC_GET_BATCH_TRANSFER_STATUS::request req = AUTO_VAL_INIT(req);
+  req.job_id = 12345;
+  wallet_rpc::batch_transfer_status status;
+  epee::json_rpc::error error;
+  ASSERT_FALSE(invoke("get_batch_transfer_status", req, status, error));
+  ASSERT_EQ(WALLET_RPC_ERROR_CODE_WRONG_JOB_ID, error.code);
+}